@@ -0,0 +1,239 @@
+#include "Bundle.h"
+#include "MappedFile.h"
+#include "CompiledGrammar.h"
+#include "LALRParseAlgorithm.h"
+#include <cstring>
+
+using namespace ParseParty;
+
+static const char bundleMagic[8] = { 'P', 'P', 'B', 'U', 'N', 'D', 'L', 'E' };
+
+//------------------------------- Bundle -------------------------------
+
+/*static*/ bool Bundle::IsBundleFile(const std::string& file)
+{
+	std::ifstream fileStream;
+	fileStream.open(file.c_str(), std::ios::in | std::ios::binary);
+	if (!fileStream.is_open())
+		return false;
+
+	char magic[sizeof(bundleMagic)];
+	if (!fileStream.read(magic, sizeof(magic)))
+		return false;
+
+	return ::memcmp(magic, bundleMagic, sizeof(magic)) == 0;
+}
+
+/*static*/ uint32_t Bundle::GetLayoutSignature()
+{
+	// Any change in the size of a bundled struct, or in byte order, changes the signature.
+	uint32_t sizeArray[] =
+	{
+		0x01020304,
+		(uint32_t)sizeof(CompiledGrammar::Rule),
+		(uint32_t)sizeof(CompiledGrammar::Sequence),
+		(uint32_t)sizeof(CompiledGrammar::Symbol),
+		(uint32_t)sizeof(CompiledGrammar::Terminal),
+		(uint32_t)sizeof(CompiledGrammar::Operator),
+		(uint32_t)sizeof(LALRParseTable::Action),
+		(uint32_t)sizeof(int),
+		(uint32_t)sizeof(uint64_t)
+	};
+
+	return CompiledGrammar::HashText((const char*)sizeArray, sizeof(sizeArray));
+}
+
+/*static*/ uint32_t Bundle::UpdateChecksum(uint32_t checksum, const char* data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		checksum ^= (uint8_t)data[i];
+		checksum *= 16777619u;
+	}
+
+	return checksum;
+}
+
+/*static*/ void Bundle::PackInt(std::string& buffer, int value)
+{
+	int32_t packedValue = value;
+	buffer.append((const char*)&packedValue, sizeof(packedValue));
+}
+
+/*static*/ void Bundle::PackString(std::string& buffer, const std::string& text)
+{
+	PackInt(buffer, (int)text.length());
+	buffer.append(text);
+}
+
+/*static*/ bool Bundle::UnpackInt(const char*& data, const char* dataEnd, int& value)
+{
+	int32_t packedValue = 0;
+	if (dataEnd - data < (signed)sizeof(packedValue))
+		return false;
+
+	::memcpy(&packedValue, data, sizeof(packedValue));
+	data += sizeof(packedValue);
+	value = packedValue;
+	return true;
+}
+
+/*static*/ bool Bundle::UnpackString(const char*& data, const char* dataEnd, std::string& text)
+{
+	int length = 0;
+	if (!UnpackInt(data, dataEnd, length) || length < 0 || dataEnd - data < length)
+		return false;
+
+	text.assign(data, length);
+	data += length;
+	return true;
+}
+
+//------------------------------- Bundle::Writer -------------------------------
+
+Bundle::Writer::Writer()
+{
+	this->sectionArray = new std::vector<Section>();
+	this->sectionData = new std::string();
+}
+
+/*virtual*/ Bundle::Writer::~Writer()
+{
+	delete this->sectionArray;
+	delete this->sectionData;
+}
+
+void Bundle::Writer::AddSection(SectionTag tag, const void* data, size_t size)
+{
+	// Offsets are relative to the section data for now, and get fixed up when we know how big the section table is.
+	Section section;
+	section.tag = (uint32_t)tag;
+	section.reserved = 0;
+	section.offset = this->sectionData->size();
+	section.size = size;
+	this->sectionArray->push_back(section);
+
+	this->sectionData->append((const char*)data, size);
+	while (this->sectionData->size() % 8 != 0)
+		this->sectionData->push_back('\0');
+}
+
+bool Bundle::Writer::WriteFile(const std::string& bundleFile, std::string& error) const
+{
+	Header header;
+	::memcpy(header.magic, bundleMagic, sizeof(header.magic));
+	header.version = PARSE_PARTY_BUNDLE_VERSION;
+	header.layoutSignature = GetLayoutSignature();
+	header.sectionCount = (uint32_t)this->sectionArray->size();
+
+	// Both of these are multiples of 8 bytes, so the sections stay aligned.
+	uint64_t dataOffset = sizeof(Header) + this->sectionArray->size() * sizeof(Section);
+
+	std::vector<Section> fixedSectionArray = *this->sectionArray;
+	for (Section& section : fixedSectionArray)
+		section.offset += dataOffset;
+
+	header.checksum = UpdateChecksum(2166136261u, (const char*)fixedSectionArray.data(), fixedSectionArray.size() * sizeof(Section));
+	header.checksum = UpdateChecksum(header.checksum, this->sectionData->data(), this->sectionData->size());
+
+	std::ofstream fileStream;
+	fileStream.open(bundleFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!fileStream.is_open())
+	{
+		error = "Failed to open file for writing: " + bundleFile;
+		return false;
+	}
+
+	fileStream.write((const char*)&header, sizeof(header));
+	fileStream.write((const char*)fixedSectionArray.data(), fixedSectionArray.size() * sizeof(Section));
+	fileStream.write(this->sectionData->data(), this->sectionData->size());
+	if (!fileStream.good())
+	{
+		error = "Failed to write file: " + bundleFile;
+		return false;
+	}
+
+	return true;
+}
+
+//------------------------------- Bundle::Reader -------------------------------
+
+Bundle::Reader::Reader()
+{
+	this->sectionArray = nullptr;
+	this->sectionCount = 0;
+}
+
+/*virtual*/ Bundle::Reader::~Reader()
+{
+}
+
+bool Bundle::Reader::ReadFile(const std::string& bundleFile, std::string& error)
+{
+	this->sectionArray = nullptr;
+	this->sectionCount = 0;
+	this->mappedFile = std::make_shared<MappedFile>();
+
+	if (!this->mappedFile->Open(bundleFile, error))
+	{
+		this->mappedFile.reset();
+		return false;
+	}
+
+	const char* data = this->mappedFile->GetData();
+	size_t size = this->mappedFile->GetSize();
+
+	const Header* header = (const Header*)data;
+	if (size < sizeof(Header) || ::memcmp(header->magic, bundleMagic, sizeof(header->magic)) != 0)
+		error = "Not a bundle file: " + bundleFile;
+	else if (header->version != PARSE_PARTY_BUNDLE_VERSION)
+		error = FormatString("Bundle is version %d, but we only read version %d.  It will need to be rebuilt.", header->version, PARSE_PARTY_BUNDLE_VERSION);
+	else if (header->layoutSignature != GetLayoutSignature())
+		error = "Bundle was written by a build of the library with a different data layout.  It will need to be rebuilt.";
+	else if ((size - sizeof(Header)) / sizeof(Section) < header->sectionCount)
+		error = "Bundle section table is truncated.";
+	else if (UpdateChecksum(2166136261u, data + sizeof(Header), size - sizeof(Header)) != header->checksum)
+		error = "Bundle is damaged; its checksum doesn't match.  It will need to be rebuilt.";
+	else
+	{
+		// Go by whether every section fits, not by the error string, which may come to us with something already in it.
+		const Section* sectionArray = (const Section*)(data + sizeof(Header));
+		bool sectionsFit = true;
+		for (int i = 0; i < (signed)header->sectionCount && sectionsFit; i++)
+			if (sectionArray[i].offset % 8 != 0 || sectionArray[i].offset > size || sectionArray[i].size > size - sectionArray[i].offset)
+				sectionsFit = false;
+
+		if (!sectionsFit)
+			error = "Bundle has a section that is misaligned or runs past the end of the file.";
+		else
+		{
+			this->sectionArray = sectionArray;
+			this->sectionCount = (int)header->sectionCount;
+			return true;
+		}
+	}
+
+	this->mappedFile.reset();
+	return false;
+}
+
+bool Bundle::Reader::HasSection(SectionTag tag) const
+{
+	size_t size = 0;
+	return this->GetSection(tag, size) != nullptr;
+}
+
+char* Bundle::Reader::GetSection(SectionTag tag, size_t& size) const
+{
+	for (int i = 0; i < this->sectionCount; i++)
+	{
+		if (this->sectionArray[i].tag == (uint32_t)tag)
+		{
+			size = (size_t)this->sectionArray[i].size;
+			return this->mappedFile->GetData() + this->sectionArray[i].offset;
+		}
+	}
+
+	size = 0;
+	return nullptr;
+}
\ No newline at end of file
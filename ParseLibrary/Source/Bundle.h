@@ -0,0 +1,141 @@
+#pragma once
+
+#include "Common.h"
+#include "FlatArray.h"
+#include "FormatString.h"
+
+// Bump this whenever the layout of any section changes, so that old bundles get rejected rather than misread.
+#define PARSE_PARTY_BUNDLE_VERSION		8
+
+namespace ParseParty
+{
+	class MappedFile;
+
+	// A bundle is a binary file holding a compiled grammar (along with its analysis and any parse tables
+	// built for it) and/or a lexicon, so that a process can get going without parsing any JSON or building
+	// any tables.  It's just a header, a table of sections, and the sections themselves, each aligned to
+	// 8 bytes.  The bigger sections are arrays of plain old data, written straight out of memory, which is
+	// what lets us map the file and then use those arrays right where they sit.  The catch is that a bundle
+	// is only good for the build of the library that wrote it (or one with the same struct layouts and byte
+	// order), which we check with a layout signature in the header.  The header also has a checksum of everything
+	// after it, so that a damaged bundle gets rejected up-front, rather than sending a parse off into the weeds.
+	class PARSE_PARTY_API Bundle
+	{
+	public:
+		enum class SectionTag : uint32_t
+		{
+			GRAMMAR_INFO = 1,
+			COMPILED_GRAMMAR_INFO,
+			RULES,
+			SEQUENCES,
+			SYMBOLS,
+			TERMINALS,
+			STRING_POOL,
+			LITERAL_TABLE,
+			RULE_FIRST_SETS,
+			SEQUENCE_FIRST_SETS,
+			RULE_FOLLOW_SETS,
+			LL1_SEQUENCE_TABLE,
+			LALR_INFO,
+			LALR_ACTION_OFFSETS,
+			LALR_ACTIONS,
+			LALR_GOTOS,
+			LEXICON,
+			RESTORE_PLANS,
+			OPERATORS,
+			SKIP_TERMINALS
+		};
+
+		struct Header
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t layoutSignature;
+			uint32_t sectionCount;
+			uint32_t checksum;
+		};
+
+		struct Section
+		{
+			uint32_t tag;
+			uint32_t reserved;
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		class PARSE_PARTY_API Writer
+		{
+		public:
+			Writer();
+			virtual ~Writer();
+
+			void AddSection(SectionTag tag, const void* data, size_t size);
+
+			template<typename T>
+			void AddArray(SectionTag tag, const FlatArray<T>& array)
+			{
+				this->AddSection(tag, array.data(), array.size() * sizeof(T));
+			}
+
+			bool WriteFile(const std::string& bundleFile, std::string& error) const;
+
+		private:
+
+			std::vector<Section>* sectionArray;
+			std::string* sectionData;
+		};
+
+		class PARSE_PARTY_API Reader
+		{
+		public:
+			Reader();
+			virtual ~Reader();
+
+			bool ReadFile(const std::string& bundleFile, std::string& error);
+
+			bool HasSection(SectionTag tag) const;
+
+			// The returned data lives in the mapped file, so it's only good for as long as the file is kept around.
+			char* GetSection(SectionTag tag, size_t& size) const;
+
+			template<typename T>
+			bool ViewArray(SectionTag tag, FlatArray<T>& array, std::string& error) const
+			{
+				size_t size = 0;
+				char* data = this->GetSection(tag, size);
+				if (!data || size % sizeof(T) != 0)
+				{
+					error = FormatString("Bundle section %d is missing or malformed.", (int)tag);
+					return false;
+				}
+
+				array.View((T*)data, size / sizeof(T));
+				return true;
+			}
+
+			// Anything looking into the bundle should hang on to this.
+			std::shared_ptr<MappedFile> GetMappedFile() const { return this->mappedFile; }
+
+		private:
+
+			std::shared_ptr<MappedFile> mappedFile;
+			const Section* sectionArray;
+			int sectionCount;
+		};
+
+		static bool IsBundleFile(const std::string& file);
+
+		// Small sections, such as the grammar info, are packed and unpacked a field at a time with these.
+		static void PackInt(std::string& buffer, int value);
+		static void PackString(std::string& buffer, const std::string& text);
+		static bool UnpackInt(const char*& data, const char* dataEnd, int& value);
+		static bool UnpackString(const char*& data, const char* dataEnd, std::string& text);
+
+	private:
+
+		static uint32_t GetLayoutSignature();
+
+		// This is 32-bit FNV-1a, which can be run over the payload a piece at a time.
+		static uint32_t UpdateChecksum(uint32_t checksum, const char* data, size_t size);
+	};
+}
\ No newline at end of file
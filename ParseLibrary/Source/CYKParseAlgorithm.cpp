@@ -0,0 +1,552 @@
+#include "CYKParseAlgorithm.h"
+
+using namespace ParseParty;
+
+// Below this many tokens, the chart is small enough that starting threads costs more than it saves.
+#define CYK_PARALLEL_TOKEN_COUNT		256
+#define CYK_MAX_THREAD_COUNT			8
+
+//------------------------------- CNFGrammar -------------------------------
+
+CNFGrammar::CNFGrammar()
+{
+	this->symbolArray = new std::vector<SymbolInfo>();
+	this->productionArray = new std::vector<Production>();
+	this->headProductionArray = new std::vector<std::vector<int>>();
+	this->terminalHeadArray = new std::vector<uint64_t>();
+	this->unitClosureArray = new std::vector<uint64_t>();
+	this->rightMaskArray = new std::vector<uint64_t>();
+	this->pairOffsetArray = new std::vector<int>();
+	this->pairRightArray = new std::vector<int>();
+	this->pairHeadArray = new std::vector<uint64_t>();
+	this->wordCount = 0;
+}
+
+/*virtual*/ CNFGrammar::~CNFGrammar()
+{
+	delete this->symbolArray;
+	delete this->productionArray;
+	delete this->headProductionArray;
+	delete this->terminalHeadArray;
+	delete this->unitClosureArray;
+	delete this->rightMaskArray;
+	delete this->pairOffsetArray;
+	delete this->pairRightArray;
+	delete this->pairHeadArray;
+}
+
+void CNFGrammar::Build(const CompiledGrammar* compiledGrammar)
+{
+	this->symbolArray->clear();
+	this->productionArray->clear();
+
+	for (int ruleID = 0; ruleID < compiledGrammar->GetRuleCount(); ruleID++)
+		this->AddSymbol(SymbolInfo::Type::RULE, ruleID, 0, compiledGrammar->GetRule(ruleID).nullable);
+
+	std::vector<int> terminalSymbolArray(compiledGrammar->GetTerminalCount(), -1);
+	std::vector<int> cnfSymbolArray;
+
+	for (int sequenceID = 0; sequenceID < compiledGrammar->GetSequenceCount(); sequenceID++)
+	{
+		const CompiledGrammar::Sequence& sequence = compiledGrammar->GetSequence(sequenceID);
+		const CompiledGrammar::Symbol* symbolArray = compiledGrammar->GetSymbols(sequence);
+
+		// Empty sequences don't go in the chart at all.  They're accounted for by the nullable flags.
+		if (sequence.symbolCount == 0)
+			continue;
+
+		if (sequence.symbolCount == 1)
+		{
+			if (symbolArray[0].type == CompiledGrammar::Symbol::Type::TERMINAL)
+				this->AddProduction(sequence.ruleID, -1, -1, symbolArray[0].id, -1, false);
+			else
+				this->AddProduction(sequence.ruleID, symbolArray[0].id, -1, -1, -1, false);
+
+			continue;
+		}
+
+		cnfSymbolArray.clear();
+		for (int i = 0; i < sequence.symbolCount; i++)
+		{
+			if (symbolArray[i].type == CompiledGrammar::Symbol::Type::NON_TERMINAL)
+				cnfSymbolArray.push_back(symbolArray[i].id);
+			else
+			{
+				int& terminalSymbol = terminalSymbolArray[symbolArray[i].id];
+				if (terminalSymbol < 0)
+				{
+					terminalSymbol = this->AddSymbol(SymbolInfo::Type::TERMINAL, symbolArray[i].id, 0, false);
+					this->AddProduction(terminalSymbol, -1, -1, symbolArray[i].id, -1, false);
+				}
+
+				cnfSymbolArray.push_back(terminalSymbol);
+			}
+		}
+
+		// A -> X1 X2 ... Xn becomes A -> X1 N2, N2 -> X2 N3, ..., Nn-1 -> Xn-1 Xn.
+		int head = sequence.ruleID;
+		for (int i = 0; i < sequence.symbolCount - 2; i++)
+		{
+			bool tailNullable = true;
+			for (int j = i + 1; j < sequence.symbolCount && tailNullable; j++)
+				tailNullable = (*this->symbolArray)[cnfSymbolArray[j]].nullable;
+
+			int tail = this->AddSymbol(SymbolInfo::Type::TAIL, sequenceID, i + 1, tailNullable);
+			this->AddBinaryProduction(head, cnfSymbolArray[i], tail);
+			head = tail;
+		}
+
+		this->AddBinaryProduction(head, cnfSymbolArray[sequence.symbolCount - 2], cnfSymbolArray[sequence.symbolCount - 1]);
+	}
+
+	int symbolCount = (int)this->symbolArray->size();
+	this->wordCount = (symbolCount + 63) / 64;
+
+	this->headProductionArray->clear();
+	this->headProductionArray->resize(symbolCount);
+	for (int i = 0; i < (int)this->productionArray->size(); i++)
+		(*this->headProductionArray)[(*this->productionArray)[i].head].push_back(i);
+
+	this->terminalHeadArray->assign(size_t(compiledGrammar->GetTerminalCount()) * this->wordCount, 0);
+	for (const Production& production : *this->productionArray)
+		if (production.terminalID >= 0)
+			this->terminalHeadArray->data()[production.terminalID * this->wordCount + (production.head >> 6)] |= uint64_t(1) << (production.head & 63);
+
+	// The unit closure of B is every symbol A such that A =>* B using unit productions alone, B included.
+	this->unitClosureArray->assign(size_t(symbolCount) * this->wordCount, 0);
+	for (int symbol = 0; symbol < symbolCount; symbol++)
+		this->unitClosureArray->data()[symbol * this->wordCount + (symbol >> 6)] |= uint64_t(1) << (symbol & 63);
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (const Production& production : *this->productionArray)
+		{
+			if (production.terminalID >= 0 || production.right >= 0)
+				continue;
+
+			uint64_t* closureSet = this->unitClosureArray->data() + production.left * this->wordCount;
+			const uint64_t* headClosureSet = this->unitClosureArray->data() + production.head * this->wordCount;
+			for (int i = 0; i < this->wordCount; i++)
+			{
+				if ((closureSet[i] | headClosureSet[i]) != closureSet[i])
+				{
+					closureSet[i] |= headClosureSet[i];
+					changed = true;
+				}
+			}
+		}
+	}
+
+	// Group the binary productions by left symbol, then by right symbol.
+	std::vector<std::tuple<int, int, int>> binaryArray;
+	for (const Production& production : *this->productionArray)
+		if (production.right >= 0)
+			binaryArray.push_back(std::tuple<int, int, int>(production.left, production.right, production.head));
+
+	std::sort(binaryArray.begin(), binaryArray.end());
+
+	this->rightMaskArray->assign(size_t(symbolCount) * this->wordCount, 0);
+	this->pairOffsetArray->assign(symbolCount + 1, 0);
+	this->pairRightArray->clear();
+	this->pairHeadArray->clear();
+
+	int i = 0;
+	for (int symbol = 0; symbol < symbolCount; symbol++)
+	{
+		(*this->pairOffsetArray)[symbol] = (int)this->pairRightArray->size();
+
+		while (i < (int)binaryArray.size() && std::get<0>(binaryArray[i]) == symbol)
+		{
+			int right = std::get<1>(binaryArray[i]);
+			this->rightMaskArray->data()[symbol * this->wordCount + (right >> 6)] |= uint64_t(1) << (right & 63);
+
+			int pair = (int)this->pairRightArray->size();
+			this->pairRightArray->push_back(right);
+			this->pairHeadArray->resize(this->pairHeadArray->size() + this->wordCount, 0);
+
+			for (; i < (int)binaryArray.size() && std::get<0>(binaryArray[i]) == symbol && std::get<1>(binaryArray[i]) == right; i++)
+			{
+				int head = std::get<2>(binaryArray[i]);
+				this->pairHeadArray->data()[pair * this->wordCount + (head >> 6)] |= uint64_t(1) << (head & 63);
+			}
+		}
+	}
+
+	(*this->pairOffsetArray)[symbolCount] = (int)this->pairRightArray->size();
+}
+
+int CNFGrammar::AddSymbol(SymbolInfo::Type type, int id, int firstSymbol, bool nullable)
+{
+	this->symbolArray->push_back(SymbolInfo{ type, id, firstSymbol, nullable });
+	return (int)this->symbolArray->size() - 1;
+}
+
+void CNFGrammar::AddProduction(int head, int left, int right, int terminalID, int nulledSymbol, bool nulledFirst)
+{
+	// A -> A never derives anything new.
+	if (terminalID < 0 && right < 0 && left == head)
+		return;
+
+	this->productionArray->push_back(Production{ head, left, right, terminalID, nulledSymbol, nulledFirst });
+}
+
+void CNFGrammar::AddBinaryProduction(int head, int left, int right)
+{
+	this->AddProduction(head, left, right, -1, -1, false);
+
+	// The chart only holds non-empty spans, so if either side can be empty, the other side can derive the whole span by itself.
+	if ((*this->symbolArray)[left].nullable)
+		this->AddProduction(head, right, -1, -1, left, true);
+
+	if ((*this->symbolArray)[right].nullable)
+		this->AddProduction(head, left, -1, -1, right, false);
+}
+
+//------------------------------- CYKParseAlgorithm -------------------------------
+
+CYKParseAlgorithm::CYKParseAlgorithm(const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray, const Grammar* grammar) : Algorithm(tokenArray, grammar)
+{
+	this->cnfGrammar = nullptr;
+	this->tokenCount = 0;
+	this->chart = new std::vector<uint64_t>();
+	this->diagonalOffsetArray = new std::vector<int>();
+	this->visitedArray = new std::vector<int>();
+	this->searchQueue = new std::vector<std::pair<int, int>>();
+	this->visitStamp = 0;
+}
+
+/*virtual*/ CYKParseAlgorithm::~CYKParseAlgorithm()
+{
+	delete this->chart;
+	delete this->diagonalOffsetArray;
+	delete this->visitedArray;
+	delete this->searchQueue;
+}
+
+/*virtual*/ Parser::SyntaxNode* CYKParseAlgorithm::Parse()
+{
+	int initialRuleID = this->compiledGrammar->GetInitialRuleID();
+	if (initialRuleID < 0)
+		return nullptr;
+
+	this->tokenCount = (int)this->tokenArray->size();
+	if (this->tokenCount == 0)
+		return nullptr;
+
+	this->cnfGrammar = this->compiledGrammar->GetCNFGrammar();
+
+	this->diagonalOffsetArray->assign(this->tokenCount + 2, 0);
+	for (int length = 1; length <= this->tokenCount; length++)
+		(*this->diagonalOffsetArray)[length + 1] = (*this->diagonalOffsetArray)[length] + this->tokenCount - length + 1;
+
+	this->chart->assign(size_t((*this->diagonalOffsetArray)[this->tokenCount + 1]) * this->cnfGrammar->GetWordCount(), 0);
+
+	int threadCount = 1;
+	if (this->tokenCount >= CYK_PARALLEL_TOKEN_COUNT)
+		threadCount = std::clamp((int)std::thread::hardware_concurrency(), 1, CYK_MAX_THREAD_COUNT);
+
+	// Every thread takes its own share of each diagonal, and nobody moves on to the next diagonal until all are done with this one.
+	std::barrier<> diagonalBarrier(threadCount);
+	std::vector<std::thread> threadArray;
+	for (int i = 1; i < threadCount; i++)
+		threadArray.push_back(std::thread(&CYKParseAlgorithm::FillDiagonals, this, i, threadCount, &diagonalBarrier));
+
+	this->FillDiagonals(0, threadCount, &diagonalBarrier);
+
+	for (std::thread& thread : threadArray)
+		thread.join();
+
+	if (!this->CellContains(0, this->tokenCount, initialRuleID))
+	{
+		const Lexer::FileLocation& fileLocation = (*this->tokenArray)[0]->fileLocation;
+		*this->error = FormatString("Failed to parse at line %d, column %d: the input does not derive from rule \"%s\".", fileLocation.line, fileLocation.column, this->compiledGrammar->GetRuleName(initialRuleID));
+		return nullptr;
+	}
+
+	this->visitedArray->assign(this->cnfGrammar->GetSymbolCount(), 0);
+	this->visitStamp = 0;
+
+	return this->BuildNode(initialRuleID, 0, this->tokenCount);
+}
+
+void CYKParseAlgorithm::FillDiagonals(int threadNumber, int threadCount, std::barrier<>* diagonalBarrier)
+{
+	std::vector<uint64_t> directSet(this->cnfGrammar->GetWordCount());
+
+	for (int length = 1; length <= this->tokenCount; length++)
+	{
+		// Give each thread a contiguous run of cells so that no two threads write to the same cache line much.
+		int cellCount = this->tokenCount - length + 1;
+		int chunkSize = (cellCount + threadCount - 1) / threadCount;
+		int firstStart = threadNumber * chunkSize;
+		int lastStart = std::min(firstStart + chunkSize, cellCount);
+
+		for (int start = firstStart; start < lastStart; start++)
+			this->FillCell(start, length, directSet.data());
+
+		if (threadCount > 1)
+			diagonalBarrier->arrive_and_wait();
+	}
+}
+
+void CYKParseAlgorithm::FillCell(int start, int length, uint64_t* directSet)
+{
+	int wordCount = this->cnfGrammar->GetWordCount();
+	std::fill(directSet, directSet + wordCount, 0);
+
+	if (length == 1)
+	{
+		const Lexer::Token* token = (*this->tokenArray)[start].get();
+		int tokenLiteral = (*this->tokenLiteralArray)[start];
+
+		if (tokenLiteral >= 0)
+		{
+			const uint64_t* headSet = this->cnfGrammar->GetTerminalHeads(tokenLiteral);
+			for (int i = 0; i < wordCount; i++)
+				directSet[i] |= headSet[i];
+		}
+
+		for (int terminalID : this->compiledGrammar->GetTokenTypeTerminals(token->type))
+		{
+			const uint64_t* headSet = this->cnfGrammar->GetTerminalHeads(terminalID);
+			for (int i = 0; i < wordCount; i++)
+				directSet[i] |= headSet[i];
+		}
+	}
+	else
+	{
+		for (int split = 1; split < length; split++)
+		{
+			const uint64_t* leftCell = this->GetCell(start, split);
+			const uint64_t* rightCell = this->GetCell(start + split, length - split);
+
+			for (int i = 0; i < wordCount; i++)
+			{
+				uint64_t bits = leftCell[i];
+				while (bits)
+				{
+					int left = i * 64 + std::countr_zero(bits);
+					bits &= bits - 1;
+
+					// Most of the time, nothing on the right can follow this symbol, and one AND per word tells us so.
+					const uint64_t* rightMask = this->cnfGrammar->GetRightMask(left);
+					int j;
+					for (j = 0; j < wordCount; j++)
+						if (rightCell[j] & rightMask[j])
+							break;
+
+					if (j == wordCount)
+						continue;
+
+					for (int pair = this->cnfGrammar->GetPairOffset(left); pair < this->cnfGrammar->GetPairOffset(left + 1); pair++)
+					{
+						int right = this->cnfGrammar->GetPairRight(pair);
+						if ((rightCell[right >> 6] & (uint64_t(1) << (right & 63))) == 0)
+							continue;
+
+						const uint64_t* headSet = this->cnfGrammar->GetPairHeads(pair);
+						for (int k = 0; k < wordCount; k++)
+							directSet[k] |= headSet[k];
+					}
+				}
+			}
+		}
+	}
+
+	// Lastly, anything that derives what we found by unit productions derives the span too.
+	uint64_t* cell = this->GetCell(start, length);
+	for (int i = 0; i < wordCount; i++)
+	{
+		uint64_t bits = directSet[i];
+		while (bits)
+		{
+			int symbol = i * 64 + std::countr_zero(bits);
+			bits &= bits - 1;
+
+			const uint64_t* closureSet = this->cnfGrammar->GetUnitClosure(symbol);
+			for (int j = 0; j < wordCount; j++)
+				cell[j] |= closureSet[j];
+		}
+	}
+}
+
+// Find a production by which the given symbol derives the given span.  The chart tells us what derives
+// what, but not how, so we have to look.  Binary and terminal productions can be checked directly, but
+// unit productions can go around in circles, so we search those breadth-first for the nearest symbol that
+// derives the span directly, and take the first step in that direction.  Following this all the way down
+// always gets closer to a direct derivation, so it always gets there.
+int CYKParseAlgorithm::ChooseProduction(int symbol, int start, int length, int& split)
+{
+	int productionID = this->ChooseDirectProduction(symbol, start, length, split);
+	if (productionID >= 0)
+		return productionID;
+
+	this->visitStamp++;
+	(*this->visitedArray)[symbol] = this->visitStamp;
+	this->searchQueue->clear();
+	this->searchQueue->push_back(std::pair<int, int>(symbol, -1));
+
+	for (int i = 0; i < (int)this->searchQueue->size(); i++)
+	{
+		std::pair<int, int> entry = (*this->searchQueue)[i];
+		if (i > 0 && this->ChooseDirectProduction(entry.first, start, length, split) >= 0)
+			return entry.second;
+
+		for (int unitProductionID : this->cnfGrammar->GetHeadProductions(entry.first))
+		{
+			const CNFGrammar::Production& production = this->cnfGrammar->GetProduction(unitProductionID);
+			if (production.terminalID >= 0 || production.right >= 0)
+				continue;
+
+			if ((*this->visitedArray)[production.left] == this->visitStamp || !this->CellContains(start, length, production.left))
+				continue;
+
+			(*this->visitedArray)[production.left] = this->visitStamp;
+			this->searchQueue->push_back(std::pair<int, int>(production.left, (i == 0) ? unitProductionID : entry.second));
+		}
+	}
+
+	return -1;
+}
+
+int CYKParseAlgorithm::ChooseDirectProduction(int symbol, int start, int length, int& split)
+{
+	for (int productionID : this->cnfGrammar->GetHeadProductions(symbol))
+	{
+		const CNFGrammar::Production& production = this->cnfGrammar->GetProduction(productionID);
+
+		if (production.terminalID >= 0)
+		{
+			if (length == 1 && this->TokenMatches(start, production.terminalID))
+				return productionID;
+		}
+		else if (production.right >= 0)
+		{
+			for (int i = 1; i < length; i++)
+			{
+				if (this->CellContains(start, i, production.left) && this->CellContains(start + i, length - i, production.right))
+				{
+					split = i;
+					return productionID;
+				}
+			}
+		}
+	}
+
+	return -1;
+}
+
+Parser::SyntaxNode* CYKParseAlgorithm::BuildNode(int ruleID, int start, int length)
+{
+	Parser::SyntaxNode* node = new Parser::SyntaxNode(this->compiledGrammar->GetRuleName(ruleID), this->GetLocation(start));
+	this->ExpandBody(ruleID, start, length, node);
+	return node;
+}
+
+// Add to the given node the children that the given symbol contributes over the given span.
+void CYKParseAlgorithm::ExpandBody(int symbol, int start, int length, Parser::SyntaxNode* node)
+{
+	int split = 0;
+	int productionID = this->ChooseProduction(symbol, start, length, split);
+	assert(productionID >= 0);
+	if (productionID < 0)
+		return;
+
+	const CNFGrammar::Production& production = this->cnfGrammar->GetProduction(productionID);
+
+	if (production.terminalID >= 0)
+	{
+		const Lexer::Token* token = (*this->tokenArray)[start].get();
+		this->AppendChild(node, new Parser::SyntaxNode(*token->text, token->fileLocation));
+	}
+	else if (production.right >= 0)
+	{
+		this->ExpandSymbol(production.left, start, split, node);
+		this->ExpandSymbol(production.right, start + split, length - split, node);
+	}
+	else if (production.nulledSymbol >= 0 && production.nulledFirst)
+	{
+		this->ExpandNulledSymbol(production.nulledSymbol, start, node);
+		this->ExpandSymbol(production.left, start, length, node);
+	}
+	else
+	{
+		this->ExpandSymbol(production.left, start, length, node);
+		if (production.nulledSymbol >= 0)
+			this->ExpandNulledSymbol(production.nulledSymbol, start + length, node);
+	}
+}
+
+void CYKParseAlgorithm::ExpandSymbol(int symbol, int start, int length, Parser::SyntaxNode* parentNode)
+{
+	// Rules get a node of their own, but the symbols we made up in the conversion are spliced into their parent.  So is
+	// the R of "R -> X R" for a repetition R, so that all the items go into the one node.
+	const CNFGrammar::SymbolInfo& symbolInfo = this->cnfGrammar->GetSymbol(symbol);
+	bool ownNode = (symbolInfo.type == CNFGrammar::SymbolInfo::Type::RULE);
+	if (ownNode && this->compiledGrammar->GetRule(symbolInfo.id).repeats && *parentNode->text == this->compiledGrammar->GetRuleName(symbolInfo.id))
+		ownNode = false;
+
+	if (ownNode)
+		this->AppendChild(parentNode, this->BuildNode(symbol, start, length));
+	else
+		this->ExpandBody(symbol, start, length, parentNode);
+}
+
+void CYKParseAlgorithm::ExpandNulledSymbol(int symbol, int start, Parser::SyntaxNode* parentNode)
+{
+	const CNFGrammar::SymbolInfo& symbolInfo = this->cnfGrammar->GetSymbol(symbol);
+
+	switch (symbolInfo.type)
+	{
+		case CNFGrammar::SymbolInfo::Type::RULE:
+		{
+			this->AppendChild(parentNode, this->BuildNulledNode(symbolInfo.id, start));
+			break;
+		}
+		case CNFGrammar::SymbolInfo::Type::TAIL:
+		{
+			// A nullable tail is nothing but nullable rules.
+			const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(symbolInfo.id);
+			const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+			for (int i = symbolInfo.firstSymbol; i < sequence.symbolCount; i++)
+				this->AppendChild(parentNode, this->BuildNulledNode(symbolArray[i].id, start));
+			break;
+		}
+		case CNFGrammar::SymbolInfo::Type::TERMINAL:
+		{
+			// Terminals are never nullable.
+			assert(false);
+			break;
+		}
+	}
+}
+
+Parser::SyntaxNode* CYKParseAlgorithm::BuildNulledNode(int ruleID, int start)
+{
+	Parser::SyntaxNode* node = new Parser::SyntaxNode(this->compiledGrammar->GetRuleName(ruleID), this->GetLocation(start));
+
+	int sequenceID = this->compiledGrammar->GetRule(ruleID).nullSequence;
+	if (sequenceID >= 0)
+	{
+		const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+		const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+		for (int i = 0; i < sequence.symbolCount; i++)
+			this->AppendChild(node, this->BuildNulledNode(symbolArray[i].id, start));
+	}
+
+	return node;
+}
+
+void CYKParseAlgorithm::AppendChild(Parser::SyntaxNode* parentNode, Parser::SyntaxNode* childNode)
+{
+	parentNode->childList->push_back(childNode);
+	childNode->parentNode = parentNode;
+}
+
+const Lexer::FileLocation& CYKParseAlgorithm::GetLocation(int start) const
+{
+	return (*this->tokenArray)[std::min(start, this->tokenCount - 1)]->fileLocation;
+}
\ No newline at end of file
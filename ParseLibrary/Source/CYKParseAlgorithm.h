@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Parser.h"
+
+namespace ParseParty
+{
+	// This is a grammar in Chomsky normal form, derived from a compiled grammar.  Every production is
+	// either A -> t, A -> B C, or A -> B.  (Strictly speaking, unit productions aren't allowed in CNF,
+	// but they're much cheaper to deal with as a closure on each chart cell than to eliminate.)  Long
+	// sequences get split up using synthetic "tail" symbols, terminals in long sequences get wrapped by
+	// synthetic symbols, and nullable symbols are dealt with by adding a unit production that skips them.
+	// Each production remembers enough about where it came from that we can rebuild the original tree.
+	class PARSE_PARTY_API CNFGrammar
+	{
+	public:
+		CNFGrammar();
+		virtual ~CNFGrammar();
+
+		void Build(const CompiledGrammar* compiledGrammar);
+
+		struct SymbolInfo
+		{
+			enum class Type : uint8_t
+			{
+				RULE,		// One of the rules of the original grammar.  These come first, so that symbol IDs and rule IDs agree.
+				TERMINAL,		// A wrapper around a terminal.
+				TAIL		// The tail end of an original sequence.
+			};
+
+			Type type;
+			int id;		// The rule, terminal or sequence ID, depending on the type.
+			int firstSymbol;		// For tails, the position in the original sequence where the tail begins.
+			bool nullable;
+		};
+
+		struct Production
+		{
+			int head;
+			int left;		// For unit productions, this is the only symbol on the right.
+			int right;		// This is -1 for unit and terminal productions.
+			int terminalID;		// This is -1 unless it's a terminal production.
+			int nulledSymbol;		// For unit productions made by skipping a nullable symbol, this is that symbol, otherwise -1.
+			bool nulledFirst;		// Did the skipped symbol come before the other one?
+		};
+
+		int GetSymbolCount() const { return (int)this->symbolArray->size(); }
+		int GetWordCount() const { return this->wordCount; }
+		const SymbolInfo& GetSymbol(int symbol) const { return (*this->symbolArray)[symbol]; }
+		const Production& GetProduction(int production) const { return (*this->productionArray)[production]; }
+		const std::vector<int>& GetHeadProductions(int symbol) const { return (*this->headProductionArray)[symbol]; }
+
+		// These are bit-sets over symbols, each GetWordCount() words long.
+		const uint64_t* GetTerminalHeads(int terminalID) const { return this->terminalHeadArray->data() + terminalID * this->wordCount; }
+		const uint64_t* GetUnitClosure(int symbol) const { return this->unitClosureArray->data() + symbol * this->wordCount; }
+		const uint64_t* GetRightMask(int symbol) const { return this->rightMaskArray->data() + symbol * this->wordCount; }
+
+		// For each symbol B, the binary productions with B on the left are grouped by the symbol C on the
+		// right, and for each such pair, there is a bit-set of all heads A with A -> B C.
+		int GetPairOffset(int symbol) const { return (*this->pairOffsetArray)[symbol]; }
+		int GetPairRight(int pair) const { return (*this->pairRightArray)[pair]; }
+		const uint64_t* GetPairHeads(int pair) const { return this->pairHeadArray->data() + pair * this->wordCount; }
+
+	private:
+
+		int AddSymbol(SymbolInfo::Type type, int id, int firstSymbol, bool nullable);
+		void AddProduction(int head, int left, int right, int terminalID, int nulledSymbol, bool nulledFirst);
+		void AddBinaryProduction(int head, int left, int right);
+
+		std::vector<SymbolInfo>* symbolArray;
+		std::vector<Production>* productionArray;
+		std::vector<std::vector<int>>* headProductionArray;
+		std::vector<uint64_t>* terminalHeadArray;
+		std::vector<uint64_t>* unitClosureArray;
+		std::vector<uint64_t>* rightMaskArray;
+		std::vector<int>* pairOffsetArray;
+		std::vector<int>* pairRightArray;
+		std::vector<uint64_t>* pairHeadArray;
+		int wordCount;
+	};
+
+	// This is the Cocke-Younger-Kasami algorithm.  It fills out a triangular chart where each cell
+	// is the set of symbols deriving a given span of tokens, and each cell is a bit-set, so that
+	// combining two cells comes down to ANDs and ORs over whole machine words.  All the cells for
+	// spans of the same length are independent of one another, so we fill each of those diagonals
+	// in parallel across several threads.  Cost is cubic in the number of tokens no matter what, but
+	// it doesn't care how ambiguous the grammar is, which makes it a good baseline for the others.
+	class CYKParseAlgorithm : public Parser::Algorithm
+	{
+	public:
+		CYKParseAlgorithm(const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray, const Grammar* grammar);
+		virtual ~CYKParseAlgorithm();
+
+		virtual Parser::SyntaxNode* Parse() override;
+
+	private:
+
+		uint64_t* GetCell(int start, int length)
+		{
+			return this->chart->data() + size_t((*this->diagonalOffsetArray)[length] + start) * this->cnfGrammar->GetWordCount();
+		}
+
+		bool CellContains(int start, int length, int symbol)
+		{
+			return (this->GetCell(start, length)[symbol >> 6] & (uint64_t(1) << (symbol & 63))) != 0;
+		}
+
+		void FillDiagonals(int threadNumber, int threadCount, std::barrier<>* diagonalBarrier);
+		void FillCell(int start, int length, uint64_t* directSet);
+
+		int ChooseProduction(int symbol, int start, int length, int& split);
+		int ChooseDirectProduction(int symbol, int start, int length, int& split);
+		Parser::SyntaxNode* BuildNode(int ruleID, int start, int length);
+		void ExpandBody(int symbol, int start, int length, Parser::SyntaxNode* node);
+		void ExpandSymbol(int symbol, int start, int length, Parser::SyntaxNode* parentNode);
+		void ExpandNulledSymbol(int symbol, int start, Parser::SyntaxNode* parentNode);
+		Parser::SyntaxNode* BuildNulledNode(int ruleID, int start);
+		void AppendChild(Parser::SyntaxNode* parentNode, Parser::SyntaxNode* childNode);
+		const Lexer::FileLocation& GetLocation(int start) const;
+
+		const CNFGrammar* cnfGrammar;
+		int tokenCount;
+		std::vector<uint64_t>* chart;		// The cells, one diagonal (span length) after another, each GetWordCount() words long.
+		std::vector<int>* diagonalOffsetArray;		// Index this by span length to get the index of the first cell of that length.
+		std::vector<int>* visitedArray;
+		std::vector<std::pair<int, int>>* searchQueue;		// (symbol, first production taken) pairs for the breadth-first search over unit productions.
+		int visitStamp;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,664 @@
+#include "CharacterScanner.h"
+#include "CompiledGrammar.h"
+#include "FormatString.h"
+#include <cstring>
+
+using namespace ParseParty;
+
+// Patterns for terminals are small, so a DFA this big means the pattern is not what was meant.
+#define CHARACTER_PATTERN_MAX_STATES		4096
+
+// Past this many bytes, text made up for a pattern heads for the nearest place it can stop.
+#define CHARACTER_PATTERN_GENERATE_LENGTH	12
+
+// Patterns are first parsed into an NFA, in the manner of Thompson, and the NFA then made into a DFA by the subset construction.
+// A state either takes a byte from its set to its first out-state, or goes to either of its out-states on nothing.
+struct PatternState
+{
+	uint64_t byteSet[4];
+	bool consumes;
+	int out[2];
+};
+
+// The end of a fragment is always a state going nowhere yet, for the next fragment to be joined onto.
+struct PatternFragment
+{
+	int start;
+	int end;
+};
+
+static bool ParsePatternAlternation(const char*& cursor, std::vector<PatternState>& stateArray, PatternFragment& fragment, std::string& error);
+
+static int AddPatternState(std::vector<PatternState>& stateArray, bool consumes, int out0 = -1, int out1 = -1)
+{
+	stateArray.push_back(PatternState{ { 0, 0, 0, 0 }, consumes, { out0, out1 } });
+	return (int)stateArray.size() - 1;
+}
+
+static void AddByteRange(uint64_t* byteSet, int firstByte, int lastByte)
+{
+	for (int byte = firstByte; byte <= lastByte; byte++)
+		byteSet[byte >> 6] |= uint64_t(1) << (byte & 63);
+}
+
+static uint8_t EscapedByte(char ch)
+{
+	switch (ch)
+	{
+		case 'n': return '\n';
+		case 'r': return '\r';
+		case 't': return '\t';
+	}
+
+	return (uint8_t)ch;
+}
+
+// This adds the bytes the escape at the cursor (just after the backslash) stands for to the given set.
+static void ParsePatternEscape(const char*& cursor, uint64_t* byteSet)
+{
+	uint64_t classSet[4] = { 0, 0, 0, 0 };
+	bool complement = false;
+	char ch = *cursor++;
+
+	switch (ch)
+	{
+		case 'D': complement = true;		// Fall through...
+		case 'd': AddByteRange(classSet, '0', '9'); break;
+		case 'W': complement = true;		// Fall through...
+		case 'w': AddByteRange(classSet, 'a', 'z'); AddByteRange(classSet, 'A', 'Z'); AddByteRange(classSet, '0', '9'); AddByteRange(classSet, '_', '_'); break;
+		case 'S': complement = true;		// Fall through...
+		case 's': AddByteRange(classSet, ' ', ' '); AddByteRange(classSet, '\t', '\r'); break;
+		default: AddByteRange(classSet, EscapedByte(ch), EscapedByte(ch)); break;
+	}
+
+	for (int i = 0; i < 4; i++)
+		byteSet[i] |= complement ? ~classSet[i] : classSet[i];
+}
+
+static bool ParsePatternClass(const char*& cursor, uint64_t* byteSet, std::string& error)
+{
+	uint64_t classSet[4] = { 0, 0, 0, 0 };
+	bool complement = (*cursor == '^');
+	if (complement)
+		cursor++;
+
+	// A "]" right at the start is just a "]".
+	bool first = true;
+	while (*cursor != ']' || first)
+	{
+		first = false;
+
+		if (*cursor == '\0' || (*cursor == '\\' && cursor[1] == '\0'))
+		{
+			error = "Character class is missing its closing \"]\".";
+			return false;
+		}
+
+		// Escapes like "\d" stand for sets of their own, which can't be the ends of a range.
+		if (*cursor == '\\' && ::strchr("dDwWsS", cursor[1]))
+		{
+			cursor++;
+			ParsePatternEscape(cursor, classSet);
+			continue;
+		}
+
+		uint8_t firstByte = (*cursor == '\\') ? EscapedByte(*++cursor) : (uint8_t)*cursor;
+		cursor++;
+
+		uint8_t lastByte = firstByte;
+		if (cursor[0] == '-' && cursor[1] != ']' && cursor[1] != '\0' && !(cursor[1] == '\\' && cursor[2] == '\0'))
+		{
+			cursor++;
+			lastByte = (*cursor == '\\') ? EscapedByte(*++cursor) : (uint8_t)*cursor;
+			cursor++;
+
+			if (lastByte < firstByte)
+			{
+				error = "Character class has a range going backwards.";
+				return false;
+			}
+		}
+
+		AddByteRange(classSet, firstByte, lastByte);
+	}
+
+	cursor++;
+
+	for (int i = 0; i < 4; i++)
+		byteSet[i] |= complement ? ~classSet[i] : classSet[i];
+
+	return true;
+}
+
+static bool ParsePatternAtom(const char*& cursor, std::vector<PatternState>& stateArray, PatternFragment& fragment, std::string& error)
+{
+	if (*cursor == '(')
+	{
+		cursor++;
+		if (!ParsePatternAlternation(cursor, stateArray, fragment, error))
+			return false;
+
+		if (*cursor != ')')
+		{
+			error = "Group is missing its closing \")\".";
+			return false;
+		}
+
+		cursor++;
+		return true;
+	}
+
+	if (*cursor == '*' || *cursor == '+' || *cursor == '?')
+	{
+		error = FormatString("Nothing for \"%c\" to repeat.", *cursor);
+		return false;
+	}
+
+	uint64_t byteSet[4] = { 0, 0, 0, 0 };
+	char ch = *cursor++;
+	if (ch == '[')
+	{
+		if (!ParsePatternClass(cursor, byteSet, error))
+			return false;
+	}
+	else if (ch == '.')
+	{
+		AddByteRange(byteSet, 0, 255);
+		byteSet['\n' >> 6] &= ~(uint64_t(1) << ('\n' & 63));
+	}
+	else if (ch == '\\')
+	{
+		if (*cursor == '\0')
+		{
+			error = "Pattern ends in a backslash.";
+			return false;
+		}
+
+		ParsePatternEscape(cursor, byteSet);
+	}
+	else
+		AddByteRange(byteSet, (uint8_t)ch, (uint8_t)ch);
+
+	fragment.end = AddPatternState(stateArray, false);
+	fragment.start = AddPatternState(stateArray, true, fragment.end);
+	::memcpy(stateArray[fragment.start].byteSet, byteSet, sizeof(byteSet));
+	return true;
+}
+
+static bool ParsePatternRepetition(const char*& cursor, std::vector<PatternState>& stateArray, PatternFragment& fragment, std::string& error)
+{
+	if (!ParsePatternAtom(cursor, stateArray, fragment, error))
+		return false;
+
+	while (*cursor == '*' || *cursor == '+' || *cursor == '?')
+	{
+		char quantifier = *cursor++;
+		int endState = AddPatternState(stateArray, false);
+		int splitState = AddPatternState(stateArray, false, fragment.start, endState);
+
+		if (quantifier == '?')
+			stateArray[fragment.end].out[0] = endState;
+		else
+			stateArray[fragment.end].out[0] = splitState;
+
+		if (quantifier != '+')
+			fragment.start = splitState;
+
+		fragment.end = endState;
+	}
+
+	return true;
+}
+
+static bool ParsePatternConcatenation(const char*& cursor, std::vector<PatternState>& stateArray, PatternFragment& fragment, std::string& error)
+{
+	fragment.start = AddPatternState(stateArray, false);
+	fragment.end = fragment.start;
+
+	while (*cursor != '\0' && *cursor != '|' && *cursor != ')')
+	{
+		PatternFragment nextFragment;
+		if (!ParsePatternRepetition(cursor, stateArray, nextFragment, error))
+			return false;
+
+		stateArray[fragment.end].out[0] = nextFragment.start;
+		fragment.end = nextFragment.end;
+	}
+
+	return true;
+}
+
+static bool ParsePatternAlternation(const char*& cursor, std::vector<PatternState>& stateArray, PatternFragment& fragment, std::string& error)
+{
+	if (!ParsePatternConcatenation(cursor, stateArray, fragment, error))
+		return false;
+
+	while (*cursor == '|')
+	{
+		cursor++;
+
+		PatternFragment otherFragment;
+		if (!ParsePatternConcatenation(cursor, stateArray, otherFragment, error))
+			return false;
+
+		int endState = AddPatternState(stateArray, false);
+		int splitState = AddPatternState(stateArray, false, fragment.start, otherFragment.start);
+		stateArray[fragment.end].out[0] = endState;
+		stateArray[otherFragment.end].out[0] = endState;
+		fragment.start = splitState;
+		fragment.end = endState;
+	}
+
+	return true;
+}
+
+// Add the given state to the given set, along with every state we can get to from it on nothing.  Only the
+// states consuming a byte, and the accepting state, are kept; they're all that matter to where we can go next.
+static void AddPatternClosure(const std::vector<PatternState>& stateArray, int stateIndex, int acceptState, std::vector<uint8_t>& visitedArray, std::vector<int>& stateSet)
+{
+	std::vector<int> stateStack;
+	stateStack.push_back(stateIndex);
+	while (stateStack.size() > 0)
+	{
+		int i = stateStack.back();
+		stateStack.pop_back();
+
+		if (i < 0 || visitedArray[i])
+			continue;
+
+		visitedArray[i] = 1;
+
+		if (stateArray[i].consumes || i == acceptState)
+			stateSet.push_back(i);
+
+		if (!stateArray[i].consumes)
+		{
+			stateStack.push_back(stateArray[i].out[1]);
+			stateStack.push_back(stateArray[i].out[0]);
+		}
+	}
+}
+
+//------------------------------- CharacterPattern -------------------------------
+
+CharacterPattern::CharacterPattern()
+{
+	this->transitionTable = new std::vector<int>();
+	this->acceptArray = new std::vector<uint8_t>();
+	this->acceptDistanceArray = new std::vector<int>();
+}
+
+/*virtual*/ CharacterPattern::~CharacterPattern()
+{
+	delete this->transitionTable;
+	delete this->acceptArray;
+	delete this->acceptDistanceArray;
+}
+
+bool CharacterPattern::Compile(const std::string& patternText, std::string& error)
+{
+	this->transitionTable->clear();
+	this->acceptArray->clear();
+	this->acceptDistanceArray->clear();
+
+	std::vector<PatternState> stateArray;
+	PatternFragment fragment;
+	const char* cursor = patternText.c_str();
+	if (!ParsePatternAlternation(cursor, stateArray, fragment, error))
+		return false;
+
+	if (*cursor != '\0')
+	{
+		error = "Pattern has a \")\" with no \"(\" to go with it.";
+		return false;
+	}
+
+	// Each state of the DFA is the set of NFA states we could be in, kept sorted so that equal sets look the same.
+	std::map<std::vector<int>, int> dfaStateMap;
+	std::vector<std::vector<int>> dfaStateArray;
+	std::vector<uint8_t> visitedArray(stateArray.size(), 0);
+
+	std::vector<int> initialSet;
+	AddPatternClosure(stateArray, fragment.start, fragment.end, visitedArray, initialSet);
+	std::sort(initialSet.begin(), initialSet.end());
+	dfaStateMap.insert(std::pair<std::vector<int>, int>(initialSet, 0));
+	dfaStateArray.push_back(initialSet);
+
+	for (int dfaState = 0; dfaState < (signed)dfaStateArray.size(); dfaState++)
+	{
+		std::vector<int> stateSet = dfaStateArray[dfaState];
+		this->acceptArray->push_back(std::binary_search(stateSet.begin(), stateSet.end(), fragment.end) ? 1 : 0);
+		this->transitionTable->resize(this->transitionTable->size() + 256, -1);
+
+		for (int byte = 0; byte < 256; byte++)
+		{
+			std::vector<int> nextSet;
+			std::fill(visitedArray.begin(), visitedArray.end(), 0);
+			for (int i : stateSet)
+				if (stateArray[i].consumes && (stateArray[i].byteSet[byte >> 6] & (uint64_t(1) << (byte & 63))) != 0)
+					AddPatternClosure(stateArray, stateArray[i].out[0], fragment.end, visitedArray, nextSet);
+
+			if (nextSet.size() == 0)
+				continue;
+
+			std::sort(nextSet.begin(), nextSet.end());
+			std::map<std::vector<int>, int>::iterator iter = dfaStateMap.find(nextSet);
+			if (iter == dfaStateMap.end())
+			{
+				if (dfaStateArray.size() >= CHARACTER_PATTERN_MAX_STATES)
+				{
+					error = "Pattern is too complicated.";
+					return false;
+				}
+
+				iter = dfaStateMap.insert(std::pair<std::vector<int>, int>(nextSet, (int)dfaStateArray.size())).first;
+				dfaStateArray.push_back(nextSet);
+			}
+
+			(*this->transitionTable)[dfaState * 256 + byte] = iter->second;
+		}
+	}
+
+	// Every state of the NFA can get to its end, so every state of the DFA can get to an accepting one.
+	int dfaStateCount = (int)this->acceptArray->size();
+	for (int dfaState = 0; dfaState < dfaStateCount; dfaState++)
+		this->acceptDistanceArray->push_back((*this->acceptArray)[dfaState] ? 0 : INT_MAX);
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (int dfaState = 0; dfaState < dfaStateCount; dfaState++)
+		{
+			int& distance = (*this->acceptDistanceArray)[dfaState];
+			for (int byte = 0; byte < 256; byte++)
+			{
+				int nextState = (*this->transitionTable)[dfaState * 256 + byte];
+				if (nextState >= 0 && (*this->acceptDistanceArray)[nextState] != INT_MAX && (*this->acceptDistanceArray)[nextState] + 1 < distance)
+				{
+					distance = (*this->acceptDistanceArray)[nextState] + 1;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void CharacterPattern::Generate(std::mt19937_64& random, std::string& text) const
+{
+	text = "";
+
+	int state = 0;
+	while (true)
+	{
+		bool longEnough = (text.length() >= CHARACTER_PATTERN_GENERATE_LENGTH);
+		if ((*this->acceptArray)[state] && (longEnough || random() % 4 == 0))
+			break;
+
+		// Printable bytes are preferred, but we'll take what we can get.
+		int byteArray[256];
+		int byteCount = 0;
+		for (int pass = 0; pass < 2 && byteCount == 0; pass++)
+		{
+			for (int byte = 0; byte < 256; byte++)
+			{
+				int nextState = (*this->transitionTable)[state * 256 + byte];
+				if (nextState < 0 || (pass == 0 && (byte < 0x20 || byte > 0x7E)))
+					continue;
+
+				if (longEnough && (*this->acceptDistanceArray)[nextState] >= (*this->acceptDistanceArray)[state])
+					continue;
+
+				byteArray[byteCount++] = byte;
+			}
+		}
+
+		if (byteCount == 0)
+			break;
+
+		int byte = byteArray[random() % byteCount];
+		text += (char)byte;
+		state = (*this->transitionTable)[state * 256 + byte];
+	}
+}
+
+int CharacterPattern::Match(const char* text, int length, int position) const
+{
+	const int* transitionTable = this->transitionTable->data();
+	const uint8_t* acceptArray = this->acceptArray->data();
+
+	int matchEnd = acceptArray[0] ? position : -1;
+	int state = 0;
+	for (int i = position; i < length; i++)
+	{
+		state = transitionTable[state * 256 + (uint8_t)text[i]];
+		if (state < 0)
+			break;
+
+		if (acceptArray[state])
+			matchEnd = i + 1;
+	}
+
+	return matchEnd;
+}
+
+//------------------------------- CharacterScanner -------------------------------
+
+CharacterScanner::CharacterScanner()
+{
+	this->compiledGrammar = nullptr;
+	this->patternArray = new std::vector<CharacterPattern*>();
+	this->literalLengthArray = new std::vector<int>();
+	this->terminalByteSetArray = new std::vector<uint64_t>();
+	this->ruleByteSetArray = new std::vector<uint64_t>();
+	this->sequenceByteSetArray = new std::vector<uint64_t>();
+	this->identifierPattern = new CharacterPattern();
+	this->numberPattern = new CharacterPattern();
+	this->stringPattern = new CharacterPattern();
+}
+
+/*virtual*/ CharacterScanner::~CharacterScanner()
+{
+	for (CharacterPattern* pattern : *this->patternArray)
+		delete pattern;
+
+	delete this->patternArray;
+	delete this->literalLengthArray;
+	delete this->terminalByteSetArray;
+	delete this->ruleByteSetArray;
+	delete this->sequenceByteSetArray;
+	delete this->identifierPattern;
+	delete this->numberPattern;
+	delete this->stringPattern;
+}
+
+bool CharacterScanner::Build(const CompiledGrammar* compiledGrammar, std::string& error)
+{
+	this->compiledGrammar = compiledGrammar;
+
+	// These are what the lexer's identifier, number and string token generators would match.
+	if (!this->identifierPattern->Compile("[A-Za-z][A-Za-z0-9_]*", error) ||
+		!this->numberPattern->Compile("-[0-9.]+|[0-9][0-9.]*", error) ||
+		!this->stringPattern->Compile("\"[^\"]*\"", error))
+	{
+		return false;
+	}
+
+	int terminalCount = compiledGrammar->GetTerminalCount();
+	this->patternArray->assign(terminalCount, nullptr);
+	this->literalLengthArray->assign(terminalCount, 0);
+	this->terminalByteSetArray->assign(terminalCount * 4, 0);
+
+	for (int terminalID = 0; terminalID < terminalCount; terminalID++)
+	{
+		const char* terminalText = compiledGrammar->GetTerminalText(terminalID);
+		uint64_t* byteSet = this->terminalByteSetArray->data() + terminalID * 4;
+		const CharacterPattern* pattern = nullptr;
+
+		switch (compiledGrammar->GetTerminal(terminalID).matchClass)
+		{
+			case CompiledGrammar::Terminal::Class::LITERAL:
+			{
+				(*this->literalLengthArray)[terminalID] = (int)::strlen(terminalText);
+				if (terminalText[0] != '\0')
+					AddByteRange(byteSet, (uint8_t)terminalText[0], (uint8_t)terminalText[0]);
+
+				break;
+			}
+			case CompiledGrammar::Terminal::Class::PATTERN:
+			{
+				std::string patternText(terminalText + 1, ::strlen(terminalText) - 2);
+				CharacterPattern* terminalPattern = new CharacterPattern();
+				(*this->patternArray)[terminalID] = terminalPattern;
+
+				std::string patternError;
+				if (!terminalPattern->Compile(patternText, patternError))
+				{
+					error = FormatString("Bad pattern %s: %s", terminalText, patternError.c_str());
+					return false;
+				}
+
+				// A terminal matching nothing could go on matching nothing forever.
+				if (terminalPattern->MatchesEmpty())
+				{
+					error = FormatString("Pattern %s can match an empty string, which a terminal can't.", terminalText);
+					return false;
+				}
+
+				pattern = terminalPattern;
+				break;
+			}
+			case CompiledGrammar::Terminal::Class::STRING:
+			{
+				pattern = this->stringPattern;
+				break;
+			}
+			case CompiledGrammar::Terminal::Class::NUMBER:
+			case CompiledGrammar::Terminal::Class::INT:
+			case CompiledGrammar::Terminal::Class::FLOAT:
+			{
+				pattern = this->numberPattern;
+				break;
+			}
+			case CompiledGrammar::Terminal::Class::IDENTIFIER:
+			{
+				pattern = this->identifierPattern;
+				break;
+			}
+		}
+
+		if (pattern)
+			for (int byte = 0; byte < 256; byte++)
+				if (pattern->CanStartWith((uint8_t)byte))
+					AddByteRange(byteSet, byte, byte);
+	}
+
+	this->ruleByteSetArray->assign(compiledGrammar->GetRuleCount() * 4, 0);
+	for (int ruleID = 0; ruleID < compiledGrammar->GetRuleCount(); ruleID++)
+		this->UnionTerminalByteSets(compiledGrammar->GetFirstSet(ruleID), this->ruleByteSetArray->data() + ruleID * 4);
+
+	this->sequenceByteSetArray->assign(compiledGrammar->GetSequenceCount() * 4, 0);
+	for (int sequenceID = 0; sequenceID < compiledGrammar->GetSequenceCount(); sequenceID++)
+		this->UnionTerminalByteSets(compiledGrammar->GetSequenceFirstSet(sequenceID), this->sequenceByteSetArray->data() + sequenceID * 4);
+
+	return true;
+}
+
+void CharacterScanner::UnionTerminalByteSets(const uint64_t* terminalSet, uint64_t* byteSet) const
+{
+	for (int terminalID = 0; terminalID < this->compiledGrammar->GetTerminalCount(); terminalID++)
+	{
+		if (!CompiledGrammar::SetContains(terminalSet, terminalID))
+			continue;
+
+		const uint64_t* terminalByteSet = this->terminalByteSetArray->data() + terminalID * 4;
+		for (int i = 0; i < 4; i++)
+			byteSet[i] |= terminalByteSet[i];
+	}
+}
+
+int CharacterScanner::Skip(const char* text, int length, int position) const
+{
+	int skipTerminalCount = this->compiledGrammar->GetSkipTerminalCount();
+
+	// Keep going until none of them matches, since whitespace and comments can come in any order.
+	int i = 0;
+	while (i < skipTerminalCount && position < length)
+	{
+		int skipEnd = this->MatchTerminal(this->compiledGrammar->GetSkipTerminal(i), text, length, position);
+		if (skipEnd > position)
+		{
+			position = skipEnd;
+			i = 0;
+		}
+		else
+			i++;
+	}
+
+	return position;
+}
+
+int CharacterScanner::MatchTerminal(int terminalID, const char* text, int length, int position) const
+{
+	if (position >= length || !ByteSetContains(this->terminalByteSetArray->data() + terminalID * 4, (uint8_t)text[position]))
+		return -1;
+
+	switch (this->compiledGrammar->GetTerminal(terminalID).matchClass)
+	{
+		case CompiledGrammar::Terminal::Class::LITERAL:
+		{
+			int literalLength = (*this->literalLengthArray)[terminalID];
+			const char* literalText = this->compiledGrammar->GetTerminalText(terminalID);
+			if (literalLength > length - position || ::memcmp(text + position, literalText, literalLength) != 0)
+				return -1;
+
+			// A keyword can't run on into an identifier.
+			int end = position + literalLength;
+			if (end < length && IsWordByte(literalText[literalLength - 1]) && IsWordByte(text[end]))
+				return -1;
+
+			return end;
+		}
+		case CompiledGrammar::Terminal::Class::PATTERN:
+		{
+			return (*this->patternArray)[terminalID]->Match(text, length, position);
+		}
+		case CompiledGrammar::Terminal::Class::STRING:
+		{
+			return this->stringPattern->Match(text, length, position);
+		}
+		case CompiledGrammar::Terminal::Class::NUMBER:
+		{
+			return this->numberPattern->Match(text, length, position);
+		}
+		case CompiledGrammar::Terminal::Class::INT:
+		case CompiledGrammar::Terminal::Class::FLOAT:
+		{
+			// Like the lexer, we take the whole number first, and then see which kind it is.
+			int end = this->numberPattern->Match(text, length, position);
+			if (end < 0)
+				return -1;
+
+			bool isFloat = (::memchr(text + position, '.', end - position) != nullptr);
+			return (isFloat == (this->compiledGrammar->GetTerminal(terminalID).matchClass == CompiledGrammar::Terminal::Class::FLOAT)) ? end : -1;
+		}
+		case CompiledGrammar::Terminal::Class::IDENTIFIER:
+		{
+			return this->identifierPattern->Match(text, length, position);
+		}
+	}
+
+	return -1;
+}
+
+void CharacterScanner::GetMatchText(int terminalID, const char* text, int start, int end, std::string& matchText) const
+{
+	// The lexer leaves the quotes off of strings, so we do too.
+	if (this->compiledGrammar->GetTerminal(terminalID).matchClass == CompiledGrammar::Terminal::Class::STRING)
+		matchText.assign(text + start + 1, end - start - 2);
+	else
+		matchText.assign(text + start, end - start);
+}
\ No newline at end of file
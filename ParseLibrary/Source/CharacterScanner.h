@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Common.h"
+
+namespace ParseParty
+{
+	class CompiledGrammar;
+
+	// A pattern is a regular expression over bytes, written between slashes in a grammar (e.g., "/[a-z_][a-z0-9_]*/").
+	// What's supported is literal characters, "." (anything but a newline), character classes like "[a-z]" or "[^\n]",
+	// the escapes \d, \w and \s (and \D, \W and \S for their complements), \n, \r and \t, any other escaped character
+	// standing for itself, grouping with parentheses, alternation with "|", and the quantifiers "*", "+" and "?".  There
+	// are no anchors or back-references.  The pattern is compiled into a DFA up-front, so matching is a table lookup per
+	// byte, and always finds the longest match, the way a lexer would.
+	class PARSE_PARTY_API CharacterPattern
+	{
+	public:
+		CharacterPattern();
+		virtual ~CharacterPattern();
+
+		bool Compile(const std::string& patternText, std::string& error);
+
+		// Return the end of the longest match starting at the given position, or -1 if there's none.
+		int Match(const char* text, int length, int position) const;
+
+		bool MatchesEmpty() const { return (*this->acceptArray)[0] != 0; }
+		bool CanStartWith(uint8_t byte) const { return (*this->transitionTable)[byte] >= 0; }
+
+		// Make up some random text matching the pattern, printable if at all possible.  This is for the SentenceGenerator.
+		void Generate(std::mt19937_64& random, std::string& text) const;
+
+	private:
+
+		std::vector<int>* transitionTable;		// Index this by state times 256 plus the byte to get the next state, or -1 if there is none.
+		std::vector<uint8_t>* acceptArray;
+		std::vector<int>* acceptDistanceArray;		// The fewest bytes it takes to get from each state to an accepting one.
+	};
+
+	// This is what the scannerless algorithm needs in order to match the terminals of a grammar right against the
+	// characters of the input, with no lexer in between.  Literal terminals match their text exactly, except that
+	// one ending in a letter, digit or underscore can't be followed by another (so "if" doesn't match the start of
+	// "iffy").  Pattern terminals match as above.  The terminal classes match what the lexer would give us for them;
+	// "@identifier" is [A-Za-z][A-Za-z0-9_]*, "@number" is an optional minus sign and then digits and dots, "@int" and
+	// "@float" being numbers without and with a dot, and "@string" is anything between double quotes, quotes not included.
+	//
+	// The grammar's skip patterns (usually whitespace and comments) are skipped before every terminal.  For each rule
+	// and alternative, we also keep the set of bytes it can start with, made from its FIRST set, so that the algorithm
+	// can rule it out at a glance, as it does with tokens.
+	class PARSE_PARTY_API CharacterScanner
+	{
+	public:
+		CharacterScanner();
+		virtual ~CharacterScanner();
+
+		// Fail if any pattern is malformed, or can match nothing at all.
+		bool Build(const CompiledGrammar* compiledGrammar, std::string& error);
+
+		// Return the position after any skip patterns matching at the given one.
+		int Skip(const char* text, int length, int position) const;
+
+		// Return the end of the given terminal's match at the given position, or -1 if it doesn't match there.
+		int MatchTerminal(int terminalID, const char* text, int length, int position) const;
+
+		// This is the text of the node for a terminal matched between the given positions.
+		void GetMatchText(int terminalID, const char* text, int start, int end, std::string& matchText) const;
+
+		// This is null for a terminal that isn't a pattern.
+		const CharacterPattern* GetPattern(int terminalID) const { return (*this->patternArray)[terminalID]; }
+
+		bool RuleCanStartWith(int ruleID, uint8_t byte) const { return ByteSetContains(this->ruleByteSetArray->data() + ruleID * 4, byte); }
+		bool SequenceCanStartWith(int sequenceID, uint8_t byte) const { return ByteSetContains(this->sequenceByteSetArray->data() + sequenceID * 4, byte); }
+
+	private:
+
+		static bool ByteSetContains(const uint64_t* byteSet, uint8_t byte)
+		{
+			return (byteSet[byte >> 6] & (uint64_t(1) << (byte & 63))) != 0;
+		}
+
+		static bool IsWordByte(char ch)
+		{
+			return ::isalnum((uint8_t)ch) || ch == '_';
+		}
+
+		void UnionTerminalByteSets(const uint64_t* terminalSet, uint64_t* byteSet) const;
+
+		const CompiledGrammar* compiledGrammar;
+		std::vector<CharacterPattern*>* patternArray;		// For each terminal, the pattern matching it, or null for a literal.
+		std::vector<int>* literalLengthArray;
+		std::vector<uint64_t>* terminalByteSetArray;		// Each of these sets is 4 words long, a bit per byte.
+		std::vector<uint64_t>* ruleByteSetArray;
+		std::vector<uint64_t>* sequenceByteSetArray;
+		CharacterPattern* identifierPattern;
+		CharacterPattern* numberPattern;
+		CharacterPattern* stringPattern;
+	};
+}
\ No newline at end of file
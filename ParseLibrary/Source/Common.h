@@ -9,10 +9,16 @@
 #endif
 
 #include <list>
+#include <deque>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <set>
 #include <string>
+#include <string_view>
+#include <array>
+#include <tuple>
+#include <utility>
 #include <functional>
 #include <fstream>
 #include <sstream>
@@ -21,4 +27,12 @@
 //#include <ranges>
 #include <iomanip>
 #include <algorithm>
-#include <memory>
\ No newline at end of file
+#include <memory>
+#include <cstdint>
+#include <climits>
+#include <random>
+#include <bit>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <barrier>
\ No newline at end of file
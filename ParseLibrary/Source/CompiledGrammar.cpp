@@ -0,0 +1,1211 @@
+#include "CompiledGrammar.h"
+#include "LL1ParseAlgorithm.h"
+#include "LALRParseAlgorithm.h"
+#include "CYKParseAlgorithm.h"
+#include "GrammarOptimizer.h"
+#include "MappedFile.h"
+#include "CharacterScanner.h"
+#include <cstring>
+
+using namespace ParseParty;
+
+//------------------------------- CompiledGrammar -------------------------------
+
+CompiledGrammar::CompiledGrammar()
+{
+	this->ruleArray = new FlatArray<Rule>();
+	this->sequenceArray = new FlatArray<Sequence>();
+	this->symbolArray = new FlatArray<Symbol>();
+	this->terminalArray = new FlatArray<Terminal>();
+	this->stringPool = new FlatArray<char>();
+	this->literalTable = new FlatArray<int>();
+	this->tokenTypeTerminalArray = new std::vector<std::vector<int>>();
+	this->ruleFirstSetArray = new FlatArray<uint64_t>();
+	this->sequenceFirstSetArray = new FlatArray<uint64_t>();
+	this->ruleFollowSetArray = new FlatArray<uint64_t>();
+	this->restorePlanArray = new FlatArray<int>();
+	this->operatorArray = new FlatArray<Operator>();
+	this->skipTerminalArray = new FlatArray<int>();
+	this->terminalSetWordCount = 0;
+	this->initialRuleID = -1;
+	this->optimized = false;
+	this->needsTreeRestore = false;
+	this->hasCuts = false;
+	this->tableMutex = new std::mutex();
+	this->ll1ParseTable = nullptr;
+	this->ll1ParseTableError = nullptr;
+	this->lalrParseTable = nullptr;
+	this->lalrParseTableError = nullptr;
+	this->cnfGrammar = nullptr;
+	this->characterScanner = nullptr;
+	this->characterScannerError = nullptr;
+	this->ll1ParseTableBuilt = false;
+	this->lalrParseTableBuilt = false;
+	this->cnfGrammarBuilt = false;
+	this->characterScannerBuilt = false;
+}
+
+/*virtual*/ CompiledGrammar::~CompiledGrammar()
+{
+	delete this->ruleArray;
+	delete this->sequenceArray;
+	delete this->symbolArray;
+	delete this->terminalArray;
+	delete this->stringPool;
+	delete this->literalTable;
+	delete this->tokenTypeTerminalArray;
+	delete this->ruleFirstSetArray;
+	delete this->sequenceFirstSetArray;
+	delete this->ruleFollowSetArray;
+	delete this->restorePlanArray;
+	delete this->operatorArray;
+	delete this->skipTerminalArray;
+	delete this->ll1ParseTable;
+	delete this->ll1ParseTableError;
+	delete this->lalrParseTable;
+	delete this->lalrParseTableError;
+	delete this->cnfGrammar;
+	delete this->characterScanner;
+	delete this->characterScannerError;
+	delete this->tableMutex;
+}
+
+void CompiledGrammar::Clear()
+{
+	this->ruleArray->clear();
+	this->sequenceArray->clear();
+	this->symbolArray->clear();
+	this->terminalArray->clear();
+	this->stringPool->clear();
+	this->literalTable->clear();
+	this->tokenTypeTerminalArray->clear();
+	this->ruleFirstSetArray->clear();
+	this->sequenceFirstSetArray->clear();
+	this->ruleFollowSetArray->clear();
+	this->restorePlanArray->clear();
+	this->operatorArray->clear();
+	this->skipTerminalArray->clear();
+	this->terminalSetWordCount = 0;
+	this->initialRuleID = -1;
+	this->optimized = false;
+	this->needsTreeRestore = false;
+	this->hasCuts = false;
+	this->bundleFile.reset();
+
+	delete this->ll1ParseTable;
+	delete this->ll1ParseTableError;
+	this->ll1ParseTable = nullptr;
+	this->ll1ParseTableError = nullptr;
+	this->ll1ParseTableBuilt = false;
+
+	delete this->lalrParseTable;
+	delete this->lalrParseTableError;
+	this->lalrParseTable = nullptr;
+	this->lalrParseTableError = nullptr;
+	this->lalrParseTableBuilt = false;
+
+	delete this->cnfGrammar;
+	this->cnfGrammar = nullptr;
+	this->cnfGrammarBuilt = false;
+
+	delete this->characterScanner;
+	delete this->characterScannerError;
+	this->characterScanner = nullptr;
+	this->characterScannerError = nullptr;
+	this->characterScannerBuilt = false;
+}
+
+bool CompiledGrammar::Compile(const Grammar* grammar, std::string& error)
+{
+	this->Clear();
+
+	// Rule IDs are handed out up-front so that forward references can be resolved in a single pass.
+	std::map<std::string, int> ruleIDMap;
+	for (const std::pair<const std::string, Grammar::Rule*>& pair : *grammar->ruleMap)
+	{
+		int ruleID = (int)this->ruleArray->size();
+		ruleIDMap.insert(std::pair<std::string, int>(pair.first, ruleID));
+		this->ruleArray->push_back(Rule{ this->AddString(pair.first), 0, 0, false, -1, false, false, false, 0, 0, 0, 0 });
+	}
+
+	auto resolveToken = [this, &ruleIDMap, &error](const std::string& ruleName, const Grammar::Token* grammarToken, Symbol& symbol) -> bool
+	{
+		const Grammar::NonTerminalToken* nonTerminalToken = dynamic_cast<const Grammar::NonTerminalToken*>(grammarToken);
+		if (nonTerminalToken)
+		{
+			std::map<std::string, int>::iterator iter = ruleIDMap.find(*nonTerminalToken->ruleName);
+			if (iter == ruleIDMap.end())
+			{
+				error = FormatString("Rule \"%s\" refers to unknown rule \"%s\".", ruleName.c_str(), nonTerminalToken->ruleName->c_str());
+				return false;
+			}
+
+			symbol.type = Symbol::Type::NON_TERMINAL;
+			symbol.id = iter->second;
+		}
+		else
+		{
+			symbol.type = Symbol::Type::TERMINAL;
+			symbol.id = this->InternTerminal(grammarToken->GetText());
+		}
+
+		return true;
+	};
+
+	// Repetitions become rules of their own, made once all the rules of the grammar are in, so that the sequences of each
+	// rule stay together.  A rule for "X*" is "R -> X R | (nothing)", for "X?" it's "R -> X | (nothing)", "X+" is "X R" with R
+	// as for "X*", and "X % S" is "X R" with "R -> S X R | (nothing)".  These are all spliced into their parents, so the items
+	// come out as siblings, and the ones that repeat are flagged as such, so that an algorithm can loop over them rather than recurse.
+	// An operator rule is "E -> O R" in the same way, with an alternative "R -> op O R" for each of its operators before "R -> (nothing)".
+	struct HelperRule
+	{
+		int ruleID;
+		std::vector<std::vector<Symbol>> alternativeArray;
+	};
+
+	std::vector<HelperRule> helperRuleArray;
+
+	for (const std::pair<const std::string, Grammar::Rule*>& pair : *grammar->ruleMap)
+	{
+		const Grammar::Rule* grammarRule = pair.second;
+		int ruleID = ruleIDMap.find(pair.first)->second;
+		(*this->ruleArray)[ruleID].firstSequence = (int)this->sequenceArray->size();
+		(*this->ruleArray)[ruleID].sequenceCount = (int)grammarRule->matchSequenceArray->size();
+		int repetitionNumber = 1;
+
+		// This gives back the index of the new helper rule, since references into the array don't last.
+		auto addHelperRule = [this, &ruleIDMap, &pair, &repetitionNumber, &helperRuleArray](bool repeats) -> int
+		{
+			std::string helperName;
+			do
+			{
+				helperName = FormatString("%s~%d", pair.first.c_str(), repetitionNumber++);
+			} while (ruleIDMap.find(helperName) != ruleIDMap.end());
+
+			HelperRule helperRule;
+			helperRule.ruleID = (int)this->ruleArray->size();
+			this->ruleArray->push_back(Rule{ this->AddString(helperName), 0, 0, false, -1, false, true, repeats, 0, 0, 0, 0 });
+			helperRuleArray.push_back(helperRule);
+			return (int)helperRuleArray.size() - 1;
+		};
+
+		// The operators are kept with the rule, for building the tree by precedence once the list is matched.
+		if (grammarRule->operatorArray->size() > 0)
+		{
+			Grammar::NonTerminalToken operandToken(*grammarRule->operandRuleName);
+			Symbol operandSymbol;
+			if (!resolveToken(pair.first, &operandToken, operandSymbol))
+				return false;
+
+			int tailIndex = addHelperRule(true);
+			int tailRuleID = helperRuleArray[tailIndex].ruleID;
+
+			(*this->ruleArray)[ruleID].firstOperator = (int)this->operatorArray->size();
+			(*this->ruleArray)[ruleID].operatorCount = (int)grammarRule->operatorArray->size();
+			for (const Grammar::Operator& grammarOperator : *grammarRule->operatorArray)
+			{
+				int terminalID = this->InternTerminal(grammarOperator.text);
+				this->operatorArray->push_back(Operator{ terminalID, grammarOperator.precedence, grammarOperator.rightAssociative });
+				helperRuleArray[tailIndex].alternativeArray.push_back(std::vector<Symbol>{ Symbol{ Symbol::Type::TERMINAL, terminalID }, operandSymbol, Symbol{ Symbol::Type::NON_TERMINAL, tailRuleID } });
+			}
+
+			helperRuleArray[tailIndex].alternativeArray.push_back(std::vector<Symbol>());
+
+			Sequence sequence;
+			sequence.ruleID = ruleID;
+			sequence.firstSymbol = (int)this->symbolArray->size();
+			sequence.symbolCount = 2;
+			sequence.type = Grammar::MatchSequence::Type::LEFT_TO_RIGHT;
+			sequence.nullable = false;
+			sequence.cutSymbol = -1;
+			this->symbolArray->push_back(operandSymbol);
+			this->symbolArray->push_back(Symbol{ Symbol::Type::NON_TERMINAL, tailRuleID });
+			sequence.hasAdjacentNonTerminals = HasAdjacentNonTerminals(this->symbolArray->data() + sequence.firstSymbol, sequence.symbolCount);
+			this->sequenceArray->push_back(sequence);
+			(*this->ruleArray)[ruleID].sequenceCount = 1;
+			continue;
+		}
+
+		for (const Grammar::MatchSequence* matchSequence : *grammarRule->matchSequenceArray)
+		{
+			Sequence sequence;
+			sequence.ruleID = ruleID;
+			sequence.firstSymbol = (int)this->symbolArray->size();
+			sequence.symbolCount = 0;
+			sequence.type = matchSequence->type;
+			sequence.hasAdjacentNonTerminals = false;
+			sequence.nullable = false;
+			sequence.cutSymbol = -1;
+
+			// A repetition can take up two symbols, so the cut has to be placed as we go.
+			for (int i = 0; i < (int)matchSequence->tokenSequence->size(); i++)
+			{
+				if (i == matchSequence->cutIndex)
+					sequence.cutSymbol = (int)this->symbolArray->size() - sequence.firstSymbol;
+
+				const Grammar::Token* grammarToken = (*matchSequence->tokenSequence)[i];
+				Symbol symbol;
+
+				const Grammar::RepeatToken* repeatToken = dynamic_cast<const Grammar::RepeatToken*>(grammarToken);
+				if (!repeatToken)
+				{
+					if (!resolveToken(pair.first, grammarToken, symbol))
+						return false;
+
+					this->symbolArray->push_back(symbol);
+					continue;
+				}
+
+				Symbol itemSymbol;
+				if (!resolveToken(pair.first, repeatToken->itemToken, itemSymbol))
+					return false;
+
+				bool repeats = (repeatToken->repetition != Grammar::RepeatToken::Repetition::ZERO_OR_ONE);
+				int helperIndex = addHelperRule(repeats);
+				int helperRuleID = helperRuleArray[helperIndex].ruleID;
+
+				std::vector<Symbol> bodyArray;
+				if (repeatToken->repetition == Grammar::RepeatToken::Repetition::SEPARATED)
+				{
+					Symbol separatorSymbol;
+					if (!resolveToken(pair.first, repeatToken->separatorToken, separatorSymbol))
+						return false;
+
+					bodyArray.push_back(separatorSymbol);
+				}
+
+				bodyArray.push_back(itemSymbol);
+				if (repeats)
+					bodyArray.push_back(Symbol{ Symbol::Type::NON_TERMINAL, helperRuleID });
+
+				// The non-empty alternative comes first, since the first-match-wins algorithms would otherwise never take it.
+				helperRuleArray[helperIndex].alternativeArray.push_back(bodyArray);
+				helperRuleArray[helperIndex].alternativeArray.push_back(std::vector<Symbol>());
+
+				if (repeatToken->repetition == Grammar::RepeatToken::Repetition::ONE_OR_MORE || repeatToken->repetition == Grammar::RepeatToken::Repetition::SEPARATED)
+					this->symbolArray->push_back(itemSymbol);
+
+				symbol.type = Symbol::Type::NON_TERMINAL;
+				symbol.id = helperRuleID;
+				this->symbolArray->push_back(symbol);
+			}
+
+			sequence.symbolCount = (int)this->symbolArray->size() - sequence.firstSymbol;
+			if (matchSequence->cutIndex == (int)matchSequence->tokenSequence->size())
+				sequence.cutSymbol = sequence.symbolCount;
+
+			sequence.hasAdjacentNonTerminals = HasAdjacentNonTerminals(this->symbolArray->data() + sequence.firstSymbol, sequence.symbolCount);
+			this->sequenceArray->push_back(sequence);
+		}
+	}
+
+	for (const HelperRule& helperRule : helperRuleArray)
+	{
+		Rule& rule = (*this->ruleArray)[helperRule.ruleID];
+		rule.firstSequence = (int)this->sequenceArray->size();
+		rule.sequenceCount = (int)helperRule.alternativeArray.size();
+
+		for (const std::vector<Symbol>& alternative : helperRule.alternativeArray)
+		{
+			Sequence sequence;
+			sequence.ruleID = helperRule.ruleID;
+			sequence.firstSymbol = (int)this->symbolArray->size();
+			sequence.symbolCount = (int)alternative.size();
+			sequence.type = Grammar::MatchSequence::Type::LEFT_TO_RIGHT;
+			sequence.hasAdjacentNonTerminals = HasAdjacentNonTerminals(alternative.data(), sequence.symbolCount);
+			sequence.nullable = false;
+			sequence.cutSymbol = -1;
+
+			for (const Symbol& symbol : alternative)
+				this->symbolArray->push_back(symbol);
+
+			this->sequenceArray->push_back(sequence);
+		}
+	}
+
+	std::map<std::string, int>::iterator iter = ruleIDMap.find(*grammar->initialRule);
+	if (iter == ruleIDMap.end())
+	{
+		error = FormatString("Initial rule \"%s\" not found.", grammar->initialRule->c_str());
+		return false;
+	}
+
+	this->initialRuleID = iter->second;
+	this->needsTreeRestore = (helperRuleArray.size() > 0);
+
+	// What's skipped is interned like any other terminal, but only ever matched by the scanner.  Whitespace is the default,
+	// whether the grammar came from a file or was put together in code, and whatever algorithm it ends up being used with.
+	if (grammar->skipArray->size() == 0)
+		this->skipTerminalArray->push_back(this->InternTerminal("/\\s+/"));
+
+	for (const std::string& skipText : *grammar->skipArray)
+		this->skipTerminalArray->push_back(this->InternTerminal(skipText));
+
+	this->BuildLiteralTable();
+	this->ComputeAnalysis();
+
+	return true;
+}
+
+/*static*/ bool CompiledGrammar::HasAdjacentNonTerminals(const Symbol* symbolArray, int symbolCount)
+{
+	for (int i = 1; i < symbolCount; i++)
+		if (symbolArray[i].type == Symbol::Type::NON_TERMINAL && symbolArray[i - 1].type == Symbol::Type::NON_TERMINAL)
+			return true;
+
+	return false;
+}
+
+bool CompiledGrammar::Optimize()
+{
+	// Grammars viewed from a bundle come optimized already, if they were going to be.
+	if (this->optimized || this->ruleArray->IsView() || this->initialRuleID < 0)
+		return false;
+
+	GrammarOptimizer grammarOptimizer;
+	if (!grammarOptimizer.Optimize(this))
+		return false;
+
+	const std::vector<GrammarOptimizer::Rule>& optimizedRuleArray = grammarOptimizer.GetRuleArray();
+
+	// The original rules keep their names and operators, so we just hang on to where those are in the string pool and operator array.
+	std::vector<Rule> originalRuleArray;
+	for (const Rule& rule : *this->ruleArray)
+		originalRuleArray.push_back(rule);
+
+	this->ruleArray->clear();
+	this->sequenceArray->clear();
+	this->symbolArray->clear();
+	this->restorePlanArray->clear();
+
+	std::vector<int> planArray;
+	for (int ruleID = 0; ruleID < (signed)optimizedRuleArray.size(); ruleID++)
+	{
+		const GrammarOptimizer::Rule& optimizedRule = optimizedRuleArray[ruleID];
+
+		Rule rule;
+		rule.nameOffset = (ruleID < (signed)originalRuleArray.size()) ? originalRuleArray[ruleID].nameOffset : this->AddString(optimizedRule.name);
+		rule.firstSequence = (int)this->sequenceArray->size();
+		rule.sequenceCount = (int)optimizedRule.sequenceArray.size();
+		rule.nullable = false;
+		rule.nullSequence = -1;
+		rule.leftRecursive = false;
+		rule.spliced = optimizedRule.spliced;
+		rule.repeats = optimizedRule.repeats;
+		rule.firstOperator = (ruleID < (signed)originalRuleArray.size()) ? originalRuleArray[ruleID].firstOperator : 0;
+		rule.operatorCount = (ruleID < (signed)originalRuleArray.size()) ? originalRuleArray[ruleID].operatorCount : 0;
+
+		planArray.clear();
+		GrammarOptimizer::EncodePlan(optimizedRule.planItemArray, planArray);
+		rule.restorePlanOffset = (int)this->restorePlanArray->size();
+		rule.restorePlanSize = (int)planArray.size();
+		for (int planValue : planArray)
+			this->restorePlanArray->push_back(planValue);
+
+		for (const GrammarOptimizer::Sequence& optimizedSequence : optimizedRule.sequenceArray)
+		{
+			Sequence sequence;
+			sequence.ruleID = ruleID;
+			sequence.firstSymbol = (int)this->symbolArray->size();
+			sequence.symbolCount = (int)optimizedSequence.symbolArray.size();
+			sequence.type = optimizedSequence.type;
+			sequence.nullable = false;
+			sequence.cutSymbol = optimizedSequence.cutSymbol;
+
+			for (const Symbol& symbol : optimizedSequence.symbolArray)
+				this->symbolArray->push_back(symbol);
+
+			sequence.hasAdjacentNonTerminals = HasAdjacentNonTerminals(optimizedSequence.symbolArray.data(), sequence.symbolCount);
+
+			this->sequenceArray->push_back(sequence);
+		}
+
+		this->ruleArray->push_back(rule);
+	}
+
+	// No new terminals were made, so the literal table is still good.
+	this->ComputeAnalysis();
+	this->optimized = true;
+	this->needsTreeRestore = true;
+	return true;
+}
+
+void CompiledGrammar::WriteBundle(Bundle::Writer& bundleWriter) const
+{
+	std::string info;
+	Bundle::PackInt(info, this->initialRuleID);
+	Bundle::PackInt(info, this->terminalSetWordCount);
+	Bundle::PackInt(info, this->optimized ? 1 : 0);
+	Bundle::PackInt(info, this->hasCuts ? 1 : 0);
+	bundleWriter.AddSection(Bundle::SectionTag::COMPILED_GRAMMAR_INFO, info.data(), info.size());
+
+	bundleWriter.AddArray(Bundle::SectionTag::RULES, *this->ruleArray);
+	bundleWriter.AddArray(Bundle::SectionTag::SEQUENCES, *this->sequenceArray);
+	bundleWriter.AddArray(Bundle::SectionTag::SYMBOLS, *this->symbolArray);
+	bundleWriter.AddArray(Bundle::SectionTag::TERMINALS, *this->terminalArray);
+	bundleWriter.AddArray(Bundle::SectionTag::STRING_POOL, *this->stringPool);
+	bundleWriter.AddArray(Bundle::SectionTag::LITERAL_TABLE, *this->literalTable);
+	bundleWriter.AddArray(Bundle::SectionTag::RULE_FIRST_SETS, *this->ruleFirstSetArray);
+	bundleWriter.AddArray(Bundle::SectionTag::SEQUENCE_FIRST_SETS, *this->sequenceFirstSetArray);
+	bundleWriter.AddArray(Bundle::SectionTag::RULE_FOLLOW_SETS, *this->ruleFollowSetArray);
+	bundleWriter.AddArray(Bundle::SectionTag::RESTORE_PLANS, *this->restorePlanArray);
+	bundleWriter.AddArray(Bundle::SectionTag::OPERATORS, *this->operatorArray);
+	bundleWriter.AddArray(Bundle::SectionTag::SKIP_TERMINALS, *this->skipTerminalArray);
+
+	// Tables that failed to build aren't written, and will just fail again if asked for.
+	std::lock_guard<std::mutex> lock(*this->tableMutex);
+
+	if (this->ll1ParseTable)
+		this->ll1ParseTable->WriteBundle(bundleWriter);
+
+	if (this->lalrParseTable)
+		this->lalrParseTable->WriteBundle(bundleWriter);
+}
+
+bool CompiledGrammar::ReadBundle(const Bundle::Reader& bundleReader, std::string& error)
+{
+	this->Clear();
+
+	size_t infoSize = 0;
+	const char* info = bundleReader.GetSection(Bundle::SectionTag::COMPILED_GRAMMAR_INFO, infoSize);
+	const char* infoEnd = info + infoSize;
+	int optimizedValue = 0;
+	int hasCutsValue = 0;
+	if (!info ||
+		!Bundle::UnpackInt(info, infoEnd, this->initialRuleID) ||
+		!Bundle::UnpackInt(info, infoEnd, this->terminalSetWordCount) ||
+		!Bundle::UnpackInt(info, infoEnd, optimizedValue) ||
+		!Bundle::UnpackInt(info, infoEnd, hasCutsValue))
+	{
+		error = "Bundle has no compiled grammar in it.";
+		return false;
+	}
+
+	// None of this is copied; the arrays just look into the mapped file, which we keep open for as long as we're around.
+	this->bundleFile = bundleReader.GetMappedFile();
+
+	if (!bundleReader.ViewArray(Bundle::SectionTag::RULES, *this->ruleArray, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::SEQUENCES, *this->sequenceArray, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::SYMBOLS, *this->symbolArray, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::TERMINALS, *this->terminalArray, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::STRING_POOL, *this->stringPool, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::LITERAL_TABLE, *this->literalTable, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::RULE_FIRST_SETS, *this->ruleFirstSetArray, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::SEQUENCE_FIRST_SETS, *this->sequenceFirstSetArray, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::RULE_FOLLOW_SETS, *this->ruleFollowSetArray, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::RESTORE_PLANS, *this->restorePlanArray, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::OPERATORS, *this->operatorArray, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::SKIP_TERMINALS, *this->skipTerminalArray, error))
+	{
+		this->Clear();
+		return false;
+	}
+
+	// The layout signature covers struct sizes, but not the contents, so make sure the sizes at least all agree with one another.
+	size_t setSize = size_t(this->terminalSetWordCount);
+	if (this->initialRuleID < 0 || this->initialRuleID >= (signed)this->ruleArray->size() ||
+		setSize != (this->terminalArray->size() + 1 + 63) / 64 ||
+		this->ruleFirstSetArray->size() != this->ruleArray->size() * setSize ||
+		this->sequenceFirstSetArray->size() != this->sequenceArray->size() * setSize ||
+		this->ruleFollowSetArray->size() != this->ruleArray->size() * setSize ||
+		this->stringPool->size() == 0 || this->stringPool->back() != '\0' ||
+		(this->literalTable->size() & (this->literalTable->size() - 1)) != 0)
+	{
+		error = "Bundle has an inconsistent compiled grammar in it.";
+		this->Clear();
+		return false;
+	}
+
+	// The sizes can all agree and the indices in the arrays still point anywhere, which would have the parse algorithms reading
+	// out of bounds, or going around in circles, on a bundle that's been damaged.  So every index gets checked, once, up-front.
+	if (!this->CheckBundleIndices())
+	{
+		error = "Bundle has an inconsistent compiled grammar in it.";
+		this->Clear();
+		return false;
+	}
+
+	this->optimized = (optimizedValue != 0);
+	this->hasCuts = (hasCutsValue != 0);
+	this->needsTreeRestore = this->optimized;
+	for (const Rule& rule : *this->ruleArray)
+		if (rule.spliced)
+			this->needsTreeRestore = true;
+
+	this->BuildTokenTypeTerminals();
+
+	if (bundleReader.HasSection(Bundle::SectionTag::LL1_SEQUENCE_TABLE))
+	{
+		this->ll1ParseTable = new LL1ParseTable();
+		if (!this->ll1ParseTable->ReadBundle(this, bundleReader, error))
+		{
+			this->Clear();
+			return false;
+		}
+
+		this->ll1ParseTableBuilt = true;
+	}
+
+	if (bundleReader.HasSection(Bundle::SectionTag::LALR_INFO))
+	{
+		this->lalrParseTable = new LALRParseTable();
+		if (!this->lalrParseTable->ReadBundle(this, bundleReader, error))
+		{
+			this->Clear();
+			return false;
+		}
+
+		this->lalrParseTableBuilt = true;
+	}
+
+	return true;
+}
+
+// True if the run of the given length at the given offset lies within an array of the given size.
+static bool RunFits(int offset, int length, size_t size)
+{
+	return offset >= 0 && length >= 0 && size_t(offset) <= size && size_t(length) <= size - size_t(offset);
+}
+
+// A restore plan is a run of items, each either a child (-1), the rest of the children (-2), or a rule ID and
+// a count of the items grouped under a node for that rule.  Walk it the way Parser::RestoreTree() will, minus the recursion.
+static bool CheckRestorePlan(const int* plan, int planSize, int ruleCount)
+{
+	std::vector<int> itemCountStack;
+	int planPosition = 0;
+	while (planPosition < planSize)
+	{
+		int planValue = plan[planPosition++];
+		if (planValue >= 0)
+		{
+			if (planValue >= ruleCount || planPosition >= planSize || plan[planPosition] < 0)
+				return false;
+
+			itemCountStack.push_back(plan[planPosition++]);
+		}
+		else if (planValue != -1 && planValue != -2)
+			return false;
+		else if (itemCountStack.size() > 0)
+			itemCountStack.back()--;
+
+		while (itemCountStack.size() > 0 && itemCountStack.back() == 0)
+		{
+			itemCountStack.pop_back();
+			if (itemCountStack.size() > 0)
+				itemCountStack.back()--;
+		}
+	}
+
+	return itemCountStack.size() == 0;
+}
+
+bool CompiledGrammar::CheckBundleIndices() const
+{
+	int ruleCount = (int)this->ruleArray->size();
+	int sequenceCount = (int)this->sequenceArray->size();
+	int terminalCount = (int)this->terminalArray->size();
+	int stringPoolSize = (int)this->stringPool->size();
+
+	for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+	{
+		const Rule& rule = (*this->ruleArray)[ruleID];
+		if (rule.nameOffset < 0 || rule.nameOffset >= stringPoolSize ||
+			!RunFits(rule.firstSequence, rule.sequenceCount, sequenceCount) ||
+			(rule.nullSequence != -1 && (rule.nullSequence < rule.firstSequence || rule.nullSequence >= rule.firstSequence + rule.sequenceCount)) ||
+			!RunFits(rule.restorePlanOffset, rule.restorePlanSize, this->restorePlanArray->size()) ||
+			!RunFits(rule.firstOperator, rule.operatorCount, this->operatorArray->size()) ||
+			!CheckRestorePlan(this->GetRestorePlan(rule), rule.restorePlanSize, ruleCount))
+		{
+			return false;
+		}
+
+		for (int i = 0; i < rule.sequenceCount; i++)
+			if ((*this->sequenceArray)[rule.firstSequence + i].ruleID != ruleID)
+				return false;
+	}
+
+	for (const Sequence& sequence : *this->sequenceArray)
+	{
+		if (sequence.ruleID < 0 || sequence.ruleID >= ruleCount ||
+			!RunFits(sequence.firstSymbol, sequence.symbolCount, this->symbolArray->size()) ||
+			sequence.cutSymbol < -1 || sequence.cutSymbol > sequence.symbolCount ||
+			(sequence.type != Grammar::MatchSequence::Type::LEFT_TO_RIGHT && sequence.type != Grammar::MatchSequence::Type::RIGHT_TO_LEFT))
+		{
+			return false;
+		}
+	}
+
+	for (const Symbol& symbol : *this->symbolArray)
+	{
+		if (symbol.type == Symbol::Type::TERMINAL)
+		{
+			if (symbol.id < 0 || symbol.id >= terminalCount)
+				return false;
+		}
+		else if (symbol.type == Symbol::Type::NON_TERMINAL)
+		{
+			if (symbol.id < 0 || symbol.id >= ruleCount)
+				return false;
+		}
+		else
+			return false;
+	}
+
+	for (const Terminal& terminal : *this->terminalArray)
+		if (terminal.textOffset < 0 || terminal.textOffset >= stringPoolSize || uint8_t(terminal.matchClass) > uint8_t(Terminal::Class::PATTERN))
+			return false;
+
+	// Every literal has to be in the table, and there has to be an empty slot somewhere, or a lookup that misses never ends.
+	int literalCount = 0;
+	for (const Terminal& terminal : *this->terminalArray)
+		if (terminal.matchClass == Terminal::Class::LITERAL)
+			literalCount++;
+
+	int literalSlotCount = 0;
+	for (int terminalID : *this->literalTable)
+	{
+		if (terminalID < 0)
+			continue;
+
+		if (terminalID >= terminalCount || (*this->terminalArray)[terminalID].matchClass != Terminal::Class::LITERAL)
+			return false;
+
+		literalSlotCount++;
+	}
+
+	if (literalSlotCount != literalCount || (literalCount > 0 && literalSlotCount >= (int)this->literalTable->size()))
+		return false;
+
+	for (const Operator& compiledOperator : *this->operatorArray)
+		if (compiledOperator.terminalID < 0 || compiledOperator.terminalID >= terminalCount)
+			return false;
+
+	// Nothing past the end-of-input bit may be set in a terminal set, or we'd go looking for terminals that aren't there.
+	int lastBit = terminalCount & 63;
+	uint64_t unusedMask = (lastBit == 63) ? 0 : ~((uint64_t(2) << lastBit) - 1);
+	const FlatArray<uint64_t>* setArrayArray[] = { this->ruleFirstSetArray, this->sequenceFirstSetArray, this->ruleFollowSetArray };
+	for (const FlatArray<uint64_t>* setArray : setArrayArray)
+		for (size_t i = this->terminalSetWordCount - 1; i < setArray->size(); i += this->terminalSetWordCount)
+			if (((*setArray)[i] & unusedMask) != 0)
+				return false;
+
+	for (int terminalID : *this->skipTerminalArray)
+		if (terminalID < 0 || terminalID >= terminalCount)
+			return false;
+
+	return true;
+}
+
+int CompiledGrammar::AddString(const std::string& text)
+{
+	int offset = (int)this->stringPool->size();
+	this->stringPool->resize(offset + text.length() + 1);
+	::memcpy(this->stringPool->data() + offset, text.c_str(), text.length() + 1);
+	return offset;
+}
+
+int CompiledGrammar::InternTerminal(const std::string& terminalText)
+{
+	int terminalID = this->FindTerminal(terminalText);
+	if (terminalID >= 0)
+		return terminalID;
+
+	Terminal terminal;
+	terminal.textOffset = this->AddString(terminalText);
+
+	if (terminalText == "@string")
+		terminal.matchClass = Terminal::Class::STRING;
+	else if (terminalText == "@number")
+		terminal.matchClass = Terminal::Class::NUMBER;
+	else if (terminalText == "@int")
+		terminal.matchClass = Terminal::Class::INT;
+	else if (terminalText == "@float")
+		terminal.matchClass = Terminal::Class::FLOAT;
+	else if (terminalText == "@identifier")
+		terminal.matchClass = Terminal::Class::IDENTIFIER;
+	else if (terminalText.length() > 2 && terminalText[0] == '/' && terminalText.back() == '/')
+		terminal.matchClass = Terminal::Class::PATTERN;
+	else
+		terminal.matchClass = Terminal::Class::LITERAL;
+
+	this->terminalArray->push_back(terminal);
+	return (int)this->terminalArray->size() - 1;
+}
+
+void CompiledGrammar::BuildLiteralTable()
+{
+	int literalCount = 0;
+	for (const Terminal& terminal : *this->terminalArray)
+		if (terminal.matchClass == Terminal::Class::LITERAL)
+			literalCount++;
+
+	// Keep the load factor at or below one half so that probe sequences stay short.
+	int tableSize = 4;
+	while (tableSize < 2 * literalCount)
+		tableSize *= 2;
+
+	this->literalTable->assign(tableSize, -1);
+
+	for (int terminalID = 0; terminalID < (signed)this->terminalArray->size(); terminalID++)
+	{
+		if ((*this->terminalArray)[terminalID].matchClass != Terminal::Class::LITERAL)
+			continue;
+
+		const char* text = this->GetTerminalText(terminalID);
+		uint32_t i = HashText(text, (int)::strlen(text)) & (tableSize - 1);
+		while ((*this->literalTable)[i] >= 0)
+			i = (i + 1) & (tableSize - 1);
+
+		(*this->literalTable)[i] = terminalID;
+	}
+}
+
+/*static*/ uint32_t CompiledGrammar::HashText(const char* text, int length)
+{
+	// This is the 32-bit FNV-1a hash.
+	uint32_t hash = 2166136261u;
+	for (int i = 0; i < length; i++)
+	{
+		hash ^= (uint8_t)text[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+int CompiledGrammar::LookupLiteral(const Lexer::Token& token) const
+{
+	// A quoted string is never the same thing as a keyword or operator that happens to have the same text.
+	if (token.type == Lexer::Token::Type::STRING_LITERAL || this->literalTable->size() == 0)
+		return -1;
+
+	uint32_t mask = (uint32_t)this->literalTable->size() - 1;
+	uint32_t i = HashText(token.text->c_str(), (int)token.text->length()) & mask;
+	while (true)
+	{
+		int terminalID = (*this->literalTable)[i];
+		if (terminalID < 0)
+			return -1;
+
+		if (*token.text == this->GetTerminalText(terminalID))
+			return terminalID;
+
+		i = (i + 1) & mask;
+	}
+}
+
+void CompiledGrammar::ClassifyTokens(const std::vector<std::shared_ptr<Lexer::Token>>& tokenArray, std::vector<int>& tokenLiteralArray, std::vector<int>& tokenClassArray, std::vector<uint64_t>& tokenClassSetArray) const
+{
+	tokenLiteralArray.resize(tokenArray.size());
+	tokenClassArray.resize(tokenArray.size());
+	tokenClassSetArray.clear();
+
+	// What a token matches is only a function of its literal and its type, so that pair is its class.
+	// Few of the possible pairs ever turn up, so classes are numbered as we find them.
+	int tokenTypeCount = (int)this->tokenTypeTerminalArray->size();
+	std::vector<int> classMap(((int)this->terminalArray->size() + 1) * tokenTypeCount, -1);
+
+	for (int i = 0; i < (signed)tokenArray.size(); i++)
+	{
+		const Lexer::Token& token = *tokenArray[i];
+		int tokenLiteral = this->LookupLiteral(token);
+		tokenLiteralArray[i] = tokenLiteral;
+
+		int& tokenClass = classMap[(tokenLiteral + 1) * tokenTypeCount + (int)token.type];
+		if (tokenClass < 0)
+		{
+			tokenClass = (int)(tokenClassSetArray.size() / this->terminalSetWordCount);
+			tokenClassSetArray.resize(tokenClassSetArray.size() + this->terminalSetWordCount, 0);
+			uint64_t* terminalSet = tokenClassSetArray.data() + tokenClass * this->terminalSetWordCount;
+
+			if (tokenLiteral >= 0)
+				terminalSet[tokenLiteral >> 6] |= uint64_t(1) << (tokenLiteral & 63);
+
+			for (int terminalID : (*this->tokenTypeTerminalArray)[(int)token.type])
+				terminalSet[terminalID >> 6] |= uint64_t(1) << (terminalID & 63);
+		}
+
+		tokenClassArray[i] = tokenClass;
+	}
+}
+
+int CompiledGrammar::FindRule(const std::string& ruleName) const
+{
+	for (int ruleID = 0; ruleID < (signed)this->ruleArray->size(); ruleID++)
+		if (ruleName == this->GetRuleName(ruleID))
+			return ruleID;
+
+	return -1;
+}
+
+int CompiledGrammar::FindTerminal(const std::string& terminalText) const
+{
+	for (int terminalID = 0; terminalID < (signed)this->terminalArray->size(); terminalID++)
+		if (terminalText == this->GetTerminalText(terminalID))
+			return terminalID;
+
+	return -1;
+}
+
+void CompiledGrammar::ComputeAnalysis()
+{
+	int terminalCount = (int)this->terminalArray->size();
+
+	this->BuildTokenTypeTerminals();
+
+	this->hasCuts = false;
+	for (const Sequence& sequence : *this->sequenceArray)
+		if (sequence.cutSymbol >= 0)
+			this->hasCuts = true;
+
+	// Make room for the end-of-input marker too.
+	this->terminalSetWordCount = (terminalCount + 1 + 63) / 64;
+	this->ruleFirstSetArray->assign(this->ruleArray->size() * this->terminalSetWordCount, 0);
+	this->sequenceFirstSetArray->assign(this->sequenceArray->size() * this->terminalSetWordCount, 0);
+	this->ruleFollowSetArray->assign(this->ruleArray->size() * this->terminalSetWordCount, 0);
+
+	// Nullability and FIRST sets are the least fixed-point of the obvious equations.
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (int sequenceID = 0; sequenceID < (signed)this->sequenceArray->size(); sequenceID++)
+		{
+			Sequence& sequence = (*this->sequenceArray)[sequenceID];
+			const Symbol* symbolArray = this->GetSymbols(sequence);
+			uint64_t* sequenceFirstSet = this->sequenceFirstSetArray->data() + sequenceID * this->terminalSetWordCount;
+
+			bool nullable = this->UnionSequenceFirstSet(sequenceFirstSet, symbolArray, sequence.symbolCount);
+			if (nullable && !sequence.nullable)
+			{
+				sequence.nullable = true;
+				changed = true;
+			}
+
+			Rule& rule = (*this->ruleArray)[sequence.ruleID];
+			if (sequence.nullable && !rule.nullable)
+			{
+				rule.nullable = true;
+				changed = true;
+			}
+
+			uint64_t* ruleFirstSet = this->ruleFirstSetArray->data() + sequence.ruleID * this->terminalSetWordCount;
+			if (UnionSet(ruleFirstSet, sequenceFirstSet, this->terminalSetWordCount))
+				changed = true;
+		}
+	}
+
+	// Algorithms that build empty derivations need to pick an alternative for each nullable rule that
+	// only refers to rules whose empty derivations were already picked, or they could recurse forever.
+	changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (Rule& rule : *this->ruleArray)
+		{
+			if (!rule.nullable || rule.nullSequence >= 0)
+				continue;
+
+			for (int i = 0; i < rule.sequenceCount && rule.nullSequence < 0; i++)
+			{
+				const Sequence& sequence = (*this->sequenceArray)[rule.firstSequence + i];
+				const Symbol* symbolArray = this->GetSymbols(sequence);
+
+				int j;
+				for (j = 0; j < sequence.symbolCount; j++)
+					if (symbolArray[j].type != Symbol::Type::NON_TERMINAL || (*this->ruleArray)[symbolArray[j].id].nullSequence < 0)
+						break;
+
+				if (j == sequence.symbolCount)
+				{
+					rule.nullSequence = rule.firstSequence + i;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	// A rule is left-recursive if it can derive a sequence starting with itself.  The rules that can start a rule's
+	// sequences, after nothing but nullable rules, are its left corners, and we just look for the rule among the left
+	// corners of its left corners, and so on.
+	std::vector<std::vector<int>> leftCornerArray(this->ruleArray->size());
+	for (const Sequence& sequence : *this->sequenceArray)
+	{
+		const Symbol* symbolArray = this->GetSymbols(sequence);
+		for (int i = 0; i < sequence.symbolCount && symbolArray[i].type == Symbol::Type::NON_TERMINAL; i++)
+		{
+			leftCornerArray[sequence.ruleID].push_back(symbolArray[i].id);
+			if (!(*this->ruleArray)[symbolArray[i].id].nullable)
+				break;
+		}
+	}
+
+	std::vector<bool> visitedArray;
+	std::vector<int> ruleStack;
+	for (int ruleID = 0; ruleID < (signed)this->ruleArray->size(); ruleID++)
+	{
+		visitedArray.assign(this->ruleArray->size(), false);
+		ruleStack = leftCornerArray[ruleID];
+		while (ruleStack.size() > 0 && !(*this->ruleArray)[ruleID].leftRecursive)
+		{
+			int cornerRuleID = ruleStack.back();
+			ruleStack.pop_back();
+
+			if (cornerRuleID == ruleID)
+				(*this->ruleArray)[ruleID].leftRecursive = true;
+			else if (!visitedArray[cornerRuleID])
+			{
+				visitedArray[cornerRuleID] = true;
+				for (int nextRuleID : leftCornerArray[cornerRuleID])
+					ruleStack.push_back(nextRuleID);
+			}
+		}
+	}
+
+	// Now FOLLOW sets, which depend on the FIRST sets.
+	if (this->initialRuleID >= 0)
+	{
+		int endOfInput = this->GetEndOfInputTerminal();
+		this->ruleFollowSetArray->data()[this->initialRuleID * this->terminalSetWordCount + (endOfInput >> 6)] |= uint64_t(1) << (endOfInput & 63);
+	}
+
+	changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (const Sequence& sequence : *this->sequenceArray)
+		{
+			const Symbol* symbolArray = this->GetSymbols(sequence);
+
+			for (int i = 0; i < sequence.symbolCount; i++)
+			{
+				if (symbolArray[i].type != Symbol::Type::NON_TERMINAL)
+					continue;
+
+				uint64_t* followSet = this->ruleFollowSetArray->data() + symbolArray[i].id * this->terminalSetWordCount;
+
+				std::vector<uint64_t> restFirstSet(this->terminalSetWordCount, 0);
+				bool restNullable = this->UnionSequenceFirstSet(restFirstSet.data(), symbolArray + i + 1, sequence.symbolCount - i - 1);
+				if (UnionSet(followSet, restFirstSet.data(), this->terminalSetWordCount))
+					changed = true;
+
+				if (restNullable && UnionSet(followSet, this->GetFollowSet(sequence.ruleID), this->terminalSetWordCount))
+					changed = true;
+			}
+		}
+	}
+}
+
+void CompiledGrammar::BuildTokenTypeTerminals()
+{
+	// Which non-literal terminals can match a token is only a function of its type.
+	int tokenTypeCount = (int)Lexer::Token::Type::CLOSE_CURLY_BRACE + 1;
+	this->tokenTypeTerminalArray->clear();
+	this->tokenTypeTerminalArray->resize(tokenTypeCount);
+	for (int tokenType = 0; tokenType < tokenTypeCount; tokenType++)
+		for (int terminalID = 0; terminalID < (signed)this->terminalArray->size(); terminalID++)
+			if ((*this->terminalArray)[terminalID].matchClass != Terminal::Class::LITERAL && this->TerminalMatches(terminalID, (Lexer::Token::Type)tokenType, -1))
+				(*this->tokenTypeTerminalArray)[tokenType].push_back(terminalID);
+}
+
+bool CompiledGrammar::UnionSequenceFirstSet(uint64_t* terminalSet, const Symbol* symbolArray, int symbolCount) const
+{
+	for (int i = 0; i < symbolCount; i++)
+	{
+		const Symbol& symbol = symbolArray[i];
+
+		if (symbol.type == Symbol::Type::TERMINAL)
+		{
+			terminalSet[symbol.id >> 6] |= uint64_t(1) << (symbol.id & 63);
+			return false;
+		}
+
+		UnionSet(terminalSet, this->GetFirstSet(symbol.id), this->terminalSetWordCount);
+
+		if (!(*this->ruleArray)[symbol.id].nullable)
+			return false;
+	}
+
+	return true;
+}
+
+/*static*/ bool CompiledGrammar::UnionSet(uint64_t* terminalSetA, const uint64_t* terminalSetB, int wordCount)
+{
+	bool changed = false;
+
+	for (int i = 0; i < wordCount; i++)
+	{
+		uint64_t word = terminalSetA[i] | terminalSetB[i];
+		if (word != terminalSetA[i])
+		{
+			terminalSetA[i] = word;
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+void CompiledGrammar::GetTerminalSetText(const uint64_t* terminalSet, std::vector<std::string>& terminalTextArray) const
+{
+	terminalTextArray.clear();
+
+	for (int terminalID = 0; terminalID < (signed)this->terminalArray->size(); terminalID++)
+		if (SetContains(terminalSet, terminalID))
+			terminalTextArray.push_back(this->GetTerminalText(terminalID));
+
+	if (SetContains(terminalSet, this->GetEndOfInputTerminal()))
+		terminalTextArray.push_back("@end");
+}
+
+bool CompiledGrammar::GetFirstSet(const std::string& ruleName, std::vector<std::string>& terminalTextArray) const
+{
+	int ruleID = this->FindRule(ruleName);
+	if (ruleID < 0)
+		return false;
+
+	this->GetTerminalSetText(this->GetFirstSet(ruleID), terminalTextArray);
+	return true;
+}
+
+bool CompiledGrammar::GetFollowSet(const std::string& ruleName, std::vector<std::string>& terminalTextArray) const
+{
+	int ruleID = this->FindRule(ruleName);
+	if (ruleID < 0)
+		return false;
+
+	this->GetTerminalSetText(this->GetFollowSet(ruleID), terminalTextArray);
+	return true;
+}
+
+bool CompiledGrammar::IsNullable(const std::string& ruleName) const
+{
+	int ruleID = this->FindRule(ruleName);
+	if (ruleID < 0)
+		return false;
+
+	return (*this->ruleArray)[ruleID].nullable;
+}
+
+bool CompiledGrammar::IsLeftRecursive(const std::string& ruleName) const
+{
+	int ruleID = this->FindRule(ruleName);
+	if (ruleID < 0)
+		return false;
+
+	return (*this->ruleArray)[ruleID].leftRecursive;
+}
+
+const LL1ParseTable* CompiledGrammar::GetLL1ParseTable(std::string& error) const
+{
+	// A table never changes once it's built (or found not to build), so only building it takes the lock.
+	if (!this->ll1ParseTableBuilt.load())
+	{
+		std::lock_guard<std::mutex> lock(*this->tableMutex);
+
+		if (!this->ll1ParseTableBuilt.load())
+		{
+			LL1ParseTable* parseTable = new LL1ParseTable();
+			std::string buildError;
+			if (parseTable->Build(this, buildError))
+				this->ll1ParseTable = parseTable;
+			else
+			{
+				delete parseTable;
+				this->ll1ParseTableError = new std::string(buildError);
+			}
+
+			this->ll1ParseTableBuilt.store(true);
+		}
+	}
+
+	if (this->ll1ParseTableError)
+		error = *this->ll1ParseTableError;
+
+	return this->ll1ParseTable;
+}
+
+const LALRParseTable* CompiledGrammar::GetLALRParseTable(std::string& error, bool allowConflicts /*= false*/) const
+{
+	if (!this->lalrParseTableBuilt.load())
+	{
+		std::lock_guard<std::mutex> lock(*this->tableMutex);
+
+		if (!this->lalrParseTableBuilt.load())
+		{
+			LALRParseTable* parseTable = new LALRParseTable();
+			std::string buildError;
+			if (parseTable->Build(this, buildError))
+				this->lalrParseTable = parseTable;
+			else
+			{
+				delete parseTable;
+				this->lalrParseTableError = new std::string(buildError);
+			}
+
+			this->lalrParseTableBuilt.store(true);
+		}
+	}
+
+	if (this->lalrParseTableError)
+	{
+		error = *this->lalrParseTableError;
+		return nullptr;
+	}
+
+	if (!allowConflicts && this->lalrParseTable->HasConflicts())
+	{
+		error = "Grammar is not LALR(1)." + this->lalrParseTable->GetConflictText();
+		return nullptr;
+	}
+
+	return this->lalrParseTable;
+}
+
+const CNFGrammar* CompiledGrammar::GetCNFGrammar() const
+{
+	if (!this->cnfGrammarBuilt.load())
+	{
+		std::lock_guard<std::mutex> lock(*this->tableMutex);
+
+		if (!this->cnfGrammarBuilt.load())
+		{
+			this->cnfGrammar = new CNFGrammar();
+			this->cnfGrammar->Build(this);
+			this->cnfGrammarBuilt.store(true);
+		}
+	}
+
+	return this->cnfGrammar;
+}
+
+const CharacterScanner* CompiledGrammar::GetCharacterScanner(std::string& error) const
+{
+	if (!this->characterScannerBuilt.load())
+	{
+		std::lock_guard<std::mutex> lock(*this->tableMutex);
+
+		if (!this->characterScannerBuilt.load())
+		{
+			CharacterScanner* characterScanner = new CharacterScanner();
+			std::string buildError;
+			if (characterScanner->Build(this, buildError))
+				this->characterScanner = characterScanner;
+			else
+			{
+				delete characterScanner;
+				this->characterScannerError = new std::string(buildError);
+			}
+
+			this->characterScannerBuilt.store(true);
+		}
+	}
+
+	if (this->characterScannerError)
+		error = *this->characterScannerError;
+
+	return this->characterScanner;
+}
\ No newline at end of file
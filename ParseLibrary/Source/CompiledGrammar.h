@@ -0,0 +1,266 @@
+#pragma once
+
+#include "Common.h"
+#include "Lexer.h"
+#include "Grammar.h"
+#include "FlatArray.h"
+#include "Bundle.h"
+
+namespace ParseParty
+{
+	class LL1ParseTable;
+	class LALRParseTable;
+	class CNFGrammar;
+	class CharacterScanner;
+	class MappedFile;
+
+	// This is the form of a grammar that the parse algorithms actually run against.  Rules, match
+	// sequences and terminals are all identified by dense integer IDs, match sequences are flat runs
+	// of tagged symbols, and each terminal is resolved up-front to either a class of lexer token
+	// (e.g., "@number") or an interned literal.  Once compiled, it is never modified, so the inner
+	// loops of a parse never need to do a string comparison, a map lookup or a dynamic cast.
+	//
+	// All the arrays are flat runs of plain old data, so they can also be written out to a bundle file
+	// as-is, and later looked at right where they sit in the mapped file without being read in at all.
+	class PARSE_PARTY_API CompiledGrammar
+	{
+	public:
+		CompiledGrammar();
+		virtual ~CompiledGrammar();
+
+		bool Compile(const Grammar* grammar, std::string& error);
+		void Clear();
+
+		// Rework the grammar with the passes of the GrammarOptimizer.  This has to be done before any parse tables are built.
+		// The parse algorithms don't care, but the trees they build have to be put back into shape with Parser::RestoreTree().
+		bool Optimize();
+		bool IsOptimized() const { return this->optimized; }
+
+		// True if the trees built for the grammar have nodes to splice or plans to follow (e.g., for repetitions), which Parser::RestoreTree() takes care of.
+		bool NeedsTreeRestore() const { return this->needsTreeRestore; }
+
+		// True if any alternative has a cut in it, which the quick algorithm uses to size its memo table.
+		bool HasCuts() const { return this->hasCuts; }
+
+		// Any parse tables already built go into the bundle along with the grammar, so that they needn't be built again.
+		void WriteBundle(Bundle::Writer& bundleWriter) const;
+		bool ReadBundle(const Bundle::Reader& bundleReader, std::string& error);
+
+		struct Symbol
+		{
+			enum class Type : uint8_t
+			{
+				TERMINAL,
+				NON_TERMINAL
+			};
+
+			Type type;
+			int id;		// A terminal ID or a rule ID, depending on the type.
+		};
+
+		struct Terminal
+		{
+			enum class Class : uint8_t
+			{
+				LITERAL,
+				STRING,
+				NUMBER,
+				INT,
+				FLOAT,
+				IDENTIFIER,
+				PATTERN		// Written between slashes (e.g., "/[0-9]+/"), these only match characters, for the scannerless algorithm.
+			};
+
+			Class matchClass;
+			int textOffset;
+		};
+
+		struct Sequence
+		{
+			int ruleID;
+			int firstSymbol;
+			int symbolCount;
+			Grammar::MatchSequence::Type type;
+			bool hasAdjacentNonTerminals;
+			bool nullable;
+			int cutSymbol;		// How many symbols come before the cut, or -1 if there isn't one.
+		};
+
+		struct Rule
+		{
+			int nameOffset;
+			int firstSequence;
+			int sequenceCount;
+			bool nullable;
+			int nullSequence;		// If nullable, this is an alternative to use for an empty derivation of the rule that doesn't go around in circles.
+			bool leftRecursive;
+			bool spliced;		// Is this a tail rule made by the optimizer, or a rule made for a repetition?  Nodes for these get spliced into their parents.
+			bool repeats;		// If so, is it of the form "R -> X R | Y R | ... | (nothing)"?  Then the alternatives, less R, can be matched in a loop.
+			int restorePlanOffset;		// If the optimizer changed the shape of the rule's nodes, this is where to find how to change it back.
+			int restorePlanSize;
+			int firstOperator;		// For operator rules, this is where to find the binary operators, which get built into a tree by precedence after the parse.
+			int operatorCount;
+		};
+
+		struct Operator
+		{
+			int terminalID;
+			int precedence;
+			bool rightAssociative;
+		};
+
+		int GetRuleCount() const { return (int)this->ruleArray->size(); }
+		int GetSequenceCount() const { return (int)this->sequenceArray->size(); }
+		int GetTerminalCount() const { return (int)this->terminalArray->size(); }
+		int GetInitialRuleID() const { return this->initialRuleID; }
+
+		const Rule& GetRule(int ruleID) const { return (*this->ruleArray)[ruleID]; }
+		const Sequence& GetSequence(int sequenceID) const { return (*this->sequenceArray)[sequenceID]; }
+		const Terminal& GetTerminal(int terminalID) const { return (*this->terminalArray)[terminalID]; }
+		const Operator& GetOperator(int operatorID) const { return (*this->operatorArray)[operatorID]; }
+		const Symbol* GetSymbols(const Sequence& sequence) const { return this->symbolArray->data() + sequence.firstSymbol; }
+		const char* GetRuleName(int ruleID) const { return this->stringPool->data() + (*this->ruleArray)[ruleID].nameOffset; }
+		const char* GetTerminalText(int terminalID) const { return this->stringPool->data() + (*this->terminalArray)[terminalID].textOffset; }
+
+		// These are the terminals the scannerless algorithm skips over before every other terminal (e.g., whitespace and comments.)
+		int GetSkipTerminalCount() const { return (int)this->skipTerminalArray->size(); }
+		int GetSkipTerminal(int i) const { return (*this->skipTerminalArray)[i]; }
+
+		// A restore plan is a run of integers encoded as GrammarOptimizer::EncodePlan() describes.
+		const int* GetRestorePlan(const Rule& rule) const { return this->restorePlanArray->data() + rule.restorePlanOffset; }
+
+		// These involve string work, so don't call them while parsing.
+		int FindRule(const std::string& ruleName) const;
+		int FindTerminal(const std::string& terminalText) const;
+
+		// Return the literal terminal ID matching the given token, or -1 if there is none.
+		int LookupLiteral(const Lexer::Token& token) const;
+
+		// Resolve every token of the given array to its literal terminal ID (or -1) once, and to a token class.  Tokens
+		// in the same class match the same terminals, and the set of those is made once per class, so that matching a
+		// token against a terminal during the parse comes down to a bit test.  Class sets are GetTerminalSetWordCount() words long.
+		void ClassifyTokens(const std::vector<std::shared_ptr<Lexer::Token>>& tokenArray, std::vector<int>& tokenLiteralArray, std::vector<int>& tokenClassArray, std::vector<uint64_t>& tokenClassSetArray) const;
+
+		bool TerminalMatches(int terminalID, Lexer::Token::Type tokenType, int tokenLiteral) const
+		{
+			switch ((*this->terminalArray)[terminalID].matchClass)
+			{
+				case Terminal::Class::LITERAL:
+					return tokenLiteral == terminalID;
+				case Terminal::Class::STRING:
+					return tokenType == Lexer::Token::Type::STRING_LITERAL;
+				case Terminal::Class::NUMBER:
+					return tokenType == Lexer::Token::Type::NUMBER_LITERAL_INT || tokenType == Lexer::Token::Type::NUMBER_LITERAL_FLOAT;
+				case Terminal::Class::INT:
+					return tokenType == Lexer::Token::Type::NUMBER_LITERAL_INT;
+				case Terminal::Class::FLOAT:
+					return tokenType == Lexer::Token::Type::NUMBER_LITERAL_FLOAT;
+				case Terminal::Class::IDENTIFIER:
+					return tokenType == Lexer::Token::Type::IDENTIFIER;
+				case Terminal::Class::PATTERN:
+					return false;
+			}
+
+			return false;
+		}
+
+		// Get the non-literal terminals (e.g., "@string") that match tokens of the given type.
+		const std::vector<int>& GetTokenTypeTerminals(Lexer::Token::Type tokenType) const { return (*this->tokenTypeTerminalArray)[(int)tokenType]; }
+
+		// A token matches its literal, if it has one, and then the non-literal terminals for its type (e.g., "print", lexed as an
+		// identifier, matches both "print" and "@identifier").  Where a table has something for more than one of these, the literal
+		// wins, the way a keyword wins out over an identifier, so "print" can be a keyword without clashing with "@identifier".
+		// This returns the first of the token's terminals, in that order, that the given predicate likes, or -1 if none of them.
+		template<typename Predicate>
+		int FindPrecedentTerminal(Lexer::Token::Type tokenType, int tokenLiteral, Predicate predicate) const
+		{
+			if (tokenLiteral >= 0 && predicate(tokenLiteral))
+				return tokenLiteral;
+
+			for (int terminalID : this->GetTokenTypeTerminals(tokenType))
+				if (predicate(terminalID))
+					return terminalID;
+
+			return -1;
+		}
+
+		static uint32_t HashText(const char* text, int length);
+
+		// The FIRST and FOLLOW sets are bit-sets over terminal IDs, each GetTerminalSetWordCount() words long.
+		// There is one extra bit, at the index GetEndOfInputTerminal(), used to mark the end of the token stream.
+		int GetTerminalSetWordCount() const { return this->terminalSetWordCount; }
+		int GetEndOfInputTerminal() const { return (int)this->terminalArray->size(); }
+		const uint64_t* GetFirstSet(int ruleID) const { return this->ruleFirstSetArray->data() + ruleID * this->terminalSetWordCount; }
+		const uint64_t* GetSequenceFirstSet(int sequenceID) const { return this->sequenceFirstSetArray->data() + sequenceID * this->terminalSetWordCount; }
+		const uint64_t* GetFollowSet(int ruleID) const { return this->ruleFollowSetArray->data() + ruleID * this->terminalSetWordCount; }
+
+		static bool SetContains(const uint64_t* terminalSet, int terminalID)
+		{
+			return (terminalSet[terminalID >> 6] & (uint64_t(1) << (terminalID & 63))) != 0;
+		}
+
+		// These are for the benefit of a human trying to reason about their grammar.
+		void GetTerminalSetText(const uint64_t* terminalSet, std::vector<std::string>& terminalTextArray) const;
+		bool GetFirstSet(const std::string& ruleName, std::vector<std::string>& terminalTextArray) const;
+		bool GetFollowSet(const std::string& ruleName, std::vector<std::string>& terminalTextArray) const;
+		bool IsNullable(const std::string& ruleName) const;
+		bool IsLeftRecursive(const std::string& ruleName) const;
+
+		// Parse tables are built the first time they're asked for, and then cached until the grammar is cleared.  Only building one
+		// takes a lock, and Grammar::Compile() builds whatever its algorithm needs, so the parses after that never wait on each other.
+		// If the grammar doesn't admit the table (e.g., it isn't LL(1)), then null is returned with all conflicts listed in the error.
+		const LL1ParseTable* GetLL1ParseTable(std::string& error) const;
+		// The LALR(1) table is kept even if it has conflicts, for the benefit of the GLR algorithm, which asks for it that way.
+		const LALRParseTable* GetLALRParseTable(std::string& error, bool allowConflicts = false) const;
+		// Any grammar can be put into Chomsky normal form, so this one never fails.
+		const CNFGrammar* GetCNFGrammar() const;
+		// The scanner isn't bundled, since it's quick to build.  This fails if any of the patterns won't compile.
+		const CharacterScanner* GetCharacterScanner(std::string& error) const;
+
+	private:
+
+		void ComputeAnalysis();
+		bool CheckBundleIndices() const;
+		void BuildTokenTypeTerminals();
+		bool UnionSequenceFirstSet(uint64_t* terminalSet, const Symbol* symbolArray, int symbolCount) const;
+		static bool HasAdjacentNonTerminals(const Symbol* symbolArray, int symbolCount);
+		static bool UnionSet(uint64_t* terminalSetA, const uint64_t* terminalSetB, int wordCount);
+
+		int AddString(const std::string& text);
+		int InternTerminal(const std::string& terminalText);
+		void BuildLiteralTable();
+
+		FlatArray<Rule>* ruleArray;
+		FlatArray<Sequence>* sequenceArray;
+		FlatArray<Symbol>* symbolArray;
+		FlatArray<Terminal>* terminalArray;
+		FlatArray<char>* stringPool;
+		FlatArray<int>* literalTable;		// Open-addressed hash table of literal terminal IDs; -1 marks an empty slot.
+		std::vector<std::vector<int>>* tokenTypeTerminalArray;		// For each lexer token type, the non-literal terminals it matches.  This one isn't bundled, but it's cheap to rebuild.
+		FlatArray<uint64_t>* ruleFirstSetArray;
+		FlatArray<uint64_t>* sequenceFirstSetArray;
+		FlatArray<uint64_t>* ruleFollowSetArray;
+		FlatArray<int>* restorePlanArray;
+		FlatArray<Operator>* operatorArray;
+		FlatArray<int>* skipTerminalArray;
+		int terminalSetWordCount;
+		int initialRuleID;
+		bool optimized;
+		bool needsTreeRestore;
+		bool hasCuts;
+		std::shared_ptr<MappedFile> bundleFile;		// If we were read from a bundle, then the arrays above are looking into this.
+
+		std::mutex* tableMutex;		// Only held while building a table.  Once a table's flag is set, the table is read without it.
+		mutable std::atomic<bool> ll1ParseTableBuilt;
+		mutable std::atomic<bool> lalrParseTableBuilt;
+		mutable std::atomic<bool> cnfGrammarBuilt;
+		mutable std::atomic<bool> characterScannerBuilt;
+		mutable LL1ParseTable* ll1ParseTable;
+		mutable std::string* ll1ParseTableError;
+		mutable LALRParseTable* lalrParseTable;
+		mutable std::string* lalrParseTableError;
+		mutable CNFGrammar* cnfGrammar;
+		mutable CharacterScanner* characterScanner;
+		mutable std::string* characterScannerError;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Common.h"
+
+namespace ParseParty
+{
+	// This is an array of plain old data that either owns its elements, just like a vector, or merely
+	// looks at elements living somewhere else, such as in a memory-mapped bundle file.  It reads the
+	// same either way, so the code using it doesn't care where the data came from.  Only an owning array
+	// can grow, and clearing a viewing array turns it back into an empty owning array.
+	template<typename T>
+	class FlatArray
+	{
+	public:
+		FlatArray()
+		{
+			this->viewData = nullptr;
+			this->viewSize = 0;
+			this->viewing = false;
+		}
+
+		size_t size() const { return this->viewing ? this->viewSize : this->ownedArray.size(); }
+
+		T* data() { return this->viewing ? this->viewData : this->ownedArray.data(); }
+		const T* data() const { return this->viewing ? this->viewData : this->ownedArray.data(); }
+
+		T& operator[](size_t i) { return this->data()[i]; }
+		const T& operator[](size_t i) const { return this->data()[i]; }
+
+		T* begin() { return this->data(); }
+		T* end() { return this->data() + this->size(); }
+		const T* begin() const { return this->data(); }
+		const T* end() const { return this->data() + this->size(); }
+
+		T& back() { return this->data()[this->size() - 1]; }
+
+		void clear()
+		{
+			this->ownedArray.clear();
+			this->viewData = nullptr;
+			this->viewSize = 0;
+			this->viewing = false;
+		}
+
+		void push_back(const T& value)
+		{
+			assert(!this->viewing);
+			this->ownedArray.push_back(value);
+		}
+
+		void resize(size_t size, const T& value = T())
+		{
+			assert(!this->viewing);
+			this->ownedArray.resize(size, value);
+		}
+
+		void assign(size_t size, const T& value)
+		{
+			this->clear();
+			this->ownedArray.assign(size, value);
+		}
+
+		// The caller is responsible for keeping the given data around for as long as we're looking at it.
+		void View(T* data, size_t size)
+		{
+			this->ownedArray.clear();
+			this->viewData = data;
+			this->viewSize = size;
+			this->viewing = true;
+		}
+
+		bool IsView() const { return this->viewing; }
+
+	private:
+
+		std::vector<T> ownedArray;
+		T* viewData;
+		size_t viewSize;
+		bool viewing;
+	};
+}
\ No newline at end of file
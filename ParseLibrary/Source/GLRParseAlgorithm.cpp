@@ -0,0 +1,302 @@
+#include "GLRParseAlgorithm.h"
+
+using namespace ParseParty;
+
+GLRParseAlgorithm::GLRParseAlgorithm(const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray, const Grammar* grammar) : Algorithm(tokenArray, grammar)
+{
+	this->parseTable = nullptr;
+	this->parsePosition = 0;
+	this->stackNodeArena = new std::deque<StackNode>();
+	this->stackEdgeArena = new std::deque<StackEdge>();
+	this->frontierArray = new std::vector<StackNode*>();
+	this->stateNodeArray = new std::vector<StackNode*>();
+	this->reduceQueue = new std::vector<std::pair<StackNode*, StackEdge*>>();
+	this->pathValueArray = new std::vector<int>();
+	this->valueArray = new std::vector<ForestValue>();
+	this->childValueArray = new std::vector<int>();
+	this->ambiguitySet = new std::set<std::pair<int, int>>();
+	this->actionBuffer = new std::vector<LALRParseTable::Action>();
+	this->token = nullptr;
+	this->tokenLiteral = -1;
+}
+
+/*virtual*/ GLRParseAlgorithm::~GLRParseAlgorithm()
+{
+	delete this->stackNodeArena;
+	delete this->stackEdgeArena;
+	delete this->frontierArray;
+	delete this->stateNodeArray;
+	delete this->reduceQueue;
+	delete this->pathValueArray;
+	delete this->valueArray;
+	delete this->childValueArray;
+	delete this->ambiguitySet;
+	delete this->actionBuffer;
+}
+
+/*virtual*/ Parser::SyntaxNode* GLRParseAlgorithm::Parse()
+{
+	this->parseTable = this->compiledGrammar->GetLALRParseTable(*this->error, true);
+	if (!this->parseTable)
+		return nullptr;
+
+	int tokenCount = (int)this->tokenArray->size();
+	if (tokenCount == 0)
+		return nullptr;
+
+	this->stackNodeArena->clear();
+	this->stackEdgeArena->clear();
+	this->frontierArray->clear();
+	this->stateNodeArray->assign(this->parseTable->GetStateCount(), nullptr);
+	this->valueArray->clear();
+	this->childValueArray->clear();
+	this->ambiguityArray->clear();
+
+	this->parsePosition = 0;
+
+	bool created = false;
+	StackNode* bottomNode = this->GetStackNode(0, 0, created);
+
+	while (true)
+	{
+		this->token = (this->parsePosition < tokenCount) ? (*this->tokenArray)[this->parsePosition].get() : nullptr;
+		this->tokenLiteral = this->token ? (*this->tokenLiteralArray)[this->parsePosition] : -1;
+		this->ambiguitySet->clear();
+
+		// Perform all reductions possible on the current token.  This may add stack tops, which get reduced in turn, and edges
+		// to the stack tops already reduced, which get reduced again along those.  A long list can call for as many of these
+		// as it has items, all in a chain, which is why they're queued up here, rather than done right away.
+		this->reduceQueue->clear();
+		for (StackNode* node : *this->frontierArray)
+			this->reduceQueue->push_back(std::pair<StackNode*, StackEdge*>(node, nullptr));
+
+		while (this->reduceQueue->size() > 0)
+		{
+			std::pair<StackNode*, StackEdge*> pair = this->reduceQueue->back();
+			this->reduceQueue->pop_back();
+			if (!pair.second)
+				pair.first->reduced = true;
+
+			this->PerformReductions(pair.first, pair.second);
+		}
+
+		if (!this->token)
+			break;
+
+		// Now shift the token onto every stack that can take it.
+		int tokenValue = (int)this->valueArray->size();
+		this->valueArray->push_back(ForestValue{ -1, this->parsePosition, 0, 0, -1 });
+
+		std::vector<StackNode*> shiftArray = *this->frontierArray;
+		for (StackNode* node : shiftArray)
+			(*this->stateNodeArray)[node->state] = nullptr;
+
+		this->frontierArray->clear();
+		this->parsePosition++;
+
+		for (StackNode* node : shiftArray)
+		{
+			int actionCount = 0;
+			const LALRParseTable::Action* actionArray = this->parseTable->FindAllActions(node->state, this->token, this->tokenLiteral, actionCount, *this->actionBuffer);
+			for (int i = 0; i < actionCount; i++)
+			{
+				if (actionArray[i].type == LALRParseTable::Action::Type::SHIFT)
+				{
+					StackNode* shiftNode = this->GetStackNode(actionArray[i].value, this->parsePosition, created);
+					this->AddStackEdge(shiftNode, node, tokenValue);
+				}
+			}
+		}
+
+		// If no stack could take the token, then every stack has died, and we're done.
+		if (this->frontierArray->size() == 0)
+		{
+			const Lexer::FileLocation& fileLocation = this->token->fileLocation;
+			*this->error = FormatString("Failed to parse at line %d, column %d.", fileLocation.line, fileLocation.column);
+			return nullptr;
+		}
+	}
+
+	for (StackNode* node : *this->frontierArray)
+	{
+		int actionCount = 0;
+		const LALRParseTable::Action* actionArray = this->parseTable->FindAllActions(node->state, nullptr, -1, actionCount, *this->actionBuffer);
+		for (int i = 0; i < actionCount; i++)
+		{
+			if (actionArray[i].type != LALRParseTable::Action::Type::ACCEPT)
+				continue;
+
+			for (StackEdge* edge = node->firstEdge; edge; edge = edge->nextEdge)
+				if (edge->targetNode == bottomNode)
+					return this->BuildNode(edge->value);
+		}
+	}
+
+	const Lexer::FileLocation& fileLocation = (*this->tokenArray)[tokenCount - 1]->fileLocation;
+	*this->error = FormatString("Failed to parse at line %d, column %d: unexpected end of input.", fileLocation.line, fileLocation.column);
+	return nullptr;
+}
+
+GLRParseAlgorithm::StackNode* GLRParseAlgorithm::GetStackNode(int state, int parsePosition, bool& created)
+{
+	StackNode* node = (*this->stateNodeArray)[state];
+	if (node)
+	{
+		created = false;
+		return node;
+	}
+
+	this->stackNodeArena->push_back(StackNode{ state, parsePosition, false, nullptr });
+	node = &this->stackNodeArena->back();
+	this->frontierArray->push_back(node);
+	(*this->stateNodeArray)[state] = node;
+	created = true;
+	return node;
+}
+
+GLRParseAlgorithm::StackEdge* GLRParseAlgorithm::AddStackEdge(StackNode* node, StackNode* targetNode, int value)
+{
+	// New edges go at the front, so that any walk of the edges already underway doesn't see them.
+	this->stackEdgeArena->push_back(StackEdge{ targetNode, value, node->firstEdge });
+	node->firstEdge = &this->stackEdgeArena->back();
+	return node->firstEdge;
+}
+
+// Perform every reduction called for by the current token on the given stack top.  If an edge is
+// given, then only reductions along paths through that edge are performed, because all the others
+// were already performed.
+void GLRParseAlgorithm::PerformReductions(StackNode* node, StackEdge* requiredEdge)
+{
+	int actionCount = 0;
+	const LALRParseTable::Action* actionArray = this->parseTable->FindAllActions(node->state, this->token, this->tokenLiteral, actionCount, *this->actionBuffer);
+
+	for (int i = 0; i < actionCount; i++)
+	{
+		if (actionArray[i].type != LALRParseTable::Action::Type::REDUCE)
+			continue;
+
+		int pathLength = this->compiledGrammar->GetSequence(actionArray[i].value).symbolCount;
+		if (pathLength == 0 && requiredEdge)
+			continue;
+
+		this->FindReductionPaths(node, actionArray[i].value, pathLength, requiredEdge, requiredEdge == nullptr);
+	}
+}
+
+void GLRParseAlgorithm::FindReductionPaths(StackNode* node, int sequenceID, int pathLength, StackEdge* requiredEdge, bool requiredEdgeFound)
+{
+	if (pathLength == 0)
+	{
+		if (requiredEdgeFound)
+			this->Reduce(node, sequenceID);
+
+		return;
+	}
+
+	for (StackEdge* edge = node->firstEdge; edge; edge = edge->nextEdge)
+	{
+		this->pathValueArray->push_back(edge->value);
+		this->FindReductionPaths(edge->targetNode, sequenceID, pathLength - 1, requiredEdge, requiredEdgeFound || edge == requiredEdge);
+		this->pathValueArray->pop_back();
+	}
+}
+
+void GLRParseAlgorithm::Reduce(StackNode* targetNode, int sequenceID)
+{
+	const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+
+	// A table we built ourselves always has somewhere to go here, but one read from a damaged bundle might not, and then the stack just dies.
+	int state = this->parseTable->GetGoto(targetNode->state, sequence.ruleID);
+	if (state < 0)
+		return;
+
+	// The values of the path are the last ones on the path array, in reverse order.
+	int value = (int)this->valueArray->size();
+	this->valueArray->push_back(ForestValue{ sequenceID, targetNode->parsePosition, (int)this->childValueArray->size(), sequence.symbolCount, -1 });
+	for (int i = 0; i < sequence.symbolCount; i++)
+		this->childValueArray->push_back((*this->pathValueArray)[this->pathValueArray->size() - 1 - i]);
+
+	bool created = false;
+	StackNode* node = this->GetStackNode(state, this->parsePosition, created);
+	if (created)
+	{
+		this->AddStackEdge(node, targetNode, value);
+		this->reduceQueue->push_back(std::pair<StackNode*, StackEdge*>(node, nullptr));
+		return;
+	}
+
+	// If the stacks have already met, then we've found another derivation of the same rule over the same tokens.
+	for (StackEdge* edge = node->firstEdge; edge; edge = edge->nextEdge)
+	{
+		if (edge->targetNode == targetNode)
+		{
+			ForestValue& existingValue = (*this->valueArray)[edge->value];
+			(*this->valueArray)[value].alternative = existingValue.alternative;
+			existingValue.alternative = value;
+			this->RecordAmbiguity((*this->valueArray)[value]);
+			return;
+		}
+	}
+
+	// Otherwise, the new edge makes new paths, and those need to be reduced along wherever we already did our reductions.
+	// Stack tops not reduced yet will take the new edge into account when they are.
+	StackEdge* edge = this->AddStackEdge(node, targetNode, value);
+	for (int i = 0; i < (int)this->frontierArray->size(); i++)
+		if ((*this->frontierArray)[i]->reduced)
+			this->reduceQueue->push_back(std::pair<StackNode*, StackEdge*>((*this->frontierArray)[i], edge));
+}
+
+void GLRParseAlgorithm::RecordAmbiguity(const ForestValue& value)
+{
+	int ruleID = this->compiledGrammar->GetSequence(value.sequenceID).ruleID;
+	if (this->ambiguitySet->find(std::pair<int, int>(ruleID, value.parsePosition)) != this->ambiguitySet->end())
+		return;
+
+	this->ambiguitySet->insert(std::pair<int, int>(ruleID, value.parsePosition));
+
+	Parser::Ambiguity ambiguity;
+	ambiguity.ruleName = this->compiledGrammar->GetRuleName(ruleID);
+	ambiguity.firstToken = value.parsePosition;
+	ambiguity.lastToken = this->parsePosition - 1;
+	ambiguity.fileLocation = (*this->tokenArray)[std::min(value.parsePosition, (int)this->tokenArray->size() - 1)]->fileLocation;
+	this->ambiguityArray->push_back(ambiguity);
+}
+
+Parser::SyntaxNode* GLRParseAlgorithm::BuildNode(int value)
+{
+	const ForestValue& forestValue = (*this->valueArray)[value];
+
+	if (forestValue.sequenceID < 0)
+	{
+		const Lexer::Token* token = (*this->tokenArray)[forestValue.parsePosition].get();
+		return new Parser::SyntaxNode(*token->text, token->fileLocation);
+	}
+
+	int ruleID = this->compiledGrammar->GetSequence(forestValue.sequenceID).ruleID;
+	const Lexer::FileLocation& fileLocation = (*this->tokenArray)[std::min(forestValue.parsePosition, (int)this->tokenArray->size() - 1)]->fileLocation;
+	Parser::SyntaxNode* parentNode = new Parser::SyntaxNode(this->compiledGrammar->GetRuleName(ruleID), fileLocation);
+
+	// A repetition "R -> X R" would have us recurse once per item, so we loop down the chain of R values instead,
+	// and put all the items into the one node.
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	while (true)
+	{
+		const ForestValue& chainValue = (*this->valueArray)[value];
+		bool repeating = (rule.repeats && this->compiledGrammar->GetSequence(chainValue.sequenceID).symbolCount > 0);
+		int childCount = repeating ? (chainValue.childCount - 1) : chainValue.childCount;
+
+		for (int i = 0; i < childCount; i++)
+		{
+			Parser::SyntaxNode* childNode = this->BuildNode((*this->childValueArray)[chainValue.childOffset + i]);
+			parentNode->childList->push_back(childNode);
+			childNode->parentNode = parentNode;
+		}
+
+		if (!repeating)
+			break;
+
+		value = (*this->childValueArray)[chainValue.childOffset + childCount];
+	}
+
+	return parentNode;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "LALRParseAlgorithm.h"
+
+namespace ParseParty
+{
+	// This is a generalized LR parser.  It is driven by the same LALR(1) tables as the LALR algorithm,
+	// but where those tables have conflicts, it simply tries every action at once, keeping the various
+	// parse stacks in a graph-structured stack (GSS) so that they share what they have in common.  Stacks
+	// that arrive at the same state at the same point of the input are merged back into one, so away from
+	// the conflicts, there is only ever one stack top and we run at about the speed of the LALR algorithm.
+	//
+	// When two stacks merge after having reduced the same stretch of tokens to the same rule in different
+	// ways, the grammar is ambiguous there.  We keep both derivations in a little packed forest of values,
+	// report the region, and extract the first derivation into the syntax tree.
+	class GLRParseAlgorithm : public Parser::Algorithm
+	{
+	public:
+		GLRParseAlgorithm(const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray, const Grammar* grammar);
+		virtual ~GLRParseAlgorithm();
+
+		virtual Parser::SyntaxNode* Parse() override;
+
+	private:
+
+		struct StackNode;
+
+		struct StackEdge
+		{
+			StackNode* targetNode;
+			int value;
+			StackEdge* nextEdge;
+		};
+
+		struct StackNode
+		{
+			int state;
+			int parsePosition;
+			bool reduced;
+			StackEdge* firstEdge;
+		};
+
+		struct ForestValue
+		{
+			int sequenceID;		// This is -1 for a token value.
+			int parsePosition;		// The position of the token, or of the first token spanned by the rule.
+			int childOffset;
+			int childCount;
+			int alternative;		// The next way of deriving the same rule over the same tokens, or -1.
+		};
+
+		StackNode* GetStackNode(int state, int parsePosition, bool& created);
+		StackEdge* AddStackEdge(StackNode* node, StackNode* targetNode, int value);
+		void PerformReductions(StackNode* node, StackEdge* requiredEdge);
+		void FindReductionPaths(StackNode* node, int sequenceID, int pathLength, StackEdge* requiredEdge, bool requiredEdgeFound);
+		void Reduce(StackNode* targetNode, int sequenceID);
+		void RecordAmbiguity(const ForestValue& value);
+		Parser::SyntaxNode* BuildNode(int value);
+
+		const LALRParseTable* parseTable;
+		int parsePosition;
+		std::deque<StackNode>* stackNodeArena;
+		std::deque<StackEdge>* stackEdgeArena;
+		std::vector<StackNode*>* frontierArray;		// The stack tops at the current position of the input.
+		std::vector<StackNode*>* stateNodeArray;		// The same, indexed by state, so that stacks in the same state get merged.
+		std::vector<std::pair<StackNode*, StackEdge*>>* reduceQueue;		// Stack tops to reduce, each along paths through the given edge only, if any.
+		std::vector<int>* pathValueArray;		// The values along the path being followed, last symbol first.
+		std::vector<ForestValue>* valueArray;
+		std::vector<int>* childValueArray;
+		std::set<std::pair<int, int>>* ambiguitySet;		// The (rule ID, position) pairs already reported for ambiguities ending at the current position.
+		std::vector<LALRParseTable::Action>* actionBuffer;
+		const Lexer::Token* token;
+		int tokenLiteral;
+	};
+}
\ No newline at end of file
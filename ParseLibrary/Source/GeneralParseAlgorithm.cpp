@@ -4,19 +4,453 @@ using namespace ParseParty;
 
 GeneralParseAlgorithm::GeneralParseAlgorithm(const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray, const Grammar* grammar) : Parser::Algorithm(tokenArray, grammar)
 {
+	this->itemBaseArray = new std::vector<int>();
+	this->itemSequenceArray = new std::vector<int>();
+	this->itemArray = new std::vector<EarleyItem>();
+	this->setOffsetArray = new std::vector<int>();
+	this->linkArray = new std::vector<EarleyLink>();
+	this->waiterArray = new std::vector<std::pair<int, int>>();
+	this->waiterOffsetArray = new std::vector<int>();
+	this->currentWaiterArray = new std::vector<std::vector<int>>();
+	this->currentWaiterRuleArray = new std::vector<int>();
+	this->currentItemMap = new std::unordered_map<uint64_t, int>();
+	this->predictedSetArray = new std::vector<int>();
+	this->leoEntryArray = new std::vector<LeoEntry>();
+	this->leoEntryMap = new std::unordered_map<uint64_t, int>();
+	this->extractionStack = new std::vector<ExtractionTask>();
+
+	// The items of each sequence (one for each position of the dot) get consecutive IDs.
+	for (int sequenceID = 0; sequenceID < this->compiledGrammar->GetSequenceCount(); sequenceID++)
+	{
+		this->itemBaseArray->push_back((int)this->itemSequenceArray->size());
+		for (int i = 0; i <= this->compiledGrammar->GetSequence(sequenceID).symbolCount; i++)
+			this->itemSequenceArray->push_back(sequenceID);
+	}
 }
 
 /*virtual*/ GeneralParseAlgorithm::~GeneralParseAlgorithm()
 {
+	delete this->itemBaseArray;
+	delete this->itemSequenceArray;
+	delete this->itemArray;
+	delete this->setOffsetArray;
+	delete this->linkArray;
+	delete this->waiterArray;
+	delete this->waiterOffsetArray;
+	delete this->currentWaiterArray;
+	delete this->currentWaiterRuleArray;
+	delete this->currentItemMap;
+	delete this->predictedSetArray;
+	delete this->leoEntryArray;
+	delete this->leoEntryMap;
+	delete this->extractionStack;
 }
 
 /*virtual*/ Parser::SyntaxNode* GeneralParseAlgorithm::Parse()
 {
-	// TODO: I have no idea how to write this.  Still thinking about it.
+	int initialRuleID = this->compiledGrammar->GetInitialRuleID();
+	if (initialRuleID < 0)
+		return nullptr;
+
+	int tokenCount = (int)this->tokenArray->size();
+	if (tokenCount == 0)
+		return nullptr;
+
+	this->itemArray->clear();
+	this->setOffsetArray->clear();
+	this->linkArray->clear();
+	this->waiterArray->clear();
+	this->waiterOffsetArray->clear();
+	this->currentWaiterArray->clear();
+	this->currentWaiterArray->resize(this->compiledGrammar->GetRuleCount());
+	this->currentWaiterRuleArray->clear();
+	this->currentItemMap->clear();
+	this->predictedSetArray->assign(this->compiledGrammar->GetRuleCount(), -1);
+	this->leoEntryArray->clear();
+	this->leoEntryMap->clear();
+
+	this->setOffsetArray->push_back(0);
+	this->waiterOffsetArray->push_back(0);
+
+	int set = 0;
+	while (true)
+	{
+		// Predict the initial rule if this is the first set.  After that, every set is seeded by scanning.
+		if (set == 0)
+		{
+			(*this->predictedSetArray)[initialRuleID] = 0;
+			const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(initialRuleID);
+			for (int i = 0; i < rule.sequenceCount; i++)
+				this->AddItem((*this->itemBaseArray)[rule.firstSequence + i], 0, nullptr);
+		}
+
+		// Note that items get added to the set as we go through it.
+		for (int i = (*this->setOffsetArray)[set]; i < (int)this->itemArray->size(); i++)
+		{
+			EarleyItem item = (*this->itemArray)[i];
+
+			CompiledGrammar::Symbol symbol;
+			if (!this->GetItemSymbol(item.itemID, symbol))
+			{
+				this->CompleteItem(i, set);
+				continue;
+			}
+
+			if (symbol.type != CompiledGrammar::Symbol::Type::NON_TERMINAL)
+				continue;
+
+			const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(symbol.id);
+
+			// Don't bother predicting an alternative that can't start with the next token.
+			if ((*this->predictedSetArray)[symbol.id] != set)
+			{
+				(*this->predictedSetArray)[symbol.id] = set;
+
+				for (int j = 0; j < rule.sequenceCount; j++)
+				{
+					int sequenceID = rule.firstSequence + j;
+					if (this->compiledGrammar->GetSequence(sequenceID).nullable || (set < tokenCount && this->TokenInSet(set, this->compiledGrammar->GetSequenceFirstSet(sequenceID))))
+						this->AddItem((*this->itemBaseArray)[sequenceID], set, nullptr);
+				}
+			}
+
+			if (rule.nullable)
+			{
+				EarleyLink link{ EarleyLink::Type::NULLED, i, symbol.id, -1 };
+				this->AddItem(item.itemID + 1, item.origin, &link);
+			}
+		}
+
+		// The set is done, so file away what's waiting on what for the benefit of later completions.
+		std::sort(this->currentWaiterRuleArray->begin(), this->currentWaiterRuleArray->end());
+		for (int ruleID : *this->currentWaiterRuleArray)
+		{
+			for (int i : (*this->currentWaiterArray)[ruleID])
+				this->waiterArray->push_back(std::pair<int, int>(ruleID, i));
+
+			(*this->currentWaiterArray)[ruleID].clear();
+		}
+
+		this->currentWaiterRuleArray->clear();
+		this->waiterOffsetArray->push_back((int)this->waiterArray->size());
+		this->setOffsetArray->push_back((int)this->itemArray->size());
+
+		if (set == tokenCount)
+			break;
+
+		// Seed the next set by stepping over the current token.
+		this->currentItemMap->clear();
+		for (int i = (*this->setOffsetArray)[set]; i < (*this->setOffsetArray)[set + 1]; i++)
+		{
+			const EarleyItem& item = (*this->itemArray)[i];
+
+			CompiledGrammar::Symbol symbol;
+			if (this->GetItemSymbol(item.itemID, symbol) && symbol.type == CompiledGrammar::Symbol::Type::TERMINAL && this->TokenMatches(set, symbol.id))
+			{
+				EarleyLink link{ EarleyLink::Type::SCAN, i, -1, -1 };
+				this->AddItem(item.itemID + 1, item.origin, &link);
+			}
+		}
+
+		if ((int)this->itemArray->size() == (*this->setOffsetArray)[set + 1])
+		{
+			const Lexer::FileLocation& fileLocation = (*this->tokenArray)[set]->fileLocation;
+			*this->error = FormatString("Failed to parse at line %d, column %d.", fileLocation.line, fileLocation.column);
+			return nullptr;
+		}
+
+		set++;
+	}
+
+	// Look for a completion of the initial rule that spans the whole input.  It may have been skipped over by a Leo link.
+	for (int i = (*this->setOffsetArray)[set]; i < (*this->setOffsetArray)[set + 1]; i++)
+	{
+		const EarleyItem& item = (*this->itemArray)[i];
+
+		CompiledGrammar::Symbol symbol;
+		if (item.origin == 0 && !this->GetItemSymbol(item.itemID, symbol) && this->compiledGrammar->GetSequence((*this->itemSequenceArray)[item.itemID]).ruleID == initialRuleID)
+			return this->FinishTree(this->BuildItemNode(i, set));
+	}
 
-	// TODO: It's hard to research in the literature on this subject, because it's super technical and I don't understand most of it, but
-	//       I wonder if the problem I'm trying to solve here is actually undecidable; meaning, no algorithm exists which could solve it
-	//       in a finite amount of time.  More than likely, I'm just not smart enough to figure it out.
+	for (int i = (*this->setOffsetArray)[set]; i < (*this->setOffsetArray)[set + 1]; i++)
+	{
+		for (int j = (*this->itemArray)[i].firstLink; j >= 0; j = (*this->linkArray)[j].next)
+		{
+			const EarleyLink& link = (*this->linkArray)[j];
+			if (link.type != EarleyLink::Type::LEO)
+				continue;
 
+			int levelCount = 1;
+			for (int k = link.predecessor; k >= 0; k = (*this->leoEntryArray)[k].next, levelCount++)
+			{
+				const EarleyItem& penultimateItem = (*this->itemArray)[(*this->leoEntryArray)[k].penultimate];
+				if (penultimateItem.origin == 0 && this->compiledGrammar->GetSequence((*this->itemSequenceArray)[penultimateItem.itemID]).ruleID == initialRuleID)
+					return this->FinishTree(this->BuildLeoNode(link, set, levelCount));
+			}
+		}
+	}
+
+	const Lexer::FileLocation& fileLocation = this->GetSetLocation(set);
+	*this->error = FormatString("Failed to parse at line %d, column %d: unexpected end of input.", fileLocation.line, fileLocation.column);
 	return nullptr;
+}
+
+bool GeneralParseAlgorithm::GetItemSymbol(int itemID, CompiledGrammar::Symbol& symbol) const
+{
+	int sequenceID = (*this->itemSequenceArray)[itemID];
+	int dot = itemID - (*this->itemBaseArray)[sequenceID];
+
+	const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+	if (dot >= sequence.symbolCount)
+		return false;
+
+	symbol = this->compiledGrammar->GetSymbols(sequence)[dot];
+	return true;
+}
+
+int GeneralParseAlgorithm::AddItem(int itemID, int origin, const EarleyLink* link)
+{
+	uint64_t key = (uint64_t(itemID) << 32) | uint32_t(origin);
+	std::pair<std::unordered_map<uint64_t, int>::iterator, bool> pair = this->currentItemMap->insert(std::pair<uint64_t, int>(key, (int)this->itemArray->size()));
+
+	if (!pair.second)
+	{
+		// We've derived an existing item another way.  Keep the first derivation first, since it's the one we'll extract.
+		int itemIndex = pair.first->second;
+		if (link)
+		{
+			EarleyLink& firstLink = (*this->linkArray)[(*this->itemArray)[itemIndex].firstLink];
+			EarleyLink alternativeLink = *link;
+			alternativeLink.next = firstLink.next;
+			firstLink.next = (int)this->linkArray->size();
+			this->linkArray->push_back(alternativeLink);
+		}
+
+		return itemIndex;
+	}
+
+	int itemIndex = (int)this->itemArray->size();
+	EarleyItem item{ itemID, origin, -1 };
+
+	if (link)
+	{
+		item.firstLink = (int)this->linkArray->size();
+		this->linkArray->push_back(*link);
+	}
+
+	this->itemArray->push_back(item);
+
+	CompiledGrammar::Symbol symbol;
+	if (this->GetItemSymbol(itemID, symbol) && symbol.type == CompiledGrammar::Symbol::Type::NON_TERMINAL)
+	{
+		std::vector<int>& currentWaiters = (*this->currentWaiterArray)[symbol.id];
+		if (currentWaiters.size() == 0)
+			this->currentWaiterRuleArray->push_back(symbol.id);
+
+		currentWaiters.push_back(itemIndex);
+	}
+
+	return itemIndex;
+}
+
+void GeneralParseAlgorithm::CompleteItem(int itemIndex, int set)
+{
+	EarleyItem item = (*this->itemArray)[itemIndex];
+	int ruleID = this->compiledGrammar->GetSequence((*this->itemSequenceArray)[item.itemID]).ruleID;
+
+	// An empty completion can only advance items of this set, some of which may not be here yet.
+	// That's okay, because those will step over the rule on their own when they predict it.
+	if (item.origin == set)
+	{
+		std::vector<int>& currentWaiters = (*this->currentWaiterArray)[ruleID];
+		for (int i = 0; i < (int)currentWaiters.size(); i++)
+		{
+			int waiterIndex = currentWaiters[i];
+			EarleyLink link{ EarleyLink::Type::COMPLETE, waiterIndex, itemIndex, -1 };
+			this->AddItem((*this->itemArray)[waiterIndex].itemID + 1, (*this->itemArray)[waiterIndex].origin, &link);
+		}
+
+		return;
+	}
+
+	int leoEntry = this->GetLeoEntry(item.origin, ruleID);
+	if (leoEntry >= 0)
+	{
+		const LeoEntry& entry = (*this->leoEntryArray)[leoEntry];
+		EarleyLink link{ EarleyLink::Type::LEO, leoEntry, itemIndex, -1 };
+		this->AddItem(entry.topItemID, entry.topOrigin, &link);
+		return;
+	}
+
+	std::vector<std::pair<int, int>>::iterator begin = this->waiterArray->begin() + (*this->waiterOffsetArray)[item.origin];
+	std::vector<std::pair<int, int>>::iterator end = this->waiterArray->begin() + (*this->waiterOffsetArray)[item.origin + 1];
+	std::vector<std::pair<int, int>>::iterator iter = std::lower_bound(begin, end, std::pair<int, int>(ruleID, -1));
+
+	for (; iter != end && iter->first == ruleID; iter++)
+	{
+		int waiterIndex = iter->second;
+		EarleyLink link{ EarleyLink::Type::COMPLETE, waiterIndex, itemIndex, -1 };
+		this->AddItem((*this->itemArray)[waiterIndex].itemID + 1, (*this->itemArray)[waiterIndex].origin, &link);
+	}
+}
+
+// If exactly one item of the given (finished) set is waiting on the given rule, and it has the rule as
+// its last symbol, then completing the rule from that set can only ever lead to completing that item too.
+// Following this up as far as it goes gives us the topmost item of the chain, which is all we need to add.
+int GeneralParseAlgorithm::GetLeoEntry(int set, int ruleID)
+{
+	uint64_t key = (uint64_t(set) << 32) | uint32_t(ruleID);
+	std::unordered_map<uint64_t, int>::iterator iter = this->leoEntryMap->find(key);
+	if (iter != this->leoEntryMap->end())
+		return iter->second;
+
+	// This also stops us from going around in circles with cyclic grammars.
+	this->leoEntryMap->insert(std::pair<uint64_t, int>(key, -1));
+
+	std::vector<std::pair<int, int>>::iterator begin = this->waiterArray->begin() + (*this->waiterOffsetArray)[set];
+	std::vector<std::pair<int, int>>::iterator end = this->waiterArray->begin() + (*this->waiterOffsetArray)[set + 1];
+	std::vector<std::pair<int, int>>::iterator first = std::lower_bound(begin, end, std::pair<int, int>(ruleID, -1));
+
+	if (first == end || first->first != ruleID || (first + 1 != end && (first + 1)->first == ruleID))
+		return -1;
+
+	int penultimate = first->second;
+	EarleyItem penultimateItem = (*this->itemArray)[penultimate];
+
+	CompiledGrammar::Symbol symbol;
+	if (this->GetItemSymbol(penultimateItem.itemID + 1, symbol))
+		return -1;
+
+	int penultimateRuleID = this->compiledGrammar->GetSequence((*this->itemSequenceArray)[penultimateItem.itemID]).ruleID;
+	int next = this->GetLeoEntry(penultimateItem.origin, penultimateRuleID);
+
+	LeoEntry entry{ penultimate, next, penultimateItem.itemID + 1, penultimateItem.origin };
+	if (next >= 0)
+	{
+		entry.topItemID = (*this->leoEntryArray)[next].topItemID;
+		entry.topOrigin = (*this->leoEntryArray)[next].topOrigin;
+	}
+
+	int leoEntry = (int)this->leoEntryArray->size();
+	this->leoEntryArray->push_back(entry);
+	(*this->leoEntryMap)[key] = leoEntry;
+	return leoEntry;
+}
+
+// Trees can get very deep (think left recursion), so rather than recurse, nodes are created childless
+// with a note to come back and fill in their children, which we keep doing here until the tree is complete.
+Parser::SyntaxNode* GeneralParseAlgorithm::FinishTree(Parser::SyntaxNode* rootNode)
+{
+	while (this->extractionStack->size() > 0)
+	{
+		ExtractionTask task = this->extractionStack->back();
+		this->extractionStack->pop_back();
+		this->PrependChildren(task.parentNode, task.itemIndex, task.set);
+	}
+
+	return rootNode;
+}
+
+Parser::SyntaxNode* GeneralParseAlgorithm::BuildItemNode(int itemIndex, int set)
+{
+	const EarleyItem& item = (*this->itemArray)[itemIndex];
+	if (item.firstLink >= 0 && (*this->linkArray)[item.firstLink].type == EarleyLink::Type::LEO)
+		return this->BuildLeoNode((*this->linkArray)[item.firstLink], set, -1);
+
+	int ruleID = this->compiledGrammar->GetSequence((*this->itemSequenceArray)[item.itemID]).ruleID;
+	Parser::SyntaxNode* parentNode = new Parser::SyntaxNode(this->compiledGrammar->GetRuleName(ruleID), this->GetSetLocation(item.origin));
+	this->extractionStack->push_back(ExtractionTask{ parentNode, itemIndex, set });
+	return parentNode;
+}
+
+// Rebuild the completions that a Leo link skipped, from the bottom of the chain on up, stopping after the given number of levels (or at the top if -1).
+Parser::SyntaxNode* GeneralParseAlgorithm::BuildLeoNode(const EarleyLink& link, int set, int levelCount)
+{
+	Parser::SyntaxNode* childNode = this->BuildItemNode(link.child, set);
+	int childSet = (*this->itemArray)[link.child].origin;
+
+	for (int i = link.predecessor, level = 0; i >= 0 && level != levelCount; i = (*this->leoEntryArray)[i].next, level++)
+	{
+		int penultimate = (*this->leoEntryArray)[i].penultimate;
+		const EarleyItem& penultimateItem = (*this->itemArray)[penultimate];
+		int ruleID = this->compiledGrammar->GetSequence((*this->itemSequenceArray)[penultimateItem.itemID]).ruleID;
+
+		Parser::SyntaxNode* parentNode = new Parser::SyntaxNode(this->compiledGrammar->GetRuleName(ruleID), this->GetSetLocation(penultimateItem.origin));
+		parentNode->childList->push_back(childNode);
+		childNode->parentNode = parentNode;
+		this->extractionStack->push_back(ExtractionTask{ parentNode, penultimate, childSet });
+
+		childNode = parentNode;
+		childSet = penultimateItem.origin;
+	}
+
+	return childNode;
+}
+
+Parser::SyntaxNode* GeneralParseAlgorithm::BuildNulledNode(int ruleID, int set)
+{
+	Parser::SyntaxNode* parentNode = new Parser::SyntaxNode(this->compiledGrammar->GetRuleName(ruleID), this->GetSetLocation(set));
+
+	int sequenceID = this->compiledGrammar->GetRule(ruleID).nullSequence;
+	if (sequenceID >= 0)
+	{
+		const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+		const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+		for (int i = 0; i < sequence.symbolCount; i++)
+		{
+			Parser::SyntaxNode* childNode = this->BuildNulledNode(symbolArray[i].id, set);
+			parentNode->childList->push_back(childNode);
+			childNode->parentNode = parentNode;
+		}
+	}
+
+	return parentNode;
+}
+
+// Walk back from the given item to the start of its sequence, putting a node for each symbol stepped over in front of the given node's children.
+void GeneralParseAlgorithm::PrependChildren(Parser::SyntaxNode* parentNode, int itemIndex, int set)
+{
+	while ((*this->itemArray)[itemIndex].firstLink >= 0)
+	{
+		const EarleyLink& link = (*this->linkArray)[(*this->itemArray)[itemIndex].firstLink];
+		Parser::SyntaxNode* childNode = nullptr;
+
+		switch (link.type)
+		{
+			case EarleyLink::Type::SCAN:
+			{
+				const Lexer::Token* token = (*this->tokenArray)[set - 1].get();
+				childNode = new Parser::SyntaxNode(*token->text, token->fileLocation);
+				set--;
+				break;
+			}
+			case EarleyLink::Type::COMPLETE:
+			{
+				childNode = this->BuildItemNode(link.child, set);
+				set = (*this->itemArray)[link.child].origin;
+				break;
+			}
+			case EarleyLink::Type::NULLED:
+			{
+				childNode = this->BuildNulledNode(link.child, set);
+				break;
+			}
+			case EarleyLink::Type::LEO:
+			{
+				// Leo links only ever derive completed items, and those are handled by the caller.
+				assert(false);
+				return;
+			}
+		}
+
+		parentNode->childList->push_front(childNode);
+		childNode->parentNode = parentNode;
+
+		itemIndex = link.predecessor;
+	}
+}
+
+const Lexer::FileLocation& GeneralParseAlgorithm::GetSetLocation(int set) const
+{
+	return (*this->tokenArray)[std::min(set, (int)this->tokenArray->size() - 1)]->fileLocation;
 }
\ No newline at end of file
@@ -4,10 +4,21 @@
 
 namespace ParseParty
 {
-	// This algorithm is designed to be an improvement over the SlowParseAlgorithm.
-	// Specifically, it should be able to handle adjacent non-terminals.  It makes the
-	// same assumption that paran/brackets of all sorts are balanced, and that terminals
-	// match at the same nesting level.
+	// This algorithm is designed to be an improvement over the SlowParseAlgorithm.  It's an Earley
+	// parser, so it handles any context-free grammar at all: left recursion, adjacent non-terminals,
+	// nullable rules, ambiguity, you name it.  It makes no assumptions about balanced brackets either.
+	//
+	// Each Earley set is a dense run of items (a dotted rule plus an origin) in one big array, and every
+	// item remembers how it came to be through a list of links back to the items it was made from.
+	// The items and their links make up a shared packed parse forest, since an item reached in more than
+	// one way is only ever stored once with all its alternative links attached.  The syntax tree we hand
+	// back is simply the one you get by following the first link of every item.
+	//
+	// Nullable rules are dealt with as Aycock & Horspool suggest, by stepping over a nullable non-terminal
+	// right at the time it's predicted.  Right recursion is dealt with using Leo's optimization, which
+	// skips the long chains of completions that right recursion would otherwise cause in every set,
+	// keeping unambiguous grammars at (near) linear time.  The skipped items are reconstructed from the
+	// Leo entries when we extract the tree.
 	class GeneralParseAlgorithm : public Parser::Algorithm
 	{
 	public:
@@ -15,5 +26,72 @@ namespace ParseParty
 		virtual ~GeneralParseAlgorithm();
 
 		virtual Parser::SyntaxNode* Parse() override;
+
+	private:
+
+		struct EarleyItem
+		{
+			int itemID;		// Identifies a sequence and the position of the dot in it.
+			int origin;		// The set in which the sequence was predicted.
+			int firstLink;		// The first of the ways this item was derived, or -1 if it was predicted.
+		};
+
+		struct EarleyLink
+		{
+			enum class Type : uint8_t
+			{
+				SCAN,		// Stepped over a terminal.
+				COMPLETE,		// Stepped over a non-terminal that derived a non-empty span.
+				NULLED,		// Stepped over a nullable non-terminal as soon as it was predicted.
+				LEO			// Went straight to the top of a deterministic chain of completions.
+			};
+
+			Type type;
+			int predecessor;		// The item with the dot one symbol back, or for Leo links, the Leo entry.
+			int child;		// The completed item stepped over, or for nulled links, the rule ID.
+			int next;		// The next alternative derivation of the same item, or -1.
+		};
+
+		struct LeoEntry
+		{
+			int penultimate;		// The only item of its set waiting on the rule, which it has as its last symbol.
+			int next;		// The Leo entry above this one in the chain, or -1.
+			int topItemID;
+			int topOrigin;
+		};
+
+		struct ExtractionTask
+		{
+			Parser::SyntaxNode* parentNode;
+			int itemIndex;
+			int set;
+		};
+
+		bool GetItemSymbol(int itemID, CompiledGrammar::Symbol& symbol) const;
+		int AddItem(int itemID, int origin, const EarleyLink* link);
+		void CompleteItem(int itemIndex, int set);
+		int GetLeoEntry(int set, int ruleID);
+
+		Parser::SyntaxNode* FinishTree(Parser::SyntaxNode* rootNode);
+		Parser::SyntaxNode* BuildItemNode(int itemIndex, int set);
+		Parser::SyntaxNode* BuildLeoNode(const EarleyLink& link, int set, int levelCount);
+		Parser::SyntaxNode* BuildNulledNode(int ruleID, int set);
+		void PrependChildren(Parser::SyntaxNode* parentNode, int itemIndex, int set);
+		const Lexer::FileLocation& GetSetLocation(int set) const;
+
+		std::vector<int>* itemBaseArray;		// Index this by sequence ID to get the ID of the item with the dot at the start of the sequence.
+		std::vector<int>* itemSequenceArray;		// Index this by item ID to get the sequence ID of the item.
+		std::vector<EarleyItem>* itemArray;
+		std::vector<int>* setOffsetArray;
+		std::vector<EarleyLink>* linkArray;
+		std::vector<std::pair<int, int>>* waiterArray;		// For each finished set, (rule ID, item) pairs sorted by rule ID, for all items with the dot before that rule.
+		std::vector<int>* waiterOffsetArray;
+		std::vector<std::vector<int>>* currentWaiterArray;		// The same, indexed by rule ID, but just for the set we're working on.
+		std::vector<int>* currentWaiterRuleArray;
+		std::unordered_map<uint64_t, int>* currentItemMap;
+		std::vector<int>* predictedSetArray;		// For each rule, the last set in which we predicted it.
+		std::vector<LeoEntry>* leoEntryArray;
+		std::unordered_map<uint64_t, int>* leoEntryMap;
+		std::vector<ExtractionTask>* extractionStack;
 	};
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Grammar.h"
 #include "Lexer.h"
+#include "CompiledGrammar.h"
 
 using namespace ParseParty;
 
@@ -11,6 +12,10 @@ Grammar::Grammar()
 	this->initialRule = new std::string();
 	this->algorithmName = new std::string();
 	this->flags = 0;
+	this->skipArray = new std::vector<std::string>();
+	this->compiledGrammar = new CompiledGrammar();
+	this->selectedAlgorithmName = new std::string();
+	this->algorithmSelectionReason = new std::string();
 }
 
 /*virtual*/ Grammar::~Grammar()
@@ -20,6 +25,10 @@ Grammar::Grammar()
 	delete this->ruleMap;
 	delete this->initialRule;
 	delete this->algorithmName;
+	delete this->skipArray;
+	delete this->compiledGrammar;
+	delete this->selectedAlgorithmName;
+	delete this->algorithmSelectionReason;
 }
 
 void Grammar::Clear()
@@ -30,6 +39,153 @@ void Grammar::Clear()
 	this->ruleMap->clear();
 	*this->initialRule = "";
 	*this->algorithmName = "";
+	this->skipArray->clear();
+	*this->selectedAlgorithmName = "";
+	*this->algorithmSelectionReason = "";
+	this->compiledGrammar->Clear();
+}
+
+bool Grammar::Compile(std::string& error)
+{
+	// The slow algorithm matches the rules just as they're written, so there's no point optimizing them for it.
+	if ((this->flags & PARSE_PARTY_GRAMMAR_FLAG_OPTIMIZE) != 0 && *this->algorithmName != "slow")
+	{
+		// If the optimized rules don't suit the table we need, then fall back on the rules as written;
+		// if the grammar itself is at fault, we'll just hit the same problem again.
+		std::string optimizeError;
+		if (this->CompileAndCheck(true, optimizeError))
+			return true;
+	}
+
+	return this->CompileAndCheck(false, error);
+}
+
+bool Grammar::CompileAndCheck(bool optimize, std::string& error)
+{
+	// Whatever we picked last time was for whatever the rules and algorithm were last time.
+	*this->selectedAlgorithmName = "";
+	*this->algorithmSelectionReason = "";
+
+	if (!this->compiledGrammar->Compile(this, error))
+		return false;
+
+	if (optimize)
+		this->compiledGrammar->Optimize();
+
+	if (*this->algorithmName == "auto")
+		this->SelectAlgorithm();
+
+	if (!this->BuildTables(error))
+		return false;
+
+	// Patterns can only be matched against characters, so they're no good to an algorithm working on tokens.  The terminals
+	// to skip don't count, though; those are only for the scannerless algorithm, and everything else just leaves them be.
+	if (*this->algorithmName != "scannerless")
+	{
+		for (int sequenceID = 0; sequenceID < this->compiledGrammar->GetSequenceCount(); sequenceID++)
+		{
+			const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+			const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+			for (int i = 0; i < sequence.symbolCount; i++)
+			{
+				if (symbolArray[i].type == CompiledGrammar::Symbol::Type::TERMINAL &&
+					this->compiledGrammar->GetTerminal(symbolArray[i].id).matchClass == CompiledGrammar::Terminal::Class::PATTERN)
+				{
+					error = FormatString("The terminal %s is a pattern, which only the scannerless algorithm can match.", this->compiledGrammar->GetTerminalText(symbolArray[i].id));
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+// Every table the algorithm needs gets built here, rather than by the first parse, so that once the grammar is compiled (and maybe
+// published to a registry), parsing with it never has to wait on the lock that building a table takes.  Table-driven algorithms
+// can also tell us up-front this way whether they'll be able to handle the grammar.
+bool Grammar::BuildTables(std::string& error)
+{
+	const std::string& algorithmName = this->GetSelectedAlgorithmName();
+
+	if (algorithmName == "ll1" && !this->compiledGrammar->GetLL1ParseTable(error))
+		return false;
+
+	if (algorithmName == "lalr" && !this->compiledGrammar->GetLALRParseTable(error))
+		return false;
+
+	if (algorithmName == "glr" && !this->compiledGrammar->GetLALRParseTable(error, true))
+		return false;
+
+	if (algorithmName == "scannerless" && !this->compiledGrammar->GetCharacterScanner(error))
+		return false;
+
+	if (algorithmName == "cyk")
+		this->compiledGrammar->GetCNFGrammar();
+
+	return true;
+}
+
+const CompiledGrammar* Grammar::GetCompiledGrammar() const
+{
+	return this->compiledGrammar;
+}
+
+const std::string& Grammar::GetSelectedAlgorithmName() const
+{
+	if (*this->algorithmName == "auto")
+		return *this->selectedAlgorithmName;
+
+	return *this->algorithmName;
+}
+
+const std::string& Grammar::GetAlgorithmSelectionReason() const
+{
+	return *this->algorithmSelectionReason;
+}
+
+// The quick and slow algorithms are never picked here.  Whether or not they get a grammar right depends on
+// more than we can tell by looking at it (e.g., the order of the alternatives, or how brackets nest in the input),
+// so they're only ever used by request.  Of the rest, the table-driven ones are linear time when they apply at all.
+void Grammar::SelectAlgorithm()
+{
+	std::string tableError;
+
+	std::vector<std::string> leftRecursiveRuleArray;
+	bool hasAdjacentNonTerminals = false;
+	for (int ruleID = 0; ruleID < this->compiledGrammar->GetRuleCount(); ruleID++)
+	{
+		const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+		if (rule.leftRecursive)
+			leftRecursiveRuleArray.push_back(this->compiledGrammar->GetRuleName(ruleID));
+
+		for (int i = 0; i < rule.sequenceCount; i++)
+			if (this->compiledGrammar->GetSequence(rule.firstSequence + i).hasAdjacentNonTerminals)
+				hasAdjacentNonTerminals = true;
+	}
+
+	if (this->compiledGrammar->GetLL1ParseTable(tableError))
+	{
+		*this->selectedAlgorithmName = "ll1";
+		*this->algorithmSelectionReason = "The grammar is LL(1), so one token of look-ahead always tells us which alternative to take.";
+		return;
+	}
+
+	std::string notLL1Reason;
+	if (leftRecursiveRuleArray.size() > 0)
+		notLL1Reason = " (rule \"" + leftRecursiveRuleArray[0] + "\" is left-recursive, for one)";
+
+	if (this->compiledGrammar->GetLALRParseTable(tableError))
+	{
+		*this->selectedAlgorithmName = "lalr";
+		*this->algorithmSelectionReason = "The grammar is LALR(1), but not LL(1)" + notLL1Reason + ".";
+		return;
+	}
+
+	*this->selectedAlgorithmName = "general";
+	*this->algorithmSelectionReason = "The grammar is neither LL(1) nor LALR(1), so it is either ambiguous or needs more than one token of look-ahead, and only a general algorithm is sure to parse it.";
+	if (hasAdjacentNonTerminals)
+		*this->algorithmSelectionReason += "  (The slow algorithm is out in any case, since the grammar has non-terminals next to one another.)";
 }
 
 const Grammar::Rule* Grammar::GetInitialRule() const
@@ -52,6 +208,15 @@ bool Grammar::ReadFile(const std::string& grammarFile, std::string& error)
 
 	this->Clear();
 
+	if (Bundle::IsBundleFile(grammarFile))
+	{
+		Bundle::Reader bundleReader;
+		if (!bundleReader.ReadFile(grammarFile, error))
+			return false;
+
+		return this->ReadBundle(bundleReader, error);
+	}
+
 	std::ifstream fileStream;
 	fileStream.open(grammarFile.c_str(), std::ios::in);
 	if (!fileStream.is_open())
@@ -100,6 +265,22 @@ bool Grammar::ReadFile(const std::string& grammarFile, std::string& error)
 	if (!this->ReadFlags(jsonFlags))
 		return false;
 
+	JsonArray* jsonSkipArray = dynamic_cast<JsonArray*>(jsonObject->GetValue("skip").get());
+	if (jsonSkipArray)
+	{
+		for (int i = 0; i < (signed)jsonSkipArray->GetSize(); i++)
+		{
+			const JsonString* jsonSkip = dynamic_cast<const JsonString*>(jsonSkipArray->GetValue(i).get());
+			if (!jsonSkip)
+			{
+				error = "Each \"skip\" entry should be a string.";
+				return false;
+			}
+
+			this->skipArray->push_back(jsonSkip->GetValue());
+		}
+	}
+
 	JsonObject* jsonRuleMap = dynamic_cast<JsonObject*>(jsonObject->GetValue("rules").get());
 	if (!jsonRuleMap)
 	{
@@ -110,16 +291,17 @@ bool Grammar::ReadFile(const std::string& grammarFile, std::string& error)
 	for (std::pair<std::string, std::shared_ptr<JsonValue>> pair : *jsonRuleMap)
 	{
 		JsonArray* jsonRuleValue = dynamic_cast<JsonArray*>(pair.second.get());
-		if (!jsonRuleValue)
+		JsonObject* jsonOperatorRule = dynamic_cast<JsonObject*>(pair.second.get());
+		if (!jsonRuleValue && !jsonOperatorRule)
 		{
-			error = "Each rule entry should be an array.";
+			error = "Each rule entry should be an array, or an object for an operator rule.";
 			return false;
 		}
 
 		Rule* rule = new Rule();
 		*rule->name = pair.first;
 
-		if (!rule->Read(jsonRuleValue, jsonRuleMap))
+		if (jsonRuleValue ? !rule->Read(jsonRuleValue, jsonRuleMap) : !rule->ReadOperators(jsonOperatorRule, jsonRuleMap))
 		{
 			error = "Failed to read rule: " + *rule->name;
 			delete rule;
@@ -132,12 +314,60 @@ bool Grammar::ReadFile(const std::string& grammarFile, std::string& error)
 	if (this->ruleMap->size() != jsonRuleMap->GetSize())
 		return false;
 
-	return true;
+	return this->Compile(error);
 }
 
 bool Grammar::WriteFile(const std::string& grammarFile) const
 {
-	return false;
+	if (this->compiledGrammar->GetRuleCount() == 0)
+		return false;
+
+	Bundle::Writer bundleWriter;
+	this->WriteBundle(bundleWriter);
+
+	std::string error;
+	return bundleWriter.WriteFile(grammarFile, error);
+}
+
+void Grammar::WriteBundle(Bundle::Writer& bundleWriter) const
+{
+	std::string info;
+	Bundle::PackInt(info, this->flags);
+	Bundle::PackString(info, *this->initialRule);
+	Bundle::PackString(info, *this->algorithmName);
+	Bundle::PackString(info, *this->selectedAlgorithmName);
+	Bundle::PackString(info, *this->algorithmSelectionReason);
+	bundleWriter.AddSection(Bundle::SectionTag::GRAMMAR_INFO, info.data(), info.size());
+
+	this->compiledGrammar->WriteBundle(bundleWriter);
+}
+
+bool Grammar::ReadBundle(const Bundle::Reader& bundleReader, std::string& error)
+{
+	this->Clear();
+
+	size_t infoSize = 0;
+	const char* info = bundleReader.GetSection(Bundle::SectionTag::GRAMMAR_INFO, infoSize);
+	const char* infoEnd = info + infoSize;
+	if (!info ||
+		!Bundle::UnpackInt(info, infoEnd, this->flags) ||
+		!Bundle::UnpackString(info, infoEnd, *this->initialRule) ||
+		!Bundle::UnpackString(info, infoEnd, *this->algorithmName) ||
+		!Bundle::UnpackString(info, infoEnd, *this->selectedAlgorithmName) ||
+		!Bundle::UnpackString(info, infoEnd, *this->algorithmSelectionReason))
+	{
+		error = "Bundle has no grammar in it.";
+		this->Clear();
+		return false;
+	}
+
+	if (!this->compiledGrammar->ReadBundle(bundleReader, error) || !this->BuildTables(error))
+	{
+		this->Clear();
+		return false;
+	}
+
+	return true;
 }
 
 bool Grammar::ReadFlags(const JsonObject* jsonFlags)
@@ -153,6 +383,10 @@ bool Grammar::ReadFlags(const JsonObject* jsonFlags)
 		const JsonBool* jsonDeleteStructureTokens = dynamic_cast<const JsonBool*>(jsonFlags->GetValue("delete_structure_tokens").get());
 		if (jsonDeleteStructureTokens && jsonDeleteStructureTokens->GetValue())
 			this->flags |= PARSE_PARTY_GRAMMAR_FLAG_DELETE_STRUCTURE_TOKENS;
+
+		const JsonBool* jsonOptimize = dynamic_cast<const JsonBool*>(jsonFlags->GetValue("optimize").get());
+		if (jsonOptimize && jsonOptimize->GetValue())
+			this->flags |= PARSE_PARTY_GRAMMAR_FLAG_OPTIMIZE;
 	}
 
 	return true;
@@ -201,7 +435,11 @@ Grammar::TerminalToken::TerminalToken(const std::string& givenText)
 		return MatchResult::YES;
 
 	if (*this->text == "@identifier")
-		return MatchResult::YES;
+		return (token.type == Lexer::Token::Type::IDENTIFIER) ? MatchResult::YES : MatchResult::NO;
+
+	// A quoted string should never match a keyword or operator that just happens to have the same text.
+	if (token.type == Lexer::Token::Type::STRING_LITERAL)
+		return MatchResult::NO;
 
 	return (*this->text == *token.text) ? MatchResult::YES : MatchResult::NO;
 }
@@ -242,12 +480,115 @@ Grammar::NonTerminalToken::NonTerminalToken(const std::string& givenRuleName)
 	return *this->ruleName;
 }
 
+//------------------------------- Grammar::RepeatToken -------------------------------
+
+Grammar::RepeatToken::RepeatToken()
+{
+	this->repetition = Repetition::ZERO_OR_MORE;
+	this->itemToken = nullptr;
+	this->separatorToken = nullptr;
+}
+
+Grammar::RepeatToken::RepeatToken(Repetition givenRepetition, Token* givenItemToken, Token* givenSeparatorToken)
+{
+	this->repetition = givenRepetition;
+	this->itemToken = givenItemToken;
+	this->separatorToken = givenSeparatorToken;
+}
+
+/*virtual*/ Grammar::RepeatToken::~RepeatToken()
+{
+	delete this->itemToken;
+	delete this->separatorToken;
+}
+
+/*virtual*/ Grammar::Token::MatchResult Grammar::RepeatToken::Matches(const Lexer::Token& token, std::string* ruleName /*= nullptr*/) const
+{
+	return MatchResult::MAYBE;
+}
+
+/*virtual*/ std::string Grammar::RepeatToken::GetText() const
+{
+	switch (this->repetition)
+	{
+		case Repetition::ZERO_OR_MORE:
+			return this->itemToken->GetText() + "*";
+		case Repetition::ONE_OR_MORE:
+			return this->itemToken->GetText() + "+";
+		case Repetition::ZERO_OR_ONE:
+			return this->itemToken->GetText() + "?";
+		case Repetition::SEPARATED:
+			return this->itemToken->GetText() + " % " + this->separatorToken->GetText();
+	}
+
+	return "";
+}
+
+/*static*/ Grammar::RepeatToken* Grammar::RepeatToken::Parse(const std::string& text, const JsonObject* jsonRuleMap)
+{
+	// Only rules and terminal classes can be repeated.  That way, literals like "++" or "?" are never mistaken for repetitions.
+	auto makeItemToken = [jsonRuleMap](const std::string& itemText) -> Token*
+	{
+		if (jsonRuleMap->GetValue(itemText))
+			return new NonTerminalToken(itemText);
+
+		if (itemText == "@string" || itemText == "@number" || itemText == "@int" || itemText == "@float" || itemText == "@identifier")
+			return new TerminalToken(itemText);
+
+		return nullptr;
+	};
+
+	size_t i = text.find(" % ");
+	if (i != std::string::npos && i > 0 && i + 3 < text.length())
+	{
+		Token* itemToken = makeItemToken(text.substr(0, i));
+		if (itemToken)
+		{
+			std::string separatorText = text.substr(i + 3);
+			Token* separatorToken = nullptr;
+			if (jsonRuleMap->GetValue(separatorText))
+				separatorToken = new NonTerminalToken(separatorText);
+			else
+				separatorToken = new TerminalToken(separatorText);
+
+			return new RepeatToken(Repetition::SEPARATED, itemToken, separatorToken);
+		}
+	}
+
+	if (text.length() < 2)
+		return nullptr;
+
+	Repetition repetition;
+	switch (text[text.length() - 1])
+	{
+		case '*':
+			repetition = Repetition::ZERO_OR_MORE;
+			break;
+		case '+':
+			repetition = Repetition::ONE_OR_MORE;
+			break;
+		case '?':
+			repetition = Repetition::ZERO_OR_ONE;
+			break;
+		default:
+			return nullptr;
+	}
+
+	Token* itemToken = makeItemToken(text.substr(0, text.length() - 1));
+	if (!itemToken)
+		return nullptr;
+
+	return new RepeatToken(repetition, itemToken, nullptr);
+}
+
 //------------------------------- Grammar::Rule -------------------------------
 
 Grammar::Rule::Rule()
 {
 	this->matchSequenceArray = new std::vector<MatchSequence*>();
 	this->name = new std::string();
+	this->operandRuleName = new std::string();
+	this->operatorArray = new std::vector<Operator>();
 }
 
 /*virtual*/ Grammar::Rule::~Rule()
@@ -256,6 +597,8 @@ Grammar::Rule::Rule()
 
 	delete this->name;
 	delete this->matchSequenceArray;
+	delete this->operandRuleName;
+	delete this->operatorArray;
 }
 
 void Grammar::Rule::Clear()
@@ -264,6 +607,8 @@ void Grammar::Rule::Clear()
 		delete matchSequence;
 
 	this->matchSequenceArray->clear();
+	*this->operandRuleName = "";
+	this->operatorArray->clear();
 }
 
 bool Grammar::Rule::Read(const JsonArray* jsonRuleArray, const JsonObject* jsonRuleMap)
@@ -298,12 +643,25 @@ bool Grammar::Rule::Read(const JsonArray* jsonRuleArray, const JsonObject* jsonR
 			if (!jsonToken)
 				return false;
 
+			if (jsonToken->GetValue() == "@cut")
+			{
+				if (matchSequence->cutIndex >= 0)
+					return false;
+
+				matchSequence->cutIndex = (int)matchSequence->tokenSequence->size();
+				continue;
+			}
+
 			Token* token = nullptr;
 
 			if (jsonRuleMap->GetValue(jsonToken->GetValue()))
 				token = new NonTerminalToken(jsonToken->GetValue());
 			else
-				token = new TerminalToken(jsonToken->GetValue());
+			{
+				token = RepeatToken::Parse(jsonToken->GetValue(), jsonRuleMap);
+				if (!token)
+					token = new TerminalToken(jsonToken->GetValue());
+			}
 
 			matchSequence->tokenSequence->push_back(token);
 		}
@@ -312,6 +670,53 @@ bool Grammar::Rule::Read(const JsonArray* jsonRuleArray, const JsonObject* jsonR
 	return true;
 }
 
+bool Grammar::Rule::ReadOperators(const JsonObject* jsonOperatorRule, const JsonObject* jsonRuleMap)
+{
+	this->Clear();
+
+	const JsonString* jsonOperand = dynamic_cast<const JsonString*>(jsonOperatorRule->GetValue("operand").get());
+	if (!jsonOperand || !jsonRuleMap->GetValue(jsonOperand->GetValue()))
+		return false;
+
+	*this->operandRuleName = jsonOperand->GetValue();
+
+	const JsonArray* jsonLevelArray = dynamic_cast<const JsonArray*>(jsonOperatorRule->GetValue("operators").get());
+	if (!jsonLevelArray || jsonLevelArray->GetSize() == 0)
+		return false;
+
+	for (int i = 0; i < (signed)jsonLevelArray->GetSize(); i++)
+	{
+		const JsonArray* jsonLevel = dynamic_cast<const JsonArray*>(jsonLevelArray->GetValue(i).get());
+		if (!jsonLevel || jsonLevel->GetSize() < 2)
+			return false;
+
+		const JsonString* jsonAssociativity = dynamic_cast<const JsonString*>(jsonLevel->GetValue(0).get());
+		if (!jsonAssociativity || (jsonAssociativity->GetValue() != "left" && jsonAssociativity->GetValue() != "right"))
+			return false;
+
+		for (int j = 1; j < (signed)jsonLevel->GetSize(); j++)
+		{
+			const JsonString* jsonOperator = dynamic_cast<const JsonString*>(jsonLevel->GetValue(j).get());
+			if (!jsonOperator || jsonOperator->GetValue().length() == 0)
+				return false;
+
+			for (const Operator& existingOperator : *this->operatorArray)
+				if (existingOperator.text == jsonOperator->GetValue())
+					return false;
+
+			this->operatorArray->push_back(Operator{ jsonOperator->GetValue(), i + 1, jsonAssociativity->GetValue() == "right" });
+		}
+	}
+
+	// There's just the one alternative, for the sake of anything that doesn't know about operator rules.  It's
+	// made into rules that match the operands and operators as a list when the grammar is compiled.
+	MatchSequence* matchSequence = new MatchSequence();
+	matchSequence->tokenSequence->push_back(new NonTerminalToken(*this->operandRuleName));
+	this->matchSequenceArray->push_back(matchSequence);
+
+	return true;
+}
+
 bool Grammar::Rule::Write(JsonArray* jsonRuleArray) const
 {
 	return false;
@@ -323,6 +728,7 @@ Grammar::MatchSequence::MatchSequence()
 {
 	this->tokenSequence = new std::vector<Token*>();
 	this->type = Type::LEFT_TO_RIGHT;
+	this->cutIndex = -1;
 }
 
 /*virtual*/ Grammar::MatchSequence::~MatchSequence()
@@ -338,6 +744,7 @@ void Grammar::MatchSequence::Clear()
 		delete token;
 
 	this->tokenSequence->clear();
+	this->cutIndex = -1;
 }
 
 bool Grammar::MatchSequence::HasTwoAdjacentNonTermainls() const
@@ -347,7 +754,10 @@ bool Grammar::MatchSequence::HasTwoAdjacentNonTermainls() const
 		const Token* tokenA = (*this->tokenSequence)[i];
 		const Token* tokenB = (*this->tokenSequence)[i + 1];
 
-		if (dynamic_cast<const NonTerminalToken*>(tokenA) && dynamic_cast<const NonTerminalToken*>(tokenB))
+		// Repetitions are matched by rules of their own, so they count as non-terminals here.
+		bool nonTerminalA = dynamic_cast<const NonTerminalToken*>(tokenA) || dynamic_cast<const RepeatToken*>(tokenA);
+		bool nonTerminalB = dynamic_cast<const NonTerminalToken*>(tokenB) || dynamic_cast<const RepeatToken*>(tokenB);
+		if (nonTerminalA && nonTerminalB)
 			return true;
 	}
 
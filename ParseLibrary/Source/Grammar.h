@@ -3,24 +3,43 @@
 #include "Common.h"
 #include "Lexer.h"
 #include "JsonValue.h"
+#include "Bundle.h"
 
 #define PARSE_PARTY_GRAMMAR_FLAG_FLATTEN_AST				0x00000001
 #define PARSE_PARTY_GRAMMAR_FLAG_DELETE_STRUCTURE_TOKENS	0x00000002
+#define PARSE_PARTY_GRAMMAR_FLAG_OPTIMIZE					0x00000004
 
 namespace ParseParty
 {
+	class CompiledGrammar;
+
 	class PARSE_PARTY_API Grammar
 	{
 	public:
 		Grammar();
 		virtual ~Grammar();
 
+		// A grammar file is either JSON or a bundle, which we can tell apart by looking at it.
+		// We only write bundles, which is only possible once the grammar is compiled.
 		bool ReadFile(const std::string& grammarFile, std::string& error);
 		bool WriteFile(const std::string& grammarFile) const;
 
+		// A grammar read from a bundle has no rule map, just its compiled form; which is all the parse algorithms need.
+		void WriteBundle(Bundle::Writer& bundleWriter) const;
+		bool ReadBundle(const Bundle::Reader& bundleReader, std::string& error);
+
 		void Clear();
 
-		// TODO: Given a lexer, we could generate a random code sequence which should always parse correctly.
+		// This is called by ReadFile(), but needs to be called by the user if the rules were setup some other way.
+		bool Compile(std::string& error);
+		const CompiledGrammar* GetCompiledGrammar() const;
+
+		// If the algorithm is "auto", then the grammar is analyzed when compiled, and the fastest algorithm
+		// sure to parse it correctly is picked for it.  These tell you which one was picked, and why.
+		const std::string& GetSelectedAlgorithmName() const;
+		const std::string& GetAlgorithmSelectionReason() const;
+
+		// Random code that parses with a given grammar can be made up with the SentenceGenerator.
 
 		class Rule;
 
@@ -44,6 +63,11 @@ namespace ParseParty
 			virtual std::string GetText() const = 0;
 		};
 
+		// A terminal is either literal text (e.g., "while" or "+="), which matches a token with that text, or a class
+		// of tokens: "@string", "@number", "@int", "@float" or "@identifier", matching a token of that type.  Note that
+		// "@identifier" only matches identifiers, not keywords or operators, and that a quoted string only ever matches
+		// "@string", never a literal that happens to have the same text as what's between the quotes.  An identifier can
+		// match both a literal and "@identifier", though (e.g., "foo"), and the algorithms take both into account.
 		class TerminalToken : public Token
 		{
 		public:
@@ -70,6 +94,41 @@ namespace ParseParty
 			std::string* ruleName;
 		};
 
+		// This is a repetition of a single token, written by putting "*" (zero or more), "+" (one or more) or "?" (zero or one)
+		// after the name of a rule or a terminal class like "@number"; or a separated list, written as the item and the
+		// separator with " % " between them (e.g., "json-value % ,") and meaning one or more items.  The compiled grammar
+		// turns these into rules of its own, but the matched items all become children of the node for the rule using them.
+		class RepeatToken : public Token
+		{
+		public:
+			enum class Repetition
+			{
+				ZERO_OR_MORE,
+				ONE_OR_MORE,
+				ZERO_OR_ONE,
+				SEPARATED
+			};
+
+			RepeatToken();
+			RepeatToken(Repetition givenRepetition, Token* givenItemToken, Token* givenSeparatorToken);
+			virtual ~RepeatToken();
+
+			virtual MatchResult Matches(const Lexer::Token& token, std::string* ruleName = nullptr) const override;
+			virtual std::string GetText() const override;
+
+			// Return a new repeat token if the given text is written as one, or null if it isn't.
+			static RepeatToken* Parse(const std::string& text, const JsonObject* jsonRuleMap);
+
+			Repetition repetition;
+			Token* itemToken;
+			Token* separatorToken;		// Only for separated lists.
+		};
+
+		// An alternative can have a cut in it, written "@cut" where it goes, for example just after the ";" ending a statement.
+		// This promises that once the alternative has matched up to the cut, there's no going back on it.  The quick algorithm
+		// then won't try any of the rule's other alternatives, and can forget whatever it remembered about the input before
+		// the cut, which keeps its memory in check on long inputs.  The other algorithms (and generated parsers) ignore cuts,
+		// since they either don't backtrack, or don't remember enough to be worth forgetting.
 		class MatchSequence
 		{
 		public:
@@ -87,8 +146,26 @@ namespace ParseParty
 
 			std::vector<Token*>* tokenSequence;
 			Type type;
+			int cutIndex;		// How many tokens come before the cut, or -1 if there isn't one.
 		};
 
+		// A binary operator of an operator rule.  Higher precedence binds more tightly.
+		struct Operator
+		{
+			std::string text;
+			int precedence;
+			bool rightAssociative;
+		};
+
+		// A rule is normally given as an array of alternatives.  It can also be given as an operator rule, which is an
+		// object naming the rule for its operands and listing its binary operators by level of precedence, loosest first,
+		// each level being an array of "left" or "right" (the associativity) followed by the operators at that level...
+		//
+		//		"expression": { "operand": "term", "operators": [ [ "left", "+", "-" ], [ "left", "*", "/" ], [ "right", "^" ] ] }
+		//
+		// The operands and operators are matched as a flat list, in a loop, and then built into a tree of binary nodes by
+		// precedence climbing, each binary node being one for the rule.  That saves having a rule per level of precedence,
+		// and the descent through all of them for every operand.
 		class Rule
 		{
 		public:
@@ -96,12 +173,15 @@ namespace ParseParty
 			virtual ~Rule();
 
 			bool Read(const JsonArray* jsonRuleArray, const JsonObject* jsonRuleMap);
+			bool ReadOperators(const JsonObject* jsonOperatorRule, const JsonObject* jsonRuleMap);
 			bool Write(JsonArray* jsonRuleArray) const;
 
 			void Clear();
 
 			std::vector<MatchSequence*>* matchSequenceArray;
 			std::string* name;
+			std::string* operandRuleName;		// Only for operator rules.
+			std::vector<Operator>* operatorArray;
 		};
 
 		bool ReadFlags(const JsonObject* jsonFlags);
@@ -112,5 +192,19 @@ namespace ParseParty
 		std::string* initialRule;
 		std::string* algorithmName;
 		int flags;
+
+		// For the scannerless algorithm, which has no lexer to skip whitespace and comments for it, this is what to skip before every terminal;
+		// each is a literal or a pattern, like /\s+/.  A grammar file can give these as "skip", and if none are given, whitespace is skipped.
+		std::vector<std::string>* skipArray;
+
+	private:
+
+		bool CompileAndCheck(bool optimize, std::string& error);
+		void SelectAlgorithm();
+		bool BuildTables(std::string& error);
+
+		CompiledGrammar* compiledGrammar;
+		std::string* selectedAlgorithmName;
+		std::string* algorithmSelectionReason;
 	};
 }
\ No newline at end of file
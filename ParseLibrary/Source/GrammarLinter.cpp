@@ -0,0 +1,841 @@
+#include "GrammarLinter.h"
+#include "CompiledGrammar.h"
+#include "FormatString.h"
+#include <cstring>
+
+using namespace ParseParty;
+
+static bool IsOpenerText(const char* text)
+{
+	return ::strcmp(text, "(") == 0 || ::strcmp(text, "[") == 0 || ::strcmp(text, "{") == 0;
+}
+
+static bool IsCloserText(const char* text)
+{
+	return ::strcmp(text, ")") == 0 || ::strcmp(text, "]") == 0 || ::strcmp(text, "}") == 0;
+}
+
+//------------------------------- GrammarLinter -------------------------------
+
+GrammarLinter::GrammarLinter()
+{
+	this->algorithmName = new std::string();
+	this->compiledGrammar = nullptr;
+	this->ownCompiledGrammar = new CompiledGrammar();
+	this->continueSetArray = new std::vector<uint64_t>();
+	this->findingArray = nullptr;
+	this->lintQuick = false;
+	this->lintSlow = false;
+	this->optimizing = false;
+}
+
+/*virtual*/ GrammarLinter::~GrammarLinter()
+{
+	delete this->algorithmName;
+	delete this->ownCompiledGrammar;
+	delete this->continueSetArray;
+}
+
+/*static*/ const char* GrammarLinter::GetKindName(Finding::Kind kind)
+{
+	switch (kind)
+	{
+		case Finding::Kind::SHADOWED_ALTERNATIVE:
+			return "shadowed-alternative";
+		case Finding::Kind::SHARED_PREFIX:
+			return "shared-prefix";
+		case Finding::Kind::ADJACENT_NON_TERMINALS:
+			return "adjacent-non-terminals";
+		case Finding::Kind::NULLABLE_LOOP:
+			return "nullable-loop";
+		case Finding::Kind::HIDDEN_LEFT_RECURSION:
+			return "hidden-left-recursion";
+		case Finding::Kind::MIXED_NESTING:
+			return "mixed-nesting";
+	}
+
+	return "?";
+}
+
+/*static*/ const char* GrammarLinter::GetCostName(Cost cost)
+{
+	switch (cost)
+	{
+		case Cost::LINEAR:
+			return "linear";
+		case Cost::POLYNOMIAL:
+			return "polynomial";
+		case Cost::EXPONENTIAL:
+			return "exponential";
+		case Cost::FAILURE:
+			return "failure";
+	}
+
+	return "?";
+}
+
+bool GrammarLinter::Lint(const Grammar* grammar, std::vector<Finding>& findingArray, std::string& error)
+{
+	findingArray.clear();
+
+	if (!this->Prepare(grammar, error))
+		return false;
+
+	this->findingArray = &findingArray;
+
+	for (int ruleID = 0; ruleID < this->compiledGrammar->GetRuleCount(); ruleID++)
+	{
+		if (this->lintQuick)
+		{
+			this->LintAlternatives(ruleID);
+			this->LintNullableLoops(ruleID);
+			this->LintLeftRecursion(ruleID);
+		}
+
+		if (this->lintSlow)
+			this->LintSlowAlternatives(ruleID);
+	}
+
+	for (int sequenceID = 0; sequenceID < this->compiledGrammar->GetSequenceCount(); sequenceID++)
+	{
+		this->LintAdjacentNonTerminals(sequenceID);
+
+		if (this->lintSlow)
+			this->LintNesting(sequenceID);
+	}
+
+	std::stable_sort(findingArray.begin(), findingArray.end(), [](const Finding& findingA, const Finding& findingB) -> bool
+		{
+			return (int)findingA.cost > (int)findingB.cost;
+		});
+
+	this->findingArray = nullptr;
+	return true;
+}
+
+bool GrammarLinter::Prepare(const Grammar* grammar, std::string& error)
+{
+	// A grammar read from a bundle has only its compiled form, which may well be optimized, but it's all we've got.
+	if (grammar->ruleMap->size() == 0)
+		this->compiledGrammar = grammar->GetCompiledGrammar();
+	else
+	{
+		if (!this->ownCompiledGrammar->Compile(grammar, error))
+			return false;
+
+		this->compiledGrammar = this->ownCompiledGrammar;
+	}
+
+	std::string algorithmName = *this->algorithmName;
+	if (algorithmName.length() == 0)
+		algorithmName = grammar->GetSelectedAlgorithmName();
+
+	this->lintQuick = (algorithmName == "quick" || algorithmName == "scannerless" || algorithmName == "all");
+	this->lintSlow = (algorithmName == "slow" || algorithmName == "all");
+	this->optimizing = (grammar->flags & PARSE_PARTY_GRAMMAR_FLAG_OPTIMIZE) != 0 && algorithmName != "slow" && !this->compiledGrammar->IsOptimized();
+
+	if (this->lintQuick)
+		this->ComputeContinueSets();
+
+	return true;
+}
+
+// A rule can go on with a terminal where it could've ended instead if it ends with a list, or with something optional, or if one
+// of its alternatives starts with all of another.  Whatever can go last in a rule can do the same for it.  This is a guess, since
+// the real answer depends on what the rules can match, not just on how they're written, but it catches the usual suspects.
+void GrammarLinter::ComputeContinueSets()
+{
+	int ruleCount = this->compiledGrammar->GetRuleCount();
+	int wordCount = this->compiledGrammar->GetTerminalSetWordCount();
+
+	std::vector<uint64_t> goOnSetArray(ruleCount * wordCount, 0);
+	for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+	{
+		const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+		uint64_t* goOnSet = goOnSetArray.data() + ruleID * wordCount;
+
+		// Every item of a repetition can be followed by another.
+		if (rule.repeats)
+		{
+			const uint64_t* firstSet = this->compiledGrammar->GetFirstSet(ruleID);
+			for (int k = 0; k < wordCount; k++)
+				goOnSet[k] |= firstSet[k];
+		}
+
+		for (int j = 0; j < rule.sequenceCount; j++)
+		{
+			const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(rule.firstSequence + j);
+			const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
+			// Whatever can match nothing at the end of the alternative can still match something.
+			for (int i = sequence.symbolCount - 1; i > 0 && this->SymbolsNullable(&symbolArray[i], 1); i--)
+				this->UnionFirstSet(goOnSet, &symbolArray[i], sequence.symbolCount - i);
+
+			// A left-recursive alternative goes on with whatever comes after the rule.
+			for (int i = 0; i < sequence.symbolCount; i++)
+			{
+				if (symbolArray[i].type == CompiledGrammar::Symbol::Type::NON_TERMINAL && symbolArray[i].id == ruleID)
+				{
+					this->UnionFirstSet(goOnSet, &symbolArray[i + 1], sequence.symbolCount - i - 1);
+					break;
+				}
+
+				if (!this->SymbolsNullable(&symbolArray[i], 1))
+					break;
+			}
+
+			// And an alternative that starts with all of this one goes on with the rest of it.
+			if (sequence.symbolCount == 0)
+				continue;
+
+			for (int k = 0; k < rule.sequenceCount; k++)
+			{
+				const CompiledGrammar::Sequence& longerSequence = this->compiledGrammar->GetSequence(rule.firstSequence + k);
+				const CompiledGrammar::Symbol* longerSymbolArray = this->compiledGrammar->GetSymbols(longerSequence);
+				if (longerSequence.symbolCount <= sequence.symbolCount)
+					continue;
+
+				int i;
+				for (i = 0; i < sequence.symbolCount; i++)
+					if (symbolArray[i].type != longerSymbolArray[i].type || symbolArray[i].id != longerSymbolArray[i].id)
+						break;
+
+				if (i == sequence.symbolCount)
+					this->UnionFirstSet(goOnSet, &longerSymbolArray[i], longerSequence.symbolCount - i);
+			}
+		}
+	}
+
+	this->continueSetArray->assign(ruleCount * wordCount, 0);
+	for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+	{
+		uint64_t* continueSet = this->continueSetArray->data() + ruleID * wordCount;
+
+		std::vector<bool> visitedArray(ruleCount, false);
+		std::vector<int> ruleQueue;
+		ruleQueue.push_back(ruleID);
+		visitedArray[ruleID] = true;
+
+		for (int q = 0; q < (int)ruleQueue.size(); q++)
+		{
+			const uint64_t* goOnSet = goOnSetArray.data() + ruleQueue[q] * wordCount;
+			for (int k = 0; k < wordCount; k++)
+				continueSet[k] |= goOnSet[k];
+
+			const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleQueue[q]);
+			for (int j = 0; j < rule.sequenceCount; j++)
+			{
+				const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(rule.firstSequence + j);
+				const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
+				for (int i = sequence.symbolCount - 1; i >= 0; i--)
+				{
+					if (symbolArray[i].type == CompiledGrammar::Symbol::Type::NON_TERMINAL && !visitedArray[symbolArray[i].id])
+					{
+						visitedArray[symbolArray[i].id] = true;
+						ruleQueue.push_back(symbolArray[i].id);
+					}
+
+					if (!this->SymbolsNullable(&symbolArray[i], 1))
+						break;
+				}
+			}
+		}
+	}
+}
+
+// The quick algorithm takes the first alternative that matches, so a later one starting with all of an earlier one is
+// out of luck, and alternatives with the same start have it matched again for each one that fails after it.
+void GrammarLinter::LintAlternatives(int ruleID)
+{
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	if (rule.spliced)
+		return;
+
+	std::vector<bool> shadowedArray(rule.sequenceCount, false);
+	for (int j = 1; j < rule.sequenceCount; j++)
+	{
+		const CompiledGrammar::Sequence& sequenceB = this->compiledGrammar->GetSequence(rule.firstSequence + j);
+		const CompiledGrammar::Symbol* symbolArrayB = this->compiledGrammar->GetSymbols(sequenceB);
+
+		for (int i = 0; i < j && !shadowedArray[j]; i++)
+		{
+			const CompiledGrammar::Sequence& sequenceA = this->compiledGrammar->GetSequence(rule.firstSequence + i);
+			const CompiledGrammar::Symbol* symbolArrayA = this->compiledGrammar->GetSymbols(sequenceA);
+			if (sequenceA.symbolCount == 0 || sequenceA.symbolCount > sequenceB.symbolCount)
+				continue;
+
+			int k;
+			for (k = 0; k < sequenceA.symbolCount; k++)
+				if (symbolArrayA[k].type != symbolArrayB[k].type || symbolArrayA[k].id != symbolArrayB[k].id)
+					break;
+
+			if (k < sequenceA.symbolCount)
+				continue;
+
+			std::string message;
+			if (sequenceA.symbolCount == sequenceB.symbolCount)
+				message = FormatString("Alternatives %d and %d are the same, so the quick algorithm never gets to %d.", i + 1, j + 1, j + 1);
+			else
+			{
+				message = FormatString("Alternative %d (\"%s\") starts with all of alternative %d (\"%s\").  The quick algorithm takes the first alternative that matches, "
+					"so wherever %d matches, it never gets to %d.  Put the longer one first.", j + 1, this->GetSymbolsText(symbolArrayB, sequenceB.symbolCount).c_str(),
+					i + 1, this->GetSymbolsText(symbolArrayA, sequenceA.symbolCount).c_str(), i + 1, j + 1);
+			}
+
+			this->AddFinding(Finding::Kind::SHADOWED_ALTERNATIVE, Cost::FAILURE, "quick", std::vector<int>{ ruleID }, message);
+			shadowedArray[j] = true;
+		}
+	}
+
+	bool factorable = !rule.leftRecursive;
+	for (int j = 0; j < rule.sequenceCount; j++)
+		if (this->compiledGrammar->GetSequence(rule.firstSequence + j).cutSymbol >= 0)
+			factorable = false;
+
+	std::vector<bool> groupedArray(rule.sequenceCount, false);
+	for (int i = 0; i < rule.sequenceCount; i++)
+	{
+		const CompiledGrammar::Sequence& sequenceA = this->compiledGrammar->GetSequence(rule.firstSequence + i);
+		const CompiledGrammar::Symbol* symbolArrayA = this->compiledGrammar->GetSymbols(sequenceA);
+		if (groupedArray[i] || shadowedArray[i] || sequenceA.symbolCount == 0)
+			continue;
+
+		std::vector<int> groupArray;
+		groupArray.push_back(i);
+		int prefixLength = sequenceA.symbolCount;
+
+		for (int j = i + 1; j < rule.sequenceCount; j++)
+		{
+			const CompiledGrammar::Sequence& sequenceB = this->compiledGrammar->GetSequence(rule.firstSequence + j);
+			const CompiledGrammar::Symbol* symbolArrayB = this->compiledGrammar->GetSymbols(sequenceB);
+			if (groupedArray[j] || shadowedArray[j])
+				continue;
+
+			int k;
+			for (k = 0; k < sequenceA.symbolCount && k < sequenceB.symbolCount; k++)
+				if (symbolArrayA[k].type != symbolArrayB[k].type || symbolArrayA[k].id != symbolArrayB[k].id)
+					break;
+
+			if (k == 0)
+				continue;
+
+			groupArray.push_back(j);
+			prefixLength = std::min(prefixLength, k);
+		}
+
+		if (groupArray.size() < 2)
+			continue;
+
+		for (int j : groupArray)
+			groupedArray[j] = true;
+
+		// The optimizer factors out the prefixes of alternatives next to one another.
+		bool adjacent = (groupArray.back() - groupArray.front() + 1 == (int)groupArray.size());
+		if (this->optimizing && factorable && adjacent)
+			continue;
+
+		std::string alternativesText;
+		for (int k = 0; k < (int)groupArray.size(); k++)
+		{
+			if (k > 0)
+				alternativesText += (k == (int)groupArray.size() - 1) ? " and " : ", ";
+
+			alternativesText += FormatString("%d", groupArray[k] + 1);
+		}
+
+		std::string message = FormatString("Alternatives %s start with \"%s\", which the quick algorithm matches again for each of them that fails after it.  "
+			"It remembers how the rules in there went, but still has to get back to where they got to.", alternativesText.c_str(), this->GetSymbolsText(symbolArrayA, prefixLength).c_str());
+		if (!factorable)
+			message += "  Giving it a rule of its own would save that.";
+		else if (adjacent)
+			message += "  The optimize flag would factor it out.";
+		else
+			message += "  If they were next to one another, the optimize flag would factor it out.";
+
+		this->AddFinding(Finding::Kind::SHARED_PREFIX, Cost::LINEAR, "quick", std::vector<int>{ ruleID }, message);
+	}
+}
+
+// The slow algorithm finds where an alternative's terminals are first, and then parses its non-terminals over the tokens
+// between them.  So alternatives starting (or, if matched right to left, ending) with the same non-terminal and terminal
+// have it look for that non-terminal over the same tokens, once for each alternative.  It remembers how that went, success
+// or failure, so it's only the scanning for terminals that's done over, but that's still a pass over the tokens each time.
+void GrammarLinter::LintSlowAlternatives(int ruleID)
+{
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	if (rule.spliced)
+		return;
+
+	auto getKey = [this](const CompiledGrammar::Sequence& sequence, CompiledGrammar::Symbol& nonTerminal, CompiledGrammar::Symbol& terminal) -> bool
+	{
+		if (sequence.symbolCount < 2)
+			return false;
+
+		const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+		if (sequence.type == Grammar::MatchSequence::Type::LEFT_TO_RIGHT)
+		{
+			nonTerminal = symbolArray[0];
+			terminal = symbolArray[1];
+		}
+		else
+		{
+			nonTerminal = symbolArray[sequence.symbolCount - 1];
+			terminal = symbolArray[sequence.symbolCount - 2];
+		}
+
+		return nonTerminal.type == CompiledGrammar::Symbol::Type::NON_TERMINAL && terminal.type == CompiledGrammar::Symbol::Type::TERMINAL;
+	};
+
+	std::vector<bool> groupedArray(rule.sequenceCount, false);
+	for (int i = 0; i < rule.sequenceCount; i++)
+	{
+		const CompiledGrammar::Sequence& sequenceA = this->compiledGrammar->GetSequence(rule.firstSequence + i);
+		CompiledGrammar::Symbol nonTerminalA, terminalA;
+		if (groupedArray[i] || !getKey(sequenceA, nonTerminalA, terminalA))
+			continue;
+
+		std::vector<int> groupArray;
+		groupArray.push_back(i);
+
+		for (int j = i + 1; j < rule.sequenceCount; j++)
+		{
+			const CompiledGrammar::Sequence& sequenceB = this->compiledGrammar->GetSequence(rule.firstSequence + j);
+			CompiledGrammar::Symbol nonTerminalB, terminalB;
+			if (groupedArray[j] || sequenceB.type != sequenceA.type || !getKey(sequenceB, nonTerminalB, terminalB))
+				continue;
+
+			if (nonTerminalA.id == nonTerminalB.id && terminalA.id == terminalB.id)
+				groupArray.push_back(j);
+		}
+
+		if (groupArray.size() < 2)
+			continue;
+
+		std::string alternativesText;
+		for (int k = 0; k < (int)groupArray.size(); k++)
+		{
+			groupedArray[groupArray[k]] = true;
+
+			if (k > 0)
+				alternativesText += (k == (int)groupArray.size() - 1) ? " and " : ", ";
+
+			alternativesText += FormatString("%d", groupArray[k] + 1);
+		}
+
+		bool leftToRight = (sequenceA.type == Grammar::MatchSequence::Type::LEFT_TO_RIGHT);
+		std::string message = FormatString("Alternatives %s %s \"%s %s\", so the slow algorithm scans the same tokens for \"%s\" for each of them.  "
+			"It remembers how \"%s\" went, so it's only the scanning that's done over, but factoring it out would save that.",
+			alternativesText.c_str(), leftToRight ? "start with" : "end with",
+			this->GetSymbolText(leftToRight ? nonTerminalA : terminalA).c_str(), this->GetSymbolText(leftToRight ? terminalA : nonTerminalA).c_str(),
+			this->GetSymbolText(terminalA).c_str(), this->GetSymbolText(nonTerminalA).c_str());
+
+		this->AddFinding(Finding::Kind::SHARED_PREFIX, Cost::LINEAR, "slow", std::vector<int>{ ruleID, nonTerminalA.id }, message);
+	}
+}
+
+void GrammarLinter::LintAdjacentNonTerminals(int sequenceID)
+{
+	const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+	const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+	if (!sequence.hasAdjacentNonTerminals)
+		return;
+
+	bool reportedSlow = false;
+	for (int i = 0; i + 1 < sequence.symbolCount; i++)
+	{
+		const CompiledGrammar::Symbol& symbolA = symbolArray[i];
+		const CompiledGrammar::Symbol& symbolB = symbolArray[i + 1];
+		if (symbolA.type != CompiledGrammar::Symbol::Type::NON_TERMINAL || symbolB.type != CompiledGrammar::Symbol::Type::NON_TERMINAL)
+			continue;
+
+		if (this->lintSlow && !reportedSlow)
+		{
+			std::string message = FormatString("%s has \"%s\" and \"%s\" side by side, and the slow algorithm can't match an alternative with non-terminals next to one another.",
+				this->DescribeSequence(sequenceID).c_str(), this->GetSymbolText(symbolA).c_str(), this->GetSymbolText(symbolB).c_str());
+
+			this->AddFinding(Finding::Kind::ADJACENT_NON_TERMINALS, Cost::FAILURE, "slow", std::vector<int>{ sequence.ruleID, symbolA.id, symbolB.id }, message);
+			reportedSlow = true;
+		}
+
+		if (!this->lintQuick)
+			continue;
+
+		// A list taking up where its own item left off is matched in a loop, which takes whatever the item leaves it.
+		const CompiledGrammar::Rule& ruleB = this->compiledGrammar->GetRule(symbolB.id);
+		if (symbolB.id == sequence.ruleID)
+			continue;
+
+		if (ruleB.repeats && ruleB.sequenceCount > 0)
+		{
+			const CompiledGrammar::Sequence& itemSequence = this->compiledGrammar->GetSequence(ruleB.firstSequence);
+			if (itemSequence.symbolCount > 0 && this->compiledGrammar->GetSymbols(itemSequence)[0].type == symbolA.type && this->compiledGrammar->GetSymbols(itemSequence)[0].id == symbolA.id)
+				continue;
+		}
+
+		int wordCount = this->compiledGrammar->GetTerminalSetWordCount();
+		std::vector<uint64_t> continueSet(this->continueSetArray->begin() + symbolA.id * wordCount, this->continueSetArray->begin() + (symbolA.id + 1) * wordCount);
+		if (this->compiledGrammar->GetRule(symbolA.id).nullable)
+			this->UnionFirstSet(continueSet.data(), &symbolA, 1);
+
+		std::vector<uint64_t> followSet(wordCount, 0);
+		this->UnionFirstSet(followSet.data(), &symbolArray[i + 1], sequence.symbolCount - i - 1);
+
+		int terminalID = this->FindCommonTerminal(continueSet.data(), followSet.data());
+		if (terminalID < 0)
+			continue;
+
+		std::string message = FormatString("%s has \"%s\" followed by \"%s\", but \"%s\" can go on with %s where it could have ended, and \"%s\" can start with that too.  "
+			"The quick algorithm never gives back anything a rule matched, so \"%s\" may take what \"%s\" needed.",
+			this->DescribeSequence(sequenceID).c_str(), this->GetSymbolText(symbolA).c_str(), this->GetSymbolText(symbolB).c_str(), this->GetSymbolText(symbolA).c_str(),
+			this->compiledGrammar->GetTerminalText(terminalID), this->GetSymbolText(symbolB).c_str(), this->GetSymbolText(symbolA).c_str(), this->GetSymbolText(symbolB).c_str());
+
+		this->AddFinding(Finding::Kind::ADJACENT_NON_TERMINALS, Cost::FAILURE, "quick", std::vector<int>{ sequence.ruleID, symbolA.id, symbolB.id }, message);
+	}
+}
+
+// The quick algorithm matches a repetition in a loop, and an item matching nothing ends the loop, so it can't go around forever;
+// but that item is tried and wasted at the end of every list, and it means the grammar doesn't quite say what was meant.
+void GrammarLinter::LintNullableLoops(int ruleID)
+{
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	if (!rule.repeats)
+		return;
+
+	for (int j = 0; j < rule.sequenceCount; j++)
+	{
+		const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(rule.firstSequence + j);
+		const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+		if (sequence.symbolCount < 2 || !this->SymbolsNullable(symbolArray, sequence.symbolCount - 1))
+			continue;
+
+		CompiledGrammar::Symbol ruleSymbol{ CompiledGrammar::Symbol::Type::NON_TERMINAL, ruleID };
+		std::string message = FormatString("An item of \"%s\" can match nothing.  The quick algorithm ends the list at the first item that does, "
+			"rather than go around forever, but that's an item tried for nothing at the end of every list.", this->GetSymbolText(ruleSymbol).c_str());
+
+		this->AddFinding(Finding::Kind::NULLABLE_LOOP, Cost::LINEAR, "quick", std::vector<int>{ ruleID }, message);
+		break;
+	}
+}
+
+// Direct left recursion is what the quick algorithm grows its seeds for, and it remembers the result.  Anything else
+// only comes to light when the recursion check turns away an attempt already in progress, and then nothing that depended
+// on the check can be remembered, since it could come out differently once the seed has grown.  Where there's more than
+// one way back around, that work is done over for each of them, at every level.
+void GrammarLinter::LintLeftRecursion(int ruleID)
+{
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	if (!rule.leftRecursive || rule.repeats)
+		return;
+
+	int ruleCount = this->compiledGrammar->GetRuleCount();
+
+	// The left corners of a rule are the rules its alternatives can start with, after nothing but what can match nothing.
+	struct LeftCorner
+	{
+		int sequenceIndex;
+		int symbolIndex;
+		int ruleID;
+	};
+
+	std::vector<std::vector<LeftCorner>> leftCornerArray(ruleCount);
+	for (int cornerRuleID = 0; cornerRuleID < ruleCount; cornerRuleID++)
+	{
+		const CompiledGrammar::Rule& cornerRule = this->compiledGrammar->GetRule(cornerRuleID);
+		for (int j = 0; j < cornerRule.sequenceCount; j++)
+		{
+			const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(cornerRule.firstSequence + j);
+			const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
+			for (int i = 0; i < sequence.symbolCount; i++)
+			{
+				if (symbolArray[i].type == CompiledGrammar::Symbol::Type::NON_TERMINAL)
+					leftCornerArray[cornerRuleID].push_back(LeftCorner{ j, i, symbolArray[i].id });
+
+				if (!this->SymbolsNullable(&symbolArray[i], 1))
+					break;
+			}
+		}
+	}
+
+	// First, see which rules can get back to this one, and how.
+	std::vector<int> nextArray(ruleCount, -1);
+	std::vector<int> ruleQueue;
+	ruleQueue.push_back(ruleID);
+	nextArray[ruleID] = ruleID;
+	std::vector<std::vector<int>> reverseArray(ruleCount);
+	for (int cornerRuleID = 0; cornerRuleID < ruleCount; cornerRuleID++)
+		for (const LeftCorner& leftCorner : leftCornerArray[cornerRuleID])
+			reverseArray[leftCorner.ruleID].push_back(cornerRuleID);
+
+	for (int q = 0; q < (int)ruleQueue.size(); q++)
+	{
+		for (int fromRuleID : reverseArray[ruleQueue[q]])
+		{
+			if (nextArray[fromRuleID] < 0)
+			{
+				nextArray[fromRuleID] = ruleQueue[q];
+				ruleQueue.push_back(fromRuleID);
+			}
+		}
+	}
+
+	// Then find the first alternative of the rule that goes around other than directly.
+	int foundSequence = -1, foundSymbol = -1, foundRuleID = -1;
+	for (const LeftCorner& leftCorner : leftCornerArray[ruleID])
+	{
+		if (nextArray[leftCorner.ruleID] < 0 || (leftCorner.ruleID == ruleID && leftCorner.symbolIndex == 0))
+			continue;
+
+		foundSequence = leftCorner.sequenceIndex;
+		foundSymbol = leftCorner.symbolIndex;
+		foundRuleID = leftCorner.ruleID;
+		break;
+	}
+
+	if (foundSequence < 0)
+		return;
+
+	const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(rule.firstSequence + foundSequence);
+	const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+	std::string ruleName = this->compiledGrammar->GetRuleName(ruleID);
+
+	if (foundRuleID == ruleID)
+	{
+		std::string prefixText = this->GetSymbolsText(symbolArray, foundSymbol);
+		if (foundSymbol == sequence.symbolCount - 1)
+		{
+			std::string message = FormatString("Alternative %d of \"%s\" is a loop (\"%s\") whose item, \"%s\", can match nothing, so it can go around without getting anywhere.  "
+				"The quick algorithm's recursion check stops it, but then takes \"%s\" to be left-recursive, and grows it a match at a time.",
+				foundSequence + 1, ruleName.c_str(), this->GetSymbolsText(symbolArray, sequence.symbolCount).c_str(), prefixText.c_str(), ruleName.c_str());
+
+			this->AddFinding(Finding::Kind::NULLABLE_LOOP, Cost::POLYNOMIAL, "quick", std::vector<int>{ ruleID }, message);
+		}
+		else
+		{
+			std::string message = FormatString("Alternative %d of \"%s\" starts with \"%s\", which can match nothing, and then \"%s\" again, so it's left-recursive where it doesn't look it.  "
+				"The quick algorithm only finds out when its recursion check turns the inner attempt away, and what depends on that isn't remembered.",
+				foundSequence + 1, ruleName.c_str(), prefixText.c_str(), ruleName.c_str());
+
+			this->AddFinding(Finding::Kind::HIDDEN_LEFT_RECURSION, Cost::POLYNOMIAL, "quick", std::vector<int>{ ruleID }, message);
+		}
+
+		return;
+	}
+
+	std::vector<int> pathArray;
+	for (int pathRuleID = foundRuleID; pathRuleID != ruleID; pathRuleID = nextArray[pathRuleID])
+		pathArray.push_back(pathRuleID);
+
+	// If any rule on the way has more than one way on towards this one, then the work multiplies.
+	bool branches = false;
+	for (int pathRuleID : pathArray)
+	{
+		int wayCount = 0;
+		for (const LeftCorner& leftCorner : leftCornerArray[pathRuleID])
+			if (nextArray[leftCorner.ruleID] >= 0)
+				wayCount++;
+
+		if (wayCount > 1)
+			branches = true;
+	}
+
+	std::string pathText;
+	std::vector<int> ruleIDArray{ ruleID };
+	for (int k = 0; k < (int)pathArray.size(); k++)
+	{
+		if (k > 0)
+			pathText += (k == (int)pathArray.size() - 1) ? " and " : ", ";
+
+		pathText += FormatString("\"%s\"", this->compiledGrammar->GetRuleName(this->GetUserRuleID(pathArray[k])));
+		ruleIDArray.push_back(pathArray[k]);
+	}
+
+	std::string message = FormatString("\"%s\" comes back around to itself at the same position by way of %s.  The quick algorithm only finds out when its recursion check turns "
+		"the inner attempt away, and then grows \"%s\" a match at a time, remembering nothing along the way that depended on the check.", ruleName.c_str(), pathText.c_str(), ruleName.c_str());
+	if (branches)
+		message += "  There's more than one way around, and the work multiplies with each.";
+
+	message += "  Making the recursion direct would save all that.";
+
+	this->AddFinding(Finding::Kind::HIDDEN_LEFT_RECURSION, branches ? Cost::EXPONENTIAL : Cost::POLYNOMIAL, "quick", ruleIDArray, message);
+}
+
+// The slow algorithm finds an alternative's terminals by scanning the tokens for them in order, skipping over anything in brackets.
+// So a terminal that comes after a bracket in the alternative, but before its partner, is never found.
+void GrammarLinter::LintNesting(int sequenceID)
+{
+	const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+	const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+	bool leftToRight = (sequence.type == Grammar::MatchSequence::Type::LEFT_TO_RIGHT);
+
+	std::vector<int> openerStack;
+	for (int k = 0; k < sequence.symbolCount; k++)
+	{
+		int i = leftToRight ? k : sequence.symbolCount - 1 - k;
+		if (symbolArray[i].type != CompiledGrammar::Symbol::Type::TERMINAL)
+			continue;
+
+		const char* text = this->compiledGrammar->GetTerminalText(symbolArray[i].id);
+		bool opener = leftToRight ? IsOpenerText(text) : IsCloserText(text);
+		bool closer = leftToRight ? IsCloserText(text) : IsOpenerText(text);
+
+		if (closer && openerStack.size() > 0)
+		{
+			openerStack.pop_back();
+			continue;
+		}
+
+		if (openerStack.size() > 0)
+		{
+			std::string message = FormatString("%s has %s between %s and its partner, but the slow algorithm only looks for an alternative's terminals "
+				"outside of brackets, so it never finds it.  Giving what's in the brackets a rule of its own would fix that.",
+				this->DescribeSequence(sequenceID).c_str(), text, this->compiledGrammar->GetTerminalText(symbolArray[openerStack.back()].id));
+
+			this->AddFinding(Finding::Kind::MIXED_NESTING, Cost::FAILURE, "slow", std::vector<int>{ sequence.ruleID }, message);
+			return;
+		}
+
+		if (opener)
+			openerStack.push_back(i);
+	}
+}
+
+void GrammarLinter::AddFinding(Finding::Kind kind, Cost cost, const char* algorithmName, const std::vector<int>& ruleIDArray, const std::string& message)
+{
+	Finding finding;
+	finding.kind = kind;
+	finding.cost = cost;
+	finding.algorithmName = algorithmName;
+	finding.message = message;
+
+	for (int ruleID : ruleIDArray)
+	{
+		std::string ruleName = this->compiledGrammar->GetRuleName(this->GetUserRuleID(ruleID));
+		if (std::find(finding.ruleNameArray.begin(), finding.ruleNameArray.end(), ruleName) == finding.ruleNameArray.end())
+			finding.ruleNameArray.push_back(ruleName);
+	}
+
+	this->findingArray->push_back(finding);
+}
+
+bool GrammarLinter::SymbolsNullable(const CompiledGrammar::Symbol* symbolArray, int symbolCount) const
+{
+	for (int i = 0; i < symbolCount; i++)
+		if (symbolArray[i].type == CompiledGrammar::Symbol::Type::TERMINAL || !this->compiledGrammar->GetRule(symbolArray[i].id).nullable)
+			return false;
+
+	return true;
+}
+
+void GrammarLinter::UnionFirstSet(uint64_t* terminalSet, const CompiledGrammar::Symbol* symbolArray, int symbolCount) const
+{
+	for (int i = 0; i < symbolCount; i++)
+	{
+		if (symbolArray[i].type == CompiledGrammar::Symbol::Type::TERMINAL)
+		{
+			terminalSet[symbolArray[i].id >> 6] |= uint64_t(1) << (symbolArray[i].id & 63);
+			return;
+		}
+
+		const uint64_t* firstSet = this->compiledGrammar->GetFirstSet(symbolArray[i].id);
+		for (int k = 0; k < this->compiledGrammar->GetTerminalSetWordCount(); k++)
+			terminalSet[k] |= firstSet[k];
+
+		if (!this->compiledGrammar->GetRule(symbolArray[i].id).nullable)
+			return;
+	}
+}
+
+int GrammarLinter::FindCommonTerminal(const uint64_t* terminalSetA, const uint64_t* terminalSetB) const
+{
+	for (int terminalID = 0; terminalID < this->compiledGrammar->GetTerminalCount(); terminalID++)
+		if (CompiledGrammar::SetContains(terminalSetA, terminalID) && CompiledGrammar::SetContains(terminalSetB, terminalID))
+			return terminalID;
+
+	return -1;
+}
+
+// Rules made for repetitions (and by the optimizer, for a bundled grammar) are named for the rule they came from, plus a "~" and a number.
+int GrammarLinter::GetUserRuleID(int ruleID) const
+{
+	while (ruleID >= 0 && this->compiledGrammar->GetRule(ruleID).spliced)
+	{
+		std::string ruleName = this->compiledGrammar->GetRuleName(ruleID);
+		int userRuleID = this->compiledGrammar->FindRule(ruleName.substr(0, ruleName.rfind('~')));
+		if (userRuleID < 0)
+			break;
+
+		ruleID = userRuleID;
+	}
+
+	return ruleID;
+}
+
+// A repetition is written back the way it would've been written, more or less; "X+" comes out as "X X*", for example.
+std::string GrammarLinter::GetSymbolText(const CompiledGrammar::Symbol& symbol) const
+{
+	if (symbol.type == CompiledGrammar::Symbol::Type::TERMINAL)
+		return this->compiledGrammar->GetTerminalText(symbol.id);
+
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(symbol.id);
+	if (!rule.spliced)
+		return this->compiledGrammar->GetRuleName(symbol.id);
+
+	std::string text;
+	int itemCount = 0;
+	bool grouped = false;
+	for (int j = 0; j < rule.sequenceCount; j++)
+	{
+		const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(rule.firstSequence + j);
+		int symbolCount = rule.repeats ? sequence.symbolCount - 1 : sequence.symbolCount;
+		if (symbolCount <= 0)
+			continue;
+
+		if (itemCount++ > 0)
+			text += " | ";
+
+		text += this->GetSymbolsText(this->compiledGrammar->GetSymbols(sequence), symbolCount);
+		if (symbolCount > 1)
+			grouped = true;
+	}
+
+	if (itemCount > 1 || grouped)
+		text = "(" + text + ")";
+
+	if (rule.repeats)
+		text += "*";
+	else if (rule.nullable)
+		text += "?";
+
+	return text;
+}
+
+std::string GrammarLinter::GetSymbolsText(const CompiledGrammar::Symbol* symbolArray, int symbolCount) const
+{
+	std::string text;
+	for (int i = 0; i < symbolCount; i++)
+	{
+		if (i > 0)
+			text += " ";
+
+		text += this->GetSymbolText(symbolArray[i]);
+	}
+
+	return text;
+}
+
+std::string GrammarLinter::DescribeSequence(int sequenceID) const
+{
+	const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(sequence.ruleID);
+
+	if (rule.spliced)
+	{
+		CompiledGrammar::Symbol ruleSymbol{ CompiledGrammar::Symbol::Type::NON_TERMINAL, sequence.ruleID };
+		return FormatString("The repetition \"%s\"", this->GetSymbolText(ruleSymbol).c_str());
+	}
+
+	return FormatString("Alternative %d of \"%s\" (\"%s\")", sequenceID - rule.firstSequence + 1, this->compiledGrammar->GetRuleName(sequence.ruleID),
+		this->GetSymbolsText(this->compiledGrammar->GetSymbols(sequence), sequence.symbolCount).c_str());
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Parser.h"
+
+namespace ParseParty
+{
+	// This looks a grammar over for the things known to make the backtracking algorithms (the quick and slow ones) slow, or
+	// just wrong, so that they can be fixed before some big input finds them out.  It's all done by looking at the rules,
+	// never by parsing anything, so each finding is a warning about what could happen, with a guess at how bad it'd be.
+	// What we look for is...
+	//
+	//		shadowed-alternative	An alternative that starts with all of an earlier one.  The quick algorithm takes the first
+	//								alternative that matches, so it never gets to the longer one where the shorter one matches.
+	//		shared-prefix			Alternatives starting with the same symbols, which the quick algorithm matches over again for each
+	//								alternative that fails after them.  The slow algorithm scans the same tokens for a shared terminal
+	//								for each alternative.
+	//		adjacent-non-terminals	Non-terminals side by side where the first could go on with something the second can start with.
+	//								The quick algorithm never gives back what a rule matched, so the second may never get its chance.
+	//								The slow algorithm can't match an alternative with non-terminals side by side at all.
+	//		nullable-loop			A list whose items can match nothing, so that it can go around without getting anywhere.
+	//		hidden-left-recursion	A rule that comes back around to itself at the same position by way of other rules, or after
+	//								something that can match nothing.  The quick algorithm handles direct left recursion well enough,
+	//								but this only comes to light when its recursion check turns an attempt away, and what depends on
+	//								that can't be remembered.
+	//		mixed-nesting			A terminal between a bracket and its partner in the same alternative.  The slow algorithm only
+	//								looks for an alternative's terminals at the nesting level it started at, so it never finds it.
+	//
+	// The rules are linted as written, not as the optimizer would leave them, except that we don't complain about shared prefixes
+	// that the optimizer would factor out anyway.  Findings name the rules as the user knows them, so a repetition (e.g., "X*")
+	// is blamed on the rule it's written in.
+	class PARSE_PARTY_API GrammarLinter
+	{
+	public:
+		GrammarLinter();
+		virtual ~GrammarLinter();
+
+		// This is how the work of matching the construct might grow with the size of the input, beyond what the algorithm
+		// would do anyway.  A failure is where the algorithm can reject good input, however long it takes to do so.
+		enum class Cost
+		{
+			LINEAR,
+			POLYNOMIAL,
+			EXPONENTIAL,
+			FAILURE
+		};
+
+		struct Finding
+		{
+			enum class Kind
+			{
+				SHADOWED_ALTERNATIVE,
+				SHARED_PREFIX,
+				ADJACENT_NON_TERMINALS,
+				NULLABLE_LOOP,
+				HIDDEN_LEFT_RECURSION,
+				MIXED_NESTING
+			};
+
+			Kind kind;
+			Cost cost;
+			std::string algorithmName;
+			std::vector<std::string> ruleNameArray;		// The rule the finding is about comes first, followed by any others involved.
+			std::string message;
+		};
+
+		// The findings come out worst first.  This only fails if the grammar won't compile.
+		bool Lint(const Grammar* grammar, std::vector<Finding>& findingArray, std::string& error);
+
+		static const char* GetKindName(Finding::Kind kind);
+		static const char* GetCostName(Cost cost);
+
+		// This is the algorithm to lint for.  If it's empty, it's the grammar's own, and if it's "all", it's every one that backtracks.
+		// Nothing is found for the other algorithms, since they don't backtrack.
+		std::string* algorithmName;
+
+	private:
+
+		bool Prepare(const Grammar* grammar, std::string& error);
+		void ComputeContinueSets();
+		void LintAlternatives(int ruleID);
+		void LintSlowAlternatives(int ruleID);
+		void LintAdjacentNonTerminals(int sequenceID);
+		void LintNullableLoops(int ruleID);
+		void LintLeftRecursion(int ruleID);
+		void LintNesting(int sequenceID);
+		void AddFinding(Finding::Kind kind, Cost cost, const char* algorithmName, const std::vector<int>& ruleIDArray, const std::string& message);
+
+		bool SymbolsNullable(const CompiledGrammar::Symbol* symbolArray, int symbolCount) const;
+		void UnionFirstSet(uint64_t* terminalSet, const CompiledGrammar::Symbol* symbolArray, int symbolCount) const;
+		int FindCommonTerminal(const uint64_t* terminalSetA, const uint64_t* terminalSetB) const;
+		int GetUserRuleID(int ruleID) const;
+		std::string GetSymbolText(const CompiledGrammar::Symbol& symbol) const;
+		std::string GetSymbolsText(const CompiledGrammar::Symbol* symbolArray, int symbolCount) const;
+		std::string DescribeSequence(int sequenceID) const;
+
+		const CompiledGrammar* compiledGrammar;
+		CompiledGrammar* ownCompiledGrammar;		// Rules as written, unoptimized, so that what we find is where the user put it.
+		std::vector<uint64_t>* continueSetArray;		// For each rule, the terminals it can go on with where it could've ended instead.
+		std::vector<Finding>* findingArray;
+		bool lintQuick;
+		bool lintSlow;
+		bool optimizing;
+	};
+}
\ No newline at end of file
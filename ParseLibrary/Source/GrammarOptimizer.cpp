@@ -0,0 +1,391 @@
+#include "GrammarOptimizer.h"
+
+using namespace ParseParty;
+
+// Only rules this small are worth copying into every place they're used.
+#define GRAMMAR_OPTIMIZER_MAX_INLINE_SYMBOLS		4
+
+// And we won't make any sequence longer than this by inlining.
+#define GRAMMAR_OPTIMIZER_MAX_SEQUENCE_LENGTH		16
+
+//------------------------------- GrammarOptimizer -------------------------------
+
+GrammarOptimizer::GrammarOptimizer()
+{
+	this->compiledGrammar = nullptr;
+	this->ruleArray = new std::vector<Rule>();
+	this->ruleNameSet = new std::set<std::string>();
+	this->changed = false;
+}
+
+/*virtual*/ GrammarOptimizer::~GrammarOptimizer()
+{
+	delete this->ruleArray;
+	delete this->ruleNameSet;
+}
+
+const std::vector<GrammarOptimizer::Rule>& GrammarOptimizer::GetRuleArray() const
+{
+	return *this->ruleArray;
+}
+
+bool GrammarOptimizer::Optimize(const CompiledGrammar* compiledGrammar)
+{
+	this->compiledGrammar = compiledGrammar;
+	this->ruleArray->clear();
+	this->ruleNameSet->clear();
+	this->changed = false;
+
+	int ruleCount = compiledGrammar->GetRuleCount();
+	for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+	{
+		const CompiledGrammar::Rule& compiledRule = compiledGrammar->GetRule(ruleID);
+
+		Rule rule;
+		rule.name = compiledGrammar->GetRuleName(ruleID);
+		rule.spliced = compiledRule.spliced;
+		rule.repeats = compiledRule.repeats;
+		rule.cut = false;
+
+		for (int i = 0; i < compiledRule.sequenceCount; i++)
+		{
+			const CompiledGrammar::Sequence& compiledSequence = compiledGrammar->GetSequence(compiledRule.firstSequence + i);
+			const CompiledGrammar::Symbol* symbolArray = compiledGrammar->GetSymbols(compiledSequence);
+
+			Sequence sequence;
+			sequence.symbolArray.assign(symbolArray, symbolArray + compiledSequence.symbolCount);
+			sequence.type = compiledSequence.type;
+			sequence.cutSymbol = compiledSequence.cutSymbol;
+			rule.sequenceArray.push_back(sequence);
+
+			if (sequence.cutSymbol >= 0)
+				rule.cut = true;
+		}
+
+		this->ruleNameSet->insert(rule.name);
+		this->ruleArray->push_back(rule);
+	}
+
+	std::vector<bool> visitedArray(ruleCount, false);
+	for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+		this->EliminateUnitRule(ruleID, visitedArray);
+
+	for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+		this->InlineRules(ruleID);
+
+	// Repetitions have to keep the shape the algorithms that loop over them expect.
+	for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+		if (!compiledGrammar->GetRule(ruleID).leftRecursive && !compiledGrammar->GetRule(ruleID).repeats && !(*this->ruleArray)[ruleID].cut)
+			this->FactorRule(ruleID);
+
+	return this->changed;
+}
+
+// Rules that can match nothing are left out, so that every node of a rule with a plan has some children,
+// which is how the restore tells it apart from a token that happens to have the same text.  Operator rules
+// are left out too, since their nodes have to come out as the flat list the tree is built from.
+bool GrammarOptimizer::Optimizable(int ruleID) const
+{
+	if (ruleID >= this->compiledGrammar->GetRuleCount())
+		return false;
+
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	return !rule.leftRecursive && !rule.nullable && rule.operatorCount == 0 && !(*this->ruleArray)[ruleID].cut;
+}
+
+void GrammarOptimizer::EliminateUnitRule(int ruleID, std::vector<bool>& visitedArray)
+{
+	if (visitedArray[ruleID])
+		return;
+
+	visitedArray[ruleID] = true;
+
+	Rule& rule = (*this->ruleArray)[ruleID];
+	if (!this->Optimizable(ruleID) || rule.sequenceArray.size() != 1 || rule.sequenceArray[0].symbolArray.size() != 1)
+		return;
+
+	const CompiledGrammar::Symbol& symbol = rule.sequenceArray[0].symbolArray[0];
+	if (symbol.type != CompiledGrammar::Symbol::Type::NON_TERMINAL || symbol.id == ruleID || !this->Optimizable(symbol.id))
+		return;
+
+	// Collapse the chain below us first, so that we get it in one go.
+	int unitRuleID = symbol.id;
+	this->EliminateUnitRule(unitRuleID, visitedArray);
+	const Rule& unitRule = (*this->ruleArray)[unitRuleID];
+
+	PlanItem groupItem{ PlanItem::Type::GROUP, unitRuleID, unitRule.planItemArray };
+	if (groupItem.itemArray.size() == 0)
+		groupItem.itemArray.push_back(PlanItem{ PlanItem::Type::REST, -1, {} });
+
+	rule.sequenceArray = unitRule.sequenceArray;
+	rule.planItemArray.clear();
+	rule.planItemArray.push_back(groupItem);
+	this->changed = true;
+}
+
+bool GrammarOptimizer::CanInline(int ruleID) const
+{
+	if (!this->Optimizable(ruleID))
+		return false;
+
+	const Rule& rule = (*this->ruleArray)[ruleID];
+	if (rule.sequenceArray.size() != 1 || rule.sequenceArray[0].symbolArray.size() > GRAMMAR_OPTIMIZER_MAX_INLINE_SYMBOLS)
+		return false;
+
+	for (const CompiledGrammar::Symbol& symbol : rule.sequenceArray[0].symbolArray)
+		if (symbol.type == CompiledGrammar::Symbol::Type::NON_TERMINAL && symbol.id == ruleID)
+			return false;
+
+	return true;
+}
+
+void GrammarOptimizer::InlineRules(int ruleID)
+{
+	if (!this->Optimizable(ruleID))
+		return;
+
+	Rule& rule = (*this->ruleArray)[ruleID];
+
+	int position = 0;
+	while (true)
+	{
+		bool inBounds = true;
+		for (const Sequence& sequence : rule.sequenceArray)
+			if ((int)sequence.symbolArray.size() <= position)
+				inBounds = false;
+
+		if (!inBounds)
+			break;
+
+		// Every alternative has to have the same rule here, or the plan would depend on which alternative matched.
+		const CompiledGrammar::Symbol symbol = rule.sequenceArray[0].symbolArray[position];
+		bool inlinable = (symbol.type == CompiledGrammar::Symbol::Type::NON_TERMINAL && symbol.id != ruleID && this->CanInline(symbol.id));
+		for (const Sequence& sequence : rule.sequenceArray)
+		{
+			const CompiledGrammar::Symbol& otherSymbol = sequence.symbolArray[position];
+			if (otherSymbol.type != symbol.type || otherSymbol.id != symbol.id)
+				inlinable = false;
+		}
+
+		if (!inlinable)
+		{
+			position++;
+			continue;
+		}
+
+		const Rule& inlineRule = (*this->ruleArray)[symbol.id];
+		const std::vector<CompiledGrammar::Symbol>& bodyArray = inlineRule.sequenceArray[0].symbolArray;
+
+		for (const Sequence& sequence : rule.sequenceArray)
+			if (sequence.symbolArray.size() + bodyArray.size() - 1 > GRAMMAR_OPTIMIZER_MAX_SEQUENCE_LENGTH)
+				inlinable = false;
+
+		if (!inlinable)
+		{
+			position++;
+			continue;
+		}
+
+		PlanItem groupItem{ PlanItem::Type::GROUP, symbol.id, inlineRule.planItemArray };
+		if (groupItem.itemArray.size() == 0)
+			groupItem.itemArray.push_back(PlanItem{ PlanItem::Type::REST, -1, {} });
+
+		// The group is in the middle of our children now, so it can't just take all the rest.
+		MaterializePlan(groupItem.itemArray, (int)bodyArray.size());
+
+		if (rule.planItemArray.size() == 0)
+			rule.planItemArray.push_back(PlanItem{ PlanItem::Type::REST, -1, {} });
+
+		int childNumber = 0;
+		InsertGroup(rule.planItemArray, childNumber, position, groupItem);
+
+		for (Sequence& sequence : rule.sequenceArray)
+		{
+			sequence.symbolArray.erase(sequence.symbolArray.begin() + position);
+			sequence.symbolArray.insert(sequence.symbolArray.begin() + position, bodyArray.begin(), bodyArray.end());
+		}
+
+		// Don't move on, since what we just put here might be inlinable too.
+		this->changed = true;
+	}
+}
+
+void GrammarOptimizer::FactorRule(int ruleID)
+{
+	std::vector<Sequence> sequenceArray = (*this->ruleArray)[ruleID].sequenceArray;
+	std::vector<Sequence> factoredSequenceArray;
+
+	int i = 0;
+	while (i < (int)sequenceArray.size())
+	{
+		// Find the run of alternatives starting with the same symbol as this one.
+		const std::vector<CompiledGrammar::Symbol>& firstSymbolArray = sequenceArray[i].symbolArray;
+		int j = i + 1;
+		while (j < (int)sequenceArray.size() && firstSymbolArray.size() > 0 && sequenceArray[j].symbolArray.size() > 0 &&
+			sequenceArray[j].symbolArray[0].type == firstSymbolArray[0].type && sequenceArray[j].symbolArray[0].id == firstSymbolArray[0].id)
+		{
+			j++;
+		}
+
+		if (j - i < 2)
+		{
+			factoredSequenceArray.push_back(sequenceArray[i]);
+			i = j;
+			continue;
+		}
+
+		int prefixLength = (int)firstSymbolArray.size();
+		for (int k = i + 1; k < j; k++)
+		{
+			const std::vector<CompiledGrammar::Symbol>& symbolArray = sequenceArray[k].symbolArray;
+			int length = 0;
+			while (length < prefixLength && length < (int)symbolArray.size() && symbolArray[length].type == firstSymbolArray[length].type && symbolArray[length].id == firstSymbolArray[length].id)
+				length++;
+
+			prefixLength = length;
+		}
+
+		Rule tailRule;
+		tailRule.spliced = true;
+		tailRule.repeats = false;
+		tailRule.cut = false;
+
+		int tailNumber = 1;
+		do
+		{
+			tailRule.name = FormatString("%s~%d", (*this->ruleArray)[ruleID].name.c_str(), tailNumber++);
+		} while (this->ruleNameSet->find(tailRule.name) != this->ruleNameSet->end());
+
+		for (int k = i; k < j; k++)
+		{
+			Sequence tailSequence;
+			tailSequence.symbolArray.assign(sequenceArray[k].symbolArray.begin() + prefixLength, sequenceArray[k].symbolArray.end());
+			tailSequence.type = Grammar::MatchSequence::Type::LEFT_TO_RIGHT;
+			tailSequence.cutSymbol = -1;
+			tailRule.sequenceArray.push_back(tailSequence);
+		}
+
+		int tailRuleID = (int)this->ruleArray->size();
+		this->ruleNameSet->insert(tailRule.name);
+		this->ruleArray->push_back(tailRule);
+
+		Sequence factoredSequence;
+		factoredSequence.symbolArray.assign(firstSymbolArray.begin(), firstSymbolArray.begin() + prefixLength);
+		factoredSequence.symbolArray.push_back(CompiledGrammar::Symbol{ CompiledGrammar::Symbol::Type::NON_TERMINAL, tailRuleID });
+		factoredSequence.type = Grammar::MatchSequence::Type::LEFT_TO_RIGHT;
+		factoredSequence.cutSymbol = -1;
+		factoredSequenceArray.push_back(factoredSequence);
+
+		// What's left of the run might share longer prefixes among itself.
+		this->FactorRule(tailRuleID);
+		this->changed = true;
+
+		i = j;
+	}
+
+	(*this->ruleArray)[ruleID].sequenceArray = factoredSequenceArray;
+}
+
+// Replace any REST item with however many children it would have taken.
+/*static*/ void GrammarOptimizer::MaterializePlan(std::vector<PlanItem>& planItemArray, int childCount)
+{
+	std::function<int(const std::vector<PlanItem>&)> countChildren = [&countChildren](const std::vector<PlanItem>& itemArray) -> int
+	{
+		int count = 0;
+		for (const PlanItem& item : itemArray)
+		{
+			if (item.type == PlanItem::Type::CHILD)
+				count++;
+			else if (item.type == PlanItem::Type::GROUP)
+				count += countChildren(item.itemArray);
+		}
+
+		return count;
+	};
+
+	int restCount = childCount - countChildren(planItemArray);
+
+	std::function<void(std::vector<PlanItem>&)> replaceRest = [&replaceRest, restCount](std::vector<PlanItem>& itemArray)
+	{
+		for (int i = 0; i < (int)itemArray.size(); i++)
+		{
+			if (itemArray[i].type == PlanItem::Type::GROUP)
+				replaceRest(itemArray[i].itemArray);
+			else if (itemArray[i].type == PlanItem::Type::REST)
+			{
+				itemArray.erase(itemArray.begin() + i);
+				itemArray.insert(itemArray.begin() + i, restCount, PlanItem{ PlanItem::Type::CHILD, -1, {} });
+				return;
+			}
+		}
+	};
+
+	replaceRest(planItemArray);
+}
+
+// Put the given group in place of the child at the given position, counting children as we go in the given plan.
+/*static*/ bool GrammarOptimizer::InsertGroup(std::vector<PlanItem>& planItemArray, int& childNumber, int position, const PlanItem& groupItem)
+{
+	for (int i = 0; i < (int)planItemArray.size(); i++)
+	{
+		PlanItem& item = planItemArray[i];
+
+		switch (item.type)
+		{
+			case PlanItem::Type::CHILD:
+			{
+				if (childNumber == position)
+				{
+					item = groupItem;
+					return true;
+				}
+
+				childNumber++;
+				break;
+			}
+			case PlanItem::Type::GROUP:
+			{
+				if (InsertGroup(item.itemArray, childNumber, position, groupItem))
+					return true;
+
+				break;
+			}
+			case PlanItem::Type::REST:
+			{
+				std::vector<PlanItem> insertArray(position - childNumber, PlanItem{ PlanItem::Type::CHILD, -1, {} });
+				insertArray.push_back(groupItem);
+				planItemArray.insert(planItemArray.begin() + i, insertArray.begin(), insertArray.end());
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/*static*/ void GrammarOptimizer::EncodePlan(const std::vector<PlanItem>& planItemArray, std::vector<int>& planArray)
+{
+	for (const PlanItem& item : planItemArray)
+	{
+		switch (item.type)
+		{
+			case PlanItem::Type::CHILD:
+			{
+				planArray.push_back(-1);
+				break;
+			}
+			case PlanItem::Type::REST:
+			{
+				planArray.push_back(-2);
+				break;
+			}
+			case PlanItem::Type::GROUP:
+			{
+				planArray.push_back(item.ruleID);
+				planArray.push_back((int)item.itemArray.size());
+				EncodePlan(item.itemArray, planArray);
+				break;
+			}
+		}
+	}
+}
\ No newline at end of file
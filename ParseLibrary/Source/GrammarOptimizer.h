@@ -0,0 +1,92 @@
+#pragma once
+
+#include "CompiledGrammar.h"
+
+namespace ParseParty
+{
+	// This reworks a compiled grammar into one that parses the same language with less work, at the cost
+	// of trees that come out in a different shape.  Each reworked rule gets a restore plan, which is all
+	// Parser::RestoreTree() needs to put the tree back into the shape the original grammar would have
+	// given it, so none of this is visible to the user.  There are three passes, done in this order...
+	//
+	// Unit-rule elimination.  A rule whose only alternative is another rule (A -> B) takes on the alternatives
+	// of that rule, and its plan wraps its children in a B node.  This saves a level of recursion at every A.
+	//
+	// Inlining.  A small rule with just the one alternative gets substituted for its name wherever every
+	// alternative of the calling rule has it at the same position, and the calling rule's plan groups the
+	// substituted symbols back up under a node for the inlined rule.
+	//
+	// Left-factoring.  A run of adjacent alternatives starting with the same symbols gets replaced by one
+	// alternative made of those symbols followed by a synthetic tail rule, which has what's left of each of them
+	// as alternatives, in the same order.  Nodes for tail rules are spliced into their parents.  So, rather than
+	// match the common prefix again for every alternative, we match it once, which cuts down on backtracking.
+	// Keeping the alternatives in order means the first-match-wins algorithms still pick the same one.
+	//
+	// Left-recursive rules are left alone, since their alternatives are matched in a way we'd only upset.  So
+	// are rules with a cut in any alternative, since moving symbols around would move the cut.
+	class PARSE_PARTY_API GrammarOptimizer
+	{
+	public:
+		GrammarOptimizer();
+		virtual ~GrammarOptimizer();
+
+		// This returns false if there was nothing to be done.
+		bool Optimize(const CompiledGrammar* compiledGrammar);
+
+		// A plan is a list of these, which says how to make the original list of children out of
+		// those matched by the optimized rule.  Groups make a node for the given rule out of their own items.
+		struct PlanItem
+		{
+			enum class Type
+			{
+				CHILD,		// The next child, as-is.
+				REST,		// All the children left.
+				GROUP
+			};
+
+			Type type;
+			int ruleID;
+			std::vector<PlanItem> itemArray;
+		};
+
+		struct Sequence
+		{
+			std::vector<CompiledGrammar::Symbol> symbolArray;
+			Grammar::MatchSequence::Type type;
+			int cutSymbol;
+		};
+
+		struct Rule
+		{
+			std::string name;
+			std::vector<Sequence> sequenceArray;
+			std::vector<PlanItem> planItemArray;		// Empty means there is no plan; the children are already as they should be.
+			bool spliced;
+			bool repeats;
+			bool cut;		// Does any alternative have a cut in it?
+		};
+
+		// Rules keep the IDs they had in the compiled grammar.  Any tail rules come after them.
+		const std::vector<Rule>& GetRuleArray() const;
+
+		// Plans are flattened into runs of integers for the compiled grammar.  A child is -1, the rest is -2, and a
+		// group is the rule ID followed by its item count and then its items.
+		static void EncodePlan(const std::vector<PlanItem>& planItemArray, std::vector<int>& planArray);
+
+	private:
+
+		void EliminateUnitRule(int ruleID, std::vector<bool>& visitedArray);
+		void InlineRules(int ruleID);
+		bool CanInline(int ruleID) const;
+		void FactorRule(int ruleID);
+		bool Optimizable(int ruleID) const;
+
+		static void MaterializePlan(std::vector<PlanItem>& planItemArray, int childCount);
+		static bool InsertGroup(std::vector<PlanItem>& planItemArray, int& childNumber, int position, const PlanItem& groupItem);
+
+		const CompiledGrammar* compiledGrammar;
+		std::vector<Rule>* ruleArray;
+		std::set<std::string>* ruleNameSet;
+		bool changed;
+	};
+}
\ No newline at end of file
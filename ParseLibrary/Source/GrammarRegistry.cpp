@@ -0,0 +1,182 @@
+#include "GrammarRegistry.h"
+#include "Grammar.h"
+
+#define GRAMMAR_REGISTRY_SLOT_COUNT		256
+
+using namespace ParseParty;
+
+//------------------------------- GrammarRegistry -------------------------------
+
+GrammarRegistry::GrammarRegistry()
+{
+	this->currentCatalog.store(new Catalog());
+	this->currentEpoch.store(1);
+	this->slotArray = new Slot[GRAMMAR_REGISTRY_SLOT_COUNT];
+	for (int i = 0; i < GRAMMAR_REGISTRY_SLOT_COUNT; i++)
+		this->slotArray[i].epoch.store(0);
+
+	this->overflowEpochList = new std::list<uint64_t>();
+	this->overflowMutex = new std::mutex();
+	this->retireeList = new std::list<Retiree>();
+	this->publishMutex = new std::mutex();
+}
+
+// No leases can be held by the time we go away, so everything can go.
+/*virtual*/ GrammarRegistry::~GrammarRegistry()
+{
+	const Catalog* catalog = this->currentCatalog.load();
+	for (const std::pair<const std::string, const Grammar*>& pair : *catalog)
+		delete pair.second;
+
+	delete catalog;
+
+	for (const Retiree& retiree : *this->retireeList)
+	{
+		delete retiree.catalog;
+		delete retiree.grammar;
+	}
+
+	delete[] this->slotArray;
+	delete this->overflowEpochList;
+	delete this->overflowMutex;
+	delete this->retireeList;
+	delete this->publishMutex;
+}
+
+void GrammarRegistry::Publish(const std::string& name, Grammar* grammar)
+{
+	std::lock_guard<std::mutex> lock(*this->publishMutex);
+
+	const Catalog* oldCatalog = this->currentCatalog.load();
+	Catalog* newCatalog = new Catalog(*oldCatalog);
+
+	const Grammar* oldGrammar = nullptr;
+	Catalog::iterator iter = newCatalog->find(name);
+	if (iter != newCatalog->end())
+	{
+		oldGrammar = iter->second;
+		newCatalog->erase(iter);
+	}
+
+	if (grammar)
+		newCatalog->insert(std::pair<std::string, const Grammar*>(name, grammar));
+
+	if (oldGrammar == grammar)
+		oldGrammar = nullptr;
+
+	// A lease taken from here on can only see the new catalog, and any lease that could've seen the old one
+	// was stamped with an epoch no later than the one we're leaving.
+	this->currentCatalog.store(newCatalog);
+	uint64_t epoch = this->currentEpoch.fetch_add(1);
+	this->retireeList->push_back(Retiree{ epoch, oldCatalog, oldGrammar });
+
+	this->DeleteRetirees();
+}
+
+bool GrammarRegistry::PublishFile(const std::string& name, const std::string& grammarFile, std::string& error)
+{
+	Grammar* grammar = new Grammar();
+	if (!grammar->ReadFile(grammarFile, error))
+	{
+		delete grammar;
+		return false;
+	}
+
+	this->Publish(name, grammar);
+	return true;
+}
+
+void GrammarRegistry::Reclaim()
+{
+	std::lock_guard<std::mutex> lock(*this->publishMutex);
+
+	this->DeleteRetirees();
+}
+
+// This is called with the publish mutex held.
+void GrammarRegistry::DeleteRetirees()
+{
+	uint64_t oldestEpoch = UINT64_MAX;
+	for (int i = 0; i < GRAMMAR_REGISTRY_SLOT_COUNT; i++)
+	{
+		uint64_t epoch = this->slotArray[i].epoch.load();
+		if (epoch != 0 && epoch < oldestEpoch)
+			oldestEpoch = epoch;
+	}
+
+	{
+		std::lock_guard<std::mutex> overflowLock(*this->overflowMutex);
+		for (uint64_t epoch : *this->overflowEpochList)
+			if (epoch < oldestEpoch)
+				oldestEpoch = epoch;
+	}
+
+	std::list<Retiree>::iterator iter = this->retireeList->begin();
+	while (iter != this->retireeList->end())
+	{
+		std::list<Retiree>::iterator nextIter = iter;
+		nextIter++;
+
+		if (iter->epoch < oldestEpoch)
+		{
+			delete iter->catalog;
+			delete iter->grammar;
+			this->retireeList->erase(iter);
+		}
+
+		iter = nextIter;
+	}
+}
+
+//------------------------------- GrammarRegistry::Lease -------------------------------
+
+// Threads start looking for a free slot at different places, so that they don't usually have to look far.  The stamp can
+// be a little out of date by the time we claim the slot, but that's fine, since an earlier stamp only holds up more.
+GrammarRegistry::Lease::Lease(const GrammarRegistry* registry)
+{
+	this->registry = registry;
+	this->slot = int(std::hash<std::thread::id>()(std::this_thread::get_id()) % GRAMMAR_REGISTRY_SLOT_COUNT);
+
+	uint64_t epoch = registry->currentEpoch.load();
+
+	int i;
+	for (i = 0; i < GRAMMAR_REGISTRY_SLOT_COUNT; i++)
+	{
+		uint64_t freeEpoch = 0;
+		if (registry->slotArray[this->slot].epoch.compare_exchange_strong(freeEpoch, epoch))
+			break;
+
+		this->slot = (this->slot + 1) % GRAMMAR_REGISTRY_SLOT_COUNT;
+	}
+
+	// Every slot is taken, which can only happen with more leases out than we have slots.  Rather than wait for one
+	// to come free, which could be a long time if the leases are held for long parses, we go on the overflow list.
+	if (i == GRAMMAR_REGISTRY_SLOT_COUNT)
+	{
+		std::lock_guard<std::mutex> overflowLock(*registry->overflowMutex);
+		this->slot = -1;
+		this->overflowIter = registry->overflowEpochList->insert(registry->overflowEpochList->end(), registry->currentEpoch.load());
+	}
+
+	this->catalog = registry->currentCatalog.load();
+}
+
+/*virtual*/ GrammarRegistry::Lease::~Lease()
+{
+	if (this->slot >= 0)
+		this->registry->slotArray[this->slot].epoch.store(0);
+	else
+	{
+		std::lock_guard<std::mutex> overflowLock(*this->registry->overflowMutex);
+		this->registry->overflowEpochList->erase(this->overflowIter);
+	}
+}
+
+const Grammar* GrammarRegistry::Lease::Lookup(const std::string& name) const
+{
+	Catalog::const_iterator iter = this->catalog->find(name);
+	if (iter == this->catalog->end())
+		return nullptr;
+
+	return iter->second;
+}
\ No newline at end of file
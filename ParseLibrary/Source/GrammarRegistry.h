@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Common.h"
+
+namespace ParseParty
+{
+	class Grammar;
+
+	// This is for long-running services that parse on many threads, and that need to swap in new versions of their
+	// grammars (say, when a config changes) without stopping to do so.  Grammars are published under a name, and looked up
+	// under a lease, which is what lets a parse finish on the version it started with while new parses pick up the new one.
+	//
+	// The names and grammars published at any one time make up a catalog, which is never changed once published; publishing
+	// makes a new one and swaps it in with a single atomic store.  The read path takes no locks at all, and neither does the parse
+	// after it, since compiling a grammar builds every table its algorithm needs before it can be published.  Leasing claims a
+	// slot and stamps it with the current epoch, and the epoch goes up with every publish, so a catalog (or grammar) retired
+	// in some epoch can only still be in use by a lease with a stamp no later than that.  The retired stuff is deleted by
+	// the first publish (or Reclaim()) to find no such lease left, so the publisher never waits on the readers.  The readers
+	// don't wait on anything either, so long as there are no more leases out than there are slots; past that, a lease falls
+	// back on an overflow list, which is behind a mutex of its own.  Reading and compiling the new grammar happens before
+	// any of this, off to the side, so a reload costs the readers nothing.
+	//
+	// A lease should be held for about as long as a parse, since as long as it's held, nothing retired since it was taken
+	// can be deleted.  Publishers are serialized with one another by a mutex.
+	class PARSE_PARTY_API GrammarRegistry
+	{
+	public:
+		GrammarRegistry();
+		virtual ~GrammarRegistry();
+
+		// Take ownership of the given grammar, which must be compiled already, and make it the one to use under the given name.
+		// The one it replaces (if any) is deleted once no lease can still be using it.  Publishing null takes the name away.
+		// A grammar can only be published once, under one name.
+		void Publish(const std::string& name, Grammar* grammar);
+
+		// Read and compile the given grammar file, and then publish it.  Nothing changes if this fails.
+		bool PublishFile(const std::string& name, const std::string& grammarFile, std::string& error);
+
+		// Delete whatever has been retired that no lease can still be using.  Publishing does this too.
+		void Reclaim();
+
+		class PARSE_PARTY_API Lease
+		{
+		public:
+			Lease(const GrammarRegistry* registry);
+			virtual ~Lease();
+
+			// A copy would give the slot back twice.
+			Lease(const Lease&) = delete;
+			Lease& operator=(const Lease&) = delete;
+
+			// Return the grammar published under the given name as of when the lease was taken, or null if there was none.
+			// The grammar is good for as long as the lease is held.
+			const Grammar* Lookup(const std::string& name) const;
+
+		private:
+
+			const GrammarRegistry* registry;
+			const std::map<std::string, const Grammar*>* catalog;
+			int slot;		// This is -1 if all the slots were taken, and the lease is on the overflow list instead.
+			std::list<uint64_t>::iterator overflowIter;
+		};
+
+	private:
+
+		void DeleteRetirees();
+
+		typedef std::map<std::string, const Grammar*> Catalog;
+
+		// Each of these is on a cache-line of its own, so that leases taken on different threads don't fight over it.
+		struct alignas(64) Slot
+		{
+			std::atomic<uint64_t> epoch;		// The epoch the lease holding the slot was taken in, or zero if the slot is free.
+		};
+
+		struct Retiree
+		{
+			uint64_t epoch;
+			const Catalog* catalog;
+			const Grammar* grammar;
+		};
+
+		std::atomic<const Catalog*> currentCatalog;
+		std::atomic<uint64_t> currentEpoch;
+		Slot* slotArray;
+		std::list<uint64_t>* overflowEpochList;		// The epochs of the leases that didn't get a slot.
+		std::mutex* overflowMutex;
+		std::list<Retiree>* retireeList;
+		std::mutex* publishMutex;
+	};
+}
\ No newline at end of file
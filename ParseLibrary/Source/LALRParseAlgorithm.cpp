@@ -0,0 +1,663 @@
+#include "LALRParseAlgorithm.h"
+
+using namespace ParseParty;
+
+static bool UnionLookahead(uint64_t* lookaheadA, const uint64_t* lookaheadB, int wordCount)
+{
+	bool changed = false;
+	for (int i = 0; i < wordCount; i++)
+	{
+		uint64_t word = lookaheadA[i] | lookaheadB[i];
+		if (word != lookaheadA[i])
+		{
+			lookaheadA[i] = word;
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+//------------------------------- LALRParseTable -------------------------------
+
+LALRParseTable::LALRParseTable()
+{
+	this->compiledGrammar = nullptr;
+	this->stateCount = 0;
+	this->columnCount = 0;
+	this->itemBaseArray = new std::vector<int>();
+	this->itemSequenceArray = new std::vector<int>();
+	this->actionOffsetArray = new FlatArray<int>();
+	this->actionArray = new FlatArray<Action>();
+	this->gotoTable = new FlatArray<int>();
+	this->conflictText = new std::string();
+}
+
+/*virtual*/ LALRParseTable::~LALRParseTable()
+{
+	delete this->itemBaseArray;
+	delete this->itemSequenceArray;
+	delete this->actionOffsetArray;
+	delete this->actionArray;
+	delete this->gotoTable;
+	delete this->conflictText;
+}
+
+bool LALRParseTable::Build(const CompiledGrammar* compiledGrammar, std::string& error)
+{
+	this->compiledGrammar = compiledGrammar;
+
+	if (compiledGrammar->GetInitialRuleID() < 0)
+	{
+		error = "Can't build LALR(1) tables without an initial rule.";
+		return false;
+	}
+
+	int wordCount = compiledGrammar->GetTerminalSetWordCount();
+	int endOfInput = compiledGrammar->GetEndOfInputTerminal();
+	int sequenceCount = compiledGrammar->GetSequenceCount();
+	this->columnCount = compiledGrammar->GetTerminalCount() + 1;
+
+	// An item is a sequence with a dot somewhere in it, and the items of each sequence get consecutive IDs.
+	// The sequence after all the real ones is the augmented start sequence, which is just the initial rule.
+	this->itemBaseArray->clear();
+	this->itemSequenceArray->clear();
+	for (int sequenceID = 0; sequenceID <= sequenceCount; sequenceID++)
+	{
+		int symbolCount = (sequenceID < sequenceCount) ? compiledGrammar->GetSequence(sequenceID).symbolCount : 1;
+		this->itemBaseArray->push_back((int)this->itemSequenceArray->size());
+		for (int i = 0; i <= symbolCount; i++)
+			this->itemSequenceArray->push_back(sequenceID);
+	}
+
+	int itemCount = (int)this->itemSequenceArray->size();
+
+	// For each item, precompute the FIRST set of what follows the symbol after the dot, and whether that can all vanish.
+	std::vector<uint64_t> tailFirstSetArray(itemCount * wordCount, 0);
+	std::vector<bool> tailNullableArray(itemCount, true);
+	for (int sequenceID = 0; sequenceID < sequenceCount; sequenceID++)
+	{
+		const CompiledGrammar::Sequence& sequence = compiledGrammar->GetSequence(sequenceID);
+		const CompiledGrammar::Symbol* symbolArray = compiledGrammar->GetSymbols(sequence);
+
+		for (int dot = 0; dot < sequence.symbolCount; dot++)
+		{
+			int itemID = (*this->itemBaseArray)[sequenceID] + dot;
+			uint64_t* tailFirstSet = &tailFirstSetArray[itemID * wordCount];
+
+			for (int i = dot + 1; i < sequence.symbolCount; i++)
+			{
+				const CompiledGrammar::Symbol& symbol = symbolArray[i];
+				if (symbol.type == CompiledGrammar::Symbol::Type::TERMINAL)
+				{
+					tailFirstSet[symbol.id >> 6] |= uint64_t(1) << (symbol.id & 63);
+					tailNullableArray[itemID] = false;
+					break;
+				}
+
+				UnionLookahead(tailFirstSet, compiledGrammar->GetFirstSet(symbol.id), wordCount);
+				if (!compiledGrammar->GetRule(symbol.id).nullable)
+				{
+					tailNullableArray[itemID] = false;
+					break;
+				}
+			}
+		}
+	}
+
+	// Build the LR(0) collection of item sets.  Item sets are identified by their (sorted) kernels.
+	std::vector<ItemSet> itemSetArray;
+	std::map<std::vector<int>, int> kernelMap;
+	std::vector<int> itemSlotArray(itemCount, -1);
+
+	ItemSet initialItemSet;
+	initialItemSet.itemArray.push_back((*this->itemBaseArray)[sequenceCount]);
+	initialItemSet.kernelCount = 1;
+	kernelMap.insert(std::pair<std::vector<int>, int>(initialItemSet.itemArray, 0));
+	this->CloseItemSet(initialItemSet, itemSlotArray);
+	itemSetArray.push_back(initialItemSet);
+
+	for (int state = 0; state < (int)itemSetArray.size(); state++)
+	{
+		int itemSetSize = (int)itemSetArray[state].itemArray.size();
+		itemSetArray[state].successorArray.assign(itemSetSize, -1);
+		itemSetArray[state].successorSlotArray.assign(itemSetSize, -1);
+
+		// Group the items by the symbol after the dot.  Terminals and non-terminals get disjoint keys.
+		std::map<int, std::vector<int>> transitionMap;
+		for (int i = 0; i < itemSetSize; i++)
+		{
+			CompiledGrammar::Symbol symbol;
+			if (this->GetItemSymbol(itemSetArray[state].itemArray[i], symbol))
+			{
+				int key = (symbol.type == CompiledGrammar::Symbol::Type::TERMINAL) ? symbol.id : (this->columnCount + symbol.id);
+				transitionMap[key].push_back(i);
+			}
+		}
+
+		for (const std::pair<const int, std::vector<int>>& pair : transitionMap)
+		{
+			std::vector<int> kernelArray;
+			for (int i : pair.second)
+				kernelArray.push_back(itemSetArray[state].itemArray[i] + 1);
+
+			std::sort(kernelArray.begin(), kernelArray.end());
+			kernelArray.erase(std::unique(kernelArray.begin(), kernelArray.end()), kernelArray.end());
+
+			int successor = 0;
+			std::map<std::vector<int>, int>::iterator iter = kernelMap.find(kernelArray);
+			if (iter != kernelMap.end())
+				successor = iter->second;
+			else
+			{
+				successor = (int)itemSetArray.size();
+				kernelMap.insert(std::pair<std::vector<int>, int>(kernelArray, successor));
+
+				ItemSet itemSet;
+				itemSet.itemArray = kernelArray;
+				itemSet.kernelCount = (int)kernelArray.size();
+				this->CloseItemSet(itemSet, itemSlotArray);
+				itemSetArray.push_back(itemSet);
+			}
+
+			for (int i : pair.second)
+			{
+				int advancedItemID = itemSetArray[state].itemArray[i] + 1;
+				itemSetArray[state].successorArray[i] = successor;
+				itemSetArray[state].successorSlotArray[i] = int(std::lower_bound(kernelArray.begin(), kernelArray.end(), advancedItemID) - kernelArray.begin());
+			}
+		}
+	}
+
+	this->stateCount = (int)itemSetArray.size();
+
+	// Now propagate lookaheads through the LR(0) automaton until they stop changing.  Within an item set,
+	// the closure items get what can follow them in the item that introduced them (plus that item's lookahead
+	// if all of that can vanish).  Between item sets, an item's lookahead carries over to its advanced self.
+	for (ItemSet& itemSet : itemSetArray)
+		itemSet.lookaheadArray.assign(itemSet.itemArray.size() * wordCount, 0);
+
+	itemSetArray[0].lookaheadArray[endOfInput >> 6] |= uint64_t(1) << (endOfInput & 63);
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (ItemSet& itemSet : itemSetArray)
+		{
+			int itemSetSize = (int)itemSet.itemArray.size();
+			for (int i = 0; i < itemSetSize; i++)
+				itemSlotArray[itemSet.itemArray[i]] = i;
+
+			bool closureChanged = true;
+			while (closureChanged)
+			{
+				closureChanged = false;
+
+				for (int i = 0; i < itemSetSize; i++)
+				{
+					int itemID = itemSet.itemArray[i];
+					CompiledGrammar::Symbol symbol;
+					if (!this->GetItemSymbol(itemID, symbol) || symbol.type != CompiledGrammar::Symbol::Type::NON_TERMINAL)
+						continue;
+
+					const CompiledGrammar::Rule& rule = compiledGrammar->GetRule(symbol.id);
+					for (int j = 0; j < rule.sequenceCount; j++)
+					{
+						int slot = itemSlotArray[(*this->itemBaseArray)[rule.firstSequence + j]];
+						uint64_t* lookahead = &itemSet.lookaheadArray[slot * wordCount];
+
+						if (UnionLookahead(lookahead, &tailFirstSetArray[itemID * wordCount], wordCount))
+							closureChanged = true;
+
+						if (tailNullableArray[itemID] && UnionLookahead(lookahead, &itemSet.lookaheadArray[i * wordCount], wordCount))
+							closureChanged = true;
+					}
+				}
+			}
+
+			for (int i = 0; i < itemSetSize; i++)
+				itemSlotArray[itemSet.itemArray[i]] = -1;
+
+			for (int i = 0; i < itemSetSize; i++)
+			{
+				int successor = itemSet.successorArray[i];
+				if (successor < 0)
+					continue;
+
+				ItemSet& successorItemSet = itemSetArray[successor];
+				if (UnionLookahead(&successorItemSet.lookaheadArray[itemSet.successorSlotArray[i] * wordCount], &itemSet.lookaheadArray[i * wordCount], wordCount))
+					changed = true;
+			}
+		}
+	}
+
+	// We can finally fill out the tables.
+	std::vector<std::vector<Action>> cellArray(this->stateCount * this->columnCount);
+	this->gotoTable->assign(this->stateCount * compiledGrammar->GetRuleCount(), -1);
+
+	for (int state = 0; state < this->stateCount; state++)
+	{
+		const ItemSet& itemSet = itemSetArray[state];
+
+		for (int i = 0; i < (int)itemSet.itemArray.size(); i++)
+		{
+			int itemID = itemSet.itemArray[i];
+			CompiledGrammar::Symbol symbol;
+			if (this->GetItemSymbol(itemID, symbol))
+			{
+				if (symbol.type == CompiledGrammar::Symbol::Type::NON_TERMINAL)
+					(*this->gotoTable)[state * compiledGrammar->GetRuleCount() + symbol.id] = itemSet.successorArray[i];
+				else
+				{
+					std::vector<Action>& cellActionArray = cellArray[state * this->columnCount + symbol.id];
+					if (cellActionArray.size() == 0 || cellActionArray[0].type != Action::Type::SHIFT)
+						cellActionArray.insert(cellActionArray.begin(), Action{ Action::Type::SHIFT, itemSet.successorArray[i] });
+				}
+
+				continue;
+			}
+
+			int sequenceID = (*this->itemSequenceArray)[itemID];
+			if (sequenceID == sequenceCount)
+			{
+				cellArray[state * this->columnCount + endOfInput].push_back(Action{ Action::Type::ACCEPT, 0 });
+				continue;
+			}
+
+			const uint64_t* lookahead = &itemSet.lookaheadArray[i * wordCount];
+			for (int terminalID = 0; terminalID < this->columnCount; terminalID++)
+				if (CompiledGrammar::SetContains(lookahead, terminalID))
+					cellArray[state * this->columnCount + terminalID].push_back(Action{ Action::Type::REDUCE, sequenceID });
+		}
+	}
+
+	this->actionOffsetArray->clear();
+	this->actionArray->clear();
+	this->conflictText->clear();
+
+	for (int state = 0; state < this->stateCount; state++)
+	{
+		for (int terminalID = 0; terminalID < this->columnCount; terminalID++)
+		{
+			const std::vector<Action>& cellActionArray = cellArray[state * this->columnCount + terminalID];
+			this->actionOffsetArray->push_back((int)this->actionArray->size());
+			for (const Action& action : cellActionArray)
+				this->actionArray->push_back(action);
+
+			if (cellActionArray.size() > 1)
+				this->ReportConflict(state, terminalID, cellActionArray);
+		}
+
+		// Overlapping terminals (e.g., "@number" and "@float") can't call for different actions on the same token.
+		for (int tokenType = 0; tokenType <= (int)Lexer::Token::Type::CLOSE_CURLY_BRACE; tokenType++)
+		{
+			const std::vector<int>& terminalIDArray = compiledGrammar->GetTokenTypeTerminals((Lexer::Token::Type)tokenType);
+			int terminalA = -1;
+
+			for (int terminalID : terminalIDArray)
+			{
+				if (cellArray[state * this->columnCount + terminalID].size() == 0)
+					continue;
+
+				if (terminalA < 0)
+					terminalA = terminalID;
+				else
+					this->ReportOverlap(state, terminalA, terminalID, cellArray);
+			}
+		}
+	}
+
+	this->actionOffsetArray->push_back((int)this->actionArray->size());
+
+	return true;
+}
+
+void LALRParseTable::WriteBundle(Bundle::Writer& bundleWriter) const
+{
+	std::string info;
+	Bundle::PackInt(info, this->stateCount);
+	Bundle::PackString(info, *this->conflictText);
+	bundleWriter.AddSection(Bundle::SectionTag::LALR_INFO, info.data(), info.size());
+
+	bundleWriter.AddArray(Bundle::SectionTag::LALR_ACTION_OFFSETS, *this->actionOffsetArray);
+	bundleWriter.AddArray(Bundle::SectionTag::LALR_ACTIONS, *this->actionArray);
+	bundleWriter.AddArray(Bundle::SectionTag::LALR_GOTOS, *this->gotoTable);
+}
+
+// Note that the item arrays are only needed while building the tables, so they don't get bundled.
+bool LALRParseTable::ReadBundle(const CompiledGrammar* compiledGrammar, const Bundle::Reader& bundleReader, std::string& error)
+{
+	this->compiledGrammar = compiledGrammar;
+	this->columnCount = compiledGrammar->GetTerminalCount() + 1;
+
+	size_t infoSize = 0;
+	const char* info = bundleReader.GetSection(Bundle::SectionTag::LALR_INFO, infoSize);
+	if (!info || !Bundle::UnpackInt(info, info + infoSize, this->stateCount) || !Bundle::UnpackString(info, info + infoSize, *this->conflictText))
+	{
+		error = "Bundle has malformed LALR(1) table info.";
+		return false;
+	}
+
+	if (!bundleReader.ViewArray(Bundle::SectionTag::LALR_ACTION_OFFSETS, *this->actionOffsetArray, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::LALR_ACTIONS, *this->actionArray, error) ||
+		!bundleReader.ViewArray(Bundle::SectionTag::LALR_GOTOS, *this->gotoTable, error))
+	{
+		return false;
+	}
+
+	if (this->stateCount <= 0 ||
+		this->actionOffsetArray->size() != size_t(this->stateCount) * this->columnCount + 1 ||
+		this->actionOffsetArray->back() != (int)this->actionArray->size() ||
+		this->gotoTable->size() != size_t(this->stateCount) * compiledGrammar->GetRuleCount())
+	{
+		error = "Bundle has LALR(1) tables of the wrong size.";
+		return false;
+	}
+
+	// Every action and goto has to land on a state or sequence that exists, and the runs of actions can't overlap.
+	for (size_t i = 0; i < this->actionOffsetArray->size(); i++)
+	{
+		if ((*this->actionOffsetArray)[i] < ((i > 0) ? (*this->actionOffsetArray)[i - 1] : 0))
+		{
+			error = "Bundle has LALR(1) tables that don't fit the grammar.";
+			return false;
+		}
+	}
+
+	for (const Action& action : *this->actionArray)
+	{
+		if ((action.type == Action::Type::SHIFT && (action.value < 0 || action.value >= this->stateCount)) ||
+			(action.type == Action::Type::REDUCE && (action.value < 0 || action.value >= compiledGrammar->GetSequenceCount())) ||
+			uint8_t(action.type) > uint8_t(Action::Type::ACCEPT))
+		{
+			error = "Bundle has LALR(1) tables that don't fit the grammar.";
+			return false;
+		}
+	}
+
+	for (int state : *this->gotoTable)
+	{
+		if (state < -1 || state >= this->stateCount)
+		{
+			error = "Bundle has LALR(1) tables that don't fit the grammar.";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool LALRParseTable::GetItemSymbol(int itemID, CompiledGrammar::Symbol& symbol) const
+{
+	int sequenceID = (*this->itemSequenceArray)[itemID];
+	int dot = itemID - (*this->itemBaseArray)[sequenceID];
+
+	if (sequenceID == this->compiledGrammar->GetSequenceCount())
+	{
+		symbol = CompiledGrammar::Symbol{ CompiledGrammar::Symbol::Type::NON_TERMINAL, this->compiledGrammar->GetInitialRuleID() };
+		return dot == 0;
+	}
+
+	const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+	if (dot >= sequence.symbolCount)
+		return false;
+
+	symbol = this->compiledGrammar->GetSymbols(sequence)[dot];
+	return true;
+}
+
+void LALRParseTable::CloseItemSet(ItemSet& itemSet, std::vector<int>& itemSlotArray) const
+{
+	for (int i = 0; i < (int)itemSet.itemArray.size(); i++)
+		itemSlotArray[itemSet.itemArray[i]] = i;
+
+	for (int i = 0; i < (int)itemSet.itemArray.size(); i++)
+	{
+		CompiledGrammar::Symbol symbol;
+		if (!this->GetItemSymbol(itemSet.itemArray[i], symbol) || symbol.type != CompiledGrammar::Symbol::Type::NON_TERMINAL)
+			continue;
+
+		const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(symbol.id);
+		for (int j = 0; j < rule.sequenceCount; j++)
+		{
+			int itemID = (*this->itemBaseArray)[rule.firstSequence + j];
+			if (itemSlotArray[itemID] < 0)
+			{
+				itemSlotArray[itemID] = (int)itemSet.itemArray.size();
+				itemSet.itemArray.push_back(itemID);
+			}
+		}
+	}
+
+	for (int itemID : itemSet.itemArray)
+		itemSlotArray[itemID] = -1;
+}
+
+void LALRParseTable::ReportConflict(int state, int terminalID, const std::vector<Action>& cellActionArray)
+{
+	const char* terminalText = (terminalID == this->compiledGrammar->GetEndOfInputTerminal()) ? "@end" : this->compiledGrammar->GetTerminalText(terminalID);
+	const char* conflictType = (cellActionArray[0].type == Action::Type::SHIFT) ? "shift-reduce" : "reduce-reduce";
+
+	*this->conflictText += FormatString("\nState %d has a %s conflict on \"%s\" between:", state, conflictType, terminalText);
+
+	for (const Action& action : cellActionArray)
+	{
+		if (action.type == Action::Type::SHIFT)
+			*this->conflictText += " shift;";
+		else if (action.type == Action::Type::REDUCE)
+			*this->conflictText += " reduce by " + this->DescribeSequence(action.value) + ";";
+		else
+			*this->conflictText += " accept;";
+	}
+
+	this->conflictText->pop_back();
+	*this->conflictText += ".";
+}
+
+void LALRParseTable::ReportOverlap(int state, int terminalA, int terminalB, const std::vector<std::vector<Action>>& cellArray)
+{
+	const std::vector<Action>& cellActionArrayA = cellArray[state * this->columnCount + terminalA];
+	const std::vector<Action>& cellActionArrayB = cellArray[state * this->columnCount + terminalB];
+
+	if (!std::equal(cellActionArrayA.begin(), cellActionArrayA.end(), cellActionArrayB.begin(), cellActionArrayB.end(),
+		[](const Action& actionA, const Action& actionB) { return actionA.type == actionB.type && actionA.value == actionB.value; }))
+	{
+		*this->conflictText += FormatString("\nState %d has different actions for overlapping terminals \"%s\" and \"%s\".", state, this->compiledGrammar->GetTerminalText(terminalA), this->compiledGrammar->GetTerminalText(terminalB));
+	}
+}
+
+std::string LALRParseTable::DescribeSequence(int sequenceID) const
+{
+	const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(sequence.ruleID);
+	return FormatString("rule \"%s\" alternative %d", this->compiledGrammar->GetRuleName(sequence.ruleID), sequenceID - rule.firstSequence + 1);
+}
+
+const LALRParseTable::Action* LALRParseTable::FindActions(int state, const Lexer::Token* token, int tokenLiteral, int& actionCount) const
+{
+	if (!token)
+		return this->GetActions(state, this->columnCount - 1, actionCount);
+
+	auto hasActions = [this, state](int terminalID)
+	{
+		int count = 0;
+		this->GetActions(state, terminalID, count);
+		return count > 0;
+	};
+
+	int terminalID = this->compiledGrammar->FindPrecedentTerminal(token->type, tokenLiteral, hasActions);
+	if (terminalID < 0)
+	{
+		actionCount = 0;
+		return nullptr;
+	}
+
+	return this->GetActions(state, terminalID, actionCount);
+}
+
+const LALRParseTable::Action* LALRParseTable::FindAllActions(int state, const Lexer::Token* token, int tokenLiteral, int& actionCount, std::vector<Action>& actionBuffer) const
+{
+	if (!token)
+		return this->GetActions(state, this->columnCount - 1, actionCount);
+
+	const Action* foundArray = nullptr;
+	int foundCount = 0;
+	bool merged = false;
+
+	const std::vector<int>& terminalIDArray = this->compiledGrammar->GetTokenTypeTerminals(token->type);
+	for (int i = (tokenLiteral >= 0) ? -1 : 0; i < (int)terminalIDArray.size(); i++)
+	{
+		int terminalID = (i < 0) ? tokenLiteral : terminalIDArray[i];
+		int count = 0;
+		const Action* actionArray = this->GetActions(state, terminalID, count);
+		if (count == 0)
+			continue;
+
+		if (!foundArray)
+		{
+			foundArray = actionArray;
+			foundCount = count;
+			continue;
+		}
+
+		if (!merged)
+		{
+			actionBuffer.assign(foundArray, foundArray + foundCount);
+			merged = true;
+		}
+
+		for (int j = 0; j < count; j++)
+		{
+			const Action& action = actionArray[j];
+			if (std::find_if(actionBuffer.begin(), actionBuffer.end(), [&action](const Action& existingAction) { return existingAction.type == action.type && existingAction.value == action.value; }) == actionBuffer.end())
+				actionBuffer.push_back(action);
+		}
+	}
+
+	if (merged)
+	{
+		actionCount = (int)actionBuffer.size();
+		return actionBuffer.data();
+	}
+
+	actionCount = foundCount;
+	return foundArray;
+}
+
+//------------------------------- LALRParseAlgorithm -------------------------------
+
+LALRParseAlgorithm::LALRParseAlgorithm(const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray, const Grammar* grammar) : Algorithm(tokenArray, grammar)
+{
+	this->parseStack = new std::vector<StackEntry>();
+}
+
+/*virtual*/ LALRParseAlgorithm::~LALRParseAlgorithm()
+{
+	this->ClearStack();
+
+	delete this->parseStack;
+}
+
+void LALRParseAlgorithm::ClearStack()
+{
+	for (StackEntry& entry : *this->parseStack)
+		delete entry.node;
+
+	this->parseStack->clear();
+}
+
+/*virtual*/ Parser::SyntaxNode* LALRParseAlgorithm::Parse()
+{
+	const LALRParseTable* parseTable = this->compiledGrammar->GetLALRParseTable(*this->error);
+	if (!parseTable)
+		return nullptr;
+
+	int tokenCount = (int)this->tokenArray->size();
+	if (tokenCount == 0)
+		return nullptr;
+
+	int parsePosition = 0;
+
+	this->ClearStack();
+	this->parseStack->push_back(StackEntry{ 0, nullptr, 0 });
+
+	while (true)
+	{
+		const Lexer::Token* token = (parsePosition < tokenCount) ? (*this->tokenArray)[parsePosition].get() : nullptr;
+		int tokenLiteral = token ? (*this->tokenLiteralArray)[parsePosition] : -1;
+
+		int actionCount = 0;
+		const LALRParseTable::Action* action = parseTable->FindActions(this->parseStack->back().state, token, tokenLiteral, actionCount);
+		if (actionCount == 0)
+		{
+			const Lexer::FileLocation& fileLocation = (token ? token : (*this->tokenArray)[tokenCount - 1].get())->fileLocation;
+			*this->error = FormatString("Failed to parse at line %d, column %d: unexpected %s.", fileLocation.line, fileLocation.column, token ? "token" : "end of input");
+			this->ClearStack();
+			return nullptr;
+		}
+
+		switch (action->type)
+		{
+			case LALRParseTable::Action::Type::SHIFT:
+			{
+				Parser::SyntaxNode* node = new Parser::SyntaxNode(*token->text, token->fileLocation);
+				this->parseStack->push_back(StackEntry{ action->value, node, parsePosition });
+				parsePosition++;
+				break;
+			}
+			case LALRParseTable::Action::Type::REDUCE:
+			{
+				const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(action->value);
+				int stackBase = (int)this->parseStack->size() - sequence.symbolCount;
+				int state = (stackBase > 0) ? parseTable->GetGoto((*this->parseStack)[stackBase - 1].state, sequence.ruleID) : -1;
+				if (state < 0)
+				{
+					// A table we built ourselves never gets here, but one read from a damaged bundle might.
+					*this->error = "The LALR(1) table doesn't fit the grammar.";
+					this->ClearStack();
+					return nullptr;
+				}
+
+				// An empty reduction begins where we are now.  Either way, the node gets the location of the token it begins at.
+				int startPosition = (sequence.symbolCount > 0) ? (*this->parseStack)[stackBase].parsePosition : parsePosition;
+				const Lexer::FileLocation& fileLocation = (*this->tokenArray)[std::min(startPosition, tokenCount - 1)]->fileLocation;
+
+				// Reducing by "R -> X R" for a repetition R, we already have a node for the R on the end with the items after this one,
+				// so this item just goes in front of those, rather than in a node of its own.
+				const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(sequence.ruleID);
+				Parser::SyntaxNode* parentNode = nullptr;
+				int stackTop = (int)this->parseStack->size();
+				if (rule.repeats && sequence.symbolCount > 0)
+				{
+					parentNode = (*this->parseStack)[--stackTop].node;
+					parentNode->fileLocation = fileLocation;
+				}
+				else
+					parentNode = new Parser::SyntaxNode(this->compiledGrammar->GetRuleName(sequence.ruleID), fileLocation);
+
+				std::list<Parser::SyntaxNode*>::iterator insertIter = parentNode->childList->begin();
+				for (int i = stackBase; i < stackTop; i++)
+				{
+					Parser::SyntaxNode* childNode = (*this->parseStack)[i].node;
+					parentNode->childList->insert(insertIter, childNode);
+					childNode->parentNode = parentNode;
+				}
+
+				this->parseStack->resize(stackBase);
+				this->parseStack->push_back(StackEntry{ state, parentNode, startPosition });
+				break;
+			}
+			case LALRParseTable::Action::Type::ACCEPT:
+			{
+				Parser::SyntaxNode* rootNode = this->parseStack->back().node;
+				this->parseStack->back().node = nullptr;
+				this->ClearStack();
+				return rootNode;
+			}
+		}
+	}
+
+	return nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Parser.h"
+
+namespace ParseParty
+{
+	// These are the action and goto tables of the LALR(1) automaton of a grammar.  The automaton is
+	// the usual LR(0) collection of item sets, with lookaheads then propagated through it until they
+	// settle.  Every action is kept, even when a cell ends up with more than one of them, and the
+	// conflicts are described in text so that the user can go figure out what's wrong with their grammar.
+	class PARSE_PARTY_API LALRParseTable
+	{
+	public:
+		LALRParseTable();
+		virtual ~LALRParseTable();
+
+		struct Action
+		{
+			enum class Type : uint8_t
+			{
+				SHIFT,
+				REDUCE,
+				ACCEPT
+			};
+
+			Type type;
+			int value;		// The state to shift to, or the sequence to reduce by.
+		};
+
+		bool Build(const CompiledGrammar* compiledGrammar, std::string& error);
+
+		void WriteBundle(Bundle::Writer& bundleWriter) const;
+		bool ReadBundle(const CompiledGrammar* compiledGrammar, const Bundle::Reader& bundleReader, std::string& error);
+
+		int GetStateCount() const { return this->stateCount; }
+		bool HasConflicts() const { return this->conflictText->length() > 0; }
+		const std::string& GetConflictText() const { return *this->conflictText; }
+
+		const Action* GetActions(int state, int terminalID, int& actionCount) const
+		{
+			int i = state * this->columnCount + terminalID;
+			int j = (*this->actionOffsetArray)[i];
+			actionCount = (*this->actionOffsetArray)[i + 1] - j;
+			return this->actionArray->data() + j;
+		}
+
+		// A token can match a literal and some non-literal terminals at once (e.g., "foo" and "@identifier").  If the literal
+		// has any actions, those are the token's; otherwise it's those of the other terminals, which the table only gets built
+		// if they all agree on.  Pass null for the end of input.
+		const Action* FindActions(int state, const Lexer::Token* token, int tokenLiteral, int& actionCount) const;
+
+		// The GLR algorithm tries everything, so for it, the token's actions are those of all the terminals it matches.
+		// Usually just one of them has any, and we hand those out as they are, but otherwise they get merged into the given buffer.
+		const Action* FindAllActions(int state, const Lexer::Token* token, int tokenLiteral, int& actionCount, std::vector<Action>& actionBuffer) const;
+
+		int GetGoto(int state, int ruleID) const
+		{
+			return (*this->gotoTable)[state * this->compiledGrammar->GetRuleCount() + ruleID];
+		}
+
+	private:
+
+		struct ItemSet
+		{
+			std::vector<int> itemArray;		// Kernel items first, then the rest of the closure.
+			int kernelCount;
+			std::vector<int> successorArray;		// For each item, the state we go to on the symbol after the dot, if any.
+			std::vector<int> successorSlotArray;		// For each item, where the item with the dot advanced lives in the successor state.
+			std::vector<uint64_t> lookaheadArray;
+		};
+
+		bool GetItemSymbol(int itemID, CompiledGrammar::Symbol& symbol) const;
+		void CloseItemSet(ItemSet& itemSet, std::vector<int>& itemSlotArray) const;
+		void ReportConflict(int state, int terminalID, const std::vector<Action>& cellActionArray);
+		void ReportOverlap(int state, int terminalA, int terminalB, const std::vector<std::vector<Action>>& cellArray);
+		std::string DescribeSequence(int sequenceID) const;
+
+		const CompiledGrammar* compiledGrammar;
+		int stateCount;
+		int columnCount;
+		std::vector<int>* itemBaseArray;		// Index this by sequence ID to get the ID of the item with the dot at the start of the sequence.
+		std::vector<int>* itemSequenceArray;		// Index this by item ID to get the sequence ID of the item.
+		FlatArray<int>* actionOffsetArray;
+		FlatArray<Action>* actionArray;
+		FlatArray<int>* gotoTable;
+		std::string* conflictText;
+	};
+
+	// This is a shift-reduce parser driven by the LALR(1) tables of the grammar.  Unlike our top-down
+	// algorithms, it has no trouble at all with left-recursive rules, never backtracks, and runs in time
+	// linear in the number of tokens.  It only works for grammars without any conflicts in their tables,
+	// which, like with the LL(1) algorithm, is something we find out when the grammar is loaded.
+	class LALRParseAlgorithm : public Parser::Algorithm
+	{
+	public:
+		LALRParseAlgorithm(const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray, const Grammar* grammar);
+		virtual ~LALRParseAlgorithm();
+
+		virtual Parser::SyntaxNode* Parse() override;
+
+	private:
+
+		struct StackEntry
+		{
+			int state;
+			Parser::SyntaxNode* node;
+			int parsePosition;		// This is where the node begins in the token stream.
+		};
+
+		void ClearStack();
+
+		std::vector<StackEntry>* parseStack;
+	};
+}
\ No newline at end of file
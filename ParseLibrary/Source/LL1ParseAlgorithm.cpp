@@ -0,0 +1,246 @@
+#include "LL1ParseAlgorithm.h"
+
+using namespace ParseParty;
+
+//------------------------------- LL1ParseTable -------------------------------
+
+LL1ParseTable::LL1ParseTable()
+{
+	this->compiledGrammar = nullptr;
+	this->sequenceTable = new FlatArray<int>();
+	this->columnCount = 0;
+}
+
+/*virtual*/ LL1ParseTable::~LL1ParseTable()
+{
+	delete this->sequenceTable;
+}
+
+bool LL1ParseTable::Build(const CompiledGrammar* compiledGrammar, std::string& error)
+{
+	this->compiledGrammar = compiledGrammar;
+	this->columnCount = compiledGrammar->GetTerminalCount() + 1;
+	this->sequenceTable->assign(compiledGrammar->GetRuleCount() * this->columnCount, -1);
+
+	std::vector<std::string> conflictArray;
+
+	for (int ruleID = 0; ruleID < compiledGrammar->GetRuleCount(); ruleID++)
+	{
+		const CompiledGrammar::Rule& rule = compiledGrammar->GetRule(ruleID);
+
+		for (int i = 0; i < rule.sequenceCount; i++)
+		{
+			int sequenceID = rule.firstSequence + i;
+			const CompiledGrammar::Sequence& sequence = compiledGrammar->GetSequence(sequenceID);
+
+			// An alternative is predicted by its FIRST set, and if it can derive nothing, by the FOLLOW set of its rule too.
+			for (int terminalID = 0; terminalID < this->columnCount; terminalID++)
+			{
+				bool predicted = CompiledGrammar::SetContains(compiledGrammar->GetSequenceFirstSet(sequenceID), terminalID);
+				if (!predicted && sequence.nullable)
+					predicted = CompiledGrammar::SetContains(compiledGrammar->GetFollowSet(ruleID), terminalID);
+
+				if (!predicted)
+					continue;
+
+				int& entry = (*this->sequenceTable)[ruleID * this->columnCount + terminalID];
+				if (entry >= 0)
+				{
+					const char* terminalText = (terminalID == compiledGrammar->GetEndOfInputTerminal()) ? "@end" : compiledGrammar->GetTerminalText(terminalID);
+					conflictArray.push_back(FormatString("Rule \"%s\" has alternatives %d and %d both predicted by \"%s\".", compiledGrammar->GetRuleName(ruleID), entry - rule.firstSequence + 1, i + 1, terminalText));
+				}
+				else
+					entry = sequenceID;
+			}
+		}
+
+		// Terminals like "@number" and "@int" overlap, so a token matching both can't predict two different alternatives.
+		for (int tokenType = 0; tokenType <= (int)Lexer::Token::Type::CLOSE_CURLY_BRACE; tokenType++)
+		{
+			int sequenceID = -1;
+			int terminalA = -1;
+
+			for (int terminalID = 0; terminalID < compiledGrammar->GetTerminalCount(); terminalID++)
+			{
+				if (compiledGrammar->GetTerminal(terminalID).matchClass == CompiledGrammar::Terminal::Class::LITERAL)
+					continue;
+
+				if (!compiledGrammar->TerminalMatches(terminalID, (Lexer::Token::Type)tokenType, -1))
+					continue;
+
+				int entry = this->GetSequence(ruleID, terminalID);
+				if (entry < 0)
+					continue;
+
+				if (sequenceID < 0)
+				{
+					sequenceID = entry;
+					terminalA = terminalID;
+				}
+				else if (sequenceID != entry)
+				{
+					conflictArray.push_back(FormatString("Rule \"%s\" has alternatives %d and %d predicted by overlapping terminals \"%s\" and \"%s\".", compiledGrammar->GetRuleName(ruleID), sequenceID - rule.firstSequence + 1, entry - rule.firstSequence + 1, compiledGrammar->GetTerminalText(terminalA), compiledGrammar->GetTerminalText(terminalID)));
+					break;
+				}
+			}
+		}
+	}
+
+	if (conflictArray.size() > 0)
+	{
+		// The same overlap gets found once per token type, so weed out repeats.
+		std::set<std::string> conflictSet;
+		error = "Grammar is not LL(1).";
+		for (const std::string& conflict : conflictArray)
+		{
+			if (conflictSet.find(conflict) == conflictSet.end())
+			{
+				conflictSet.insert(conflict);
+				error += "\n" + conflict;
+			}
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+void LL1ParseTable::WriteBundle(Bundle::Writer& bundleWriter) const
+{
+	bundleWriter.AddArray(Bundle::SectionTag::LL1_SEQUENCE_TABLE, *this->sequenceTable);
+}
+
+bool LL1ParseTable::ReadBundle(const CompiledGrammar* compiledGrammar, const Bundle::Reader& bundleReader, std::string& error)
+{
+	this->compiledGrammar = compiledGrammar;
+	this->columnCount = compiledGrammar->GetTerminalCount() + 1;
+
+	if (!bundleReader.ViewArray(Bundle::SectionTag::LL1_SEQUENCE_TABLE, *this->sequenceTable, error))
+		return false;
+
+	if (this->sequenceTable->size() != size_t(compiledGrammar->GetRuleCount()) * this->columnCount)
+	{
+		error = "Bundle has an LL(1) table of the wrong size.";
+		return false;
+	}
+
+	// Each rule can only predict one of its own alternatives.
+	for (int ruleID = 0; ruleID < compiledGrammar->GetRuleCount(); ruleID++)
+	{
+		const CompiledGrammar::Rule& rule = compiledGrammar->GetRule(ruleID);
+		for (int terminalID = 0; terminalID < this->columnCount; terminalID++)
+		{
+			int sequenceID = this->GetSequence(ruleID, terminalID);
+			if (sequenceID != -1 && (sequenceID < rule.firstSequence || sequenceID >= rule.firstSequence + rule.sequenceCount))
+			{
+				error = "Bundle has an LL(1) table that doesn't fit the grammar.";
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+int LL1ParseTable::Predict(int ruleID, Lexer::Token::Type tokenType, int tokenLiteral) const
+{
+	int terminalID = this->compiledGrammar->FindPrecedentTerminal(tokenType, tokenLiteral, [this, ruleID](int terminalID) { return this->GetSequence(ruleID, terminalID) >= 0; });
+	return (terminalID >= 0) ? this->GetSequence(ruleID, terminalID) : -1;
+}
+
+//------------------------------- LL1ParseAlgorithm -------------------------------
+
+LL1ParseAlgorithm::LL1ParseAlgorithm(const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray, const Grammar* grammar) : Algorithm(tokenArray, grammar)
+{
+	this->parseStack = new std::vector<StackEntry>();
+}
+
+/*virtual*/ LL1ParseAlgorithm::~LL1ParseAlgorithm()
+{
+	delete this->parseStack;
+}
+
+/*virtual*/ Parser::SyntaxNode* LL1ParseAlgorithm::Parse()
+{
+	const LL1ParseTable* parseTable = this->compiledGrammar->GetLL1ParseTable(*this->error);
+	if (!parseTable)
+		return nullptr;
+
+	int ruleID = this->compiledGrammar->GetInitialRuleID();
+	if (ruleID < 0 || this->tokenArray->size() == 0)
+		return nullptr;
+
+	int tokenCount = (int)this->tokenArray->size();
+	int endOfInput = this->compiledGrammar->GetEndOfInputTerminal();
+	int parsePosition = 0;
+	Parser::SyntaxNode* rootNode = nullptr;
+
+	this->parseStack->clear();
+	this->parseStack->push_back(StackEntry{ CompiledGrammar::Symbol{ CompiledGrammar::Symbol::Type::NON_TERMINAL, ruleID }, nullptr });
+
+	while (this->parseStack->size() > 0)
+	{
+		StackEntry entry = this->parseStack->back();
+		this->parseStack->pop_back();
+
+		const Lexer::Token* token = (parsePosition < tokenCount) ? (*this->tokenArray)[parsePosition].get() : nullptr;
+		const Lexer::FileLocation& fileLocation = (token ? token : (*this->tokenArray)[tokenCount - 1].get())->fileLocation;
+
+		if (entry.symbol.type == CompiledGrammar::Symbol::Type::TERMINAL)
+		{
+			if (!token || !this->TokenMatches(parsePosition, entry.symbol.id))
+			{
+				*this->error = FormatString("Failed to parse at line %d, column %d: expected \"%s\".", fileLocation.line, fileLocation.column, this->compiledGrammar->GetTerminalText(entry.symbol.id));
+				delete rootNode;
+				return nullptr;
+			}
+
+			Parser::SyntaxNode* childNode = new Parser::SyntaxNode(*token->text, token->fileLocation);
+			entry.parentNode->childList->push_back(childNode);
+			childNode->parentNode = entry.parentNode;
+			parsePosition++;
+			continue;
+		}
+
+		int sequenceID = token ? parseTable->Predict(entry.symbol.id, token->type, (*this->tokenLiteralArray)[parsePosition]) : parseTable->GetSequence(entry.symbol.id, endOfInput);
+		if (sequenceID < 0)
+		{
+			*this->error = FormatString("Failed to parse at line %d, column %d: unexpected %s while parsing \"%s\".", fileLocation.line, fileLocation.column, token ? "token" : "end of input", this->compiledGrammar->GetRuleName(entry.symbol.id));
+			delete rootNode;
+			return nullptr;
+		}
+
+		// The rest of a repetition goes into the node we already have for it, so that its items come out side by side.
+		Parser::SyntaxNode* parentNode = nullptr;
+		if (this->compiledGrammar->GetRule(entry.symbol.id).repeats && entry.parentNode && *entry.parentNode->text == this->compiledGrammar->GetRuleName(entry.symbol.id))
+			parentNode = entry.parentNode;
+		else
+		{
+			parentNode = new Parser::SyntaxNode(this->compiledGrammar->GetRuleName(entry.symbol.id), fileLocation);
+			if (!entry.parentNode)
+				rootNode = parentNode;
+			else
+			{
+				entry.parentNode->childList->push_back(parentNode);
+				parentNode->parentNode = entry.parentNode;
+			}
+		}
+
+		// Push the symbols in reverse so that they come off the stack (and get added to the tree) left to right.
+		const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+		const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+		for (int i = sequence.symbolCount - 1; i >= 0; i--)
+			this->parseStack->push_back(StackEntry{ symbolArray[i], parentNode });
+	}
+
+	if (parsePosition < tokenCount)
+	{
+		const Lexer::FileLocation& fileLocation = (*this->tokenArray)[parsePosition]->fileLocation;
+		*this->error = FormatString("Failed to parse at line %d, column %d: expected end of input.", fileLocation.line, fileLocation.column);
+		delete rootNode;
+		return nullptr;
+	}
+
+	return rootNode;
+}
\ No newline at end of file
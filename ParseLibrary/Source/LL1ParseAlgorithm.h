@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Parser.h"
+
+namespace ParseParty
+{
+	// For each rule and each terminal (plus the end of input), this tells us which alternative
+	// of the rule must be taken if that terminal is the next one in the token stream.
+	class PARSE_PARTY_API LL1ParseTable
+	{
+	public:
+		LL1ParseTable();
+		virtual ~LL1ParseTable();
+
+		// Fail if the grammar isn't LL(1), in which case the error lists every conflict found.
+		bool Build(const CompiledGrammar* compiledGrammar, std::string& error);
+
+		void WriteBundle(Bundle::Writer& bundleWriter) const;
+		bool ReadBundle(const CompiledGrammar* compiledGrammar, const Bundle::Reader& bundleReader, std::string& error);
+
+		int GetSequence(int ruleID, int terminalID) const
+		{
+			return (*this->sequenceTable)[ruleID * this->columnCount + terminalID];
+		}
+
+		// A token may match more than one terminal (e.g., "foo" and "@identifier").  If its literal predicts an alternative,
+		// that's the one; otherwise the non-literal terminals all predict the same one, or the table wouldn't have been built.
+		int Predict(int ruleID, Lexer::Token::Type tokenType, int tokenLiteral) const;
+
+		const CompiledGrammar* compiledGrammar;
+		FlatArray<int>* sequenceTable;
+		int columnCount;
+	};
+
+	// This is a predictive parser that uses the LL(1) table of the grammar to choose, without any
+	// backtracking, which alternative to take for every non-terminal it encounters.  There is no
+	// recursion and no memoization here; just an explicit stack, so parsing takes time linear in the
+	// number of tokens.  Of course, this only works for grammars that are LL(1), which is something
+	// we find out (along with the reasons why not) when the grammar is loaded.
+	class LL1ParseAlgorithm : public Parser::Algorithm
+	{
+	public:
+		LL1ParseAlgorithm(const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray, const Grammar* grammar);
+		virtual ~LL1ParseAlgorithm();
+
+		virtual Parser::SyntaxNode* Parse() override;
+
+	private:
+
+		struct StackEntry
+		{
+			CompiledGrammar::Symbol symbol;
+			Parser::SyntaxNode* parentNode;
+		};
+
+		std::vector<StackEntry>* parseStack;
+	};
+}
\ No newline at end of file
@@ -21,6 +21,9 @@ Lexer::Lexer()
 {
 	this->tokenGeneratorList = new std::list<TokenGenerator*>();
 	this->tabSize = 4;
+	this->statistics = new Statistics();
+	this->statisticsGeneratorArray = new std::vector<const TokenGenerator*>();
+	this->ResetStatistics();
 }
 
 /*virtual*/ Lexer::~Lexer()
@@ -28,6 +31,8 @@ Lexer::Lexer()
 	this->Clear();
 
 	delete this->tokenGeneratorList;
+	delete this->statistics;
+	delete this->statisticsGeneratorArray;
 }
 
 void Lexer::Clear()
@@ -40,6 +45,15 @@ void Lexer::Clear()
 
 bool Lexer::ReadFile(const std::string& lexiconFile, std::string& error)
 {
+	if (Bundle::IsBundleFile(lexiconFile))
+	{
+		Bundle::Reader bundleReader;
+		if (!bundleReader.ReadFile(lexiconFile, error))
+			return false;
+
+		return this->ReadBundle(bundleReader, error);
+	}
+
 	std::ifstream fileStream;
 	fileStream.open(lexiconFile.c_str(), std::ios::in);
 	if (!fileStream.is_open())
@@ -98,23 +112,7 @@ bool Lexer::ReadFile(const std::string& lexiconFile, std::string& error)
 			return false;
 		}
 
-		TokenGenerator* tokenGenerator = nullptr;
-
-		if (jsonGeneratorName->GetValue() == "ParanTokenGenerator")
-			tokenGenerator = new ParanTokenGenerator();
-		else if (jsonGeneratorName->GetValue() == "DelimeterTokenGenerator")
-			tokenGenerator = new DelimeterTokenGenerator();
-		else if (jsonGeneratorName->GetValue() == "NumberTokenGenerator")
-			tokenGenerator = new NumberTokenGenerator();
-		else if (jsonGeneratorName->GetValue() == "StringTokenGenerator")
-			tokenGenerator = new StringTokenGenerator();
-		else if (jsonGeneratorName->GetValue() == "OperatorTokenGenerator")
-			tokenGenerator = new OperatorTokenGenerator();
-		else if (jsonGeneratorName->GetValue() == "IdentifierTokenGenerator")
-			tokenGenerator = new IdentifierTokenGenerator();
-		else if (jsonGeneratorName->GetValue() == "CommentTokenGenerator")
-			tokenGenerator = new CommentTokenGenerator();
-
+		TokenGenerator* tokenGenerator = CreateTokenGenerator(jsonGeneratorName->GetValue());
 		if (!tokenGenerator)
 		{
 			error = "Unrecognized token generator: " + jsonGeneratorName->GetValue();
@@ -138,7 +136,88 @@ bool Lexer::ReadFile(const std::string& lexiconFile, std::string& error)
 
 bool Lexer::WriteFile(const std::string& lexiconFile) const
 {
-	return false;
+	Bundle::Writer bundleWriter;
+	this->WriteBundle(bundleWriter);
+
+	std::string error;
+	return bundleWriter.WriteFile(lexiconFile, error);
+}
+
+void Lexer::WriteBundle(Bundle::Writer& bundleWriter) const
+{
+	std::string lexicon;
+	Bundle::PackInt(lexicon, this->tabSize);
+	Bundle::PackInt(lexicon, (int)this->tokenGeneratorList->size());
+	for (const TokenGenerator* tokenGenerator : *this->tokenGeneratorList)
+	{
+		Bundle::PackString(lexicon, tokenGenerator->GetName());
+		tokenGenerator->WriteBundleConfig(lexicon);
+	}
+
+	bundleWriter.AddSection(Bundle::SectionTag::LEXICON, lexicon.data(), lexicon.size());
+}
+
+bool Lexer::ReadBundle(const Bundle::Reader& bundleReader, std::string& error)
+{
+	size_t lexiconSize = 0;
+	const char* lexicon = bundleReader.GetSection(Bundle::SectionTag::LEXICON, lexiconSize);
+	const char* lexiconEnd = lexicon + lexiconSize;
+	int tabSize = 0, generatorCount = 0;
+	if (!lexicon || !Bundle::UnpackInt(lexicon, lexiconEnd, tabSize) || !Bundle::UnpackInt(lexicon, lexiconEnd, generatorCount))
+	{
+		error = "Bundle has no lexicon in it.";
+		return false;
+	}
+
+	this->Clear();
+	this->tabSize = tabSize;
+
+	for (int i = 0; i < generatorCount; i++)
+	{
+		std::string generatorName;
+		if (!Bundle::UnpackString(lexicon, lexiconEnd, generatorName))
+		{
+			error = "Bundle has a malformed lexicon in it.";
+			return false;
+		}
+
+		TokenGenerator* tokenGenerator = CreateTokenGenerator(generatorName);
+		if (!tokenGenerator)
+		{
+			error = "Unrecognized token generator: " + generatorName;
+			return false;
+		}
+
+		if (!tokenGenerator->ReadBundleConfig(lexicon, lexiconEnd, error))
+		{
+			delete tokenGenerator;
+			return false;
+		}
+
+		this->tokenGeneratorList->push_back(tokenGenerator);
+	}
+
+	return true;
+}
+
+/*static*/ Lexer::TokenGenerator* Lexer::CreateTokenGenerator(const std::string& generatorName)
+{
+	if (generatorName == "ParanTokenGenerator")
+		return new ParanTokenGenerator();
+	else if (generatorName == "DelimeterTokenGenerator")
+		return new DelimeterTokenGenerator();
+	else if (generatorName == "NumberTokenGenerator")
+		return new NumberTokenGenerator();
+	else if (generatorName == "StringTokenGenerator")
+		return new StringTokenGenerator();
+	else if (generatorName == "OperatorTokenGenerator")
+		return new OperatorTokenGenerator();
+	else if (generatorName == "IdentifierTokenGenerator")
+		return new IdentifierTokenGenerator();
+	else if (generatorName == "CommentTokenGenerator")
+		return new CommentTokenGenerator();
+
+	return nullptr;
 }
 
 bool Lexer::Tokenize(const std::string& codeText, std::vector<std::shared_ptr<Token>>& tokenArray, std::string& error, bool keepComments /*= false*/, FileLocation initialFileLocation /*= FileLocation{ 1, 1 }*/)
@@ -149,15 +228,30 @@ bool Lexer::Tokenize(const std::string& codeText, std::vector<std::shared_ptr<To
 	const char* codeBuffer = codeText.c_str();
 	FileLocation fileLocation = initialFileLocation;
 
+	PARSE_PARTY_LEXER_STATS(typedef std::chrono::steady_clock Clock);
+	PARSE_PARTY_LEXER_STATS(Clock::time_point tokenizeStartTime = Clock::now());
+	PARSE_PARTY_LEXER_STATS(this->statistics->tokenizeCount++);
+
+	// The generator list can be modified directly by the user, so make sure our stats line up with it.
+	PARSE_PARTY_LEXER_STATS(this->SyncGeneratorStatistics());
+	PARSE_PARTY_LEXER_STATS(std::vector<Statistics::GeneratorStatistics>& generatorStatisticsArray = this->statistics->generatorStatisticsArray);
+	PARSE_PARTY_LEXER_STATS(int k = 0);
+
 	int i = 0, j = 0;
 	while (i < (signed)codeText.length())
 	{
+		PARSE_PARTY_LEXER_STATS(int whitespaceStart = i);
+
 		while (i < (signed)codeText.length() && ::isspace(codeText.c_str()[i]))
 			i++;
 
+		PARSE_PARTY_LEXER_STATS(this->statistics->whitespaceBytesSkipped += i - whitespaceStart);
+
 		if (i == codeText.length())
 			break;
 
+		PARSE_PARTY_LEXER_STATS(Clock::time_point locationStartTime = Clock::now());
+
 		while (j < i)
 		{
 			if (codeBuffer[j] != '\n')
@@ -176,13 +270,27 @@ bool Lexer::Tokenize(const std::string& codeText, std::vector<std::shared_ptr<To
 			j++;
 		}
 
+		PARSE_PARTY_LEXER_STATS(this->statistics->locationTrackingTime += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - locationStartTime).count());
+
 		std::shared_ptr<Token> token;
 
+		PARSE_PARTY_LEXER_STATS(k = 0);
+
 		for (TokenGenerator* tokenGenerator : *this->tokenGeneratorList)
 		{
+			PARSE_PARTY_LEXER_STATS(Statistics::GeneratorStatistics& generatorStatistics = generatorStatisticsArray[k++]);
+			PARSE_PARTY_LEXER_STATS(Clock::time_point generatorStartTime = Clock::now());
+
 			token = tokenGenerator->GenerateToken(codeBuffer, i);
+
+			PARSE_PARTY_LEXER_STATS(generatorStatistics.time += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - generatorStartTime).count());
+			PARSE_PARTY_LEXER_STATS(generatorStatistics.attemptCount++);
+
 			if (token)
 			{
+				PARSE_PARTY_LEXER_STATS(generatorStatistics.successCount++);
+				PARSE_PARTY_LEXER_STATS(generatorStatistics.bytesConsumed += i - j);
+
 				token->fileLocation = fileLocation;
 
 				if (token->type != Token::Type::COMMENT || keepComments)
@@ -195,10 +303,76 @@ bool Lexer::Tokenize(const std::string& codeText, std::vector<std::shared_ptr<To
 		if (i == j)
 		{
 			error = FormatString("Failed to tokenize at line %d, column %d.", fileLocation.line, fileLocation.column);
+			PARSE_PARTY_LEXER_STATS(this->statistics->tokenizeTime += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - tokenizeStartTime).count());
 			return false;
 		}
 	}
 
+	PARSE_PARTY_LEXER_STATS(this->statistics->tokenizeTime += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - tokenizeStartTime).count());
+
+	return true;
+}
+
+// If the generators aren't the ones the per-generator counts were for, then those counts are started over,
+// rather than left where they are to be credited to whatever generator now has the same index.
+void Lexer::SyncGeneratorStatistics()
+{
+	std::vector<const TokenGenerator*> generatorArray(this->tokenGeneratorList->begin(), this->tokenGeneratorList->end());
+	if (generatorArray == *this->statisticsGeneratorArray && this->statistics->generatorStatisticsArray.size() == generatorArray.size())
+		return;
+
+	*this->statisticsGeneratorArray = generatorArray;
+	this->statistics->generatorStatisticsArray.clear();
+	for (const TokenGenerator* tokenGenerator : generatorArray)
+		this->statistics->generatorStatisticsArray.push_back(Statistics::GeneratorStatistics{ tokenGenerator->GetName(), 0, 0, 0, 0 });
+}
+
+void Lexer::ResetStatistics()
+{
+	this->statistics->generatorStatisticsArray.clear();
+	this->statistics->whitespaceBytesSkipped = 0;
+	this->statistics->locationTrackingTime = 0;
+	this->statistics->tokenizeTime = 0;
+	this->statistics->tokenizeCount = 0;
+}
+
+const Lexer::Statistics& Lexer::GetStatistics() const
+{
+	return *this->statistics;
+}
+
+/*static*/ bool Lexer::StatisticsEnabled()
+{
+#if defined PARSE_PARTY_LEXER_STATISTICS
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool Lexer::WriteStatistics(JsonObject* jsonStatistics) const
+{
+	if (!StatisticsEnabled())
+		return false;
+
+	std::shared_ptr<JsonArray> jsonGeneratorArray = std::make_shared<JsonArray>();
+	for (const Statistics::GeneratorStatistics& generatorStatistics : this->statistics->generatorStatisticsArray)
+	{
+		std::shared_ptr<JsonObject> jsonGenerator = std::make_shared<JsonObject>();
+		jsonGenerator->SetValue("name", std::make_shared<JsonString>(generatorStatistics.name));
+		jsonGenerator->SetValue("attempts", std::make_shared<JsonInt>((long)generatorStatistics.attemptCount));
+		jsonGenerator->SetValue("successes", std::make_shared<JsonInt>((long)generatorStatistics.successCount));
+		jsonGenerator->SetValue("bytes_consumed", std::make_shared<JsonInt>((long)generatorStatistics.bytesConsumed));
+		jsonGenerator->SetValue("time_ns", std::make_shared<JsonInt>((long)generatorStatistics.time));
+		jsonGeneratorArray->PushValue(jsonGenerator);
+	}
+
+	jsonStatistics->SetValue("token_generators", jsonGeneratorArray);
+	jsonStatistics->SetValue("whitespace_bytes_skipped", std::make_shared<JsonInt>((long)this->statistics->whitespaceBytesSkipped));
+	jsonStatistics->SetValue("location_tracking_time_ns", std::make_shared<JsonInt>((long)this->statistics->locationTrackingTime));
+	jsonStatistics->SetValue("tokenize_time_ns", std::make_shared<JsonInt>((long)this->statistics->tokenizeTime));
+	jsonStatistics->SetValue("tokenize_count", std::make_shared<JsonInt>((long)this->statistics->tokenizeCount));
+
 	return true;
 }
 
@@ -237,6 +411,20 @@ Lexer::TokenGenerator::TokenGenerator()
 {
 }
 
+/*virtual*/ std::string Lexer::TokenGenerator::GetName() const
+{
+	return "TokenGenerator";
+}
+
+/*virtual*/ void Lexer::TokenGenerator::WriteBundleConfig(std::string& buffer) const
+{
+}
+
+/*virtual*/ bool Lexer::TokenGenerator::ReadBundleConfig(const char*& data, const char* dataEnd, std::string& error)
+{
+	return true;
+}
+
 //-------------------------------- Lexer::ParanTokenGenerator --------------------------------
 
 Lexer::ParanTokenGenerator::ParanTokenGenerator()
@@ -298,6 +486,11 @@ Lexer::ParanTokenGenerator::ParanTokenGenerator()
 	return false;
 }
 
+/*virtual*/ std::string Lexer::ParanTokenGenerator::GetName() const
+{
+	return "ParanTokenGenerator";
+}
+
 //-------------------------------- Lexer::DelimeterTokenGenerator --------------------------------
 
 Lexer::DelimeterTokenGenerator::DelimeterTokenGenerator()
@@ -344,6 +537,11 @@ Lexer::DelimeterTokenGenerator::DelimeterTokenGenerator()
 	return false;
 }
 
+/*virtual*/ std::string Lexer::DelimeterTokenGenerator::GetName() const
+{
+	return "DelimeterTokenGenerator";
+}
+
 //-------------------------------- Lexer::StringTokenGenerator --------------------------------
 
 Lexer::StringTokenGenerator::StringTokenGenerator(bool processEscapeSequences /*= false*/)
@@ -408,6 +606,29 @@ bool Lexer::StringTokenGenerator::CollapseEscapeSequences(std::string& text)
 	return false;
 }
 
+/*virtual*/ std::string Lexer::StringTokenGenerator::GetName() const
+{
+	return "StringTokenGenerator";
+}
+
+/*virtual*/ void Lexer::StringTokenGenerator::WriteBundleConfig(std::string& buffer) const
+{
+	Bundle::PackInt(buffer, this->processEscapeSequences ? 1 : 0);
+}
+
+/*virtual*/ bool Lexer::StringTokenGenerator::ReadBundleConfig(const char*& data, const char* dataEnd, std::string& error)
+{
+	int processEscapeSequences = 0;
+	if (!Bundle::UnpackInt(data, dataEnd, processEscapeSequences))
+	{
+		error = "Bundle has a malformed string token generator config.";
+		return false;
+	}
+
+	this->processEscapeSequences = processEscapeSequences != 0;
+	return true;
+}
+
 //-------------------------------- Lexer::NumberTokenGenerator --------------------------------
 
 Lexer::NumberTokenGenerator::NumberTokenGenerator()
@@ -464,6 +685,11 @@ Lexer::NumberTokenGenerator::NumberTokenGenerator()
 	return false;
 }
 
+/*virtual*/ std::string Lexer::NumberTokenGenerator::GetName() const
+{
+	return "NumberTokenGenerator";
+}
+
 //-------------------------------- Lexer::OperatorTokenGenerator --------------------------------
 
 Lexer::OperatorTokenGenerator::OperatorTokenGenerator()
@@ -543,6 +769,46 @@ Lexer::OperatorTokenGenerator::OperatorTokenGenerator()
 	return false;
 }
 
+/*virtual*/ std::string Lexer::OperatorTokenGenerator::GetName() const
+{
+	return "OperatorTokenGenerator";
+}
+
+/*virtual*/ void Lexer::OperatorTokenGenerator::WriteBundleConfig(std::string& buffer) const
+{
+	Bundle::PackInt(buffer, (int)this->operatorSet->size());
+	for (const std::string& operatorText : *this->operatorSet)
+		Bundle::PackString(buffer, operatorText);
+}
+
+/*virtual*/ bool Lexer::OperatorTokenGenerator::ReadBundleConfig(const char*& data, const char* dataEnd, std::string& error)
+{
+	this->operatorSet->clear();
+	delete this->operatorCharSet;
+	this->operatorCharSet = nullptr;
+
+	int operatorCount = 0;
+	if (!Bundle::UnpackInt(data, dataEnd, operatorCount))
+	{
+		error = "Bundle has a malformed operator token generator config.";
+		return false;
+	}
+
+	for (int i = 0; i < operatorCount; i++)
+	{
+		std::string operatorText;
+		if (!Bundle::UnpackString(data, dataEnd, operatorText))
+		{
+			error = "Bundle has a malformed operator token generator config.";
+			return false;
+		}
+
+		this->operatorSet->insert(operatorText);
+	}
+
+	return true;
+}
+
 //-------------------------------- Lexer::IdentifierTokenGenerator --------------------------------
 
 Lexer::IdentifierTokenGenerator::IdentifierTokenGenerator()
@@ -600,6 +866,44 @@ Lexer::IdentifierTokenGenerator::IdentifierTokenGenerator()
 	return false;
 }
 
+/*virtual*/ std::string Lexer::IdentifierTokenGenerator::GetName() const
+{
+	return "IdentifierTokenGenerator";
+}
+
+/*virtual*/ void Lexer::IdentifierTokenGenerator::WriteBundleConfig(std::string& buffer) const
+{
+	Bundle::PackInt(buffer, (int)this->keywordSet->size());
+	for (const std::string& keyword : *this->keywordSet)
+		Bundle::PackString(buffer, keyword);
+}
+
+/*virtual*/ bool Lexer::IdentifierTokenGenerator::ReadBundleConfig(const char*& data, const char* dataEnd, std::string& error)
+{
+	this->keywordSet->clear();
+
+	int keywordCount = 0;
+	if (!Bundle::UnpackInt(data, dataEnd, keywordCount))
+	{
+		error = "Bundle has a malformed identifier token generator config.";
+		return false;
+	}
+
+	for (int i = 0; i < keywordCount; i++)
+	{
+		std::string keyword;
+		if (!Bundle::UnpackString(data, dataEnd, keyword))
+		{
+			error = "Bundle has a malformed identifier token generator config.";
+			return false;
+		}
+
+		this->keywordSet->insert(keyword);
+	}
+
+	return true;
+}
+
 //-------------------------------- Lexer::CommentTokenGenerator --------------------------------
 
 Lexer::CommentTokenGenerator::CommentTokenGenerator()
@@ -632,4 +936,9 @@ Lexer::CommentTokenGenerator::CommentTokenGenerator()
 /*virtual*/ bool Lexer::CommentTokenGenerator::WriteConfig(JsonObject* jsonConfig) const
 {
 	return false;
+}
+
+/*virtual*/ std::string Lexer::CommentTokenGenerator::GetName() const
+{
+	return "CommentTokenGenerator";
 }
\ No newline at end of file
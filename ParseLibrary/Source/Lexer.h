@@ -2,6 +2,16 @@
 
 #include "Common.h"
 #include "FormatString.h"
+#include "Bundle.h"
+#include <chrono>
+
+// Define this to have the lexer keep per-token-generator counts and timings.  When it's
+// not defined, none of the bookkeeping code is compiled into the tokenizer loop.
+#if defined PARSE_PARTY_LEXER_STATISTICS
+#	define PARSE_PARTY_LEXER_STATS(...)		__VA_ARGS__
+#else
+#	define PARSE_PARTY_LEXER_STATS(...)
+#endif
 
 namespace ParseParty
 {
@@ -26,11 +36,42 @@ namespace ParseParty
 		class Token;
 
 		void Clear();
+
+		// Like grammar files, a lexicon file is either JSON or a bundle, and we only write bundles.
 		bool ReadFile(const std::string& lexiconFile, std::string& error);
 		bool WriteFile(const std::string& lexiconFile) const;
 
+		void WriteBundle(Bundle::Writer& bundleWriter) const;
+		bool ReadBundle(const Bundle::Reader& bundleReader, std::string& error);
+
 		bool Tokenize(const std::string& codeText, std::vector<std::shared_ptr<Token>>& tokenArray, std::string& error, bool keepComments = false, FileLocation initialFileLocation = FileLocation{ 1, 1 });
 
+		// These are accumulated across calls to Tokenize() until reset, and only
+		// if the library was built with PARSE_PARTY_LEXER_STATISTICS defined.
+		// All times are in nanoseconds.
+		struct Statistics
+		{
+			struct GeneratorStatistics
+			{
+				std::string name;
+				uint64_t attemptCount;
+				uint64_t successCount;
+				uint64_t bytesConsumed;
+				uint64_t time;
+			};
+
+			std::vector<GeneratorStatistics> generatorStatisticsArray;
+			uint64_t whitespaceBytesSkipped;
+			uint64_t locationTrackingTime;
+			uint64_t tokenizeTime;
+			uint64_t tokenizeCount;
+		};
+
+		void ResetStatistics();
+		const Statistics& GetStatistics() const;
+		bool WriteStatistics(JsonObject* jsonStatistics) const;
+		static bool StatisticsEnabled();
+
 		class PARSE_PARTY_API Token
 		{
 		public:
@@ -75,6 +116,11 @@ namespace ParseParty
 			virtual std::shared_ptr<Token> GenerateToken(const char* codeBuffer, int& i) = 0;
 			virtual bool ReadConfig(const JsonObject* jsonConfig, std::string& error) = 0;
 			virtual bool WriteConfig(JsonObject* jsonConfig) const = 0;
+			virtual std::string GetName() const;
+
+			// Generators with any configuration pack it into, and unpack it from, a lexicon bundle with these.
+			virtual void WriteBundleConfig(std::string& buffer) const;
+			virtual bool ReadBundleConfig(const char*& data, const char* dataEnd, std::string& error);
 		};
 
 		class PARSE_PARTY_API ParanTokenGenerator : public TokenGenerator
@@ -86,6 +132,7 @@ namespace ParseParty
 			virtual std::shared_ptr<Token> GenerateToken(const char* codeBuffer, int& i) override;
 			virtual bool ReadConfig(const JsonObject* jsonConfig, std::string& error) override;
 			virtual bool WriteConfig(JsonObject* jsonConfig) const override;
+			virtual std::string GetName() const override;
 		};
 
 		class PARSE_PARTY_API DelimeterTokenGenerator : public TokenGenerator
@@ -97,6 +144,7 @@ namespace ParseParty
 			virtual std::shared_ptr<Token> GenerateToken(const char* codeBuffer, int& i) override;
 			virtual bool ReadConfig(const JsonObject* jsonConfig, std::string& error) override;
 			virtual bool WriteConfig(JsonObject* jsonConfig) const override;
+			virtual std::string GetName() const override;
 		};
 
 		class PARSE_PARTY_API StringTokenGenerator : public TokenGenerator
@@ -108,6 +156,9 @@ namespace ParseParty
 			virtual std::shared_ptr<Token> GenerateToken(const char* codeBuffer, int& i) override;
 			virtual bool ReadConfig(const JsonObject* jsonConfig, std::string& error) override;
 			virtual bool WriteConfig(JsonObject* jsonConfig) const override;
+			virtual std::string GetName() const override;
+			virtual void WriteBundleConfig(std::string& buffer) const override;
+			virtual bool ReadBundleConfig(const char*& data, const char* dataEnd, std::string& error) override;
 
 			bool CollapseEscapeSequences(std::string& text);
 
@@ -123,6 +174,7 @@ namespace ParseParty
 			virtual std::shared_ptr<Token> GenerateToken(const char* codeBuffer, int& i) override;
 			virtual bool ReadConfig(const JsonObject* jsonConfig, std::string& error) override;
 			virtual bool WriteConfig(JsonObject* jsonConfig) const override;
+			virtual std::string GetName() const override;
 		};
 
 		class PARSE_PARTY_API OperatorTokenGenerator : public TokenGenerator
@@ -134,6 +186,9 @@ namespace ParseParty
 			virtual std::shared_ptr<Token> GenerateToken(const char* codeBuffer, int& i) override;
 			virtual bool ReadConfig(const JsonObject* jsonConfig, std::string& error) override;
 			virtual bool WriteConfig(JsonObject* jsonConfig) const override;
+			virtual std::string GetName() const override;
+			virtual void WriteBundleConfig(std::string& buffer) const override;
+			virtual bool ReadBundleConfig(const char*& data, const char* dataEnd, std::string& error) override;
 
 			std::set<std::string>* operatorSet;
 			std::set<char>* operatorCharSet;
@@ -148,6 +203,9 @@ namespace ParseParty
 			virtual std::shared_ptr<Token> GenerateToken(const char* codeBuffer, int& i) override;
 			virtual bool ReadConfig(const JsonObject* jsonConfig, std::string& error) override;
 			virtual bool WriteConfig(JsonObject* jsonConfig) const override;
+			virtual std::string GetName() const override;
+			virtual void WriteBundleConfig(std::string& buffer) const override;
+			virtual bool ReadBundleConfig(const char*& data, const char* dataEnd, std::string& error) override;
 
 			std::set<std::string>* keywordSet;
 		};
@@ -161,10 +219,20 @@ namespace ParseParty
 			virtual std::shared_ptr<Token> GenerateToken(const char* codeBuffer, int& i) override;
 			virtual bool ReadConfig(const JsonObject* jsonConfig, std::string& error) override;
 			virtual bool WriteConfig(JsonObject* jsonConfig) const override;
+			virtual std::string GetName() const override;
 		};
 
+		static TokenGenerator* CreateTokenGenerator(const std::string& generatorName);
+
 		std::list<TokenGenerator*>* tokenGeneratorList;
 		int tabSize;
+
+	private:
+
+		void SyncGeneratorStatistics();
+
+		Statistics* statistics;
+		std::vector<const TokenGenerator*>* statisticsGeneratorArray;		// The generators the per-generator statistics are for, in order.
 	};
 
 	bool operator<(const Lexer::FileLocation& locationA, const Lexer::FileLocation& locationB);
@@ -15,50 +15,52 @@ LookAheadParseAlgorithm::LookAheadParseAlgorithm(const std::vector<std::shared_p
 // TODO: Test this algorithm.
 /*virtual*/ Parser::SyntaxNode* LookAheadParseAlgorithm::Parse()
 {
-	const Grammar::Rule* grammarRule = this->grammar->GetInitialRule();
-	if (!grammarRule)
+	int ruleID = this->compiledGrammar->GetInitialRuleID();
+	if (ruleID < 0)
 		return nullptr;
 
 	int parsePosition = 0;
-	return this->GenerateTree(grammarRule, parsePosition);
+	return this->GenerateTree(ruleID, parsePosition);
 }
 
-Parser::SyntaxNode* LookAheadParseAlgorithm::GenerateTree(const Grammar::Rule* grammarRule, int& parsePosition)
+Parser::SyntaxNode* LookAheadParseAlgorithm::GenerateTree(int ruleID, int& parsePosition)
 {
 	// This is the "look ahead" part of the algorithm.
-	int i = this->DetermineCorrectMatchSequence(grammarRule, parsePosition, 0);
+	int i = this->DetermineCorrectMatchSequence(ruleID, parsePosition, 0);
 	if (i < 0)
 		return nullptr;
 	
-	Grammar::MatchSequence* matchSequence = (*grammarRule->matchSequenceArray)[i];
+	const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(this->compiledGrammar->GetRule(ruleID).firstSequence + i);
+	const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
 
-	Parser::SyntaxNode* parentNode = new Parser::SyntaxNode(*grammarRule->name, (*this->tokenArray)[parsePosition]->fileLocation);
+	Parser::SyntaxNode* parentNode = new Parser::SyntaxNode(this->compiledGrammar->GetRuleName(ruleID), (*this->tokenArray)[parsePosition]->fileLocation);
 
-	for (Grammar::Token* grammarToken : *matchSequence->tokenSequence)
+	for (int j = 0; j < sequence.symbolCount; j++)
 	{
+		const CompiledGrammar::Symbol& symbol = symbolArray[j];
 		const Lexer::Token* token = (*this->tokenArray)[parsePosition].get();
 
-		std::string grammarRuleName;
 		bool tokenMatched = false;
 
-		switch (grammarToken->Matches(*token, &grammarRuleName))
+		switch (symbol.type)
 		{
-			case Grammar::Token::MatchResult::YES:
+			case CompiledGrammar::Symbol::Type::TERMINAL:
 			{
-				Parser::SyntaxNode* childNode = new Parser::SyntaxNode();
-				*childNode->text = *token->text;
-				childNode->fileLocation = token->fileLocation;
-				parentNode->childList->push_back(childNode);
-				childNode->parentNode = parentNode;
-				parsePosition++;
-				tokenMatched = true;
+				if (this->TokenMatches(parsePosition, symbol.id))
+				{
+					Parser::SyntaxNode* childNode = new Parser::SyntaxNode();
+					*childNode->text = *token->text;
+					childNode->fileLocation = token->fileLocation;
+					parentNode->childList->push_back(childNode);
+					childNode->parentNode = parentNode;
+					parsePosition++;
+					tokenMatched = true;
+				}
 				break;
 			}
-			case Grammar::Token::MatchResult::MAYBE:
+			case CompiledGrammar::Symbol::Type::NON_TERMINAL:
 			{
-				const Grammar::Rule* subRule = this->grammar->LookupRule(grammarRuleName);
-				assert(subRule);
-				Parser::SyntaxNode* childNode = this->GenerateTree(subRule, parsePosition);
+				Parser::SyntaxNode* childNode = this->GenerateTree(symbol.id, parsePosition);
 				if (childNode)
 				{
 					parentNode->childList->push_back(childNode);
@@ -67,10 +69,6 @@ Parser::SyntaxNode* LookAheadParseAlgorithm::GenerateTree(const Grammar::Rule* g
 				}
 				break;
 			}
-            default:
-            {
-                break;
-            }
 		}
 
 		if (!tokenMatched)
@@ -84,55 +82,50 @@ Parser::SyntaxNode* LookAheadParseAlgorithm::GenerateTree(const Grammar::Rule* g
 	return parentNode;
 }
 
-int LookAheadParseAlgorithm::DetermineCorrectMatchSequence(const Grammar::Rule* grammarRule, int parsePosition, int lookAheadPosition, int recursionDepth /*= 0*/)
+int LookAheadParseAlgorithm::DetermineCorrectMatchSequence(int ruleID, int parsePosition, int lookAheadPosition, int recursionDepth /*= 0*/)
 {
 	if (recursionDepth > this->maxRecursionDepth)
 		return -1;
 
-	for (int i = 0; i < (signed)grammarRule->matchSequenceArray->size(); i++)
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	for (int i = 0; i < rule.sequenceCount; i++)
 	{
-		Grammar::MatchSequence* matchSequence = (*grammarRule->matchSequenceArray)[i];
-		if (this->TryMatchSequence(matchSequence, parsePosition, lookAheadPosition, recursionDepth + 1))
+		const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(rule.firstSequence + i);
+		if (this->TryMatchSequence(sequence, parsePosition, lookAheadPosition, recursionDepth + 1))
 			return i;
 	}
 
 	return -1;
 }
 
-bool LookAheadParseAlgorithm::TryMatchSequence(const Grammar::MatchSequence* matchSequence, int parsePosition, int lookAheadPosition, int recursionDepth)
+bool LookAheadParseAlgorithm::TryMatchSequence(const CompiledGrammar::Sequence& sequence, int parsePosition, int lookAheadPosition, int recursionDepth)
 {
-	for (int i = 0; i < (signed)matchSequence->tokenSequence->size(); i++)
+	const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
+	for (int i = 0; i < sequence.symbolCount; i++)
 	{
 		int matchPosition = parsePosition + lookAheadPosition;
 		if (lookAheadPosition == this->lookAheadCount || matchPosition == (signed)this->tokenArray->size())
 			return true;
 
-		const Lexer::Token* token = (*this->tokenArray)[matchPosition].get();
-		const Grammar::Token* grammarToken = (*matchSequence->tokenSequence)[i];
-		std::string ruleName;
+		const CompiledGrammar::Symbol& symbol = symbolArray[i];
 
-		switch (grammarToken->Matches(*token, &ruleName))
+		switch (symbol.type)
 		{
-			case Grammar::Token::MatchResult::YES:
+			case CompiledGrammar::Symbol::Type::TERMINAL:
 			{
-				lookAheadPosition++;
+				if (this->TokenMatches(matchPosition, symbol.id))
+					lookAheadPosition++;
 				break;
 			}
-			case Grammar::Token::MatchResult::MAYBE:
+			case CompiledGrammar::Symbol::Type::NON_TERMINAL:
 			{
-				const Grammar::Rule* grammarRule = this->grammar->LookupRule(ruleName);
-				assert(grammarRule);
-
-				int j = this->DetermineCorrectMatchSequence(grammarRule, parsePosition, lookAheadPosition, recursionDepth + 1);
+				int j = this->DetermineCorrectMatchSequence(symbol.id, parsePosition, lookAheadPosition, recursionDepth + 1);
 				if (j < 0)
 					return false;
 
 				break;
 			}
-            default:
-            {
-                break;
-            }
 		}
 	}
 
@@ -17,9 +17,9 @@ namespace ParseParty
 
 	private:
 
-		Parser::SyntaxNode* GenerateTree(const Grammar::Rule* grammarRule, int& parsePosition);
-		int DetermineCorrectMatchSequence(const Grammar::Rule* grammarRule, int parsePosition, int lookAheadPosition, int recursionDepth = 0);
-		bool TryMatchSequence(const Grammar::MatchSequence* matchSequence, int parsePosition, int lookAheadPosition, int recursionDepth);
+		Parser::SyntaxNode* GenerateTree(int ruleID, int& parsePosition);
+		int DetermineCorrectMatchSequence(int ruleID, int parsePosition, int lookAheadPosition, int recursionDepth = 0);
+		bool TryMatchSequence(const CompiledGrammar::Sequence& sequence, int parsePosition, int lookAheadPosition, int recursionDepth);
 
 		int lookAheadCount;
 		int maxRecursionDepth;
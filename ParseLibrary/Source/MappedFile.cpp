@@ -0,0 +1,128 @@
+#include "MappedFile.h"
+#include "FormatString.h"
+#if defined _WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	include <Windows.h>
+#else
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
+using namespace ParseParty;
+
+//------------------------------- MappedFile -------------------------------
+
+MappedFile::MappedFile()
+{
+	this->data = nullptr;
+	this->size = 0;
+#if defined _WIN32
+	this->fileHandle = INVALID_HANDLE_VALUE;
+	this->mappingHandle = nullptr;
+#else
+	this->fileDescriptor = -1;
+#endif
+}
+
+/*virtual*/ MappedFile::~MappedFile()
+{
+	this->Close();
+}
+
+bool MappedFile::Open(const std::string& file, std::string& error)
+{
+	this->Close();
+
+#if defined _WIN32
+	this->fileHandle = ::CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (this->fileHandle == INVALID_HANDLE_VALUE)
+	{
+		error = "Failed to open file: " + file;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!::GetFileSizeEx(this->fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		error = "Failed to get size of (or got empty) file: " + file;
+		this->Close();
+		return false;
+	}
+
+	this->mappingHandle = ::CreateFileMappingA(this->fileHandle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (!this->mappingHandle)
+	{
+		error = "Failed to map file: " + file;
+		this->Close();
+		return false;
+	}
+
+	this->data = (char*)::MapViewOfFile(this->mappingHandle, FILE_MAP_COPY, 0, 0, 0);
+	if (!this->data)
+	{
+		error = "Failed to map view of file: " + file;
+		this->Close();
+		return false;
+	}
+
+	this->size = (size_t)fileSize.QuadPart;
+#else
+	this->fileDescriptor = ::open(file.c_str(), O_RDONLY);
+	if (this->fileDescriptor < 0)
+	{
+		error = "Failed to open file: " + file;
+		return false;
+	}
+
+	struct stat fileStat;
+	if (::fstat(this->fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		error = "Failed to get size of (or got empty) file: " + file;
+		this->Close();
+		return false;
+	}
+
+	void* mappedData = ::mmap(nullptr, (size_t)fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, this->fileDescriptor, 0);
+	if (mappedData == MAP_FAILED)
+	{
+		error = "Failed to map file: " + file;
+		this->Close();
+		return false;
+	}
+
+	this->data = (char*)mappedData;
+	this->size = (size_t)fileStat.st_size;
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#if defined _WIN32
+	if (this->data)
+		::UnmapViewOfFile(this->data);
+
+	if (this->mappingHandle)
+		::CloseHandle(this->mappingHandle);
+
+	if (this->fileHandle != INVALID_HANDLE_VALUE)
+		::CloseHandle(this->fileHandle);
+
+	this->mappingHandle = nullptr;
+	this->fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (this->data)
+		::munmap(this->data, this->size);
+
+	if (this->fileDescriptor >= 0)
+		::close(this->fileDescriptor);
+
+	this->fileDescriptor = -1;
+#endif
+
+	this->data = nullptr;
+	this->size = 0;
+}
\ No newline at end of file
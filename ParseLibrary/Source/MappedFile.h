@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Common.h"
+
+namespace ParseParty
+{
+	// This maps a whole file into memory, copy-on-write, so that its contents can be used in place
+	// without reading them in.  Writes to the memory never make it back to the file.
+	class PARSE_PARTY_API MappedFile
+	{
+	public:
+		MappedFile();
+		virtual ~MappedFile();
+
+		bool Open(const std::string& file, std::string& error);
+		void Close();
+
+		char* GetData() { return this->data; }
+		const char* GetData() const { return this->data; }
+		size_t GetSize() const { return this->size; }
+
+	private:
+
+		char* data;
+		size_t size;
+#if defined _WIN32
+		void* fileHandle;
+		void* mappingHandle;
+#else
+		int fileDescriptor;
+#endif
+	};
+}
\ No newline at end of file
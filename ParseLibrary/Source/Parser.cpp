@@ -2,6 +2,10 @@
 #include "QuickParseAlgorithm.h"
 #include "SlowParseAlgorithm.h"
 #include "GeneralParseAlgorithm.h"
+#include "LL1ParseAlgorithm.h"
+#include "LALRParseAlgorithm.h"
+#include "GLRParseAlgorithm.h"
+#include "CYKParseAlgorithm.h"
 
 using namespace ParseParty;
 
@@ -31,6 +35,10 @@ Parser::SyntaxNode* Parser::ParseFile(const std::string& codeFile, const Grammar
 
 Parser::SyntaxNode* Parser::Parse(const std::string& codeText, const Grammar& grammar, std::string* error /*= nullptr*/)
 {
+	// The scannerless algorithm matches the terminals of the grammar right against the text, so there's nothing to tokenize.
+	if (grammar.GetSelectedAlgorithmName() == "scannerless")
+		return this->RunAlgorithm(new QuickParseAlgorithm(&codeText, this->lexer.tabSize, &grammar), grammar, error);
+
 	SyntaxNode* rootNode = nullptr;
 	std::vector<std::shared_ptr<Lexer::Token>> tokenArray;
 
@@ -47,23 +55,63 @@ Parser::SyntaxNode* Parser::Parse(const std::vector<std::shared_ptr<Lexer::Token
 {
 	Algorithm* algorithm = nullptr;
 
-	if (*grammar.algorithmName == "quick")
+	this->ambiguityArray.clear();
+
+	const std::string& algorithmName = grammar.GetSelectedAlgorithmName();
+
+	if (algorithmName == "quick")
 		algorithm = new QuickParseAlgorithm(&tokenArray, &grammar);
-	else if (*grammar.algorithmName == "slow")
+	else if (algorithmName == "slow")
 		algorithm = new SlowParseAlgorithm(&tokenArray, &grammar);
-	else if (*grammar.algorithmName == "general")
+	else if (algorithmName == "general")
 		algorithm = new GeneralParseAlgorithm(&tokenArray, &grammar);
+	else if (algorithmName == "ll1")
+		algorithm = new LL1ParseAlgorithm(&tokenArray, &grammar);
+	else if (algorithmName == "lalr")
+		algorithm = new LALRParseAlgorithm(&tokenArray, &grammar);
+	else if (algorithmName == "glr")
+		algorithm = new GLRParseAlgorithm(&tokenArray, &grammar);
+	else if (algorithmName == "cyk")
+		algorithm = new CYKParseAlgorithm(&tokenArray, &grammar);
 
 	if (!algorithm)
 	{
 		if (error)
-			*error = (grammar.algorithmName->length() > 0) ? FormatString("Unrecognized parse algorithm: %s", grammar.algorithmName->c_str()) : "No parse algorithm specified.";
+		{
+			if (algorithmName == "scannerless")
+				*error = "The scannerless algorithm parses text, not tokens.";
+			else
+				*error = (grammar.algorithmName->length() > 0) ? FormatString("Unrecognized parse algorithm: %s", grammar.algorithmName->c_str()) : "No parse algorithm specified.";
+		}
 
 		return nullptr;
 	}
 
+	return this->RunAlgorithm(algorithm, grammar, error);
+}
+
+// Whatever the algorithm, its tree gets the same treatment.  The algorithm is deleted here.
+Parser::SyntaxNode* Parser::RunAlgorithm(Algorithm* algorithm, const Grammar& grammar, std::string* error)
+{
 	SyntaxNode* rootNode = algorithm->Parse();
 
+	this->ambiguityArray = *algorithm->ambiguityArray;
+
+	const CompiledGrammar* compiledGrammar = grammar.GetCompiledGrammar();
+	if (compiledGrammar->NeedsTreeRestore())
+	{
+		// Tail rules made by the optimizer, and rules made for repetitions, mean nothing to the user, so blame the rule they came from instead.
+		for (Ambiguity& ambiguity : this->ambiguityArray)
+		{
+			int ruleID = compiledGrammar->FindRule(ambiguity.ruleName);
+			while (ruleID >= 0 && compiledGrammar->GetRule(ruleID).spliced)
+			{
+				ambiguity.ruleName = ambiguity.ruleName.substr(0, ambiguity.ruleName.rfind('~'));
+				ruleID = compiledGrammar->FindRule(ambiguity.ruleName);
+			}
+		}
+	}
+
 	if (!rootNode)
 	{
 		if (error)
@@ -71,33 +119,255 @@ Parser::SyntaxNode* Parser::Parse(const std::vector<std::shared_ptr<Lexer::Token
 	}
 	else
 	{
-		if ((grammar.flags & PARSE_PARTY_GRAMMAR_FLAG_DELETE_STRUCTURE_TOKENS) != 0)
+		if (compiledGrammar->NeedsTreeRestore())
+			RestoreTree(rootNode, compiledGrammar);
+
+		ApplyGrammarFlags(rootNode, grammar.flags);
+	}
+
+	delete algorithm;
+
+	return rootNode;
+}
+
+/*static*/ void Parser::ApplyGrammarFlags(SyntaxNode* rootNode, int flags)
+{
+	if ((flags & PARSE_PARTY_GRAMMAR_FLAG_DELETE_STRUCTURE_TOKENS) != 0)
+	{
+		// Nodes with the following text no longer give meaning or structure to the code.
+		// The structure/meaning of the code is now found in the structure of the AST.
+		std::set<std::string> textSet;
+		textSet.insert(";");
+		textSet.insert(",");
+		textSet.insert("(");
+		textSet.insert(")");
+		textSet.insert("{");
+		textSet.insert("}");
+		textSet.insert("[");
+		textSet.insert("]");
+		rootNode->RemoveNodesWithText(textSet);
+	}
+
+	if ((flags & PARSE_PARTY_GRAMMAR_FLAG_FLATTEN_AST) != 0)
+	{
+		// Recursive definitions in the grammar cause unnecessary structure in the AST
+		// that we are trying to remove here.  This makes the tree easier to read and process.
+		rootNode->Flatten();
+	}
+}
+
+/*static*/ void Parser::RestoreTree(SyntaxNode* rootNode, const CompiledGrammar* compiledGrammar)
+{
+	// Only rules the optimizer reworked need looking at.
+	std::unordered_map<std::string, int> ruleIDMap;
+	for (int ruleID = 0; ruleID < compiledGrammar->GetRuleCount(); ruleID++)
+	{
+		const CompiledGrammar::Rule& rule = compiledGrammar->GetRule(ruleID);
+		if (rule.spliced || rule.restorePlanSize > 0 || rule.operatorCount > 0)
+			ruleIDMap.insert(std::pair<std::string, int>(compiledGrammar->GetRuleName(ruleID), ruleID));
+	}
+
+	if (ruleIDMap.size() == 0)
+		return;
+
+	std::vector<std::vector<BinaryOperator>> operatorTableArray(compiledGrammar->GetRuleCount());
+	for (int ruleID = 0; ruleID < compiledGrammar->GetRuleCount(); ruleID++)
+	{
+		const CompiledGrammar::Rule& rule = compiledGrammar->GetRule(ruleID);
+		for (int i = 0; i < rule.operatorCount; i++)
+		{
+			const CompiledGrammar::Operator& compiledOperator = compiledGrammar->GetOperator(rule.firstOperator + i);
+			operatorTableArray[ruleID].push_back(BinaryOperator{ compiledGrammar->GetTerminalText(compiledOperator.terminalID), compiledOperator.precedence, compiledOperator.rightAssociative });
+		}
+	}
+
+	// Trees can be deep, so no recursion here.  We go top-down, splicing any tail nodes into a node before following
+	// its plan.  Tails spliced in can have tails of their own, and those get spliced in on the same pass.  Group nodes
+	// made by a plan are already in shape, so only the original children are visited next.
+	std::vector<SyntaxNode*> nodeStack;
+	nodeStack.push_back(rootNode);
+	while (nodeStack.size() > 0)
+	{
+		SyntaxNode* node = nodeStack.back();
+		nodeStack.pop_back();
+
+		if (node->childList->size() == 0)
+			continue;
+
+		std::list<SyntaxNode*>::iterator childIter = node->childList->begin();
+		while (childIter != node->childList->end())
+		{
+			SyntaxNode* childNode = *childIter;
+			std::unordered_map<std::string, int>::const_iterator iter = ruleIDMap.find(*childNode->text);
+			if (iter == ruleIDMap.end() || !compiledGrammar->GetRule(iter->second).spliced)
+			{
+				childIter++;
+				continue;
+			}
+
+			for (SyntaxNode* grandChildNode : *childNode->childList)
+				grandChildNode->parentNode = node;
+
+			node->childList->splice(std::next(childIter), *childNode->childList);
+			childIter = node->childList->erase(childIter);
+			delete childNode;
+		}
+
+		std::unordered_map<std::string, int>::const_iterator iter = ruleIDMap.find(*node->text);
+		if (iter != ruleIDMap.end() && compiledGrammar->GetRule(iter->second).operatorCount > 0)
 		{
-			// Nodes with the following text no longer give meaning or structure to the code.
-			// The structure/meaning of the code is now found in the structure of the AST.
-			std::set<std::string> textSet;
-			textSet.insert(";");
-			textSet.insert(",");
-			textSet.insert("(");
-			textSet.insert(")");
-			textSet.insert("{");
-			textSet.insert("}");
-			textSet.insert("[");
-			textSet.insert("]");
-			rootNode->RemoveNodesWithText(textSet);
+			// Operator rules are never optimized, so there's no plan to follow here.  Only the operands need
+			// visiting; the operators are tokens, and the binary nodes are made in shape.
+			int i = 0;
+			for (SyntaxNode* childNode : *node->childList)
+				if (i++ % 2 == 0)
+					nodeStack.push_back(childNode);
+
+			const std::vector<BinaryOperator>& operatorTable = operatorTableArray[iter->second];
+			BuildOperatorTree(node, operatorTable.data(), (int)operatorTable.size());
+			continue;
 		}
 
-		if ((grammar.flags & PARSE_PARTY_GRAMMAR_FLAG_FLATTEN_AST) != 0)
+		if (iter == ruleIDMap.end() || compiledGrammar->GetRule(iter->second).restorePlanSize == 0)
 		{
-			// Recursive definitions in the grammar cause unnecessary structure in the AST
-			// that we are trying to remove here.  This makes the tree easier to read and process.
-			rootNode->Flatten();
+			for (SyntaxNode* childNode : *node->childList)
+				nodeStack.push_back(childNode);
+
+			continue;
 		}
+
+		const CompiledGrammar::Rule& rule = compiledGrammar->GetRule(iter->second);
+		const int* plan = compiledGrammar->GetRestorePlan(rule);
+		int planPosition = 0;
+
+		std::list<SyntaxNode*> childList;
+		childList.swap(*node->childList);
+
+		std::function<void(SyntaxNode*, int)> followPlan = [&](SyntaxNode* parentNode, int itemCount)
+		{
+			for (int j = 0; j < itemCount; j++)
+			{
+				int planValue = plan[planPosition++];
+				if (planValue == -1 || planValue == -2)
+				{
+					std::list<SyntaxNode*>::iterator lastIter = childList.begin();
+					if (planValue == -2)
+						lastIter = childList.end();
+					else if (lastIter != childList.end())
+						lastIter++;
+
+					for (std::list<SyntaxNode*>::iterator childIter = childList.begin(); childIter != lastIter; childIter++)
+					{
+						(*childIter)->parentNode = parentNode;
+						nodeStack.push_back(*childIter);
+					}
+
+					parentNode->childList->splice(parentNode->childList->end(), childList, childList.begin(), lastIter);
+				}
+				else
+				{
+					int groupItemCount = plan[planPosition++];
+					const Lexer::FileLocation& fileLocation = (childList.size() > 0) ? childList.front()->fileLocation : parentNode->fileLocation;
+					SyntaxNode* groupNode = new SyntaxNode(compiledGrammar->GetRuleName(planValue), fileLocation);
+					groupNode->parentNode = parentNode;
+					parentNode->childList->push_back(groupNode);
+					followPlan(groupNode, groupItemCount);
+				}
+			}
+		};
+
+		// The top level of a plan has no count of its own; it just runs to the end.
+		while (planPosition < rule.restorePlanSize)
+			followPlan(node, 1);
+
+		// Anything the plan didn't account for stays where it was, rather than leak.
+		for (SyntaxNode* childNode : childList)
+		{
+			childNode->parentNode = node;
+			nodeStack.push_back(childNode);
+		}
+
+		node->childList->splice(node->childList->end(), childList);
 	}
+}
 
-	delete algorithm;
+/*static*/ void Parser::BuildOperatorTree(SyntaxNode* node, const BinaryOperator* operatorArray, int operatorCount)
+{
+	// With just the one operator, or none, the node is already in shape.  This also makes it safe to call again on a binary node.
+	if (node->childList->size() <= 3 || node->childList->size() % 2 == 0)
+		return;
+
+	// Anything we don't recognize as an operator means this isn't a list we know what to do with, so it's left alone.
+	std::vector<const BinaryOperator*> listOperatorArray;
+	int i = 0;
+	for (const SyntaxNode* childNode : *node->childList)
+	{
+		if (i++ % 2 == 0)
+			continue;
 
-	return rootNode;
+		const BinaryOperator* binaryOperator = nullptr;
+		for (int j = 0; j < operatorCount && !binaryOperator; j++)
+			if (*childNode->text == operatorArray[j].text)
+				binaryOperator = &operatorArray[j];
+
+		if (!binaryOperator)
+			return;
+
+		listOperatorArray.push_back(binaryOperator);
+	}
+
+	std::vector<SyntaxNode*> operandStack;
+	std::vector<SyntaxNode*> operatorNodeStack;
+	std::vector<const BinaryOperator*> operatorStack;
+
+	auto reduce = [&]()
+	{
+		SyntaxNode* rightNode = operandStack.back();
+		operandStack.pop_back();
+		SyntaxNode* leftNode = operandStack.back();
+		operandStack.pop_back();
+
+		SyntaxNode* binaryNode = new SyntaxNode(*node->text, leftNode->fileLocation);
+		binaryNode->childList->push_back(leftNode);
+		binaryNode->childList->push_back(operatorNodeStack.back());
+		binaryNode->childList->push_back(rightNode);
+		for (SyntaxNode* childNode : *binaryNode->childList)
+			childNode->parentNode = binaryNode;
+
+		operandStack.push_back(binaryNode);
+		operatorNodeStack.pop_back();
+		operatorStack.pop_back();
+	};
+
+	// This is precedence climbing done with explicit stacks, so that long runs of right-associative operators can't blow the call stack.
+	std::list<SyntaxNode*>::iterator childIter = node->childList->begin();
+	operandStack.push_back(*childIter++);
+	for (const BinaryOperator* binaryOperator : listOperatorArray)
+	{
+		SyntaxNode* operatorNode = *childIter++;
+
+		while (operatorStack.size() > 0 && (operatorStack.back()->precedence > binaryOperator->precedence ||
+			(operatorStack.back()->precedence == binaryOperator->precedence && !binaryOperator->rightAssociative)))
+		{
+			reduce();
+		}
+
+		operatorNodeStack.push_back(operatorNode);
+		operatorStack.push_back(binaryOperator);
+		operandStack.push_back(*childIter++);
+	}
+
+	while (operatorStack.size() > 0)
+		reduce();
+
+	// The root of what we built takes the place of the node's own children.
+	SyntaxNode* rootNode = operandStack.back();
+	node->childList->clear();
+	node->childList->swap(*rootNode->childList);
+	for (SyntaxNode* childNode : *node->childList)
+		childNode->parentNode = node;
+
+	delete rootNode;
 }
 
 //------------------------------- Parser::Algorithm -------------------------------
@@ -106,12 +376,24 @@ Parser::Algorithm::Algorithm(const std::vector<std::shared_ptr<Lexer::Token>>* t
 {
 	this->tokenArray = tokenArray;
 	this->grammar = grammar;
+	this->compiledGrammar = grammar->GetCompiledGrammar();
+	this->tokenLiteralArray = new std::vector<int>();
+	this->tokenClassArray = new std::vector<int>();
+	this->tokenClassSetArray = new std::vector<uint64_t>();
+	this->terminalSetWordCount = this->compiledGrammar->GetTerminalSetWordCount();
+	if (tokenArray)
+		this->compiledGrammar->ClassifyTokens(*tokenArray, *this->tokenLiteralArray, *this->tokenClassArray, *this->tokenClassSetArray);
 	this->error = new std::string();
+	this->ambiguityArray = new std::vector<Ambiguity>();
 }
 
 /*virtual*/ Parser::Algorithm::~Algorithm()
 {
+	delete this->tokenLiteralArray;
+	delete this->tokenClassArray;
+	delete this->tokenClassSetArray;
 	delete this->error;
+	delete this->ambiguityArray;
 }
 
 //------------------------------- Parser::SyntaxNode -------------------------------
@@ -453,6 +735,38 @@ void Parser::SyntaxNode::RemoveNodesWithText(const std::set<std::string>& textSe
 		childNode->RemoveNodesWithText(textSet);
 }
 
+// Replace every node with the given text by its children, in place.  Trees can be deep, so no recursion here.
+void Parser::SyntaxNode::SpliceNodesWithText(const std::set<std::string>& textSet)
+{
+	std::vector<SyntaxNode*> nodeStack;
+	nodeStack.push_back(this);
+	while (nodeStack.size() > 0)
+	{
+		SyntaxNode* node = nodeStack.back();
+		nodeStack.pop_back();
+
+		std::list<SyntaxNode*>::iterator iter = node->childList->begin();
+		while (iter != node->childList->end())
+		{
+			SyntaxNode* childNode = *iter;
+			if (textSet.find(*childNode->text) == textSet.end())
+			{
+				nodeStack.push_back(childNode);
+				iter++;
+				continue;
+			}
+
+			// The grandchildren go in right after the child, so we look at them next, in case they need splicing too.
+			for (SyntaxNode* grandChildNode : *childNode->childList)
+				grandChildNode->parentNode = node;
+
+			node->childList->splice(std::next(iter), *childNode->childList);
+			iter = node->childList->erase(iter);
+			delete childNode;
+		}
+	}
+}
+
 int Parser::SyntaxNode::CalcSize() const
 {
 	int count = 1;
@@ -3,6 +3,7 @@
 #include "Common.h"
 #include "Lexer.h"
 #include "Grammar.h"
+#include "CompiledGrammar.h"
 
 namespace ParseParty
 {
@@ -20,6 +21,26 @@ namespace ParseParty
 		SyntaxNode* Parse(const std::string& codeText, const Grammar& grammar, std::string* error = nullptr);
 		SyntaxNode* Parse(const std::vector<std::shared_ptr<Lexer::Token>>& tokenArray, const Grammar& grammar, std::string* error = nullptr);
 
+		// This is the clean-up asked for by the grammar's flags, done after every successful parse.
+		static void ApplyGrammarFlags(SyntaxNode* rootNode, int flags);
+
+		// If the grammar was optimized, the trees built for it have to be put back into the shape they'd have had without that.  Likewise, the nodes
+		// of rules made for repetitions have to be spliced into their parents, so that the repeated items come out side by side.
+		// This is done for every successful parse before the grammar's flags are applied.
+		static void RestoreTree(SyntaxNode* rootNode, const CompiledGrammar* compiledGrammar);
+
+		struct BinaryOperator
+		{
+			const char* text;
+			int precedence;
+			bool rightAssociative;
+		};
+
+		// The node of an operator rule comes out of the parse with its operands and operators as a flat list of children.  This
+		// builds them into a tree of binary nodes by precedence, each with the text of the given node, and makes the given node
+		// the root of it.  This is done by RestoreTree(), and by generated parsers, which have the operator tables built in.
+		static void BuildOperatorTree(SyntaxNode* node, const BinaryOperator* operatorArray, int operatorCount);
+
 		class PARSE_PARTY_API SyntaxNode
 		{
 		public:
@@ -30,6 +51,7 @@ namespace ParseParty
 			void WipeChildren();
 			void Flatten();
 			void RemoveNodesWithText(const std::set<std::string>& textSet);
+			void SpliceNodesWithText(const std::set<std::string>& textSet);
 			int CalcSize() const;
 			const SyntaxNode* FindChild(const std::string& text, int maxRecurseDepth, int depth = 1) const;
 			const SyntaxNode* FindParent(const std::string& text, int maxRecurseDepth, int depth = 1) const;
@@ -55,7 +77,17 @@ namespace ParseParty
 			Lexer::FileLocation fileLocation;
 		};
 
-		// A grammar may specify an algorithm to use.
+		// Algorithms that can detect ambiguity (so far, just GLR) report each ambiguous region they find.
+		// Note that the parse still succeeds in this case, with one of the possible trees chosen for the region.
+		struct Ambiguity
+		{
+			std::string ruleName;
+			int firstToken;
+			int lastToken;
+			Lexer::FileLocation fileLocation;
+		};
+
+		// A grammar may specify an algorithm to use.  The token array is null for an algorithm working on characters.
 		class PARSE_PARTY_API Algorithm
 		{
 		public:
@@ -64,12 +96,44 @@ namespace ParseParty
 
 			virtual SyntaxNode* Parse() = 0;
 
+			// This is the set of terminals matching the token at the given position.
+			const uint64_t* GetTokenTerminalSet(int tokenPosition) const
+			{
+				return this->tokenClassSetArray->data() + (*this->tokenClassArray)[tokenPosition] * this->terminalSetWordCount;
+			}
+
+			bool TokenMatches(int tokenPosition, int terminalID) const
+			{
+				return CompiledGrammar::SetContains(this->GetTokenTerminalSet(tokenPosition), terminalID);
+			}
+
+			bool TokenInSet(int tokenPosition, const uint64_t* terminalSet) const
+			{
+				const uint64_t* tokenTerminalSet = this->GetTokenTerminalSet(tokenPosition);
+				for (int i = 0; i < this->terminalSetWordCount; i++)
+					if ((terminalSet[i] & tokenTerminalSet[i]) != 0)
+						return true;
+
+				return false;
+			}
+
 			const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray;
 			const Grammar* grammar;
+			const CompiledGrammar* compiledGrammar;
+			std::vector<int>* tokenLiteralArray;
+			std::vector<int>* tokenClassArray;
+			std::vector<uint64_t>* tokenClassSetArray;
+			int terminalSetWordCount;
 
 			std::string* error;
+			std::vector<Ambiguity>* ambiguityArray;
 		};
 
 		Lexer lexer;
+		std::vector<Ambiguity> ambiguityArray;		// This is refreshed by every parse.
+
+	private:
+
+		SyntaxNode* RunAlgorithm(Algorithm* algorithm, const Grammar& grammar, std::string* error);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,991 @@
+#include "ParserGenerator.h"
+#include <cstring>
+
+using namespace ParseParty;
+
+//------------------------------- ParserGenerator -------------------------------
+
+ParserGenerator::ParserGenerator()
+{
+	this->compiledGrammar = nullptr;
+	this->memoize = false;
+}
+
+/*virtual*/ ParserGenerator::~ParserGenerator()
+{
+}
+
+bool ParserGenerator::GenerateFiles(const Grammar* grammar, const Lexer* lexer, const std::string& className, const std::string& outputDirectory, std::string& error)
+{
+	std::string headerCode, sourceCode;
+	if (!this->Generate(grammar, lexer, className, headerCode, sourceCode, error))
+		return false;
+
+	std::string pathPrefix = outputDirectory;
+	if (pathPrefix.length() > 0 && pathPrefix.back() != '/' && pathPrefix.back() != '\\')
+		pathPrefix += "/";
+
+	pathPrefix += className;
+
+	for (int i = 0; i < 2; i++)
+	{
+		std::string file = pathPrefix + ((i == 0) ? ".h" : ".cpp");
+		const std::string& code = (i == 0) ? headerCode : sourceCode;
+
+		// Don't touch a file that wouldn't change, so that the build system doesn't rebuild everything depending on it.
+		std::ifstream inputStream(file.c_str(), std::ios::in | std::ios::binary);
+		if (inputStream.is_open())
+		{
+			std::stringstream stringStream;
+			stringStream << inputStream.rdbuf();
+			if (stringStream.str() == code)
+				continue;
+		}
+
+		inputStream.close();
+
+		std::ofstream outputStream(file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!outputStream.is_open())
+		{
+			error = "Failed to open file for writing: " + file;
+			return false;
+		}
+
+		outputStream << code;
+		if (!outputStream.good())
+		{
+			error = "Failed to write file: " + file;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ParserGenerator::Generate(const Grammar* grammar, const Lexer* lexer, const std::string& className, std::string& headerCode, std::string& sourceCode, std::string& error)
+{
+	this->compiledGrammar = grammar->GetCompiledGrammar();
+
+	if (this->compiledGrammar->GetInitialRuleID() < 0)
+	{
+		error = "The grammar has not been compiled.";
+		return false;
+	}
+
+	// Generated parsers get their tokens from a lexer, so they can't match patterns against characters.
+	if (grammar->GetSelectedAlgorithmName() == "scannerless")
+	{
+		error = "Parsers can't be generated for scannerless grammars.";
+		return false;
+	}
+
+	// The generated parser builds its trees in their final shape, with nothing to restore them afterwards,
+	// so it has to be made from the rules as written, not those the optimizer came up with.
+	CompiledGrammar unoptimizedGrammar;
+	if (this->compiledGrammar->IsOptimized())
+	{
+		if (grammar->ruleMap->size() == 0)
+		{
+			error = "The grammar was optimized and its rules are not available to undo that (it may have come from a bundle.)";
+			return false;
+		}
+
+		if (!unoptimizedGrammar.Compile(grammar, error))
+			return false;
+
+		this->compiledGrammar = &unoptimizedGrammar;
+	}
+
+	if (className.length() == 0 || ::isdigit(className[0]))
+	{
+		error = "The class name must be a C++ identifier.";
+		return false;
+	}
+
+	for (char ch : className)
+	{
+		if (!::isalnum(ch) && ch != '_')
+		{
+			error = "The class name must be a C++ identifier.";
+			return false;
+		}
+	}
+
+	for (int ruleID = 0; ruleID < this->compiledGrammar->GetRuleCount(); ruleID++)
+	{
+		if (this->compiledGrammar->GetRule(ruleID).leftRecursive)
+		{
+			error = "Rule \"" + std::string(this->compiledGrammar->GetRuleName(ruleID)) + "\" is left-recursive, so it can't be parsed by recursive descent.";
+			return false;
+		}
+	}
+
+	std::string lexerSetupCode;
+	if (!this->GenerateLexerSetup(lexer, lexerSetupCode, error))
+		return false;
+
+	int ruleCount = this->compiledGrammar->GetRuleCount();
+
+	// Only generate functions for the rules we can actually get to, or the compiler will complain about the rest.
+	std::vector<bool> reachableArray(ruleCount, false);
+	std::vector<int> ruleStack;
+	ruleStack.push_back(this->compiledGrammar->GetInitialRuleID());
+	reachableArray[ruleStack.back()] = true;
+	while (ruleStack.size() > 0)
+	{
+		const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleStack.back());
+		ruleStack.pop_back();
+
+		for (int i = 0; i < rule.sequenceCount; i++)
+		{
+			const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(rule.firstSequence + i);
+			const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
+			// Operator rules match their operators themselves, so only the operand counts.
+			int symbolCount = (rule.operatorCount > 0) ? 1 : sequence.symbolCount;
+			for (int j = 0; j < symbolCount; j++)
+			{
+				if (symbolArray[j].type == CompiledGrammar::Symbol::Type::NON_TERMINAL && !reachableArray[symbolArray[j].id])
+				{
+					reachableArray[symbolArray[j].id] = true;
+					ruleStack.push_back(symbolArray[j].id);
+				}
+			}
+		}
+	}
+
+
+	this->memoize = false;
+	for (int ruleID = 0; ruleID < ruleCount && !this->memoize; ruleID++)
+	{
+		CandidateMasks candidateMasks;
+		this->ComputeCandidateMasks(ruleID, candidateMasks);
+		if (reachableArray[ruleID] && this->CanBacktrack(ruleID, candidateMasks))
+			this->memoize = true;
+	}
+
+
+	std::string bannerComment = "// This file was generated by ParsePartyGen.  Don't edit it; edit the grammar and generate it again.\n";
+
+	headerCode = bannerComment;
+	headerCode += "\n";
+	headerCode += "#pragma once\n";
+	headerCode += "\n";
+	headerCode += "#include \"Parser.h\"\n";
+	headerCode += "\n";
+	headerCode += "class " + className + "\n";
+	headerCode += "{\n";
+	headerCode += "public:\n";
+	headerCode += "\t// Set up the given lexer the same way the lexicon we were generated from would.\n";
+	headerCode += "\tstatic void ConfigureLexer(ParseParty::Lexer& lexer);\n";
+	headerCode += "\n";
+	headerCode += "\tstatic ParseParty::Parser::SyntaxNode* Parse(const std::vector<std::shared_ptr<ParseParty::Lexer::Token>>& tokenArray, std::string* error = nullptr);\n";
+	headerCode += "\tstatic ParseParty::Parser::SyntaxNode* Parse(const std::string& codeText, std::string* error = nullptr);\n";
+	headerCode += "};\n";
+
+	std::string& code = sourceCode;
+	code = bannerComment;
+	code += "\n";
+	code += "#include \"" + className + ".h\"\n";
+	code += "\n";
+	code += "using namespace ParseParty;\n";
+	code += "\n";
+	code += "namespace\n";
+	code += "{\n";
+	if (this->memoize)
+	{
+		code += "\tstruct RuleNode : public Parser::SyntaxNode\n";
+		code += "\t{\n";
+		code += "\t\tRuleNode(int ruleID, const char* ruleName, const Lexer::FileLocation& fileLocation) : SyntaxNode(ruleName, fileLocation)\n";
+		code += "\t\t{\n";
+		code += "\t\t\tthis->ruleID = ruleID;\n";
+		code += "\t\t\tthis->endPosition = -1;\n";
+		code += "\t\t}\n";
+		code += "\n";
+		code += "\t\tint ruleID;\n";
+		code += "\t\tint endPosition;\n";
+		code += "\t};\n";
+		code += "\n";
+	}
+
+	code += "\tstruct ParseState\n";
+	code += "\t{\n";
+	code += "\t\tconst std::vector<std::shared_ptr<Lexer::Token>>* tokenArray;\n";
+	code += "\t\tstd::vector<int> literalArray;\n";
+	code += "\t\tint tokenCount;\n";
+	code += "\t\tint parsePosition;\n";
+	code += "\t\tint failPosition;\n";
+	code += "\t\tint failRuleID;\n";
+	if (this->memoize)
+		code += "\t\tstd::unordered_map<uint64_t, RuleNode*> memoMap;\t\t// Null for a rule that failed at a position, otherwise a match thrown away by backtracking.\n";
+	code += "\t};\n";
+	code += "\n";
+	code += "\tconst char* ruleNameArray[] =\n";
+	code += "\t{\n";
+	for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+		code += "\t\t" + QuoteText(this->compiledGrammar->GetRuleName(ruleID)) + ",\n";
+	code += "\t};\n";
+	code += "\n";
+
+	this->GenerateLiteralLookup(code);
+
+	code += "\tconst Lexer::FileLocation& GetLocation(const ParseState& state, int position)\n";
+	code += "\t{\n";
+	code += "\t\treturn (*state.tokenArray)[(position < state.tokenCount) ? position : (state.tokenCount - 1)]->fileLocation;\n";
+	code += "\t}\n";
+	code += "\n";
+	code += "\t// We remember the furthest we ever got, which is usually where the real problem is.\n";
+	code += "\tinline bool Fail(ParseState& state, int ruleID)\n";
+	code += "\t{\n";
+	code += "\t\tif (state.parsePosition >= state.failPosition)\n";
+	code += "\t\t{\n";
+	code += "\t\t\tstate.failPosition = state.parsePosition;\n";
+	code += "\t\t\tstate.failRuleID = ruleID;\n";
+	code += "\t\t}\n";
+	code += "\n";
+	code += "\t\treturn false;\n";
+	code += "\t}\n";
+	code += "\n";
+	code += "\tinline bool MatchToken(ParseState& state, Parser::SyntaxNode* parentNode, bool matches, int ruleID)\n";
+	code += "\t{\n";
+	code += "\t\tif (!matches)\n";
+	code += "\t\t\treturn Fail(state, ruleID);\n";
+	code += "\n";
+	code += "\t\tconst Lexer::Token* token = (*state.tokenArray)[state.parsePosition++].get();\n";
+	code += "\t\tParser::SyntaxNode* childNode = new Parser::SyntaxNode(*token->text, token->fileLocation);\n";
+	code += "\t\tparentNode->childList->push_back(childNode);\n";
+	code += "\t\tchildNode->parentNode = parentNode;\n";
+	code += "\t\treturn true;\n";
+	code += "\t}\n";
+	code += "\n";
+	code += "\tinline bool MatchRule(Parser::SyntaxNode* parentNode, Parser::SyntaxNode* childNode)\n";
+	code += "\t{\n";
+	code += "\t\tif (!childNode)\n";
+	code += "\t\t\treturn false;\n";
+	code += "\n";
+	code += "\t\tparentNode->childList->push_back(childNode);\n";
+	code += "\t\tchildNode->parentNode = parentNode;\n";
+	code += "\t\treturn true;\n";
+	code += "\t}\n";
+	code += "\n";
+
+	if (this->memoize)
+	{
+		code += "\tinline uint64_t MemoKey(int position, int ruleID)\n";
+		code += "\t{\n";
+		code += "\t\treturn (uint64_t(position) << 32) | uint64_t(ruleID);\n";
+		code += "\t}\n";
+		code += "\n";
+		code += "\tbool Recall(ParseState& state, int ruleID, Parser::SyntaxNode*& node)\n";
+		code += "\t{\n";
+		code += "\t\tstd::unordered_map<uint64_t, RuleNode*>::iterator iter = state.memoMap.find(MemoKey(state.parsePosition, ruleID));\n";
+		code += "\t\tif (iter == state.memoMap.end())\n";
+		code += "\t\t\treturn false;\n";
+		code += "\n";
+		code += "\t\tRuleNode* ruleNode = iter->second;\n";
+		code += "\t\tif (ruleNode)\n";
+		code += "\t\t{\n";
+		code += "\t\t\tstate.memoMap.erase(iter);\n";
+		code += "\t\t\tstate.parsePosition = ruleNode->endPosition;\n";
+		code += "\t\t}\n";
+		code += "\n";
+		code += "\t\tnode = ruleNode;\n";
+		code += "\t\treturn true;\n";
+		code += "\t}\n";
+		code += "\n";
+		code += "\t// The symbol kinds tell us which children are rules ('N') and which are tokens ('T').  Rather than delete\n";
+		code += "\t// the rules, we keep them, since the next alternative is likely to want the same ones at the same places.\n";
+		code += "\tvoid Backtrack(ParseState& state, Parser::SyntaxNode* node, int position, const char* symbolKinds)\n";
+		code += "\t{\n";
+		code += "\t\tfor (Parser::SyntaxNode* childNode : *node->childList)\n";
+		code += "\t\t{\n";
+		code += "\t\t\tif (*symbolKinds++ == 'T')\n";
+		code += "\t\t\t{\n";
+		code += "\t\t\t\tdelete childNode;\n";
+		code += "\t\t\t\tposition++;\n";
+		code += "\t\t\t\tcontinue;\n";
+		code += "\t\t\t}\n";
+		code += "\n";
+		code += "\t\t\tRuleNode* ruleNode = static_cast<RuleNode*>(childNode);\n";
+		code += "\t\t\truleNode->parentNode = nullptr;\n";
+		code += "\t\t\tRuleNode*& memoNode = state.memoMap[MemoKey(position, ruleNode->ruleID)];\n";
+		code += "\t\t\tdelete memoNode;\n";
+		code += "\t\t\tmemoNode = ruleNode;\n";
+		code += "\t\t\tposition = ruleNode->endPosition;\n";
+		code += "\t\t}\n";
+		code += "\n";
+		code += "\t\tnode->childList->clear();\n";
+		code += "\t}\n";
+		code += "\n";
+	}
+
+	for (int terminalID = 0; terminalID < this->compiledGrammar->GetTerminalCount(); terminalID++)
+		this->GenerateTerminalTest(terminalID, code);
+
+	for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+		if (reachableArray[ruleID])
+			code += FormatString("\tParser::SyntaxNode* ParseRule%d(ParseState& state);\n", ruleID);
+
+	for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+	{
+		if (reachableArray[ruleID])
+		{
+			code += "\n";
+			this->GenerateRuleFunction(ruleID, code);
+		}
+	}
+
+	code += "}\n";
+	code += "\n";
+	code += "/*static*/ void " + className + "::ConfigureLexer(Lexer& lexer)\n";
+	code += "{\n";
+	code += lexerSetupCode;
+	code += "}\n";
+	code += "\n";
+	code += "/*static*/ Parser::SyntaxNode* " + className + "::Parse(const std::string& codeText, std::string* error /*= nullptr*/)\n";
+	code += "{\n";
+	code += "\tLexer lexer;\n";
+	code += "\tConfigureLexer(lexer);\n";
+	code += "\n";
+	code += "\tstd::vector<std::shared_ptr<Lexer::Token>> tokenArray;\n";
+	code += "\tstd::string lexerError;\n";
+	code += "\tif (!lexer.Tokenize(codeText, tokenArray, lexerError))\n";
+	code += "\t{\n";
+	code += "\t\tif (error)\n";
+	code += "\t\t\t*error = lexerError;\n";
+	code += "\n";
+	code += "\t\treturn nullptr;\n";
+	code += "\t}\n";
+	code += "\n";
+	code += "\treturn Parse(tokenArray, error);\n";
+	code += "}\n";
+	code += "\n";
+	code += "/*static*/ Parser::SyntaxNode* " + className + "::Parse(const std::vector<std::shared_ptr<Lexer::Token>>& tokenArray, std::string* error /*= nullptr*/)\n";
+	code += "{\n";
+	code += "\tif (tokenArray.size() == 0)\n";
+	code += "\t\treturn nullptr;\n";
+	code += "\n";
+	code += "\tParseState state;\n";
+	code += "\tstate.tokenArray = &tokenArray;\n";
+	code += "\tstate.tokenCount = (int)tokenArray.size();\n";
+	code += "\tstate.parsePosition = 0;\n";
+	code += "\tstate.failPosition = -1;\n";
+	code += "\tstate.failRuleID = -1;\n";
+	code += "\tstate.literalArray.resize(tokenArray.size());\n";
+	code += "\tfor (int i = 0; i < state.tokenCount; i++)\n";
+	code += "\t\tstate.literalArray[i] = LookupLiteral(*tokenArray[i]);\n";
+	code += "\n";
+	code += FormatString("\tParser::SyntaxNode* rootNode = ParseRule%d(state);\n", this->compiledGrammar->GetInitialRuleID());
+	if (this->memoize)
+	{
+		code += "\tfor (std::pair<const uint64_t, RuleNode*>& pair : state.memoMap)\n";
+		code += "\t\tdelete pair.second;\n";
+		code += "\n";
+	}
+
+	code += "\tif (rootNode && state.parsePosition < state.tokenCount)\n";
+	code += "\t{\n";
+	code += "\t\tdelete rootNode;\n";
+	code += "\t\trootNode = nullptr;\n";
+	code += "\n";
+	code += "\t\tif (state.parsePosition >= state.failPosition)\n";
+	code += "\t\t{\n";
+	code += "\t\t\tconst Lexer::FileLocation& fileLocation = tokenArray[state.parsePosition]->fileLocation;\n";
+	code += "\t\t\tif (error)\n";
+	code += "\t\t\t\t*error = FormatString(\"Failed to parse at line %d, column %d: expected end of input.\", fileLocation.line, fileLocation.column);\n";
+	code += "\n";
+	code += "\t\t\treturn nullptr;\n";
+	code += "\t\t}\n";
+	code += "\t}\n";
+	code += "\n";
+	code += "\tif (!rootNode)\n";
+	code += "\t{\n";
+	code += "\t\tconst Lexer::FileLocation& fileLocation = GetLocation(state, state.failPosition);\n";
+	code += "\t\tif (error)\n";
+	code += "\t\t\t*error = FormatString(\"Failed to parse at line %d, column %d: unexpected %s while parsing \\\"%s\\\".\", fileLocation.line, fileLocation.column, (state.failPosition < state.tokenCount) ? \"token\" : \"end of input\", ruleNameArray[state.failRuleID]);\n";
+	code += "\n";
+	code += "\t\treturn nullptr;\n";
+	code += "\t}\n";
+	code += "\n";
+	// Nodes for the rules made for repetitions are spliced into their parents, as Parser::RestoreTree() would do.
+	std::vector<int> splicedRuleArray;
+	for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+		if (reachableArray[ruleID] && this->compiledGrammar->GetRule(ruleID).spliced)
+			splicedRuleArray.push_back(ruleID);
+
+	if (splicedRuleArray.size() > 0)
+	{
+		code += "\tstatic const std::set<std::string> splicedRuleSet =\n";
+		code += "\t{\n";
+		for (int ruleID : splicedRuleArray)
+			code += "\t\t" + QuoteText(this->compiledGrammar->GetRuleName(ruleID)) + ",\n";
+		code += "\t};\n";
+		code += "\trootNode->SpliceNodesWithText(splicedRuleSet);\n";
+		code += "\n";
+	}
+
+	code += FormatString("\tParser::ApplyGrammarFlags(rootNode, %d);\n", grammar->flags);
+	code += "\treturn rootNode;\n";
+	code += "}\n";
+
+	return true;
+}
+
+bool ParserGenerator::GenerateLexerSetup(const Lexer* lexer, std::string& code, std::string& error)
+{
+	code = "\tlexer.Clear();\n";
+	code += FormatString("\tlexer.tabSize = %d;\n", lexer->tabSize);
+
+	for (const Lexer::TokenGenerator* tokenGenerator : *lexer->tokenGeneratorList)
+	{
+		std::string generatorName = tokenGenerator->GetName();
+
+		code += "\n";
+		code += "\t{\n";
+		code += "\t\tLexer::" + generatorName + "* tokenGenerator = new Lexer::" + generatorName + "();\n";
+
+		if (generatorName == "StringTokenGenerator")
+		{
+			const Lexer::StringTokenGenerator* stringTokenGenerator = dynamic_cast<const Lexer::StringTokenGenerator*>(tokenGenerator);
+			code += std::string("\t\ttokenGenerator->processEscapeSequences = ") + (stringTokenGenerator->processEscapeSequences ? "true" : "false") + ";\n";
+		}
+		else if (generatorName == "OperatorTokenGenerator")
+		{
+			const Lexer::OperatorTokenGenerator* operatorTokenGenerator = dynamic_cast<const Lexer::OperatorTokenGenerator*>(tokenGenerator);
+			for (const std::string& operatorText : *operatorTokenGenerator->operatorSet)
+				code += "\t\ttokenGenerator->operatorSet->insert(" + QuoteText(operatorText) + ");\n";
+		}
+		else if (generatorName == "IdentifierTokenGenerator")
+		{
+			const Lexer::IdentifierTokenGenerator* identifierTokenGenerator = dynamic_cast<const Lexer::IdentifierTokenGenerator*>(tokenGenerator);
+			for (const std::string& keyword : *identifierTokenGenerator->keywordSet)
+				code += "\t\ttokenGenerator->keywordSet->insert(" + QuoteText(keyword) + ");\n";
+		}
+		else if (generatorName != "ParanTokenGenerator" && generatorName != "DelimeterTokenGenerator" && generatorName != "NumberTokenGenerator" && generatorName != "CommentTokenGenerator")
+		{
+			error = "Don't know how to generate code for token generator: " + generatorName;
+			return false;
+		}
+
+		code += "\t\tlexer.tokenGeneratorList->push_back(tokenGenerator);\n";
+		code += "\t}\n";
+	}
+
+	return true;
+}
+
+// This must agree with CompiledGrammar::LookupLiteral().  We switch on the length first, since that's cheap,
+// and then just compare against each literal of that length.
+void ParserGenerator::GenerateLiteralLookup(std::string& code)
+{
+	std::map<int, std::vector<int>> lengthMap;
+	for (int terminalID = 0; terminalID < this->compiledGrammar->GetTerminalCount(); terminalID++)
+		if (this->compiledGrammar->GetTerminal(terminalID).matchClass == CompiledGrammar::Terminal::Class::LITERAL)
+			lengthMap[(int)::strlen(this->compiledGrammar->GetTerminalText(terminalID))].push_back(terminalID);
+
+	code += "\tint LookupLiteral(const Lexer::Token& token)\n";
+	code += "\t{\n";
+	code += "\t\tif (token.type == Lexer::Token::Type::STRING_LITERAL)\n";
+	code += "\t\t\treturn -1;\n";
+	code += "\n";
+	code += "\t\tconst std::string& text = *token.text;\n";
+	code += "\t\tswitch (text.length())\n";
+	code += "\t\t{\n";
+
+	for (const std::pair<const int, std::vector<int>>& pair : lengthMap)
+	{
+		code += FormatString("\t\t\tcase %d:\n", pair.first);
+		code += "\t\t\t{\n";
+		for (int terminalID : pair.second)
+		{
+			code += "\t\t\t\tif (text == " + QuoteText(this->compiledGrammar->GetTerminalText(terminalID)) + ")\n";
+			code += FormatString("\t\t\t\t\treturn %d;\n", terminalID);
+		}
+		code += "\t\t\t\tbreak;\n";
+		code += "\t\t\t}\n";
+	}
+
+	code += "\t\t}\n";
+	code += "\n";
+	code += "\t\treturn -1;\n";
+	code += "\t}\n";
+	code += "\n";
+}
+
+void ParserGenerator::GenerateTerminalTest(int terminalID, std::string& code)
+{
+	const char* condition = nullptr;
+	switch (this->compiledGrammar->GetTerminal(terminalID).matchClass)
+	{
+		case CompiledGrammar::Terminal::Class::LITERAL:
+			condition = nullptr;
+			break;
+		case CompiledGrammar::Terminal::Class::STRING:
+			condition = "type == Lexer::Token::Type::STRING_LITERAL";
+			break;
+		case CompiledGrammar::Terminal::Class::NUMBER:
+			condition = "type == Lexer::Token::Type::NUMBER_LITERAL_INT || type == Lexer::Token::Type::NUMBER_LITERAL_FLOAT";
+			break;
+		case CompiledGrammar::Terminal::Class::INT:
+			condition = "type == Lexer::Token::Type::NUMBER_LITERAL_INT";
+			break;
+		case CompiledGrammar::Terminal::Class::FLOAT:
+			condition = "type == Lexer::Token::Type::NUMBER_LITERAL_FLOAT";
+			break;
+		case CompiledGrammar::Terminal::Class::IDENTIFIER:
+			condition = "type == Lexer::Token::Type::IDENTIFIER";
+			break;
+		case CompiledGrammar::Terminal::Class::PATTERN:
+			condition = "false";		// Patterns never match tokens.
+			break;
+	}
+
+	code += "\t// " + QuoteText(this->compiledGrammar->GetTerminalText(terminalID)) + "\n";
+	code += FormatString("\tinline bool TokenIsTerminal%d(const ParseState& state)\n", terminalID);
+	code += "\t{\n";
+	code += "\t\tif (state.parsePosition >= state.tokenCount)\n";
+	code += "\t\t\treturn false;\n";
+	code += "\n";
+
+	if (!condition)
+		code += FormatString("\t\treturn state.literalArray[state.parsePosition] == %d;\n", terminalID);
+	else
+	{
+		code += "\t\tLexer::Token::Type type = (*state.tokenArray)[state.parsePosition]->type;\n";
+		code += std::string("\t\treturn ") + condition + ";\n";
+	}
+
+	code += "\t}\n";
+	code += "\n";
+}
+
+void ParserGenerator::ComputeCandidateMasks(int ruleID, CandidateMasks& candidateMasks) const
+{
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	int tokenTypeCount = (int)Lexer::Token::Type::CLOSE_CURLY_BRACE + 1;
+
+	// Alternatives past the 64th always get tried, but nobody writes rules like that.
+	int maskedCount = (rule.sequenceCount < 64) ? rule.sequenceCount : 64;
+
+	// Work out, for every literal and every token type, which alternatives might match a token of that kind.
+	// A token matches its literal, if it has one, and then any of the non-literal terminals that match its type.
+	candidateMasks.nullableMask = 0;
+	candidateMasks.literalCaseMap.clear();
+	candidateMasks.typeCaseMap.clear();
+
+	for (int i = 0; i < maskedCount; i++)
+		if (this->compiledGrammar->GetSequence(rule.firstSequence + i).nullable)
+			candidateMasks.nullableMask |= uint64_t(1) << i;
+
+	for (int terminalID = 0; terminalID < this->compiledGrammar->GetTerminalCount(); terminalID++)
+	{
+		if (this->compiledGrammar->GetTerminal(terminalID).matchClass != CompiledGrammar::Terminal::Class::LITERAL)
+			continue;
+
+		uint64_t mask = 0;
+		for (int i = 0; i < maskedCount; i++)
+			if (CompiledGrammar::SetContains(this->compiledGrammar->GetSequenceFirstSet(rule.firstSequence + i), terminalID))
+				mask |= uint64_t(1) << i;
+
+		if (mask != 0)
+			candidateMasks.literalCaseMap[mask].push_back(terminalID);
+	}
+
+	for (int tokenType = 0; tokenType < tokenTypeCount; tokenType++)
+	{
+		uint64_t mask = 0;
+		for (int i = 0; i < maskedCount; i++)
+		{
+			const uint64_t* firstSet = this->compiledGrammar->GetSequenceFirstSet(rule.firstSequence + i);
+			for (int terminalID : this->compiledGrammar->GetTokenTypeTerminals((Lexer::Token::Type)tokenType))
+				if (CompiledGrammar::SetContains(firstSet, terminalID))
+					mask |= uint64_t(1) << i;
+		}
+
+		if (mask != 0)
+			candidateMasks.typeCaseMap[mask].push_back(tokenType);
+	}
+}
+
+// Tell us if the given rule could ever have more than one candidate alternative for a token.  (We don't know which
+// literals have which token types until the lexer gets to them, so we have to assume any literal could have any type.)
+bool ParserGenerator::CanBacktrack(int ruleID, const CandidateMasks& candidateMasks) const
+{
+	if (this->compiledGrammar->GetRule(ruleID).sequenceCount > 64)
+		return true;
+
+	std::vector<uint64_t> literalMaskArray, typeMaskArray;
+	literalMaskArray.push_back(0);
+	typeMaskArray.push_back(0);
+
+	for (const std::pair<const uint64_t, std::vector<int>>& pair : candidateMasks.literalCaseMap)
+		literalMaskArray.push_back(pair.first);
+
+	for (const std::pair<const uint64_t, std::vector<int>>& pair : candidateMasks.typeCaseMap)
+		typeMaskArray.push_back(pair.first);
+
+	for (uint64_t literalMask : literalMaskArray)
+		for (uint64_t typeMask : typeMaskArray)
+			if (std::popcount(candidateMasks.nullableMask | literalMask | typeMask) > 1)
+				return true;
+
+	return false;
+}
+
+void ParserGenerator::GenerateRuleFunction(int ruleID, std::string& code)
+{
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	if (rule.repeats)
+	{
+		this->GenerateRepetitionFunction(ruleID, code);
+		return;
+	}
+
+	if (rule.operatorCount > 0)
+	{
+		this->GenerateOperatorFunction(ruleID, code);
+		return;
+	}
+
+	int wordCount = this->compiledGrammar->GetTerminalSetWordCount();
+
+	CandidateMasks candidateMasks;
+	this->ComputeCandidateMasks(ruleID, candidateMasks);
+	uint64_t nullableMask = candidateMasks.nullableMask;
+	const std::map<uint64_t, std::vector<int>>& literalCaseMap = candidateMasks.literalCaseMap;
+	const std::map<uint64_t, std::vector<int>>& typeCaseMap = candidateMasks.typeCaseMap;
+
+	static const char* tokenTypeNameArray[] =
+	{
+		"UNKNOWN",
+		"COMMENT",
+		"DELIMETER_COMMA",
+		"DELIMETER_COLON",
+		"DELIMETER_SEMI_COLON",
+		"OPERATOR",
+		"IDENTIFIER",
+		"IDENTIFIER_KEYWORD",
+		"STRING_LITERAL",
+		"NUMBER_LITERAL_FLOAT",
+		"NUMBER_LITERAL_INT",
+		"OPEN_PARAN",
+		"CLOSE_PARAN",
+		"OPEN_SQUARE_BRACKET",
+		"CLOSE_SQUARE_BRACKET",
+		"OPEN_CURLY_BRACE",
+		"CLOSE_CURLY_BRACE"
+	};
+
+	code += "\t// " + QuoteText(this->compiledGrammar->GetRuleName(ruleID)) + "\n";
+	code += FormatString("\tParser::SyntaxNode* ParseRule%d(ParseState& state)\n", ruleID);
+	code += "\t{\n";
+	if (this->memoize)
+	{
+		code += "\t\tParser::SyntaxNode* memoNode = nullptr;\n";
+		code += FormatString("\t\tif (Recall(state, %d, memoNode))\n", ruleID);
+		code += "\t\t\treturn memoNode;\n";
+		code += "\n";
+	}
+
+	code += "\t\tint startPosition = state.parsePosition;\n";
+	code += FormatString("\t\tuint64_t candidateMask = 0x%llx;\n", (unsigned long long)nullableMask);
+
+	if (literalCaseMap.size() > 0 || typeCaseMap.size() > 0)
+	{
+		code += "\t\tif (startPosition < state.tokenCount)\n";
+		code += "\t\t{\n";
+
+		if (literalCaseMap.size() > 0)
+		{
+			code += "\t\t\tswitch (state.literalArray[startPosition])\n";
+			code += "\t\t\t{\n";
+			for (const std::pair<const uint64_t, std::vector<int>>& pair : literalCaseMap)
+			{
+				for (int terminalID : pair.second)
+					code += FormatString("\t\t\t\tcase %d:\n", terminalID);
+				code += FormatString("\t\t\t\t\tcandidateMask |= 0x%llx;\n", (unsigned long long)pair.first);
+				code += "\t\t\t\t\tbreak;\n";
+			}
+			code += "\t\t\t}\n";
+		}
+
+		if (typeCaseMap.size() > 0)
+		{
+			if (literalCaseMap.size() > 0)
+				code += "\n";
+
+			code += "\t\t\tswitch ((*state.tokenArray)[startPosition]->type)\n";
+			code += "\t\t\t{\n";
+			for (const std::pair<const uint64_t, std::vector<int>>& pair : typeCaseMap)
+			{
+				for (int tokenType : pair.second)
+					code += std::string("\t\t\t\tcase Lexer::Token::Type::") + tokenTypeNameArray[tokenType] + ":\n";
+				code += FormatString("\t\t\t\t\tcandidateMask |= 0x%llx;\n", (unsigned long long)pair.first);
+				code += "\t\t\t\t\tbreak;\n";
+			}
+			code += "\t\t\t\tdefault:\n";
+			code += "\t\t\t\t\tbreak;\n";
+			code += "\t\t\t}\n";
+		}
+
+		code += "\t\t}\n";
+	}
+
+	code += "\n";
+	if (this->memoize)
+		code += FormatString("\t\tRuleNode* node = new RuleNode(%d, ruleNameArray[%d], GetLocation(state, startPosition));\n", ruleID, ruleID);
+	else
+		code += FormatString("\t\tParser::SyntaxNode* node = new Parser::SyntaxNode(ruleNameArray[%d], GetLocation(state, startPosition));\n", ruleID);
+
+	for (int i = 0; i < rule.sequenceCount; i++)
+	{
+		int sequenceID = rule.firstSequence + i;
+		const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+		const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
+		// There's no point in generating an alternative that can never be a candidate.
+		bool reachable = (i >= 64) || sequence.nullable;
+		for (int j = 0; j < wordCount && !reachable; j++)
+			if (this->compiledGrammar->GetSequenceFirstSet(sequenceID)[j] != 0)
+				reachable = true;
+
+		if (!reachable)
+			continue;
+
+		code += "\n";
+		code += "\t\t// " + this->DescribeSequence(sequenceID) + "\n";
+
+		if (i < 64)
+			code += FormatString("\t\tif ((candidateMask & 0x%llx) != 0)\n", (unsigned long long)(uint64_t(1) << i));
+
+		code += "\t\t{\n";
+
+		if (sequence.symbolCount == 0)
+		{
+			if (this->memoize)
+				code += "\t\t\tnode->endPosition = state.parsePosition;\n";
+			code += "\t\t\treturn node;\n";
+		}
+		else
+		{
+			for (int j = 0; j < sequence.symbolCount; j++)
+			{
+				code += (j == 0) ? "\t\t\tif (" : " &&\n\t\t\t\t";
+
+				if (symbolArray[j].type == CompiledGrammar::Symbol::Type::TERMINAL)
+					code += FormatString("MatchToken(state, node, TokenIsTerminal%d(state), %d)", symbolArray[j].id, ruleID);
+				else
+					code += FormatString("MatchRule(node, ParseRule%d(state))", symbolArray[j].id);
+			}
+
+			code += ")\n";
+			code += "\t\t\t{\n";
+			if (this->memoize)
+				code += "\t\t\t\tnode->endPosition = state.parsePosition;\n";
+			code += "\t\t\t\treturn node;\n";
+			code += "\t\t\t}\n";
+			code += "\n";
+			if (this->memoize)
+			{
+				std::string symbolKinds;
+				for (int j = 0; j < sequence.symbolCount; j++)
+					symbolKinds += (symbolArray[j].type == CompiledGrammar::Symbol::Type::TERMINAL) ? 'T' : 'N';
+				code += "\t\t\tBacktrack(state, node, startPosition, \"" + symbolKinds + "\");\n";
+			}
+			else
+				code += "\t\t\tnode->WipeChildren();\n";
+			code += "\t\t\tstate.parsePosition = startPosition;\n";
+		}
+
+		code += "\t\t}\n";
+	}
+
+	code += "\n";
+	code += "\t\tdelete node;\n";
+	if (this->memoize)
+		code += FormatString("\t\tstate.memoMap[MemoKey(startPosition, %d)] = nullptr;\n", ruleID);
+	code += FormatString("\t\tFail(state, %d);\n", ruleID);
+	code += "\t\treturn nullptr;\n";
+	code += "\t}\n";
+}
+
+std::string ParserGenerator::DescribeSequence(int sequenceID) const
+{
+	const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+	const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
+	std::string description = "<empty>";
+	for (int i = 0; i < sequence.symbolCount; i++)
+	{
+		if (i == 0)
+			description = "";
+		else
+			description += " ";
+
+		if (symbolArray[i].type == CompiledGrammar::Symbol::Type::TERMINAL)
+			description += QuoteText(this->compiledGrammar->GetTerminalText(symbolArray[i].id));
+		else
+			description += "<" + QuoteText(this->compiledGrammar->GetRuleName(symbolArray[i].id)) + ">";
+	}
+
+	return description;
+}
+
+// Make the given text into a C++ string literal, which can also sit safely at the end of a line comment.
+/*static*/ std::string ParserGenerator::QuoteText(const std::string& text)
+{
+	std::string quotedText = "\"";
+
+	for (char ch : text)
+	{
+		if (ch == '"' || ch == '\\')
+		{
+			quotedText += '\\';
+			quotedText += ch;
+		}
+		else if ((unsigned char)ch < 0x20 || (unsigned char)ch >= 0x7F)
+			quotedText += FormatString("\\%03o", (unsigned char)ch);
+		else
+			quotedText += ch;
+	}
+
+	quotedText += "\"";
+	return quotedText;
+}
+
+// A repetition is matched with a loop over its items, rather than a call per item, so long lists don't go deep.  It can't fail; it just stops
+// at the first item that doesn't match in full, and leaves the rest to whatever comes next.  (Repetitions have just the one kind of item.
+// The tails of operator rules have one per operator, but never get here, since an operator rule does its own looping.)
+void ParserGenerator::GenerateRepetitionFunction(int ruleID, std::string& code)
+{
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(rule.firstSequence);
+	const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
+	code += "\t// " + QuoteText(this->compiledGrammar->GetRuleName(ruleID)) + "\n";
+	code += FormatString("\tParser::SyntaxNode* ParseRule%d(ParseState& state)\n", ruleID);
+	code += "\t{\n";
+	if (this->memoize)
+	{
+		code += "\t\tParser::SyntaxNode* memoNode = nullptr;\n";
+		code += FormatString("\t\tif (Recall(state, %d, memoNode))\n", ruleID);
+		code += "\t\t\treturn memoNode;\n";
+		code += "\n";
+	}
+
+	code += "\t\tint startPosition = state.parsePosition;\n";
+	if (this->memoize)
+		code += FormatString("\t\tRuleNode* node = new RuleNode(%d, ruleNameArray[%d], GetLocation(state, startPosition));\n", ruleID, ruleID);
+	else
+		code += FormatString("\t\tParser::SyntaxNode* node = new Parser::SyntaxNode(ruleNameArray[%d], GetLocation(state, startPosition));\n", ruleID);
+
+	code += "\n";
+	code += "\t\t// " + this->DescribeSequence(rule.firstSequence) + "\n";
+	code += "\t\twhile (state.parsePosition < state.tokenCount)\n";
+	code += "\t\t{\n";
+	code += "\t\t\tint itemPosition = state.parsePosition;\n";
+	code += "\t\t\tsize_t childCount = node->childList->size();\n";
+
+	// The last symbol is the rule itself, which is what the loop is for.
+	for (int j = 0; j < sequence.symbolCount - 1; j++)
+	{
+		code += (j == 0) ? "\t\t\tif (" : " &&\n\t\t\t\t";
+
+		if (symbolArray[j].type == CompiledGrammar::Symbol::Type::TERMINAL)
+			code += FormatString("MatchToken(state, node, TokenIsTerminal%d(state), %d)", symbolArray[j].id, ruleID);
+		else
+			code += FormatString("MatchRule(node, ParseRule%d(state))", symbolArray[j].id);
+	}
+
+	code += " &&\n\t\t\t\tstate.parsePosition > itemPosition)\n";
+	code += "\t\t\t\tcontinue;\n";
+	code += "\n";
+	code += "\t\t\twhile (node->childList->size() > childCount)\n";
+	code += "\t\t\t{\n";
+	code += "\t\t\t\tdelete node->childList->back();\n";
+	code += "\t\t\t\tnode->childList->pop_back();\n";
+	code += "\t\t\t}\n";
+	code += "\n";
+	code += "\t\t\tstate.parsePosition = itemPosition;\n";
+	code += "\t\t\tbreak;\n";
+	code += "\t\t}\n";
+	code += "\n";
+	if (this->memoize)
+		code += "\t\tnode->endPosition = state.parsePosition;\n";
+	code += "\t\treturn node;\n";
+	code += "\t}\n";
+}
+
+// An operator rule is matched as a loop over its operands and operators, with the operators tested right here rather than by a rule
+// of their own, and the tree is built by precedence before we return, so that nothing is left for the end but the grammar's flags.
+void ParserGenerator::GenerateOperatorFunction(int ruleID, std::string& code)
+{
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(rule.firstSequence);
+	int operandRuleID = this->compiledGrammar->GetSymbols(sequence)[0].id;
+
+	code += "\t// " + QuoteText(this->compiledGrammar->GetRuleName(ruleID)) + "\n";
+	code += FormatString("\tParser::SyntaxNode* ParseRule%d(ParseState& state)\n", ruleID);
+	code += "\t{\n";
+	if (this->memoize)
+	{
+		code += "\t\tParser::SyntaxNode* memoNode = nullptr;\n";
+		code += FormatString("\t\tif (Recall(state, %d, memoNode))\n", ruleID);
+		code += "\t\t\treturn memoNode;\n";
+		code += "\n";
+	}
+
+	code += "\t\tint startPosition = state.parsePosition;\n";
+	if (this->memoize)
+		code += FormatString("\t\tRuleNode* node = new RuleNode(%d, ruleNameArray[%d], GetLocation(state, startPosition));\n", ruleID, ruleID);
+	else
+		code += FormatString("\t\tParser::SyntaxNode* node = new Parser::SyntaxNode(ruleNameArray[%d], GetLocation(state, startPosition));\n", ruleID);
+
+	code += "\n";
+	code += FormatString("\t\tif (!MatchRule(node, ParseRule%d(state)))\n", operandRuleID);
+	code += "\t\t{\n";
+	code += "\t\t\tdelete node;\n";
+	if (this->memoize)
+		code += FormatString("\t\t\tstate.memoMap[MemoKey(startPosition, %d)] = nullptr;\n", ruleID);
+	code += FormatString("\t\t\tFail(state, %d);\n", ruleID);
+	code += "\t\t\treturn nullptr;\n";
+	code += "\t\t}\n";
+	code += "\n";
+	code += "\t\twhile (state.parsePosition < state.tokenCount)\n";
+	code += "\t\t{\n";
+	code += "\t\t\tint itemPosition = state.parsePosition;\n";
+
+	for (int i = 0; i < rule.operatorCount; i++)
+	{
+		code += (i == 0) ? "\t\t\tif ((" : " ||\n\t\t\t\t";
+		code += FormatString("MatchToken(state, node, TokenIsTerminal%d(state), %d)", this->compiledGrammar->GetOperator(rule.firstOperator + i).terminalID, ruleID);
+	}
+
+	code += FormatString(") &&\n\t\t\t\tMatchRule(node, ParseRule%d(state)))\n", operandRuleID);
+	code += "\t\t\t\tcontinue;\n";
+	code += "\n";
+	code += "\t\t\t// An operator with nothing after it is left to whatever comes next.\n";
+	code += "\t\t\tif (state.parsePosition > itemPosition)\n";
+	code += "\t\t\t{\n";
+	code += "\t\t\t\tdelete node->childList->back();\n";
+	code += "\t\t\t\tnode->childList->pop_back();\n";
+	code += "\t\t\t}\n";
+	code += "\n";
+	code += "\t\t\tstate.parsePosition = itemPosition;\n";
+	code += "\t\t\tbreak;\n";
+	code += "\t\t}\n";
+	code += "\n";
+	code += "\t\tstatic const Parser::BinaryOperator operatorArray[] =\n";
+	code += "\t\t{\n";
+	for (int i = 0; i < rule.operatorCount; i++)
+	{
+		const CompiledGrammar::Operator& compiledOperator = this->compiledGrammar->GetOperator(rule.firstOperator + i);
+		code += FormatString("\t\t\t{ %s, %d, %s },\n", QuoteText(this->compiledGrammar->GetTerminalText(compiledOperator.terminalID)).c_str(), compiledOperator.precedence, compiledOperator.rightAssociative ? "true" : "false");
+	}
+	code += "\t\t};\n";
+	code += FormatString("\t\tParser::BuildOperatorTree(node, operatorArray, %d);\n", rule.operatorCount);
+	if (this->memoize)
+		code += "\t\tnode->endPosition = state.parsePosition;\n";
+	code += "\t\treturn node;\n";
+	code += "\t}\n";
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Parser.h"
+
+namespace ParseParty
+{
+	// This writes out C++ source for a parser specialized to one grammar, so that the grammar needn't be
+	// read, compiled or interpreted at run-time.  The generated parser is recursive descent, with one function
+	// per rule.  Each rule function switches on the next token to find which of its alternatives could
+	// possibly match (using the FIRST sets of the alternatives), and then tries just those, in order, backtracking
+	// if one fails part way.  For an LL(1) grammar, only one alternative is ever a candidate, so there's no
+	// backtracking at all; otherwise, the first alternative to match wins, as with the quick algorithm.  Either
+	// way, the trees it builds are the same as those built by the library's own algorithms, and the grammar's
+	// flags are applied to them in the same way.  Left-recursive rules can't be parsed top-down like this, so
+	// we refuse to generate a parser for grammars with any.  If backtracking is possible at all, the generated
+	// parser remembers which rules failed where, and hangs on to the subtrees thrown away by a failed alternative
+	// so that the next one can use them, which keeps it from going exponential on alternatives sharing a prefix.
+	// Operator rules are matched with a loop, and their trees built by precedence with Parser::BuildOperatorTree().
+	//
+	// The lexicon is baked in too, so the generated class can set up a lexer for itself.
+	class PARSE_PARTY_API ParserGenerator
+	{
+	public:
+		ParserGenerator();
+		virtual ~ParserGenerator();
+
+		bool Generate(const Grammar* grammar, const Lexer* lexer, const std::string& className, std::string& headerCode, std::string& sourceCode, std::string& error);
+
+		// This writes <className>.h and <className>.cpp to the given directory.
+		bool GenerateFiles(const Grammar* grammar, const Lexer* lexer, const std::string& className, const std::string& outputDirectory, std::string& error);
+
+	private:
+
+		struct CandidateMasks
+		{
+			uint64_t nullableMask;		// Nullable alternatives are always candidates.
+			std::map<uint64_t, std::vector<int>> literalCaseMap;		// The literals to switch on, grouped by the alternatives they make candidates.
+			std::map<uint64_t, std::vector<int>> typeCaseMap;		// The same, but for token types.
+		};
+
+		bool GenerateLexerSetup(const Lexer* lexer, std::string& code, std::string& error);
+		void GenerateLiteralLookup(std::string& code);
+		void GenerateTerminalTest(int terminalID, std::string& code);
+		void ComputeCandidateMasks(int ruleID, CandidateMasks& candidateMasks) const;
+		bool CanBacktrack(int ruleID, const CandidateMasks& candidateMasks) const;
+		void GenerateRuleFunction(int ruleID, std::string& code);
+		void GenerateRepetitionFunction(int ruleID, std::string& code);
+		void GenerateOperatorFunction(int ruleID, std::string& code);
+		std::string DescribeSequence(int sequenceID) const;
+
+		static std::string QuoteText(const std::string& text);
+
+		const CompiledGrammar* compiledGrammar;
+		bool memoize;		// Only if some rule could backtrack do we need to generate the memo code.
+	};
+}
\ No newline at end of file
@@ -1,194 +1,679 @@
 #include "QuickParseAlgorithm.h"
 #include <cstring>
 
-namespace ParseParty
-{
-	bool operator<(const QuickParseAttempt& attemptA, const QuickParseAttempt& attemptB)
-	{
-		if (attemptA.parsePosition == attemptB.parsePosition)
-			return ::strcmp(attemptA.ruleName.c_str(), attemptB.ruleName.c_str()) < 0;
+using namespace ParseParty;
 
-		return attemptA.parsePosition < attemptB.parsePosition;
-	}
-}
+// Past this many (rule, position) pairs, a dense memo table would cost more memory than it's worth,
+// since most rules are never tried at most positions, so we go with a hash map instead.
+#define QUICK_PARSE_DENSE_MEMO_LIMIT		(1 << 22)
 
-using namespace ParseParty;
+// A grammar with cuts is one meant to be run over big inputs in little memory, and the dense table is sized for the
+// whole input up-front, before any cut can let go of anything.  So for those, it's only used if it's small anyway.
+#define QUICK_PARSE_CUT_DENSE_MEMO_LIMIT	(1 << 16)
 
 //------------------------------- QuickParseAlgorithm -------------------------------
 
 QuickParseAlgorithm::QuickParseAlgorithm(const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray, const Grammar* grammar) : Algorithm(tokenArray, grammar)
 {
 	this->parseCacheEnabled = true;
-	this->parseAttemptStack = new std::list<QuickParseAttempt>();
-	this->parseCacheMap = new ParseCacheMap();
+	this->parseAttemptStack = new std::vector<QuickParseAttempt>();
+	this->ruleAttemptDepthArray = new std::vector<int>();
+	this->memoTable = new std::vector<MemoEntry>();
+	this->sparseMemoMap = new std::unordered_map<uint64_t, MemoEntry>();
+	this->denseMemo = true;
+	this->lowestGuardDepth = INT_MAX;
 	this->maxParsePositionWithError = -1;
+	this->forgottenPosition = 0;
+	this->scanner = nullptr;
+	this->codeBuffer = nullptr;
+	this->codeLength = 0;
+	this->tabSize = 0;
+	this->skipEndArray = new std::vector<int>();
+	this->lineStartArray = new std::vector<int>();
+	this->locationPosition = 0;
+	this->location = Lexer::FileLocation{ 1, 1 };
+}
+
+QuickParseAlgorithm::QuickParseAlgorithm(const std::string* codeText, int tabSize, const Grammar* grammar) : Algorithm(nullptr, grammar)
+{
+	this->parseCacheEnabled = true;
+	this->parseAttemptStack = new std::vector<QuickParseAttempt>();
+	this->ruleAttemptDepthArray = new std::vector<int>();
+	this->memoTable = new std::vector<MemoEntry>();
+	this->sparseMemoMap = new std::unordered_map<uint64_t, MemoEntry>();
+	this->denseMemo = true;
+	this->lowestGuardDepth = INT_MAX;
+	this->maxParsePositionWithError = -1;
+	this->forgottenPosition = 0;
+	this->scanner = this->compiledGrammar->GetCharacterScanner(*this->error);
+	this->codeBuffer = codeText->c_str();
+	this->codeLength = (int)codeText->length();
+	this->tabSize = tabSize;
+	this->skipEndArray = new std::vector<int>();
+	this->lineStartArray = new std::vector<int>();
+	this->locationPosition = 0;
+	this->location = Lexer::FileLocation{ 1, 1 };
 }
 
 /*virtual*/ QuickParseAlgorithm::~QuickParseAlgorithm()
 {
 	delete this->parseAttemptStack;
+	delete this->ruleAttemptDepthArray;
+	delete this->skipEndArray;
+	delete this->lineStartArray;
 
 	this->ClearCache();
 
-	delete this->parseCacheMap;
+	delete this->memoTable;
+	delete this->sparseMemoMap;
 }
 
 void QuickParseAlgorithm::ClearCache()
 {
-	for (std::pair<QuickParseAttempt, QuickSyntaxNode*> pair : *this->parseCacheMap)
-		delete pair.second;
+	// Nodes that made it into a tree belong to that tree.  The rest are ours to delete.
+	for (MemoEntry& memoEntry : *this->memoTable)
+		if (memoEntry.state == MemoEntry::State::SUCCESS && memoEntry.available)
+			delete memoEntry.node;
+
+	for (std::pair<const uint64_t, MemoEntry>& pair : *this->sparseMemoMap)
+		if (pair.second.state == MemoEntry::State::SUCCESS && pair.second.available)
+			delete pair.second.node;
+
+	this->memoTable->clear();
+	this->sparseMemoMap->clear();
+}
+
+// This is for when we get past a cut.  Entries for attempts still in progress are kept, since they hold the seeds
+// of any left recursion, and we need them to finish.  Nodes that no tree has are deleted, but any remembered nodes
+// beneath them are let go of first, which makes those available if we're not forgetting about them too.
+void QuickParseAlgorithm::ForgetBefore(int parsePosition)
+{
+	if (!this->parseCacheEnabled || parsePosition <= this->forgottenPosition)
+		return;
+
+	std::vector<uint64_t> keepArray;
+	for (const QuickParseAttempt& attempt : *this->parseAttemptStack)
+		if (attempt.parsePosition < parsePosition)
+			keepArray.push_back((uint64_t(attempt.parsePosition) << 32) | uint32_t(attempt.ruleID));
+
+	std::sort(keepArray.begin(), keepArray.end());
+
+	std::vector<QuickSyntaxNode*> forgottenNodeArray;
+
+	if (this->denseMemo)
+	{
+		int ruleCount = this->compiledGrammar->GetRuleCount();
+		for (int position = this->forgottenPosition; position < parsePosition; position++)
+		{
+			for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+			{
+				MemoEntry& memoEntry = (*this->memoTable)[position * ruleCount + ruleID];
+				if (memoEntry.state == MemoEntry::State::UNKNOWN && !memoEntry.leftRecursive)
+					continue;
+
+				if (std::binary_search(keepArray.begin(), keepArray.end(), (uint64_t(position) << 32) | uint32_t(ruleID)))
+					continue;
+
+				if (memoEntry.state == MemoEntry::State::SUCCESS && memoEntry.available)
+					forgottenNodeArray.push_back(memoEntry.node);
+
+				memoEntry = MemoEntry{ MemoEntry::State::UNKNOWN, false, false, nullptr };
+			}
+		}
+	}
+	else
+	{
+		std::unordered_map<uint64_t, MemoEntry>::iterator iter = this->sparseMemoMap->begin();
+		while (iter != this->sparseMemoMap->end())
+		{
+			if (int(iter->first >> 32) >= parsePosition || std::binary_search(keepArray.begin(), keepArray.end(), iter->first))
+			{
+				iter++;
+				continue;
+			}
+
+			if (iter->second.state == MemoEntry::State::SUCCESS && iter->second.available)
+				forgottenNodeArray.push_back(iter->second.node);
+
+			iter = this->sparseMemoMap->erase(iter);
+		}
+	}
+
+	// Available nodes aren't part of any tree, so none of these is beneath another.
+	for (QuickSyntaxNode* node : forgottenNodeArray)
+	{
+		for (Parser::SyntaxNode* childNode : *node->childList)
+			this->ReleaseNode(childNode);
+
+		node->childList->clear();
+		delete node;
+	}
+
+	this->forgottenPosition = parsePosition;
+}
+
+QuickParseAlgorithm::MemoEntry* QuickParseAlgorithm::FindMemoEntry(int ruleID, int parsePosition)
+{
+	if (this->denseMemo)
+		return &(*this->memoTable)[parsePosition * this->compiledGrammar->GetRuleCount() + ruleID];
+
+	std::unordered_map<uint64_t, MemoEntry>::iterator iter = this->sparseMemoMap->find((uint64_t(parsePosition) << 32) | uint32_t(ruleID));
+	if (iter == this->sparseMemoMap->end())
+		return nullptr;
+
+	return &iter->second;
+}
+
+QuickParseAlgorithm::MemoEntry& QuickParseAlgorithm::GetMemoEntry(int ruleID, int parsePosition)
+{
+	if (this->denseMemo)
+		return (*this->memoTable)[parsePosition * this->compiledGrammar->GetRuleCount() + ruleID];
+
+	return (*this->sparseMemoMap)[(uint64_t(parsePosition) << 32) | uint32_t(ruleID)];
 }
 
 /*virtual*/ Parser::SyntaxNode* QuickParseAlgorithm::Parse()
 {
 	this->ClearCache();
 
-	const Grammar::Rule* rule = this->grammar->GetInitialRule();
-	if (!rule)
+	int ruleID = this->compiledGrammar->GetInitialRuleID();
+	if (ruleID < 0)
 		return nullptr;
 
+	// Without a scanner, a scannerless parse is a non-starter, and the error already says why.
+	if (!this->tokenArray && !this->scanner)
+		return nullptr;
+
+	if (this->scanner)
+	{
+		this->skipEndArray->assign(this->codeLength + 1, -1);
+
+		this->locationPosition = 0;
+		this->location = Lexer::FileLocation{ 1, 1 };
+
+		this->lineStartArray->clear();
+		this->lineStartArray->push_back(0);
+		for (const char* newline = (const char*)::memchr(this->codeBuffer, '\n', this->codeLength); newline; newline = (const char*)::memchr(newline + 1, '\n', this->codeBuffer + this->codeLength - newline - 1))
+			this->lineStartArray->push_back(int(newline - this->codeBuffer) + 1);
+	}
+
+	int64_t memoSize = int64_t(this->compiledGrammar->GetRuleCount()) * this->GetInputSize();
+	this->denseMemo = (memoSize <= (this->compiledGrammar->HasCuts() ? QUICK_PARSE_CUT_DENSE_MEMO_LIMIT : QUICK_PARSE_DENSE_MEMO_LIMIT));
+	if (this->denseMemo)
+		this->memoTable->assign((size_t)memoSize, MemoEntry{ MemoEntry::State::UNKNOWN, false, false, nullptr });
+
+	this->parseAttemptStack->clear();
+	this->ruleAttemptDepthArray->assign(this->compiledGrammar->GetRuleCount(), -1);
+	this->lowestGuardDepth = INT_MAX;
 	this->maxParsePositionWithError = -1;
+	this->forgottenPosition = 0;
 	int parsePosition = 0;
-	return this->MatchTokensAgainstRule(parsePosition, rule);
+	Parser::SyntaxNode* rootNode = this->MatchTokensAgainstRule(parsePosition, ruleID);
+
+	// Without a lexer, it's up to us to make sure that there's nothing left over, save for what we'd skip anyway.
+	if (rootNode && this->scanner && this->SkipFrom(parsePosition) < this->codeLength)
+	{
+		this->RecordError(parsePosition);
+		this->ReleaseNode(rootNode);
+		rootNode = nullptr;
+	}
+
+	return rootNode;
 }
 
-Parser::SyntaxNode* QuickParseAlgorithm::MatchTokensAgainstRule(int& parsePosition, const Grammar::Rule* rule)
+Parser::SyntaxNode* QuickParseAlgorithm::MatchTokensAgainstRule(int& parsePosition, int ruleID)
 {
-	if (parsePosition < 0 || parsePosition >= (signed)this->tokenArray->size())
+	if (parsePosition < 0 || parsePosition >= this->GetInputSize())
+	{
+		if (parsePosition == this->GetInputSize() && parsePosition > 0)
+			return this->MatchEndOfInput(ruleID);
+
 		return nullptr;
+	}
 
-	QuickParseAttempt parseAttempt{ *rule->name, parsePosition };
+	QuickParseAttempt parseAttempt{ ruleID, parsePosition };
 
 	// The parse cache is purely an optimization and is not needed for correctness of the algorithm.
 	if (this->parseCacheEnabled)
 	{
-		ParseCacheMap::iterator iter = this->parseCacheMap->find(parseAttempt);
-		if (iter != this->parseCacheMap->end())
-		{
-			QuickSyntaxNode* syntaxNode = iter->second;
-			this->parseCacheMap->erase(iter);
-			parsePosition += syntaxNode->parseSize;
-			return syntaxNode;
-		}
+		MemoEntry* memoEntry = this->FindMemoEntry(ruleID, parsePosition);
+		if (memoEntry && memoEntry->state == MemoEntry::State::FAILURE)
+			return nullptr;
+
+		if (memoEntry && memoEntry->state == MemoEntry::State::SUCCESS)
+			return this->TakeMemoNode(*memoEntry, parsePosition);
 	}
 
-	QuickSyntaxNode* parentNode = new QuickSyntaxNode();
-	*parentNode->text = *rule->name;
-	*parentNode->parseAttempt = parseAttempt;
-	parentNode->fileLocation = (*this->tokenArray)[parsePosition]->fileLocation;
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
 
+	// Don't bother descending into the rule if it can't possibly start with the current token.
+	if (!rule.nullable && !this->RuleCanStartAt(parsePosition, ruleID))
+	{
+		this->RecordError(parsePosition);
+		return nullptr;
+	}
+
+	int stackDepth = (int)this->parseAttemptStack->size();
 	this->parseAttemptStack->push_back(parseAttempt);
 
+	int outerAttemptDepth = (*this->ruleAttemptDepthArray)[ruleID];
+	(*this->ruleAttemptDepthArray)[ruleID] = stackDepth;
+
+	int outerLowestGuardDepth = this->lowestGuardDepth;
+	this->lowestGuardDepth = INT_MAX;
+
 	int initialParsePosition = parsePosition;
 
-	for (const Grammar::MatchSequence* matchSequence : *rule->matchSequenceArray)
+	QuickSyntaxNode* parentNode = this->MatchTokensAgainstSequences(parsePosition, ruleID);
+
+	// If one of the alternatives came back around to this very attempt, then the rule is left-recursive here,
+	// and what we just matched is only a seed.  So we feed the latest match back in as the result of the recursive
+	// attempt and match again, until the match stops getting longer.  This is the seed-growing technique of Warth
+	// et al., and it gives us left-associative trees for rules like "expression -> expression + term".
+	if (parentNode && this->parseCacheEnabled && this->GetMemoEntry(ruleID, initialParsePosition).leftRecursive)
 	{
-		int i;
-		for (i = 0; i < (signed)matchSequence->tokenSequence->size(); i++)
+		while (true)
 		{
-			const Grammar::Token* grammarToken = (*matchSequence->tokenSequence)[i];
+			this->GetMemoEntry(ruleID, initialParsePosition) = MemoEntry{ MemoEntry::State::SUCCESS, true, true, parentNode };
+
+			int grownParsePosition = initialParsePosition;
+			QuickSyntaxNode* grownNode = this->MatchTokensAgainstSequences(grownParsePosition, ruleID);
+			if (!grownNode || grownParsePosition <= parsePosition)
+			{
+				if (grownNode)
+					this->ReleaseNode(grownNode);
 
-			if (parsePosition >= (signed)this->tokenArray->size())
 				break;
+			}
 
-			const Lexer::Token* token = (*this->tokenArray)[parsePosition].get();
+			parentNode = grownNode;
+			parsePosition = grownParsePosition;
+		}
 
-			std::string ruleName;
-			bool tokenMatched = false;
+		this->GetMemoEntry(ruleID, initialParsePosition).available = false;
+	}
+
+	// Anything that came about because a recursion check ran into an attempt further up the stack depends on how
+	// that attempt is doing, and so could come out differently next time.  (These are the rules involved in some
+	// other rule's left recursion.)  Everything else is remembered.
+	bool dependsOnContext = this->lowestGuardDepth < stackDepth;
+
+	if (parentNode)
+	{
+		if (this->parseCacheEnabled)
+		{
+			if (dependsOnContext)
+				this->GetMemoEntry(ruleID, initialParsePosition) = MemoEntry{ MemoEntry::State::UNKNOWN, false, false, nullptr };
+			else
+				this->GetMemoEntry(ruleID, initialParsePosition) = MemoEntry{ MemoEntry::State::SUCCESS, false, false, parentNode };
+		}
+	}
+	else
+	{
+		this->RecordError(initialParsePosition);
+
+		if (this->parseCacheEnabled)
+			this->GetMemoEntry(ruleID, initialParsePosition) = MemoEntry{ dependsOnContext ? MemoEntry::State::UNKNOWN : MemoEntry::State::FAILURE, false, false, nullptr };
+	}
+
+	this->lowestGuardDepth = std::min(outerLowestGuardDepth, this->lowestGuardDepth);
+	(*this->ruleAttemptDepthArray)[ruleID] = outerAttemptDepth;
+	this->parseAttemptStack->pop_back();
+
+	return parentNode;
+}
+
+// Match the given symbol at the given position, adding what we match as a child of the given node.
+bool QuickParseAlgorithm::MatchSymbol(int& parsePosition, const CompiledGrammar::Symbol& symbol, QuickSyntaxNode* parentNode)
+{
+	// Only a spliced rule (an optimizer's tail, or a repetition) can match anything (that is, nothing) at the end of the input.
+	if (parsePosition >= this->GetInputSize() && !(symbol.type == CompiledGrammar::Symbol::Type::NON_TERMINAL && this->compiledGrammar->GetRule(symbol.id).spliced))
+		return false;
 
-			switch (grammarToken->Matches(*token, &ruleName))
+	switch (symbol.type)
+	{
+		case CompiledGrammar::Symbol::Type::TERMINAL:
+		{
+			if (this->scanner)
 			{
-				case Grammar::Token::MatchResult::YES:
+				int matchStart = this->SkipFrom(parsePosition);
+				int matchEnd = this->scanner->MatchTerminal(symbol.id, this->codeBuffer, this->codeLength, matchStart);
+				if (matchEnd < 0)
 				{
-					QuickSyntaxNode* childNode = new QuickSyntaxNode();
-					*childNode->text = *token->text;
-					childNode->fileLocation = token->fileLocation;
-					parentNode->childList->push_back(childNode);
-					childNode->parentNode = parentNode;
-					tokenMatched = true;
-					parsePosition++;
-					break;
+					this->RecordError(matchStart);
+					return false;
 				}
-				case Grammar::Token::MatchResult::MAYBE:
+
+				QuickSyntaxNode* childNode = new QuickSyntaxNode();
+				this->scanner->GetMatchText(symbol.id, this->codeBuffer, matchStart, matchEnd, *childNode->text);
+				childNode->fileLocation = this->GetFileLocation(matchStart);
+				parentNode->childList->push_back(childNode);
+				childNode->parentNode = parentNode;
+				parsePosition = matchEnd;
+				return true;
+			}
+
+			if (!this->TokenMatches(parsePosition, symbol.id))
+				return false;
+
+			const Lexer::Token* token = (*this->tokenArray)[parsePosition].get();
+			QuickSyntaxNode* childNode = new QuickSyntaxNode();
+			*childNode->text = *token->text;
+			childNode->fileLocation = token->fileLocation;
+			parentNode->childList->push_back(childNode);
+			childNode->parentNode = parentNode;
+			parsePosition++;
+			return true;
+		}
+		case CompiledGrammar::Symbol::Type::NON_TERMINAL:
+		{
+			// If we're already attempting to parse the rule at this position, then we'd infinitely recurse.  Instead, we
+			// let that attempt know that it's left-recursive, and go with whatever seed it has grown so far, if any.
+			Parser::SyntaxNode* childNode = nullptr;
+			int attemptDepth = 0;
+			if (!this->AlreadyAttemptingParse(QuickParseAttempt{ symbol.id, parsePosition }, attemptDepth))
+				childNode = this->MatchTokensAgainstRule(parsePosition, symbol.id);
+			else
+			{
+				this->lowestGuardDepth = std::min(this->lowestGuardDepth, attemptDepth);
+
+				if (this->parseCacheEnabled)
 				{
-					const Grammar::Rule* subRule = this->grammar->LookupRule(ruleName);
-
-					// If we're already attempting to parse the rule at this position, then we'll infinitely recurse.
-					if (subRule && !this->AlreadyAttemptingParse(QuickParseAttempt{ ruleName, parsePosition }))
-					{
-						Parser::SyntaxNode* childNode = this->MatchTokensAgainstRule(parsePosition, subRule);
-						if (childNode)
-						{
-							parentNode->childList->push_back(childNode);
-							childNode->parentNode = parentNode;
-							tokenMatched = true;
-						}
-					}
+					MemoEntry& memoEntry = this->GetMemoEntry(symbol.id, parsePosition);
+					memoEntry.leftRecursive = true;
+					if (memoEntry.state == MemoEntry::State::SUCCESS)
+						childNode = this->TakeMemoNode(memoEntry, parsePosition);
+				}
+			}
+
+			if (!childNode)
+				return false;
+
+			parentNode->childList->push_back(childNode);
+			childNode->parentNode = parentNode;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// A rule made for a repetition has the form "R -> X R | (nothing)", where X is one or more symbols, or, for an operator rule,
+// "R -> X R | Y R | ... | (nothing)".  Rather than recurse once per item, which for a long list would go very deep and leave a
+// node per item to splice, we match an item over and over, for as long as we can, and put all the items straight into the one
+// node.  Since R is spliced, it can match nothing.
+QuickSyntaxNode* QuickParseAlgorithm::MatchTokensAgainstRepetition(int& parsePosition, int ruleID)
+{
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	int lastSequence = rule.firstSequence + rule.sequenceCount - 1;		// This is the empty one.
 
+	QuickSyntaxNode* parentNode = new QuickSyntaxNode();
+	*parentNode->text = this->compiledGrammar->GetRuleName(ruleID);
+	*parentNode->parseAttempt = QuickParseAttempt{ ruleID, parsePosition };
+	parentNode->fileLocation = this->GetFileLocation(parsePosition);
+
+	int initialParsePosition = parsePosition;
+
+	while (parsePosition < this->GetInputSize())
+	{
+		int itemParsePosition = parsePosition;
+		size_t itemChildCount = parentNode->childList->size();
+		bool candidate = false;
+		bool matched = false;
+
+		for (int sequenceID = rule.firstSequence; sequenceID < lastSequence && !matched; sequenceID++)
+		{
+			const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+			if (!sequence.nullable && !this->SequenceCanStartAt(parsePosition, sequenceID))
+				continue;
+
+			candidate = true;
+
+			const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+			int bodySize = sequence.symbolCount - 1;
+
+			int i;
+			for (i = 0; i < bodySize; i++)
+				if (!this->MatchSymbol(parsePosition, symbolArray[i], parentNode))
 					break;
+
+			// An item that doesn't match in full, or that matches nothing, is no item.  What we did match of it isn't
+			// thrown away, though, in case it's wanted again.
+			matched = (i == bodySize && parsePosition > itemParsePosition);
+			if (!matched)
+			{
+				while (parentNode->childList->size() > itemChildCount)
+				{
+					this->ReleaseNode(parentNode->childList->back());
+					parentNode->childList->pop_back();
 				}
-                default:
-                {
-                    break;
-                }
+
+				parsePosition = itemParsePosition;
 			}
+		}
+
+		// This is where the list ends, which may or may not be where the parse goes wrong.
+		if (!candidate)
+			this->RecordError(parsePosition);
+
+		if (!matched)
+			break;
+	}
+
+	parentNode->parseSize = parsePosition - initialParsePosition;
+	return parentNode;
+}
+
+// Try each alternative of the given rule in turn, and return a node for the first one that matches in full.
+QuickSyntaxNode* QuickParseAlgorithm::MatchTokensAgainstSequences(int& parsePosition, int ruleID)
+{
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	if (rule.repeats)
+		return this->MatchTokensAgainstRepetition(parsePosition, ruleID);
+
+	QuickSyntaxNode* parentNode = new QuickSyntaxNode();
+	*parentNode->text = this->compiledGrammar->GetRuleName(ruleID);
+	*parentNode->parseAttempt = QuickParseAttempt{ ruleID, parsePosition };
+	parentNode->fileLocation = this->GetFileLocation(parsePosition);
+
+	int initialParsePosition = parsePosition;
+	bool matched = false;
 
-			if (!tokenMatched)
+	for (int j = 0; j < rule.sequenceCount; j++)
+	{
+		int sequenceID = rule.firstSequence + j;
+		const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+		const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
+		// Similarly, skip any alternative that can't start with the current token.
+		if (!sequence.nullable && !this->SequenceCanStartAt(parsePosition, sequenceID))
+			continue;
+
+		int i;
+		for (i = 0; i < sequence.symbolCount; i++)
+		{
+			if (i == sequence.cutSymbol)
+				this->ForgetBefore(parsePosition);
+
+			if (!this->MatchSymbol(parsePosition, symbolArray[i], parentNode))
 				break;
 		}
 
 		// Did we complete the match?
-		if (i == matchSequence->tokenSequence->size())
+		if (i == sequence.symbolCount)
+		{
+			if (i == sequence.cutSymbol)
+				this->ForgetBefore(parsePosition);
+
+			matched = true;
 			break;
+		}
 		else
 		{
 			// We didn't complete the match, but don't throw away any successful parsing that was performed if the cache is enabled.
-			if (this->parseCacheEnabled)
-			{
-				for (std::list<Parser::SyntaxNode*>::iterator iter = parentNode->childList->begin(); iter != parentNode->childList->end(); iter++)
-				{
-					QuickSyntaxNode* childNode = static_cast<QuickSyntaxNode*>(*iter);
-					if (childNode->parseAttempt->parsePosition >= 0)
-					{
-						*iter = nullptr;
-						assert(this->parseCacheMap->find(*childNode->parseAttempt) == this->parseCacheMap->end());
-						this->parseCacheMap->insert(std::pair<QuickParseAttempt, QuickSyntaxNode*>(*childNode->parseAttempt, childNode));
-					}
-				}
-			}
+			for (Parser::SyntaxNode* childNode : *parentNode->childList)
+				this->ReleaseNode(childNode);
 
-			parentNode->WipeChildren();
+			parentNode->childList->clear();
 			parsePosition = initialParsePosition;
+
+			// Once past a cut, the other alternatives are out of the running.
+			if (sequence.cutSymbol >= 0 && i >= sequence.cutSymbol)
+				break;
 		}
 	}
 
-	if (parentNode->childList->size() > 0)
+	// Empty matches don't count, except for spliced rules, which only ever stand in for what's left of their
+	// parent's alternatives (or for the optional items of a repetition), and there may be nothing left.
+	if (parentNode->childList->size() > 0 || (matched && rule.spliced))
 		parentNode->parseSize = parsePosition - initialParsePosition;
 	else
 	{
 		delete parentNode;
 		parentNode = nullptr;
+	}
+
+	return parentNode;
+}
+
+// Nothing can be matched past the end of the input, but a spliced rule can still match nothing there,
+// if one of its alternatives is empty.  There's no memo entry for the end of the input, so we don't remember it.
+QuickSyntaxNode* QuickParseAlgorithm::MatchEndOfInput(int ruleID)
+{
+	if (ruleID < 0 || ruleID >= this->compiledGrammar->GetRuleCount())
+		return nullptr;
+
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	if (!rule.spliced)
+		return nullptr;
 
-		if (this->maxParsePositionWithError < parsePosition)
+	for (int j = 0; j < rule.sequenceCount; j++)
+	{
+		if (this->compiledGrammar->GetSequence(rule.firstSequence + j).symbolCount == 0)
 		{
-			this->maxParsePositionWithError = parsePosition;
-			const Lexer::Token* token = (*this->tokenArray)[parsePosition].get();
-			*this->error = FormatString("Failed to parse at line %d, column %d.", token->fileLocation.line, token->fileLocation.column);
+			// A position of -1 keeps the node out of the memo when it's released.
+			QuickSyntaxNode* parentNode = new QuickSyntaxNode();
+			*parentNode->text = this->compiledGrammar->GetRuleName(ruleID);
+			*parentNode->parseAttempt = QuickParseAttempt{ ruleID, -1 };
+			parentNode->fileLocation = this->GetFileLocation(this->GetInputSize());
+			parentNode->parseSize = 0;
+			return parentNode;
 		}
 	}
 
-	this->parseAttemptStack->pop_back();
+	return nullptr;
+}
 
-	return parentNode;
+QuickSyntaxNode* QuickParseAlgorithm::TakeMemoNode(MemoEntry& memoEntry, int& parsePosition)
+{
+	QuickSyntaxNode* syntaxNode = memoEntry.available ? memoEntry.node : this->CloneNode(memoEntry.node);
+	memoEntry.available = false;
+	parsePosition += syntaxNode->parseSize;
+	return syntaxNode;
 }
 
-bool QuickParseAlgorithm::AlreadyAttemptingParse(const QuickParseAttempt& attempt) const
+void QuickParseAlgorithm::RecordError(int parsePosition)
 {
-	for (const QuickParseAttempt& existingAttempt : *this->parseAttemptStack)
-		if (existingAttempt.ruleName == attempt.ruleName && existingAttempt.parsePosition == attempt.parsePosition)
-			return true;
+	if (this->maxParsePositionWithError < parsePosition)
+	{
+		this->maxParsePositionWithError = parsePosition;
+		Lexer::FileLocation fileLocation = this->GetFileLocation(parsePosition);
+		*this->error = FormatString("Failed to parse at line %d, column %d.", fileLocation.line, fileLocation.column);
+	}
+}
 
-	return false;
+int QuickParseAlgorithm::SkipFrom(int parsePosition)
+{
+	int& skipEnd = (*this->skipEndArray)[parsePosition];
+	if (skipEnd < 0)
+		skipEnd = this->scanner->Skip(this->codeBuffer, this->codeLength, parsePosition);
+
+	return skipEnd;
+}
+
+// For tokens, this is where the token at the given position is, or where the last one is, at the end.  For text,
+// it's where the first thing not skipped from the given position is, counting columns the way the lexer does.
+// The parse mostly moves forward, so we count on from wherever we last were, going back to the start of the line
+// only when we have to.  That keeps all this linear in the length of the text, give or take some backtracking.
+Lexer::FileLocation QuickParseAlgorithm::GetFileLocation(int parsePosition)
+{
+	if (!this->scanner)
+		return (*this->tokenArray)[std::min(parsePosition, (int)this->tokenArray->size() - 1)]->fileLocation;
+
+	int position = this->SkipFrom(parsePosition);
+	if (position < this->locationPosition)
+	{
+		std::vector<int>::const_iterator iter = std::upper_bound(this->lineStartArray->begin(), this->lineStartArray->end(), position) - 1;
+		this->locationPosition = *iter;
+		this->location = Lexer::FileLocation{ int(iter - this->lineStartArray->begin()) + 1, 1 };
+	}
+
+	for (; this->locationPosition < position; this->locationPosition++)
+	{
+		char ch = this->codeBuffer[this->locationPosition];
+		if (ch == '\n')
+		{
+			this->location.line++;
+			this->location.column = 1;
+		}
+		else
+			this->location.column += (ch == '\t') ? this->tabSize : 1;
+	}
+
+	return this->location;
+}
+
+// Nothing we match ever takes us back to before where the rule we're matching it for started, so the positions of
+// the attempts on the stack only ever go up (or stay put) from the bottom to the top, and there's never the same attempt
+// on there twice, since that's just what we're checking for.  So if the rule is being attempted at the given position
+// at all, then that's its deepest attempt, and there's no need to look through the stack for it.
+bool QuickParseAlgorithm::AlreadyAttemptingParse(const QuickParseAttempt& attempt, int& stackDepth) const
+{
+	stackDepth = (*this->ruleAttemptDepthArray)[attempt.ruleID];
+	return stackDepth >= 0 && (*this->parseAttemptStack)[stackDepth].parsePosition == attempt.parsePosition;
+}
+
+// Let go of a node that some failed match no longer needs.  If it's the node we remembered for its rule
+// and position, then it goes back to being available.  Otherwise, it's deleted, but any remembered nodes
+// beneath it have to be rescued first.
+void QuickParseAlgorithm::ReleaseNode(Parser::SyntaxNode* node)
+{
+	QuickSyntaxNode* quickNode = static_cast<QuickSyntaxNode*>(node);
+
+	if (this->parseCacheEnabled && quickNode->parseAttempt->parsePosition >= 0)
+	{
+		MemoEntry* memoEntry = this->FindMemoEntry(quickNode->parseAttempt->ruleID, quickNode->parseAttempt->parsePosition);
+		if (memoEntry && memoEntry->state == MemoEntry::State::SUCCESS && memoEntry->node == quickNode)
+		{
+			memoEntry->available = true;
+			quickNode->parentNode = nullptr;
+			return;
+		}
+	}
+
+	for (Parser::SyntaxNode* childNode : *quickNode->childList)
+		this->ReleaseNode(childNode);
+
+	quickNode->childList->clear();
+	delete quickNode;
+}
+
+QuickSyntaxNode* QuickParseAlgorithm::CloneNode(const QuickSyntaxNode* node)
+{
+	QuickSyntaxNode* cloneNode = new QuickSyntaxNode();
+	*cloneNode->text = *node->text;
+	cloneNode->fileLocation = node->fileLocation;
+	*cloneNode->parseAttempt = *node->parseAttempt;
+	cloneNode->parseSize = node->parseSize;
+
+	for (const Parser::SyntaxNode* childNode : *node->childList)
+	{
+		QuickSyntaxNode* cloneChildNode = this->CloneNode(static_cast<const QuickSyntaxNode*>(childNode));
+		cloneNode->childList->push_back(cloneChildNode);
+		cloneChildNode->parentNode = cloneNode;
+	}
+
+	return cloneNode;
 }
 
 //------------------------------- QuickSyntaxNode -------------------------------
@@ -1,17 +1,16 @@
 #pragma once
 
 #include "Parser.h"
+#include "CharacterScanner.h"
 
 namespace ParseParty
 {
 	struct QuickParseAttempt
 	{
-		std::string ruleName;
+		int ruleID;
 		int parsePosition;
 	};
 
-	bool operator<(const QuickParseAttempt& attemptA, const QuickParseAttempt& attemptB);
-
 	class QuickSyntaxNode : public Parser::SyntaxNode
 	{
 	public:
@@ -23,32 +22,117 @@ namespace ParseParty
 	};
 
 	// The goal here is to provide an algorithm that, for some grammars, parses in linear time.
-	// For other grammars, performance should be reasonably improved through the use of something
-	// close to the concept of memoization.  Memory copies should be minimally performed, if not
-	// eliminated altogether.  Any successfully parsed sub-region of the token array should get
-	// cached for potential re-use if it is to be discarded during the parsing process.  Note that
-	// some grammars fail to parse or fail to parse correctly, but that does not mean there doesn't
-	// exist some other grammar generating the same language that will correctly parse using this
-	// parsing algorithm!  Also note that there is no restriction here that there be no two adjacent
-	// non-terminal tokens in the given grammar.
+	// For other grammars, performance should be reasonably improved through memoization; every
+	// rule we try at every position has its outcome recorded, success or failure, packrat style.
+	// Memory copies should be minimally performed, if not eliminated altogether.  Any successfully
+	// parsed sub-region of the token array should get cached for potential re-use if it is to be
+	// discarded during the parsing process.  Note that some grammars fail to parse or fail to parse
+	// correctly, but that does not mean there doesn't exist some other grammar generating the same
+	// language that will correctly parse using this parsing algorithm!  Also note that there is no
+	// restriction here that there be no two adjacent non-terminal tokens in the given grammar, and
+	// that left-recursive rules, direct or indirect, are fine too.
+	//
+	// This is also the scannerless algorithm, when given text instead of tokens.  Then positions are byte offsets into
+	// the text, and terminals are matched right against it by the grammar's CharacterScanner, skipping whatever the
+	// grammar says to skip before each one.  Nothing is tokenized, so there's no token array to build, and no tokens
+	// to allocate, which for short inputs is most of the work.  Unlike with tokens, the whole text has to be matched.
+	//
+	// Ordinarily, the memo holds on to everything it learns until the parse is done, so its memory grows with the input.
+	// When an alternative with a cut in it gets past the cut, though, we take the grammar's word for it that we'll never
+	// backtrack to before there, and forget everything we knew about the input up to that point, deleting any nodes
+	// no tree wanted.  So a long list of statements, each ending with a cut, is parsed with a memo no bigger than
+	// the biggest statement needs.  (Except for what the attempts still in progress need to keep, that is, and the dense
+	// memo table, which is allocated up-front, but which is only ever used when it's reasonably small.)  If the grammar is
+	// wrong about that, we'll just have to work some things out again.
 	class QuickParseAlgorithm : public Parser::Algorithm
 	{
 	public:
 		QuickParseAlgorithm(const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray, const Grammar* grammar);
+		QuickParseAlgorithm(const std::string* codeText, int tabSize, const Grammar* grammar);
 		virtual ~QuickParseAlgorithm();
 
 		virtual Parser::SyntaxNode* Parse() override;
 
-		Parser::SyntaxNode* MatchTokensAgainstRule(int& parsePosition, const Grammar::Rule* rule);
-		bool AlreadyAttemptingParse(const QuickParseAttempt& attempt) const;
+		Parser::SyntaxNode* MatchTokensAgainstRule(int& parsePosition, int ruleID);
+		bool AlreadyAttemptingParse(const QuickParseAttempt& attempt, int& stackDepth) const;
+		void RecordError(int parsePosition);
 		void ClearCache();
+		void ForgetBefore(int parsePosition);
 
 	private:
 
-		std::list<QuickParseAttempt>* parseAttemptStack;
-		typedef std::map<QuickParseAttempt, QuickSyntaxNode*> ParseCacheMap;
-		ParseCacheMap* parseCacheMap;
+		// This is what we know about matching a given rule at a given position.  A successful match
+		// is kept as the node we built for it, which we hand out as is if no tree has claimed it yet,
+		// or otherwise copy.  Tokens are never rematched either way.  While the rule is being matched
+		// at the position, a success here is the seed of a left-recursive match.
+		struct MemoEntry
+		{
+			enum class State : uint8_t
+			{
+				UNKNOWN,
+				SUCCESS,
+				FAILURE
+			};
+
+			State state;
+			bool available;		// True if the node isn't part of any tree.
+			bool leftRecursive;		// Set while the attempt is in progress if it turns out to depend on itself.
+			QuickSyntaxNode* node;
+		};
+
+		QuickSyntaxNode* MatchTokensAgainstSequences(int& parsePosition, int ruleID);
+		QuickSyntaxNode* MatchTokensAgainstRepetition(int& parsePosition, int ruleID);
+		bool MatchSymbol(int& parsePosition, const CompiledGrammar::Symbol& symbol, QuickSyntaxNode* parentNode);
+		QuickSyntaxNode* MatchEndOfInput(int ruleID);
+		QuickSyntaxNode* TakeMemoNode(MemoEntry& memoEntry, int& parsePosition);
+		MemoEntry* FindMemoEntry(int ruleID, int parsePosition);
+		MemoEntry& GetMemoEntry(int ruleID, int parsePosition);
+		void ReleaseNode(Parser::SyntaxNode* node);
+		QuickSyntaxNode* CloneNode(const QuickSyntaxNode* node);
+		int SkipFrom(int parsePosition);
+		Lexer::FileLocation GetFileLocation(int parsePosition);
+
+		int GetInputSize() const
+		{
+			return this->scanner ? this->codeLength : (int)this->tokenArray->size();
+		}
+
+		bool RuleCanStartAt(int parsePosition, int ruleID)
+		{
+			if (!this->scanner)
+				return this->TokenInSet(parsePosition, this->compiledGrammar->GetFirstSet(ruleID));
+
+			int position = this->SkipFrom(parsePosition);
+			return position < this->codeLength && this->scanner->RuleCanStartWith(ruleID, (uint8_t)this->codeBuffer[position]);
+		}
+
+		bool SequenceCanStartAt(int parsePosition, int sequenceID)
+		{
+			if (!this->scanner)
+				return this->TokenInSet(parsePosition, this->compiledGrammar->GetSequenceFirstSet(sequenceID));
+
+			int position = this->SkipFrom(parsePosition);
+			return position < this->codeLength && this->scanner->SequenceCanStartWith(sequenceID, (uint8_t)this->codeBuffer[position]);
+		}
+
+		std::vector<QuickParseAttempt>* parseAttemptStack;
+		std::vector<int>* ruleAttemptDepthArray;		// For each rule, the stack depth of its deepest attempt in progress, or -1 if there's none.
+		std::vector<MemoEntry>* memoTable;		// Index this by position times rule count plus rule ID.
+		std::unordered_map<uint64_t, MemoEntry>* sparseMemoMap;		// Used instead of the table when the table would be too big.
+		bool denseMemo;
 		bool parseCacheEnabled;
+		int lowestGuardDepth;		// The shallowest stack depth of an attempt that a recursion check has refused since we last looked.
 		int maxParsePositionWithError;
+		int forgottenPosition;		// The memo has nothing for positions before this, but for the attempts that were in progress.
+
+		// These are only for scannerless parsing.
+		const CharacterScanner* scanner;
+		const char* codeBuffer;
+		int codeLength;
+		int tabSize;
+		std::vector<int>* skipEndArray;		// Where skipping from each position gets us, or -1 if we haven't looked yet.
+		std::vector<int>* lineStartArray;
+		int locationPosition;		// This is where we last worked out the file location for, and that location.
+		Lexer::FileLocation location;
 	};
 }
\ No newline at end of file
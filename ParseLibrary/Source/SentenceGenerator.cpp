@@ -0,0 +1,542 @@
+#include "SentenceGenerator.h"
+#include "CharacterScanner.h"
+
+using namespace ParseParty;
+
+// Lines are broken at the first gap past this many characters.
+#define SENTENCE_GENERATOR_LINE_LENGTH		100
+
+//------------------------------- SentenceGenerator -------------------------------
+
+SentenceGenerator::SentenceGenerator()
+{
+	this->targetSize = 1000;
+	this->maxDepth = 16;
+	this->maxBreadth = 8;
+	this->seed = 0;
+	this->ruleWeightMap = new std::map<std::string, double>();
+	this->compiledGrammar = nullptr;
+	this->ownCompiledGrammar = new CompiledGrammar();
+	this->scanner = nullptr;
+	this->random = new std::mt19937_64();
+	this->ruleHeightArray = new std::vector<int>();
+	this->sequenceHeightArray = new std::vector<int>();
+	this->sequenceSizeArray = new std::vector<int>();
+	this->sequenceWeightArray = new std::vector<double>();
+	this->sequenceRecursionArray = new std::vector<Recursion>();
+	this->sequenceGrowsArray = new std::vector<uint8_t>();
+	this->reservedWordSet = new std::set<std::string>();
+	this->codeText = nullptr;
+	this->terminalCount = 0;
+	this->lineLength = 0;
+	this->breakLines = true;
+	this->separator = " ";
+}
+
+/*virtual*/ SentenceGenerator::~SentenceGenerator()
+{
+	delete this->ruleWeightMap;
+	delete this->ownCompiledGrammar;
+	delete this->random;
+	delete this->ruleHeightArray;
+	delete this->sequenceHeightArray;
+	delete this->sequenceSizeArray;
+	delete this->sequenceWeightArray;
+	delete this->sequenceRecursionArray;
+	delete this->sequenceGrowsArray;
+	delete this->reservedWordSet;
+}
+
+bool SentenceGenerator::GenerateFile(const Grammar* grammar, const Lexer* lexer, const std::string& codeFile, std::string& error)
+{
+	std::string codeText;
+	if (!this->Generate(grammar, lexer, codeText, error))
+		return false;
+
+	std::ofstream outputStream(codeFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!outputStream.is_open())
+	{
+		error = "Failed to open file for writing: " + codeFile;
+		return false;
+	}
+
+	outputStream << codeText;
+	if (!outputStream.good())
+	{
+		error = "Failed to write file: " + codeFile;
+		return false;
+	}
+
+	return true;
+}
+
+bool SentenceGenerator::Generate(const Grammar* grammar, const Lexer* lexer, std::string& codeText, std::string& error)
+{
+	codeText = "";
+
+	if (!this->Prepare(grammar, lexer, error))
+		return false;
+
+	this->random->seed(this->seed);
+	this->codeText = &codeText;
+	this->terminalCount = 0;
+	this->lineLength = 0;
+
+	this->GenerateRule(this->compiledGrammar->GetInitialRuleID(), 0, true);
+
+	codeText += "\n";
+	this->codeText = nullptr;
+	return true;
+}
+
+bool SentenceGenerator::Prepare(const Grammar* grammar, const Lexer* lexer, std::string& error)
+{
+	// A grammar read from a bundle has only its compiled form, which may well be optimized, but it's all we've got.
+	if (grammar->ruleMap->size() == 0)
+		this->compiledGrammar = grammar->GetCompiledGrammar();
+	else
+	{
+		if (!this->ownCompiledGrammar->Compile(grammar, error))
+			return false;
+
+		this->compiledGrammar = this->ownCompiledGrammar;
+	}
+
+	if (this->compiledGrammar->GetInitialRuleID() < 0)
+	{
+		error = "The grammar has no initial rule.";
+		return false;
+	}
+
+	if (this->targetSize < 0 || this->maxDepth < 0 || this->maxBreadth < 0)
+	{
+		error = "The size, depth and breadth can't be negative.";
+		return false;
+	}
+
+	this->scanner = nullptr;
+	this->separator = " ";
+	this->breakLines = true;
+	if (*grammar->algorithmName == "scannerless")
+	{
+		this->scanner = this->compiledGrammar->GetCharacterScanner(error);
+		if (!this->scanner)
+			return false;
+
+		// We can only space things out if the grammar skips spaces; otherwise, it'll just have to take them as they come.
+		if (this->scanner->Skip(" ", 1, 0) != 1)
+			this->separator = "";
+
+		this->breakLines = (this->scanner->Skip("\n", 1, 0) == 1);
+	}
+
+	this->reservedWordSet->clear();
+	for (int terminalID = 0; terminalID < this->compiledGrammar->GetTerminalCount(); terminalID++)
+		if (this->compiledGrammar->GetTerminal(terminalID).matchClass == CompiledGrammar::Terminal::Class::LITERAL)
+			this->reservedWordSet->insert(this->compiledGrammar->GetTerminalText(terminalID));
+
+	if (lexer)
+	{
+		for (const Lexer::TokenGenerator* tokenGenerator : *lexer->tokenGeneratorList)
+		{
+			const Lexer::IdentifierTokenGenerator* identifierTokenGenerator = dynamic_cast<const Lexer::IdentifierTokenGenerator*>(tokenGenerator);
+			if (identifierTokenGenerator)
+				for (const std::string& keyword : *identifierTokenGenerator->keywordSet)
+					this->reservedWordSet->insert(keyword);
+		}
+	}
+
+	std::vector<double> ruleWeightArray(this->compiledGrammar->GetRuleCount(), 1.0);
+	for (const std::pair<const std::string, double>& pair : *this->ruleWeightMap)
+	{
+		int ruleID = this->compiledGrammar->FindRule(pair.first);
+		if (ruleID < 0)
+		{
+			error = FormatString("There's no rule \"%s\" to give a weight to.", pair.first.c_str());
+			return false;
+		}
+
+		if (pair.second < 0.0)
+		{
+			error = FormatString("The weight of rule \"%s\" is negative.", pair.first.c_str());
+			return false;
+		}
+
+		ruleWeightArray[ruleID] = pair.second;
+	}
+
+	int ruleCount = this->compiledGrammar->GetRuleCount();
+	int sequenceCount = this->compiledGrammar->GetSequenceCount();
+
+	this->sequenceWeightArray->assign(sequenceCount, 1.0);
+	this->sequenceRecursionArray->assign(sequenceCount, Recursion::NONE);
+	for (int sequenceID = 0; sequenceID < sequenceCount; sequenceID++)
+	{
+		const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+		const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
+		for (int i = 0; i < sequence.symbolCount; i++)
+			if (symbolArray[i].type == CompiledGrammar::Symbol::Type::NON_TERMINAL)
+				(*this->sequenceWeightArray)[sequenceID] *= ruleWeightArray[symbolArray[i].id];
+
+		if (sequence.symbolCount > 0 && symbolArray[0].type == CompiledGrammar::Symbol::Type::NON_TERMINAL && symbolArray[0].id == sequence.ruleID)
+			(*this->sequenceRecursionArray)[sequenceID] = Recursion::LEFT;
+		else if (sequence.symbolCount > 0 && symbolArray[sequence.symbolCount - 1].type == CompiledGrammar::Symbol::Type::NON_TERMINAL && symbolArray[sequence.symbolCount - 1].id == sequence.ruleID)
+			(*this->sequenceRecursionArray)[sequenceID] = Recursion::RIGHT;
+	}
+
+	// The heights and sizes are the least fixed-point of the obvious equations, like nullability.  Choosing the lowest
+	// alternative every time is sure to finish, since the height goes down with every step; the size just breaks ties.
+	this->ruleHeightArray->assign(ruleCount, INT_MAX);
+	this->sequenceHeightArray->assign(sequenceCount, INT_MAX);
+	this->sequenceSizeArray->assign(sequenceCount, INT_MAX);
+	std::vector<int> ruleSizeArray(ruleCount, INT_MAX);
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (int sequenceID = 0; sequenceID < sequenceCount; sequenceID++)
+		{
+			const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+			const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
+			int height = 1;
+			int64_t size = 0;
+			for (int i = 0; i < sequence.symbolCount && height != INT_MAX; i++)
+			{
+				if (symbolArray[i].type == CompiledGrammar::Symbol::Type::TERMINAL)
+					size++;
+				else if ((*this->ruleHeightArray)[symbolArray[i].id] == INT_MAX)
+					height = INT_MAX;
+				else
+				{
+					height = std::max(height, (*this->ruleHeightArray)[symbolArray[i].id] + 1);
+					size += ruleSizeArray[symbolArray[i].id];
+				}
+			}
+
+			if (height == INT_MAX)
+				continue;
+
+			int clampedSize = (int)std::min(size, int64_t(INT_MAX - 1));
+			if (height < (*this->sequenceHeightArray)[sequenceID] || clampedSize < (*this->sequenceSizeArray)[sequenceID])
+			{
+				(*this->sequenceHeightArray)[sequenceID] = std::min(height, (*this->sequenceHeightArray)[sequenceID]);
+				(*this->sequenceSizeArray)[sequenceID] = std::min(clampedSize, (*this->sequenceSizeArray)[sequenceID]);
+				changed = true;
+			}
+
+			int ruleID = sequence.ruleID;
+			if (height < (*this->ruleHeightArray)[ruleID])
+			{
+				(*this->ruleHeightArray)[ruleID] = height;
+				changed = true;
+			}
+
+			if (clampedSize < ruleSizeArray[ruleID])
+			{
+				ruleSizeArray[ruleID] = clampedSize;
+				changed = true;
+			}
+		}
+	}
+
+	// An alternative can grow if it's a list, or if it names a rule that's a list or has an alternative that can grow.
+	std::vector<uint8_t> ruleGrowsArray(ruleCount, 0);
+	this->sequenceGrowsArray->assign(sequenceCount, 0);
+	changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (int sequenceID = 0; sequenceID < sequenceCount; sequenceID++)
+		{
+			const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+			const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+			if ((*this->sequenceGrowsArray)[sequenceID] || (*this->sequenceHeightArray)[sequenceID] == INT_MAX)
+				continue;
+
+			bool grows = ((*this->sequenceRecursionArray)[sequenceID] != Recursion::NONE);
+			for (int i = 0; i < sequence.symbolCount && !grows; i++)
+				if (symbolArray[i].type == CompiledGrammar::Symbol::Type::NON_TERMINAL && (ruleGrowsArray[symbolArray[i].id] || this->compiledGrammar->GetRule(symbolArray[i].id).repeats))
+					grows = true;
+
+			if (grows)
+			{
+				(*this->sequenceGrowsArray)[sequenceID] = 1;
+				ruleGrowsArray[sequence.ruleID] = 1;
+				changed = true;
+			}
+		}
+	}
+
+	int initialRuleID = this->compiledGrammar->GetInitialRuleID();
+	if ((*this->ruleHeightArray)[initialRuleID] == INT_MAX)
+	{
+		error = FormatString("The initial rule \"%s\" never gets down to just terminals, so nothing can be generated for it.", this->compiledGrammar->GetRuleName(initialRuleID));
+		return false;
+	}
+
+	return true;
+}
+
+// Pick an alternative of the given rule with the given kind of recursion (with NONE also meaning RIGHT, if we're not wrapping up),
+// and one that can grow, if asked.  This returns -1 if there's none to pick, or if we're not wrapping up and they all have a weight of zero.
+int SentenceGenerator::ChooseSequence(int ruleID, Recursion recursion, bool wrapUp, bool grow /*= false*/)
+{
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+
+	int chosenSequenceID = -1;
+	double totalWeight = 0.0;
+
+	for (int sequenceID = rule.firstSequence; sequenceID < rule.firstSequence + rule.sequenceCount; sequenceID++)
+	{
+		Recursion sequenceRecursion = (*this->sequenceRecursionArray)[sequenceID];
+		if ((*this->sequenceHeightArray)[sequenceID] == INT_MAX)
+			continue;
+
+		if (wrapUp)
+		{
+			if (sequenceRecursion != Recursion::LEFT)
+			{
+				if (chosenSequenceID < 0 ||
+					(*this->sequenceHeightArray)[sequenceID] < (*this->sequenceHeightArray)[chosenSequenceID] ||
+					((*this->sequenceHeightArray)[sequenceID] == (*this->sequenceHeightArray)[chosenSequenceID] && (*this->sequenceSizeArray)[sequenceID] < (*this->sequenceSizeArray)[chosenSequenceID]))
+				{
+					chosenSequenceID = sequenceID;
+				}
+			}
+
+			continue;
+		}
+
+		if (sequenceRecursion != recursion && !(recursion == Recursion::NONE && sequenceRecursion == Recursion::RIGHT))
+			continue;
+
+		if (grow && !(*this->sequenceGrowsArray)[sequenceID])
+			continue;
+
+		// This is the usual way of picking from a stream by weight, with each pick replacing the last with the right odds.
+		double weight = (*this->sequenceWeightArray)[sequenceID];
+		if (weight <= 0.0)
+			continue;
+
+		totalWeight += weight;
+		double fraction = double((*this->random)() >> 11) * (1.0 / 9007199254740992.0);
+		if (fraction * totalWeight < weight)
+			chosenSequenceID = sequenceID;
+	}
+
+	return chosenSequenceID;
+}
+
+// Lists are made with loops, rather than by recursing, so that lists at the top can be as long as it takes without
+// going any deeper.  A rule coming back around to itself at the end of an alternative, "R -> X R | Y", makes X X ... Y,
+// and one starting with itself, "R -> R X | Y", makes Y X X ....  Items of a list are at the depth of the list.
+void SentenceGenerator::GenerateRule(int ruleID, int depth, bool top)
+{
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+
+	if (rule.repeats)
+	{
+		// The last alternative is the empty one, and the others end with the rule itself.
+		int itemCount = top ? INT_MAX : this->RandomInt(this->maxBreadth + 1);
+		for (int i = 0; i < itemCount && !this->WrappingUp(depth); i++)
+		{
+			int sequenceID = this->ChooseSequence(ruleID, Recursion::RIGHT, false);
+			if (sequenceID < 0)
+				break;
+
+			int terminalCount = this->terminalCount;
+			const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+			this->GenerateSymbols(sequence, 0, sequence.symbolCount - 1, depth, false);
+			if (this->terminalCount == terminalCount)
+				break;
+		}
+
+		return;
+	}
+
+	int itemCount = 0;
+	bool stuck = false;
+	while (true)
+	{
+		bool wrapUp = this->WrappingUp(depth) || (!top && itemCount >= this->maxBreadth) || stuck;
+
+		// At the top, we keep the list going for as long as we can, or head for one if this isn't it.
+		int sequenceID = -1;
+		if (top && !wrapUp)
+		{
+			sequenceID = this->ChooseSequence(ruleID, Recursion::RIGHT, false);
+			if (sequenceID < 0)
+				sequenceID = this->ChooseSequence(ruleID, Recursion::NONE, false, true);
+		}
+
+		if (sequenceID < 0)
+			sequenceID = this->ChooseSequence(ruleID, Recursion::NONE, wrapUp);
+
+		if (sequenceID < 0)
+			sequenceID = this->ChooseSequence(ruleID, Recursion::NONE, true);
+
+		if (sequenceID < 0)
+			return;
+
+		const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+		if ((*this->sequenceRecursionArray)[sequenceID] != Recursion::RIGHT)
+		{
+			this->GenerateSymbols(sequence, 0, sequence.symbolCount, depth, top);
+			break;
+		}
+
+		// An item with nothing in it would have us going around in circles.
+		int terminalCount = this->terminalCount;
+		this->GenerateSymbols(sequence, 0, sequence.symbolCount - 1, depth, false);
+		stuck = (this->terminalCount == terminalCount);
+		itemCount++;
+	}
+
+	int leftItemCount = top ? INT_MAX : this->RandomInt(this->maxBreadth + 1);
+	for (int i = 0; i < leftItemCount && !this->WrappingUp(depth); i++)
+	{
+		int sequenceID = this->ChooseSequence(ruleID, Recursion::LEFT, false);
+		if (sequenceID < 0)
+			break;
+
+		int terminalCount = this->terminalCount;
+		const CompiledGrammar::Sequence& sequence = this->compiledGrammar->GetSequence(sequenceID);
+		this->GenerateSymbols(sequence, 1, sequence.symbolCount, depth, false);
+		if (this->terminalCount == terminalCount)
+			break;
+	}
+}
+
+// Spliced rules (repetitions, and the tails made by the optimizer) are really part of the rule using them, so they don't go any deeper.
+// At the top, just one of the symbols gets to carry on with the top list, preferably one of our own repetitions.
+void SentenceGenerator::GenerateSymbols(const CompiledGrammar::Sequence& sequence, int firstSymbol, int lastSymbol, int depth, bool top)
+{
+	const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
+	int topSymbol = -1;
+	for (int pass = 0; pass < 2 && top && topSymbol < 0; pass++)
+	{
+		for (int i = firstSymbol; i < lastSymbol && topSymbol < 0; i++)
+		{
+			if (symbolArray[i].type != CompiledGrammar::Symbol::Type::NON_TERMINAL)
+				continue;
+
+			const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(symbolArray[i].id);
+			if (pass == 0 && !rule.spliced)
+				continue;
+
+			for (int sequenceID = rule.firstSequence; sequenceID < rule.firstSequence + rule.sequenceCount && topSymbol < 0; sequenceID++)
+				if (rule.repeats || (*this->sequenceGrowsArray)[sequenceID])
+					topSymbol = i;
+		}
+	}
+
+	for (int i = firstSymbol; i < lastSymbol; i++)
+	{
+		const CompiledGrammar::Symbol& symbol = symbolArray[i];
+		if (symbol.type == CompiledGrammar::Symbol::Type::TERMINAL)
+			this->GenerateTerminal(symbol.id);
+		else if (this->compiledGrammar->GetRule(symbol.id).spliced)
+			this->GenerateRule(symbol.id, depth, i == topSymbol);
+		else
+			this->GenerateRule(symbol.id, depth + 1, i == topSymbol);
+	}
+}
+
+void SentenceGenerator::GenerateTerminal(int terminalID)
+{
+	std::string text;
+
+	switch (this->compiledGrammar->GetTerminal(terminalID).matchClass)
+	{
+		case CompiledGrammar::Terminal::Class::LITERAL:
+		{
+			text = this->compiledGrammar->GetTerminalText(terminalID);
+			break;
+		}
+		case CompiledGrammar::Terminal::Class::IDENTIFIER:
+		{
+			this->GenerateName(text);
+			break;
+		}
+		case CompiledGrammar::Terminal::Class::STRING:
+		{
+			// Nothing that would need escaping.
+			std::string word;
+			int wordCount = 1 + this->RandomInt(3);
+			text = "\"";
+			for (int i = 0; i < wordCount; i++)
+			{
+				this->GenerateName(word);
+				text += (i > 0) ? " " + word : word;
+			}
+
+			text += "\"";
+			break;
+		}
+		case CompiledGrammar::Terminal::Class::NUMBER:
+		case CompiledGrammar::Terminal::Class::INT:
+		case CompiledGrammar::Terminal::Class::FLOAT:
+		{
+			CompiledGrammar::Terminal::Class matchClass = this->compiledGrammar->GetTerminal(terminalID).matchClass;
+			text = std::to_string(this->RandomInt(1000));
+			if (matchClass == CompiledGrammar::Terminal::Class::FLOAT || (matchClass == CompiledGrammar::Terminal::Class::NUMBER && this->RandomInt(2) == 0))
+				text += "." + std::to_string(this->RandomInt(100));
+
+			break;
+		}
+		case CompiledGrammar::Terminal::Class::PATTERN:
+		{
+			if (this->scanner)
+				this->scanner->GetPattern(terminalID)->Generate(*this->random, text);
+
+			break;
+		}
+	}
+
+	this->Write(text);
+	this->terminalCount++;
+}
+
+// Names are a few letters and maybe a digit or two, and never a keyword.
+void SentenceGenerator::GenerateName(std::string& name)
+{
+	static const char* letters = "abcdefghijklmnopqrstuvwxyz";
+
+	do
+	{
+		name = "";
+
+		int letterCount = 1 + this->RandomInt(8);
+		for (int i = 0; i < letterCount; i++)
+			name += letters[this->RandomInt(26)];
+
+		if (this->RandomInt(4) == 0)
+			name += std::to_string(this->RandomInt(100));
+	} while (this->reservedWordSet->find(name) != this->reservedWordSet->end());
+}
+
+void SentenceGenerator::Write(const std::string& text)
+{
+	if (this->lineLength > 0)
+	{
+		if (this->breakLines && this->lineLength >= SENTENCE_GENERATOR_LINE_LENGTH)
+		{
+			*this->codeText += "\n";
+			this->lineLength = 0;
+		}
+		else
+		{
+			*this->codeText += this->separator;
+			this->lineLength++;
+		}
+	}
+
+	*this->codeText += text;
+	this->lineLength += (int)text.length();
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Parser.h"
+
+namespace ParseParty
+{
+	class CharacterScanner;
+
+	// This makes up random code in the language of a grammar, for benchmarking and scale-testing the parse algorithms
+	// on inputs as big as we like, without needing anyone's real code.  Starting from the initial rule, each rule is
+	// expanded by picking one of its alternatives at random, and each terminal is written out as its literal text, or
+	// as some made-up text of its class (an identifier, a number, a string, or something matching its pattern.)  Terminals
+	// are separated by spaces, with a line break now and then, so the lexer (or the scanner) won't run them together.
+	//
+	// How big the code gets is controlled by a few knobs...
+	//
+	//		targetSize		Roughly how many terminals to write.  The list at the top of the tree (the first one we can get to from the
+	//						initial rule) goes on for as long as it takes to get there.  Elsewhere, once we get there, we wrap up as
+	//						quickly as we can.
+	//		maxDepth		How deeply rules get nested before we start wrapping up.
+	//		maxBreadth		The most items a list gets, other than those at the top.  Lists are repetitions (e.g., "statement*"), and also
+	//						rules that come back around to themselves at the start or end of an alternative (e.g., "list -> item , list".)
+	//		seed			The same seed always gives the same code for the same grammar.
+	//
+	// Wrapping up means always picking the alternative that can finish the soonest.  Rules can also be given weights, which
+	// make the alternatives naming them more (or less) likely to be picked; an alternative's weight is the product of the
+	// weights of the rules it names, and a weight of zero means only to go there if there's no other way to finish.
+	//
+	// The code is in the grammar's language, but note that the first-match-wins algorithms (e.g., the quick one) don't
+	// always parse everything in that language, since they commit to the first alternative that matches.
+	class PARSE_PARTY_API SentenceGenerator
+	{
+	public:
+		SentenceGenerator();
+		virtual ~SentenceGenerator();
+
+		// The lexer is only needed so that no identifier we make up is one of its keywords.  It can be null.
+		bool Generate(const Grammar* grammar, const Lexer* lexer, std::string& codeText, std::string& error);
+		bool GenerateFile(const Grammar* grammar, const Lexer* lexer, const std::string& codeFile, std::string& error);
+
+		int targetSize;
+		int maxDepth;
+		int maxBreadth;
+		uint64_t seed;
+		std::map<std::string, double>* ruleWeightMap;
+
+	private:
+
+		enum class Recursion : uint8_t
+		{
+			NONE,
+			LEFT,		// The alternative starts with its own rule.
+			RIGHT		// The alternative ends with its own rule (and doesn't start with it.)
+		};
+
+		bool Prepare(const Grammar* grammar, const Lexer* lexer, std::string& error);
+		void GenerateRule(int ruleID, int depth, bool top);
+		void GenerateSymbols(const CompiledGrammar::Sequence& sequence, int firstSymbol, int lastSymbol, int depth, bool top);
+		void GenerateTerminal(int terminalID);
+		void GenerateName(std::string& name);
+		void Write(const std::string& text);
+		int ChooseSequence(int ruleID, Recursion recursion, bool wrapUp, bool grow = false);
+
+		bool WrappingUp(int depth) const
+		{
+			return depth >= this->maxDepth || this->terminalCount >= this->targetSize;
+		}
+
+		int RandomInt(int count)
+		{
+			return int((*this->random)() % uint64_t(count));
+		}
+
+		const CompiledGrammar* compiledGrammar;
+		CompiledGrammar* ownCompiledGrammar;		// Rules as written, unoptimized, so that the weights mean what they say.
+		const CharacterScanner* scanner;
+		std::mt19937_64* random;
+		std::vector<int>* ruleHeightArray;		// The fewest levels of rules it takes to get down to nothing but terminals.
+		std::vector<int>* sequenceHeightArray;
+		std::vector<int>* sequenceSizeArray;		// The fewest terminals it takes to finish an alternative.
+		std::vector<double>* sequenceWeightArray;
+		std::vector<Recursion>* sequenceRecursionArray;
+		std::vector<uint8_t>* sequenceGrowsArray;		// Can the alternative get as big as we like, by way of some list?
+		std::set<std::string>* reservedWordSet;		// Made-up identifiers can't be any of these.
+		std::string* codeText;
+		int terminalCount;
+		int lineLength;
+		bool breakLines;
+		const char* separator;
+	};
+}
\ No newline at end of file
@@ -1,24 +1,4 @@
 #include "SlowParseAlgorithm.h"
-#include <cstring>
-
-namespace ParseParty
-{
-	bool operator<(const SlowParseAlgorithm::ParseCacheKey& keyA, const SlowParseAlgorithm::ParseCacheKey& keyB)
-	{
-		if (keyA.ruleName == keyB.ruleName)
-		{
-			char bufA[128];
-			char bufB[128];
-
-			keyA.range.MakeKey(bufA, sizeof(bufA));
-			keyB.range.MakeKey(bufB, sizeof(bufB));
-
-			return ::strcmp(bufA, bufB) < 0;
-		}
-
-		return ::strcmp(keyA.ruleName.c_str(), keyB.ruleName.c_str()) < 0;
-	}
-}
 
 using namespace ParseParty;
 
@@ -38,7 +18,7 @@ SlowParseAlgorithm::SlowParseAlgorithm(const std::vector<std::shared_ptr<Lexer::
 
 void SlowParseAlgorithm::ClearCache()
 {
-	for (std::pair<ParseCacheKey, Parser::SyntaxNode*> pair : *this->parseCacheMap)
+	for (std::pair<const ParseCacheKey, Parser::SyntaxNode*>& pair : *this->parseCacheMap)
 		delete pair.second;
 
 	this->parseCacheMap->clear();
@@ -46,8 +26,8 @@ void SlowParseAlgorithm::ClearCache()
 
 /*virtual*/ Parser::SyntaxNode* SlowParseAlgorithm::Parse()
 {
-	const Grammar::Rule* rule = this->grammar->GetInitialRule();
-	if (!rule)
+	int ruleID = this->compiledGrammar->GetInitialRuleID();
+	if (ruleID < 0)
 		return nullptr;
 
 	this->ClearCache();
@@ -58,72 +38,78 @@ void SlowParseAlgorithm::ClearCache()
 
 	this->maxErrorLocation = Lexer::FileLocation{ 0, 0 };
 
-	return this->ParseRangeAgainstRule(range, rule);
+	return this->ParseRangeAgainstRule(range, ruleID);
 }
 
-Parser::SyntaxNode* SlowParseAlgorithm::ParseRangeAgainstRule(const Range& range, const Grammar::Rule* rule)
+Parser::SyntaxNode* SlowParseAlgorithm::ParseRangeAgainstRule(const Range& range, int ruleID)
 {
 	// The parse cache is purely an optimization, and should not be needed for correctness of the algorithm.
 	if (this->parseCacheMapEnabled)
 	{
-		ParseCacheKey key{ range, *rule->name };
+		ParseCacheKey key{ range, ruleID };
 		ParseCacheMap::iterator iter = this->parseCacheMap->find(key);
 		if (iter != this->parseCacheMap->end())
 		{
 			Parser::SyntaxNode* syntaxNode = iter->second;
-			this->parseCacheMap->erase(iter);
+			if (syntaxNode)
+				this->parseCacheMap->erase(iter);
+
 			return syntaxNode;
 		}
 	}
 
-	for (const Grammar::MatchSequence* matchSequence : *rule->matchSequenceArray)
+	const CompiledGrammar::Rule& rule = this->compiledGrammar->GetRule(ruleID);
+	for (int i = 0; i < rule.sequenceCount; i++)
 	{
-		Parser::SyntaxNode* syntaxNode = this->ParseRangeAgainstMatchSequence(range, matchSequence, *rule->name);
+		Parser::SyntaxNode* syntaxNode = this->ParseRangeAgainstMatchSequence(range, this->compiledGrammar->GetSequence(rule.firstSequence + i));
 		if (syntaxNode)
 			return syntaxNode;
 	}
 
+	// Without this, a rule failing over some range would fail all over again for every alternative sharing it,
+	// and for every alternative of theirs, and so on, which is exponential in how deep that goes.  Any error
+	// was already recorded the first time around, and would come out the same again.
+	if (this->parseCacheMapEnabled)
+		this->parseCacheMap->insert(std::pair<ParseCacheKey, Parser::SyntaxNode*>(ParseCacheKey{ range, ruleID }, nullptr));
+
 	return nullptr;
 }
 
-Parser::SyntaxNode* SlowParseAlgorithm::ParseRangeAgainstMatchSequence(const Range& range, const Grammar::MatchSequence* matchSequence, const std::string& ruleName)
+Parser::SyntaxNode* SlowParseAlgorithm::ParseRangeAgainstMatchSequence(const Range& range, const CompiledGrammar::Sequence& sequence)
 {
 	std::map<int, Range> subRangeMap;
-	if (!this->CalculateSubRangeMap(subRangeMap, range, matchSequence))
+	if (!this->CalculateSubRangeMap(subRangeMap, range, sequence))
 		return nullptr;
 
+	const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
 	Parser::SyntaxNode* parentNode = new Parser::SyntaxNode();
 	parentNode->fileLocation = (*this->tokenArray)[range.min]->fileLocation;
-	*parentNode->text = ruleName;
+	*parentNode->text = this->compiledGrammar->GetRuleName(sequence.ruleID);
 
-	for (int i = 0; i < (signed)matchSequence->tokenSequence->size(); i++)
+	for (int i = 0; i < sequence.symbolCount; i++)
 	{
-		const Grammar::Token* grammarToken = (*matchSequence->tokenSequence)[i];
+		const CompiledGrammar::Symbol& symbol = symbolArray[i];
 		
 		std::map<int, Range>::iterator iter = subRangeMap.find(i);
 		const Range& subRange = iter->second;
 
 		Parser::SyntaxNode* childNode = nullptr;
 
-		const Grammar::TerminalToken* terminalToken = dynamic_cast<const Grammar::TerminalToken*>(grammarToken);
-		if (terminalToken)
+		if (symbol.type == CompiledGrammar::Symbol::Type::TERMINAL)
 		{
 			Parser::SyntaxNode* dataNode = new Parser::SyntaxNode();
 			dataNode->fileLocation = (*this->tokenArray)[subRange.min]->fileLocation;
 			*dataNode->text = *(*this->tokenArray)[subRange.min]->text;
 			childNode = new Parser::SyntaxNode();
 			childNode->fileLocation = dataNode->fileLocation;
-			*childNode->text = *terminalToken->text;
+			*childNode->text = this->compiledGrammar->GetTerminalText(symbol.id);
 			childNode->childList->push_back(dataNode);
 			dataNode->parentNode = childNode;
 		}
-
-		const Grammar::NonTerminalToken* nonTerminalToken = dynamic_cast<const Grammar::NonTerminalToken*>(grammarToken);
-		if (nonTerminalToken)
+		else
 		{
-			const Grammar::Rule* rule = this->grammar->LookupRule(*nonTerminalToken->ruleName);
-			if (rule)
-				childNode = this->ParseRangeAgainstRule(subRange, rule);
+			childNode = this->ParseRangeAgainstRule(subRange, symbol.id);
 		}
 
 		if (!childNode)
@@ -133,7 +119,7 @@ Parser::SyntaxNode* SlowParseAlgorithm::ParseRangeAgainstMatchSequence(const Ran
 		childNode->parentNode = parentNode;
 	}
 
-	if (parentNode->childList->size() != matchSequence->tokenSequence->size())
+	if ((int)parentNode->childList->size() != sequence.symbolCount)
 	{
 		// I think this method of parse-error reporting will be accurate enough, provided that
 		// parsing generally happens from left to right.  There are some cases where it needs to
@@ -156,13 +142,11 @@ Parser::SyntaxNode* SlowParseAlgorithm::ParseRangeAgainstMatchSequence(const Ran
 			for (std::list<Parser::SyntaxNode*>::iterator iter = parentNode->childList->begin(); iter != parentNode->childList->end(); iter++)
 			{
 				Parser::SyntaxNode* childNode = *iter;
-				const Grammar::Token* grammarToken = (*matchSequence->tokenSequence)[i];
-				const Grammar::NonTerminalToken* nonTerminalToken = dynamic_cast<const Grammar::NonTerminalToken*>(grammarToken);
-				if (nonTerminalToken)
+				const CompiledGrammar::Symbol& symbol = symbolArray[i];
+				if (symbol.type == CompiledGrammar::Symbol::Type::NON_TERMINAL)
 				{
 					const Range& subRange = subRangeMap.find(i)->second;
-					const Grammar::Rule* rule = this->grammar->LookupRule(*nonTerminalToken->ruleName);
-					ParseCacheKey key{ subRange, *rule->name };
+					ParseCacheKey key{ subRange, symbol.id };
 					assert(this->parseCacheMap->find(key) == this->parseCacheMap->end());
 					this->parseCacheMap->insert(std::pair<ParseCacheKey, Parser::SyntaxNode*>(key, childNode));
 					*iter = nullptr;
@@ -180,28 +164,30 @@ Parser::SyntaxNode* SlowParseAlgorithm::ParseRangeAgainstMatchSequence(const Ran
 	return parentNode;
 }
 
-bool SlowParseAlgorithm::CalculateSubRangeMap(std::map<int, Range>& subRangeMap, const Range& range, const Grammar::MatchSequence* matchSequence)
+bool SlowParseAlgorithm::CalculateSubRangeMap(std::map<int, Range>& subRangeMap, const Range& range, const CompiledGrammar::Sequence& sequence)
 {
 	// Verify an assumption we're making here before we go bumbling forward.
-	if (matchSequence->HasTwoAdjacentNonTermainls())
+	if (sequence.hasAdjacentNonTerminals)
 		return false;
 
+	const CompiledGrammar::Symbol* symbolArray = this->compiledGrammar->GetSymbols(sequence);
+
 	int i_start = -1, i_stop = -1, i_delta = 0;
 	int tokenPosition = -1;
 
-	switch (matchSequence->type)
+	switch (sequence.type)
 	{
 		case Grammar::MatchSequence::Type::LEFT_TO_RIGHT:
 		{
 			i_start = 0;
-			i_stop = (int)matchSequence->tokenSequence->size();
+			i_stop = sequence.symbolCount;
 			i_delta = 1;
 			tokenPosition = range.min;
 			break;
 		}
 		case Grammar::MatchSequence::Type::RIGHT_TO_LEFT:
 		{
-			i_start = (int)matchSequence->tokenSequence->size() - 1;
+			i_start = sequence.symbolCount - 1;
 			i_stop = -1;
 			i_delta = -1;
 			tokenPosition = range.max;
@@ -212,18 +198,17 @@ bool SlowParseAlgorithm::CalculateSubRangeMap(std::map<int, Range>& subRangeMap,
 	int j = -1;
 	for (int i = i_start; i != i_stop; i += i_delta)
 	{
-		const Grammar::Token* grammarToken = (*matchSequence->tokenSequence)[i];
-		const Grammar::TerminalToken* terminalToken = dynamic_cast<const Grammar::TerminalToken*>(grammarToken);
-		if (!terminalToken)
+		const CompiledGrammar::Symbol& symbol = symbolArray[i];
+		if (symbol.type != CompiledGrammar::Symbol::Type::TERMINAL)
 			continue;
 
-		if (!this->ScanForTokenMatch(grammarToken, tokenPosition, i_delta, range))
+		if (!this->ScanForTokenMatch(symbol.id, tokenPosition, i_delta, range))
 			return false;
 
 		if (tokenPosition == j)
 		{
 			tokenPosition += i_delta;
-			if (!this->ScanForTokenMatch(grammarToken, tokenPosition, i_delta, range))
+			if (!this->ScanForTokenMatch(symbol.id, tokenPosition, i_delta, range))
 				return false;
 		}
 
@@ -232,11 +217,9 @@ bool SlowParseAlgorithm::CalculateSubRangeMap(std::map<int, Range>& subRangeMap,
 		j = tokenPosition;
 	}
 
-	for (int i = 0; i < (signed)matchSequence->tokenSequence->size(); i++)
+	for (int i = 0; i < sequence.symbolCount; i++)
 	{
-		const Grammar::Token* grammarToken = (*matchSequence->tokenSequence)[i];
-		const Grammar::NonTerminalToken* nonTerminalToken = dynamic_cast<const Grammar::NonTerminalToken*>(grammarToken);
-		if (!nonTerminalToken)
+		if (symbolArray[i].type != CompiledGrammar::Symbol::Type::NON_TERMINAL)
 			continue;
 
 		Range nonTerminalRange;
@@ -252,7 +235,7 @@ bool SlowParseAlgorithm::CalculateSubRangeMap(std::map<int, Range>& subRangeMap,
 			nonTerminalRange.min = iter->second.max + 1;
 		}
 
-		if (i == matchSequence->tokenSequence->size() - 1)
+		if (i == sequence.symbolCount - 1)
 			nonTerminalRange.max = range.max;
 		else
 		{
@@ -279,7 +262,7 @@ bool SlowParseAlgorithm::CalculateSubRangeMap(std::map<int, Range>& subRangeMap,
 	if (totalSize != range.Size())
 		return false;
 
-	for (int i = 0; i < (signed)matchSequence->tokenSequence->size() - 1; i++)
+	for (int i = 0; i < sequence.symbolCount - 1; i++)
 	{
 		std::map<int, Range>::iterator iterA = subRangeMap.find(i);
 		std::map<int, Range>::iterator iterB = subRangeMap.find(i + 1);
@@ -294,7 +277,7 @@ bool SlowParseAlgorithm::CalculateSubRangeMap(std::map<int, Range>& subRangeMap,
 	return true;
 }
 
-bool SlowParseAlgorithm::ScanForTokenMatch(const Grammar::Token* grammarToken, int& tokenPosition, int delta, const Range& range)
+bool SlowParseAlgorithm::ScanForTokenMatch(int terminalID, int& tokenPosition, int delta, const Range& range)
 {
 	int level = 0;
 
@@ -307,7 +290,7 @@ bool SlowParseAlgorithm::ScanForTokenMatch(const Grammar::Token* grammarToken, i
 
 		if (level == 0)
 		{
-			if (grammarToken->Matches(*token) == Grammar::Token::MatchResult::YES)
+			if (this->TokenMatches(tokenPosition, terminalID))
 				return true;
 		}
 
@@ -320,11 +303,6 @@ bool SlowParseAlgorithm::ScanForTokenMatch(const Grammar::Token* grammarToken, i
 	return false;
 }
 
-void SlowParseAlgorithm::Range::MakeKey(char* keyBuf, int keyBufSize) const
-{
-	sprintf(keyBuf, "%d-%d", this->min, this->max);
-}
-
 int SlowParseAlgorithm::Range::Size() const
 {
 	return this->max - this->min + 1;
@@ -343,4 +321,20 @@ bool SlowParseAlgorithm::Range::operator==(const Range& range) const
 bool SlowParseAlgorithm::Range::IsValid() const
 {
 	return this->min <= this->max;
+}
+
+bool SlowParseAlgorithm::ParseCacheKey::operator==(const ParseCacheKey& key) const
+{
+	return this->ruleID == key.ruleID && this->range == key.range;
+}
+
+// Token positions fit in 32 bits, so the range packs into one word, and then we mix in the rule ID and scramble it all
+// (as splitmix64 does), since the buckets are picked from the low bits, and ranges are mostly small and close together.
+size_t SlowParseAlgorithm::ParseCacheKey::Hash::operator()(const ParseCacheKey& key) const
+{
+	uint64_t hash = (uint64_t(uint32_t(key.range.min)) << 32) | uint32_t(key.range.max);
+	hash ^= uint64_t(uint32_t(key.ruleID)) * 0x9E3779B97F4A7C15ull;
+	hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+	hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+	return size_t(hash ^ (hash >> 31));
 }
\ No newline at end of file
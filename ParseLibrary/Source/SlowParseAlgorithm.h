@@ -25,7 +25,6 @@ namespace ParseParty
 			int min, max;
 
 			bool operator==(const Range& range) const;
-			void MakeKey(char* keyBuf, int keyBufSize) const;
 			int Size() const;
 			bool Contains(int i) const;
 			bool IsValid() const;
@@ -34,21 +33,28 @@ namespace ParseParty
 		struct ParseCacheKey
 		{
 			Range range;
-			std::string ruleName;
+			int ruleID;
+
+			bool operator==(const ParseCacheKey& key) const;
+
+			struct Hash
+			{
+				size_t operator()(const ParseCacheKey& key) const;
+			};
 		};
 
-		Parser::SyntaxNode* ParseRangeAgainstRule(const Range& range, const Grammar::Rule* rule);
-		Parser::SyntaxNode* ParseRangeAgainstMatchSequence(const Range& range, const Grammar::MatchSequence* matchSequence, const std::string& ruleName);
+		Parser::SyntaxNode* ParseRangeAgainstRule(const Range& range, int ruleID);
+		Parser::SyntaxNode* ParseRangeAgainstMatchSequence(const Range& range, const CompiledGrammar::Sequence& sequence);
 
-		bool ScanForTokenMatch(const Grammar::Token* grammarToken, int& tokenPosition, int delta, const Range& range);
-		bool CalculateSubRangeMap(std::map<int, Range>& subRangeMap, const Range& range, const Grammar::MatchSequence* matchSequence);
+		bool ScanForTokenMatch(int terminalID, int& tokenPosition, int delta, const Range& range);
+		bool CalculateSubRangeMap(std::map<int, Range>& subRangeMap, const Range& range, const CompiledGrammar::Sequence& sequence);
 		void ClearCache();
 
-		typedef std::map<ParseCacheKey, Parser::SyntaxNode*> ParseCacheMap;
+		// A successfully parsed node is kept here until something takes it, and then it's theirs.  A failure is kept as
+		// a null node for good, since whether a rule matches a range of tokens depends on nothing else.
+		typedef std::unordered_map<ParseCacheKey, Parser::SyntaxNode*, ParseCacheKey::Hash> ParseCacheMap;
 		ParseCacheMap* parseCacheMap;
 		bool parseCacheMapEnabled;
 		Lexer::FileLocation maxErrorLocation;
 	};
-
-	bool operator<(const SlowParseAlgorithm::ParseCacheKey& keyA, const SlowParseAlgorithm::ParseCacheKey& keyB);
 }
\ No newline at end of file
@@ -0,0 +1,673 @@
+#pragma once
+
+#include "Parser.h"
+
+// This lets a grammar that is fixed at build-time be written right in the source, rather than read from a
+// file at run-time.  Everything the Grammar class would work out when compiled (the rule table, the FIRST sets,
+// the dispatch tables) is instead worked out by the compiler, and the parser itself is a set of template
+// functions, one per rule, so the optimizer can see through rule boundaries.  There's nothing to load at startup.
+//
+// A grammar is a bunch of structs, one per rule, each deriving from Rule<>.  For example...
+//
+//		using namespace ParseParty::StaticGrammar;
+//
+//		struct JsonValue;
+//		struct JsonString : Rule<"json-string", Sequence<String>> {};
+//		struct JsonList : Rule<"json-list",
+//			Sequence<Literal<"[">, Literal<"]">>,
+//			Sequence<Literal<"[">, JsonValue, Literal<"]">>> {};
+//		struct JsonValue : Rule<"json-value",
+//			Sequence<JsonString>,
+//			Sequence<JsonList>,
+//			Sequence<Literal<"null">>> {};
+//
+//		Parser::SyntaxNode* rootNode = StaticParser<JsonValue>::Parse(lexer, codeText, &error);
+//
+// Rules can refer to rules that aren't defined yet, so long as they're declared.  The rules used are the
+// ones reachable from the initial rule.  Parsing is just like that done by code from the parser generator:
+// a rule tries those of its alternatives which could start with the next token, in order, and the first to
+// match wins.  So, like there, left recursion isn't supported, and you'll get a compile error if you try it.
+// The trees built are the same as those the library's algorithms build for the equivalent JSON grammar.
+
+namespace ParseParty
+{
+	namespace StaticGrammar
+	{
+		// This just lets a string literal be a template argument.
+		template<size_t N>
+		struct FixedString
+		{
+			constexpr FixedString(const char (&givenText)[N])
+			{
+				std::copy_n(givenText, N, this->text);
+			}
+
+			constexpr std::string_view View() const
+			{
+				return std::string_view(this->text, N - 1);
+			}
+
+			char text[N];
+		};
+
+		enum class TerminalClass
+		{
+			LITERAL,
+			STRING,
+			NUMBER,
+			INT,
+			FLOAT,
+			IDENTIFIER
+		};
+
+		// These are the classes other than LITERAL, and each gets a terminal ID after all the literals.
+		constexpr int terminalClassCount = 5;
+		constexpr int tokenTypeCount = int(Lexer::Token::Type::CLOSE_CURLY_BRACE) + 1;
+
+		constexpr bool TerminalClassMatches(TerminalClass terminalClass, Lexer::Token::Type tokenType)
+		{
+			switch (terminalClass)
+			{
+				case TerminalClass::STRING:
+					return tokenType == Lexer::Token::Type::STRING_LITERAL;
+				case TerminalClass::NUMBER:
+					return tokenType == Lexer::Token::Type::NUMBER_LITERAL_INT || tokenType == Lexer::Token::Type::NUMBER_LITERAL_FLOAT;
+				case TerminalClass::INT:
+					return tokenType == Lexer::Token::Type::NUMBER_LITERAL_INT;
+				case TerminalClass::FLOAT:
+					return tokenType == Lexer::Token::Type::NUMBER_LITERAL_FLOAT;
+				case TerminalClass::IDENTIFIER:
+					return tokenType == Lexer::Token::Type::IDENTIFIER;
+				default:
+					return false;
+			}
+		}
+
+		struct TerminalBase
+		{
+		};
+
+		struct RuleBase
+		{
+		};
+
+		template<FixedString Text>
+		struct Literal : public TerminalBase
+		{
+			static constexpr TerminalClass terminalClass = TerminalClass::LITERAL;
+			static constexpr std::string_view text = Text.View();
+		};
+
+		struct String : public TerminalBase { static constexpr TerminalClass terminalClass = TerminalClass::STRING; };
+		struct Number : public TerminalBase { static constexpr TerminalClass terminalClass = TerminalClass::NUMBER; };
+		struct Int : public TerminalBase { static constexpr TerminalClass terminalClass = TerminalClass::INT; };
+		struct Float : public TerminalBase { static constexpr TerminalClass terminalClass = TerminalClass::FLOAT; };
+		struct Identifier : public TerminalBase { static constexpr TerminalClass terminalClass = TerminalClass::IDENTIFIER; };
+
+		template<typename... Symbols>
+		struct Sequence
+		{
+			// This tells backtracking which children are rules ('N') and which are tokens ('T').
+			static constexpr char symbolKinds[] = { (std::is_base_of_v<RuleBase, Symbols> ? 'N' : 'T')..., '\0' };
+		};
+
+		template<FixedString Name, typename... Sequences>
+		struct Rule : public RuleBase
+		{
+			static_assert(sizeof...(Sequences) <= 64, "A rule can have at most 64 alternatives.");
+
+			static constexpr std::string_view name = Name.View();
+			using SequenceList = std::tuple<Sequences...>;
+		};
+
+		// All we need to tell two rules apart at compile-time is some address unique to each.
+		template<typename T>
+		struct RuleTag
+		{
+			static constexpr char tag = 0;
+		};
+
+		//------------------------------- Analysis -------------------------------
+
+		// This is the grammar, reachable from the given initial rule, boiled down to tables the way CompiledGrammar
+		// does it; but all at compile-time.  Constant expressions can't keep heap memory around, so everything here
+		// is built in vectors and then copied into arrays whose sizes we worked out by building them once before.
+		template<typename InitialRule>
+		class Analysis
+		{
+		public:
+			struct Symbol
+			{
+				enum class Type
+				{
+					RULE,
+					LITERAL,
+					CLASS
+				};
+
+				Type type;
+				int id;		// A rule ID, or a terminal ID once literals are resolved.
+				std::string_view text;
+			};
+
+			struct Description
+			{
+				std::vector<const void*> ruleTagArray;
+				std::vector<std::string_view> ruleNameArray;
+				std::vector<std::vector<std::vector<Symbol>>> ruleSequenceArray;
+				std::vector<std::string_view> literalArray;
+
+				constexpr int FindRule(const void* tag) const
+				{
+					for (int i = 0; i < (int)this->ruleTagArray.size(); i++)
+						if (this->ruleTagArray[i] == tag)
+							return i;
+
+					return -1;
+				}
+
+				constexpr int FindLiteral(std::string_view text) const
+				{
+					return int(std::lower_bound(this->literalArray.begin(), this->literalArray.end(), text) - this->literalArray.begin());
+				}
+			};
+
+			template<typename R>
+			static constexpr int VisitRule(Description& description)
+			{
+				int ruleID = description.FindRule(&RuleTag<R>::tag);
+				if (ruleID >= 0)
+					return ruleID;
+
+				ruleID = (int)description.ruleTagArray.size();
+				description.ruleTagArray.push_back(&RuleTag<R>::tag);
+				description.ruleNameArray.push_back(R::name);
+				description.ruleSequenceArray.push_back({});
+
+				[&]<typename... Sequences>(std::tuple<Sequences...>*)
+				{
+					(VisitSequence(description, ruleID, (Sequences*)nullptr), ...);
+				}((typename R::SequenceList*)nullptr);
+
+				return ruleID;
+			}
+
+			template<typename... Symbols>
+			static constexpr void VisitSequence(Description& description, int ruleID, Sequence<Symbols...>*)
+			{
+				std::vector<Symbol> symbolArray;
+				(symbolArray.push_back(VisitSymbol<Symbols>(description)), ...);
+				description.ruleSequenceArray[ruleID].push_back(symbolArray);
+			}
+
+			template<typename S>
+			static constexpr Symbol VisitSymbol(Description& description)
+			{
+				if constexpr (std::is_base_of_v<RuleBase, S>)
+					return Symbol{ Symbol::Type::RULE, VisitRule<S>(description), S::name };
+				else if constexpr (S::terminalClass == TerminalClass::LITERAL)
+				{
+					description.literalArray.push_back(S::text);
+					return Symbol{ Symbol::Type::LITERAL, -1, S::text };
+				}
+				else
+					return Symbol{ Symbol::Type::CLASS, int(S::terminalClass) - 1, {} };
+			}
+
+			static constexpr Description Describe()
+			{
+				Description description;
+				VisitRule<InitialRule>(description);
+
+				std::sort(description.literalArray.begin(), description.literalArray.end());
+				description.literalArray.erase(std::unique(description.literalArray.begin(), description.literalArray.end()), description.literalArray.end());
+
+				int literalCount = (int)description.literalArray.size();
+				for (std::vector<std::vector<Symbol>>& sequenceArray : description.ruleSequenceArray)
+				{
+					for (std::vector<Symbol>& symbolArray : sequenceArray)
+					{
+						for (Symbol& symbol : symbolArray)
+						{
+							if (symbol.type == Symbol::Type::LITERAL)
+								symbol.id = description.FindLiteral(symbol.text);
+							else if (symbol.type == Symbol::Type::CLASS)
+								symbol.id += literalCount;
+						}
+					}
+				}
+
+				return description;
+			}
+
+			static constexpr int ruleCount = (int)Describe().ruleTagArray.size();
+			static constexpr int literalCount = (int)Describe().literalArray.size();
+			static constexpr int terminalSetWordCount = (literalCount + terminalClassCount + 63) / 64;
+
+			template<typename R>
+			static constexpr int ruleID = Describe().FindRule(&RuleTag<R>::tag);
+
+			template<typename L>
+			static constexpr int literalID = Describe().FindLiteral(L::text);
+
+			// The candidate mask of a rule at some token is the nullable mask, OR'd with the mask for the token's
+			// literal (offset by one so that index zero is for tokens that aren't any literal), OR'd with that for
+			// its type.  Each bit is an alternative that could possibly match there.
+			struct Tables
+			{
+				std::array<const char*, ruleCount> ruleNameArray;
+				std::array<std::string_view, literalCount> literalArray;
+				std::array<uint64_t, ruleCount> nullableMaskArray;
+				std::array<uint64_t, ruleCount * (literalCount + 1)> literalMaskArray;
+				std::array<uint64_t, ruleCount * tokenTypeCount> typeMaskArray;
+				bool canBacktrack;
+			};
+
+			static constexpr Tables BuildTables()
+			{
+				Description description = Describe();
+				Tables tables{};
+
+				for (int i = 0; i < ruleCount; i++)
+					tables.ruleNameArray[i] = description.ruleNameArray[i].data();
+
+				for (int i = 0; i < literalCount; i++)
+					tables.literalArray[i] = description.literalArray[i];
+
+				// Same fixed-point iteration as CompiledGrammar does for its FIRST sets.
+				std::vector<bool> nullableArray(ruleCount, false);
+				std::vector<uint64_t> firstSetArray(ruleCount * terminalSetWordCount, 0);
+
+				auto AddSequenceFirst = [&](const std::vector<Symbol>& symbolArray, uint64_t* firstSet) -> bool
+				{
+					for (const Symbol& symbol : symbolArray)
+					{
+						if (symbol.type != Symbol::Type::RULE)
+						{
+							firstSet[symbol.id >> 6] |= uint64_t(1) << (symbol.id & 63);
+							return false;
+						}
+
+						for (int j = 0; j < terminalSetWordCount; j++)
+							firstSet[j] |= firstSetArray[symbol.id * terminalSetWordCount + j];
+
+						if (!nullableArray[symbol.id])
+							return false;
+					}
+
+					return true;
+				};
+
+				bool changed = true;
+				while (changed)
+				{
+					changed = false;
+					for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+					{
+						std::vector<uint64_t> firstSet(firstSetArray.begin() + ruleID * terminalSetWordCount, firstSetArray.begin() + (ruleID + 1) * terminalSetWordCount);
+						bool nullable = nullableArray[ruleID];
+
+						for (const std::vector<Symbol>& symbolArray : description.ruleSequenceArray[ruleID])
+							if (AddSequenceFirst(symbolArray, firstSet.data()))
+								nullable = true;
+
+						for (int j = 0; j < terminalSetWordCount; j++)
+						{
+							if (firstSet[j] != firstSetArray[ruleID * terminalSetWordCount + j])
+							{
+								firstSetArray[ruleID * terminalSetWordCount + j] = firstSet[j];
+								changed = true;
+							}
+						}
+
+						if (nullable != nullableArray[ruleID])
+						{
+							nullableArray[ruleID] = nullable;
+							changed = true;
+						}
+					}
+				}
+
+				for (int ruleID = 0; ruleID < ruleCount; ruleID++)
+				{
+					const std::vector<std::vector<Symbol>>& sequenceArray = description.ruleSequenceArray[ruleID];
+
+					// A rule that can start with itself would send the parser into infinite recursion.
+					// Throwing here isn't allowed in a constant expression, which is the point: it's a compile error.
+					std::vector<int> leadingRuleArray;
+					for (const std::vector<Symbol>& symbolArray : sequenceArray)
+					{
+						for (const Symbol& symbol : symbolArray)
+						{
+							if (symbol.type != Symbol::Type::RULE)
+								break;
+
+							leadingRuleArray.push_back(symbol.id);
+							if (!nullableArray[symbol.id])
+								break;
+						}
+					}
+
+					for (int i = 0; i < (int)leadingRuleArray.size(); i++)
+					{
+						if (leadingRuleArray[i] == ruleID)
+							throw "Left-recursive rules aren't supported by static grammars.";
+
+						for (const std::vector<Symbol>& symbolArray : description.ruleSequenceArray[leadingRuleArray[i]])
+						{
+							for (const Symbol& symbol : symbolArray)
+							{
+								if (symbol.type != Symbol::Type::RULE)
+									break;
+
+								if (std::find(leadingRuleArray.begin(), leadingRuleArray.end(), symbol.id) == leadingRuleArray.end())
+									leadingRuleArray.push_back(symbol.id);
+
+								if (!nullableArray[symbol.id])
+									break;
+							}
+						}
+					}
+
+					for (int i = 0; i < (int)sequenceArray.size(); i++)
+					{
+						uint64_t alternativeBit = uint64_t(1) << i;
+						std::vector<uint64_t> firstSet(terminalSetWordCount, 0);
+						if (AddSequenceFirst(sequenceArray[i], firstSet.data()))
+							tables.nullableMaskArray[ruleID] |= alternativeBit;
+
+						for (int terminalID = 0; terminalID < literalCount + terminalClassCount; terminalID++)
+						{
+							if ((firstSet[terminalID >> 6] & (uint64_t(1) << (terminalID & 63))) == 0)
+								continue;
+
+							if (terminalID < literalCount)
+								tables.literalMaskArray[ruleID * (literalCount + 1) + terminalID + 1] |= alternativeBit;
+							else
+							{
+								for (int tokenType = 0; tokenType < tokenTypeCount; tokenType++)
+									if (TerminalClassMatches(TerminalClass(terminalID - literalCount + 1), Lexer::Token::Type(tokenType)))
+										tables.typeMaskArray[ruleID * tokenTypeCount + tokenType] |= alternativeBit;
+							}
+						}
+					}
+
+					// If ever more than one alternative is a candidate, we might backtrack.
+					for (int i = 0; i <= literalCount; i++)
+						for (int tokenType = 0; tokenType < tokenTypeCount; tokenType++)
+							if (std::popcount(tables.nullableMaskArray[ruleID] | tables.literalMaskArray[ruleID * (literalCount + 1) + i] | tables.typeMaskArray[ruleID * tokenTypeCount + tokenType]) > 1)
+								tables.canBacktrack = true;
+				}
+
+				return tables;
+			}
+
+			static constexpr Tables tables = BuildTables();
+		};
+	}
+
+	//------------------------------- StaticParser -------------------------------
+
+	// The flags are the same as those a grammar file can have; see PARSE_PARTY_GRAMMAR_FLAG_*.
+	template<typename InitialRule, int Flags = 0>
+	class StaticParser
+	{
+	public:
+		static Parser::SyntaxNode* Parse(Lexer& lexer, const std::string& codeText, std::string* error = nullptr)
+		{
+			std::vector<std::shared_ptr<Lexer::Token>> tokenArray;
+			std::string lexerError;
+			if (!lexer.Tokenize(codeText, tokenArray, lexerError))
+			{
+				if (error)
+					*error = lexerError;
+
+				return nullptr;
+			}
+
+			return Parse(tokenArray, error);
+		}
+
+		static Parser::SyntaxNode* Parse(const std::vector<std::shared_ptr<Lexer::Token>>& tokenArray, std::string* error = nullptr)
+		{
+			if (tokenArray.size() == 0)
+				return nullptr;
+
+			ParseState state;
+			state.tokenArray = &tokenArray;
+			state.tokenCount = (int)tokenArray.size();
+			state.parsePosition = 0;
+			state.failPosition = -1;
+			state.failRuleID = -1;
+			state.literalArray.resize(tokenArray.size());
+			for (int i = 0; i < state.tokenCount; i++)
+				state.literalArray[i] = LookupLiteral(*tokenArray[i]);
+
+			Parser::SyntaxNode* rootNode = ParseRule<InitialRule>(state);
+			for (std::pair<const uint64_t, RuleNode*>& pair : state.memoMap)
+				delete pair.second;
+
+			if (rootNode && state.parsePosition < state.tokenCount)
+			{
+				delete rootNode;
+				rootNode = nullptr;
+
+				if (state.parsePosition >= state.failPosition)
+				{
+					const Lexer::FileLocation& fileLocation = tokenArray[state.parsePosition]->fileLocation;
+					if (error)
+						*error = FormatString("Failed to parse at line %d, column %d: expected end of input.", fileLocation.line, fileLocation.column);
+
+					return nullptr;
+				}
+			}
+
+			if (!rootNode)
+			{
+				const Lexer::FileLocation& fileLocation = GetLocation(state, state.failPosition);
+				if (error)
+					*error = FormatString("Failed to parse at line %d, column %d: unexpected %s while parsing \"%s\".", fileLocation.line, fileLocation.column, (state.failPosition < state.tokenCount) ? "token" : "end of input", tables.ruleNameArray[state.failRuleID]);
+
+				return nullptr;
+			}
+
+			Parser::ApplyGrammarFlags(rootNode, Flags);
+			return rootNode;
+		}
+
+	private:
+
+		using Analysis = StaticGrammar::Analysis<InitialRule>;
+
+		static constexpr const typename Analysis::Tables& tables = Analysis::tables;
+		static constexpr int literalCount = Analysis::literalCount;
+
+		// Like the generated parsers, we only bother memoizing if backtracking is possible at all.
+		static constexpr bool memoize = Analysis::tables.canBacktrack;
+
+		struct RuleNode : public Parser::SyntaxNode
+		{
+			RuleNode(int ruleID, const char* ruleName, const Lexer::FileLocation& fileLocation) : SyntaxNode(ruleName, fileLocation)
+			{
+				this->ruleID = ruleID;
+				this->endPosition = -1;
+			}
+
+			int ruleID;
+			int endPosition;
+		};
+
+		struct ParseState
+		{
+			const std::vector<std::shared_ptr<Lexer::Token>>* tokenArray;
+			std::vector<int> literalArray;
+			int tokenCount;
+			int parsePosition;
+			int failPosition;
+			int failRuleID;
+			std::unordered_map<uint64_t, RuleNode*> memoMap;		// Null for a rule that failed at a position, otherwise a match thrown away by backtracking.
+		};
+
+		static int LookupLiteral(const Lexer::Token& token)
+		{
+			if (token.type == Lexer::Token::Type::STRING_LITERAL)
+				return -1;
+
+			const std::string_view* literal = std::lower_bound(tables.literalArray.data(), tables.literalArray.data() + literalCount, std::string_view(*token.text));
+			if (literal != tables.literalArray.data() + literalCount && *literal == *token.text)
+				return int(literal - tables.literalArray.data());
+
+			return -1;
+		}
+
+		static const Lexer::FileLocation& GetLocation(const ParseState& state, int position)
+		{
+			return (*state.tokenArray)[(position < state.tokenCount) ? position : (state.tokenCount - 1)]->fileLocation;
+		}
+
+		static bool Fail(ParseState& state, int ruleID)
+		{
+			if (state.parsePosition >= state.failPosition)
+			{
+				state.failPosition = state.parsePosition;
+				state.failRuleID = ruleID;
+			}
+
+			return false;
+		}
+
+		static uint64_t MemoKey(int position, int ruleID)
+		{
+			return (uint64_t(position) << 32) | uint64_t(ruleID);
+		}
+
+		template<typename T>
+		static bool TokenIsTerminal(const ParseState& state)
+		{
+			if (state.parsePosition >= state.tokenCount)
+				return false;
+
+			if constexpr (T::terminalClass == StaticGrammar::TerminalClass::LITERAL)
+				return state.literalArray[state.parsePosition] == Analysis::template literalID<T>;
+			else
+				return StaticGrammar::TerminalClassMatches(T::terminalClass, (*state.tokenArray)[state.parsePosition]->type);
+		}
+
+		template<typename S>
+		static bool MatchSymbol(ParseState& state, Parser::SyntaxNode* parentNode, int ruleID)
+		{
+			Parser::SyntaxNode* childNode = nullptr;
+
+			if constexpr (std::is_base_of_v<StaticGrammar::RuleBase, S>)
+			{
+				childNode = ParseRule<S>(state);
+				if (!childNode)
+					return false;
+			}
+			else
+			{
+				if (!TokenIsTerminal<S>(state))
+					return Fail(state, ruleID);
+
+				const Lexer::Token* token = (*state.tokenArray)[state.parsePosition++].get();
+				childNode = new Parser::SyntaxNode(*token->text, token->fileLocation);
+			}
+
+			parentNode->childList->push_back(childNode);
+			childNode->parentNode = parentNode;
+			return true;
+		}
+
+		// Rather than delete the rules matched by a failed alternative, we keep them, since the
+		// next alternative is likely to want the same ones at the same places.
+		static void Backtrack(ParseState& state, Parser::SyntaxNode* node, int position, const char* symbolKinds)
+		{
+			for (Parser::SyntaxNode* childNode : *node->childList)
+			{
+				if (*symbolKinds++ == 'T')
+				{
+					delete childNode;
+					position++;
+					continue;
+				}
+
+				RuleNode* ruleNode = static_cast<RuleNode*>(childNode);
+				ruleNode->parentNode = nullptr;
+				RuleNode*& memoNode = state.memoMap[MemoKey(position, ruleNode->ruleID)];
+				delete memoNode;
+				memoNode = ruleNode;
+				position = ruleNode->endPosition;
+			}
+
+			node->childList->clear();
+		}
+
+		template<int RuleID, int I, typename... Symbols>
+		static bool MatchAlternative(ParseState& state, RuleNode* node, uint64_t candidateMask, int startPosition, StaticGrammar::Sequence<Symbols...>*)
+		{
+			if ((candidateMask & (uint64_t(1) << I)) == 0)
+				return false;
+
+			if ((MatchSymbol<Symbols>(state, node, RuleID) && ...))
+				return true;
+
+			if constexpr (memoize)
+				Backtrack(state, node, startPosition, StaticGrammar::Sequence<Symbols...>::symbolKinds);
+			else
+				node->WipeChildren();
+
+			state.parsePosition = startPosition;
+			return false;
+		}
+
+		template<typename R>
+		static Parser::SyntaxNode* ParseRule(ParseState& state)
+		{
+			constexpr int ruleID = Analysis::template ruleID<R>;
+			int startPosition = state.parsePosition;
+
+			if constexpr (memoize)
+			{
+				typename std::unordered_map<uint64_t, RuleNode*>::iterator iter = state.memoMap.find(MemoKey(startPosition, ruleID));
+				if (iter != state.memoMap.end())
+				{
+					RuleNode* ruleNode = iter->second;
+					if (ruleNode)
+					{
+						state.memoMap.erase(iter);
+						state.parsePosition = ruleNode->endPosition;
+					}
+
+					return ruleNode;
+				}
+			}
+
+			uint64_t candidateMask = tables.nullableMaskArray[ruleID];
+			if (startPosition < state.tokenCount)
+			{
+				candidateMask |= tables.literalMaskArray[ruleID * (literalCount + 1) + state.literalArray[startPosition] + 1];
+				candidateMask |= tables.typeMaskArray[ruleID * StaticGrammar::tokenTypeCount + int((*state.tokenArray)[startPosition]->type)];
+			}
+
+			RuleNode* node = new RuleNode(ruleID, tables.ruleNameArray[ruleID], GetLocation(state, startPosition));
+
+			bool matched = [&]<typename... Sequences, size_t... I>(std::tuple<Sequences...>*, std::index_sequence<I...>)
+			{
+				return (MatchAlternative<ruleID, I>(state, node, candidateMask, startPosition, (Sequences*)nullptr) || ...);
+			}((typename R::SequenceList*)nullptr, std::make_index_sequence<std::tuple_size_v<typename R::SequenceList>>());
+
+			if (matched)
+			{
+				node->endPosition = state.parsePosition;
+				return node;
+			}
+
+			delete node;
+			if constexpr (memoize)
+				state.memoMap[MemoKey(startPosition, ruleID)] = nullptr;
+
+			Fail(state, ruleID);
+			return nullptr;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include "ParserGenerator.h"
+#include <iostream>
+
+using namespace ParseParty;
+
+// Usage: ParsePartyGen <grammar file> <lexicon file> <class name> <output directory>
+// This writes <class name>.h and <class name>.cpp to the output directory.  Either file may be JSON or a bundle.
+int main(int argc, char** argv)
+{
+	if (argc != 5)
+	{
+		std::cerr << "Usage: ParsePartyGen <grammar file> <lexicon file> <class name> <output directory>" << std::endl;
+		return 1;
+	}
+
+	std::string error;
+
+	Grammar grammar;
+	if (!grammar.ReadFile(argv[1], error))
+	{
+		std::cerr << "Failed to read grammar file " << argv[1] << ": " << error << std::endl;
+		return 1;
+	}
+
+	Lexer lexer;
+	if (!lexer.ReadFile(argv[2], error))
+	{
+		std::cerr << "Failed to read lexicon file " << argv[2] << ": " << error << std::endl;
+		return 1;
+	}
+
+	ParserGenerator parserGenerator;
+	if (!parserGenerator.GenerateFiles(&grammar, &lexer, argv[3], argv[4], error))
+	{
+		std::cerr << "Failed to generate parser: " << error << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "GrammarLinter.h"
+#include <iostream>
+
+using namespace ParseParty;
+
+// Usage: ParsePartyLint <grammar file> [algorithm]
+// This prints what the linter finds, worst first.  The algorithm defaults to the grammar's own, and may be "all".
+// The exit code is 0 if nothing was found, 2 if something was, and 1 if the grammar couldn't be linted at all,
+// so that a build can be made to fail on a grammar that's gotten worse.
+int main(int argc, char** argv)
+{
+	if (argc != 2 && argc != 3)
+	{
+		std::cerr << "Usage: ParsePartyLint <grammar file> [algorithm]" << std::endl;
+		return 1;
+	}
+
+	std::string error;
+
+	Grammar grammar;
+	if (!grammar.ReadFile(argv[1], error))
+	{
+		std::cerr << "Failed to read grammar file " << argv[1] << ": " << error << std::endl;
+		return 1;
+	}
+
+	GrammarLinter grammarLinter;
+	if (argc == 3)
+		*grammarLinter.algorithmName = argv[2];
+
+	std::vector<GrammarLinter::Finding> findingArray;
+	if (!grammarLinter.Lint(&grammar, findingArray, error))
+	{
+		std::cerr << "Failed to lint grammar: " << error << std::endl;
+		return 1;
+	}
+
+	for (const GrammarLinter::Finding& finding : findingArray)
+	{
+		std::cout << GrammarLinter::GetCostName(finding.cost) << " (" << finding.algorithmName << ") " << GrammarLinter::GetKindName(finding.kind) << " in";
+		for (const std::string& ruleName : finding.ruleNameArray)
+			std::cout << " " << ruleName;
+
+		std::cout << std::endl << "\t" << finding.message << std::endl;
+	}
+
+	return (findingArray.size() > 0) ? 2 : 0;
+}
\ No newline at end of file
@@ -68,7 +68,7 @@ void Frame::OnGrammarFile(wxCommandEvent& event)
 	{
 		case ID_ReadGrammarFile:
 		{
-			wxFileDialog fileDialog(this, "Open Grammar File", wxEmptyString, wxEmptyString, "JSON file (*.json)|*.json", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+			wxFileDialog fileDialog(this, "Open Grammar File", wxEmptyString, wxEmptyString, "JSON file (*.json)|*.json|Bundle file (*.ppb)|*.ppb", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
 			if (wxID_OK == fileDialog.ShowModal())
 			{
 				wxBusyCursor busyCursor;
@@ -77,13 +77,19 @@ void Frame::OnGrammarFile(wxCommandEvent& event)
 				if (!wxGetApp().grammar.ReadFile((const char*)grammarFile.c_str(), error))
 					wxMessageBox("Failed to open grammar file: " + grammarFile + "\n\n" + wxString(error.c_str()), "Error!", wxICON_ERROR | wxOK, this);
 				else
-					wxMessageBox("Grammar file read!", "Success!", wxICON_INFORMATION | wxOK, this);
+				{
+					wxString message = "Grammar file read!";
+					if (*wxGetApp().grammar.algorithmName == "auto")
+						message += "\n\nUsing the \"" + wxString(wxGetApp().grammar.GetSelectedAlgorithmName().c_str()) + "\" algorithm.  " + wxString(wxGetApp().grammar.GetAlgorithmSelectionReason().c_str());
+
+					wxMessageBox(message, "Success!", wxICON_INFORMATION | wxOK, this);
+				}
 			}
 			break;
 		}
 		case ID_WriteGrammarFile:
 		{
-			wxFileDialog fileDialog(this, "Save Grammar File", wxEmptyString, wxEmptyString, "JSON file (*.json)|*.json", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+			wxFileDialog fileDialog(this, "Save Grammar File", wxEmptyString, wxEmptyString, "Bundle file (*.ppb)|*.ppb", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
 			if (wxID_OK == fileDialog.ShowModal())
 			{
 				wxBusyCursor busyCursor;
@@ -105,7 +111,7 @@ void Frame::OnLexiconFile(wxCommandEvent& event)
 	{
 		case ID_ReadLexiconFile:
 		{
-			wxFileDialog fileDialog(this, "Open Lexicon File", wxEmptyString, wxEmptyString, "JSON file (*.json)|*.json", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+			wxFileDialog fileDialog(this, "Open Lexicon File", wxEmptyString, wxEmptyString, "JSON file (*.json)|*.json|Bundle file (*.ppb)|*.ppb", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
 			if (wxID_OK == fileDialog.ShowModal())
 			{
 				wxBusyCursor busyCursor;
@@ -120,7 +126,7 @@ void Frame::OnLexiconFile(wxCommandEvent& event)
 		}
 		case ID_WriteLexiconFile:
 		{
-			wxFileDialog fileDialog(this, "Save Lexicon File", wxEmptyString, wxEmptyString, "JSON file (*.json)|*.json", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+			wxFileDialog fileDialog(this, "Save Lexicon File", wxEmptyString, wxEmptyString, "Bundle file (*.ppb)|*.ppb", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
 			if (wxID_OK == fileDialog.ShowModal())
 			{
 				wxBusyCursor busyCursor;
@@ -246,7 +252,7 @@ void Frame::OnUpdateUI(wxUpdateUIEvent& event)
 	{
 		case ID_ParseFile:
 		{
-			event.Enable(wxGetApp().grammar.ruleMap->size() > 0);
+			event.Enable(wxGetApp().grammar.GetCompiledGrammar()->GetRuleCount() > 0);
 			break;
 		}
 		case ID_WriteSyntaxTreeFile: